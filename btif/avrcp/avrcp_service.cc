@@ -205,6 +205,22 @@ class MediaInterfaceWrapper : public MediaInterface {
                                bound_cb));
   }
 
+  void GetFolderItemsRange(uint16_t player_id, std::string media_id,
+                           uint32_t start, uint32_t end,
+                           FolderItemsRangeCallback folder_cb) override {
+    auto cb_lambda = [](FolderItemsRangeCallback cb, uint32_t num_items,
+                        std::vector<ListItem> item_list) {
+      do_in_main_thread(FROM_HERE,
+                        base::Bind(cb, num_items, std::move(item_list)));
+    };
+
+    auto bound_cb = base::Bind(cb_lambda, folder_cb);
+
+    do_in_avrcp_jni(base::Bind(&MediaInterface::GetFolderItemsRange,
+                               base::Unretained(wrapped_), player_id, media_id,
+                               start, end, bound_cb));
+  }
+
   void SetBrowsedPlayer(uint16_t player_id,
                         SetBrowsedPlayerCallback browse_cb) override {
     auto cb_lambda = [](SetBrowsedPlayerCallback cb, bool success,
@@ -0,0 +1,155 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BTIF_A2DP_SINK_JITTER_BUFFER_H
+#define BTIF_A2DP_SINK_JITTER_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "bt_types.h"
+
+//
+// Jitter buffer of the A2DP Sink.
+//
+// Received media packets are held until their playout time, and decoded in
+// media timestamp order. The playout is paced by the local clock: every
+// Tick() writes the PCM due since the previous one. Packets arriving after
+// their playout time are dropped, and missing media is concealed with
+// silence. The difference between the source clock and the local clock is
+// compensated by removing or inserting single PCM frames, to keep the
+// buffered media at the target latency.
+//
+class BtifA2dpSinkJitterBuffer {
+ public:
+  struct Config {
+    // Sample rate of the media timestamps and of the decoded PCM.
+    uint32_t sample_rate;
+    // Size of a decoded PCM frame (one sample of each channel), in octets.
+    size_t frame_size;
+    // Latency the buffered media is kept at.
+    uint32_t target_latency_ms;
+    // Buffered media beyond this latency is dropped.
+    uint32_t max_latency_ms;
+  };
+
+  struct Stats {
+    size_t packets_received;
+    size_t packets_decoded;
+    size_t packets_late;        // Arrived after their playout time
+    size_t packets_overflowed;  // Dropped above the maximum latency
+    size_t underruns;
+    uint64_t frames_played;
+    uint64_t frames_concealed;
+    uint64_t frames_inserted;
+    uint64_t frames_removed;
+    uint32_t fill_ms;          // Buffered media
+    uint32_t fill_average_ms;  // Buffered media, smoothed
+    uint32_t fill_max_ms;
+    int32_t drift_ppm;  // Estimated source clock drift
+    // Time from the reception of a packet to the playout of its media.
+    uint32_t latency_last_ms;
+    uint32_t latency_average_ms;
+    uint32_t latency_max_ms;
+  };
+
+  // Decodes |p_pkt|. The decoded PCM is passed back with AddPcm() before it
+  // returns.
+  using DecodeCallback = std::function<bool(BT_HDR* p_pkt)>;
+  // Plays |len| octets of PCM.
+  using WriteCallback = std::function<void(const uint8_t* p_data, size_t len)>;
+
+  BtifA2dpSinkJitterBuffer(const Config& config, DecodeCallback decode,
+                           WriteCallback write);
+  ~BtifA2dpSinkJitterBuffer();
+
+  const Config& config() const { return config_; }
+
+  // Buffers |p_pkt|, with the AVDTP media |timestamp| and its reception time
+  // |arrival_us|. Takes the ownership of |p_pkt|.
+  void Enqueue(BT_HDR* p_pkt, uint32_t timestamp, uint64_t arrival_us);
+
+  // Adds the PCM decoded from the packet being decoded.
+  void AddPcm(const uint8_t* p_data, size_t len);
+
+  // Decodes the packets due and writes the PCM due at |now_us|.
+  void Tick(uint64_t now_us);
+
+  // Drops the buffered media, and waits for the target latency to be
+  // buffered again before resuming the playout. The statistics are kept.
+  void Flush();
+
+  Stats GetStats() const;
+
+ private:
+  struct Packet {
+    BT_HDR* p_pkt;
+    int64_t timestamp;
+    uint64_t arrival_us;
+  };
+
+  int64_t UnwrapTimestamp(uint32_t timestamp);
+  int64_t BufferedFrames() const;
+  bool DecodeNext();
+  size_t WriteFrames(size_t frames_due);
+  void UpdateDriftCompensation(uint64_t elapsed_us);
+
+  Config config_;
+  DecodeCallback decode_;
+  WriteCallback write_;
+
+  // Buffered packets, in media timestamp order.
+  std::deque<Packet> packets_;
+  bool have_timestamp_;
+  int64_t newest_timestamp_;
+  // Media frames of the newest decoded packet, to estimate the end of the
+  // buffered media.
+  int64_t packet_frames_;
+
+  // Playing, as opposed to buffering up to the target latency.
+  bool playing_;
+  // The playout started since the last flush: |play_timestamp_| is valid.
+  bool started_;
+  // Media timestamp of the first frame not yet decoded or concealed.
+  int64_t play_timestamp_;
+  uint64_t now_us_;
+  uint64_t last_tick_us_;
+  // Fraction of a frame due, in units of 1 / 1000000 frame.
+  uint64_t frames_due_remainder_;
+
+  // Decoded PCM not played yet, from |pcm_start_|.
+  std::vector<uint8_t> pcm_;
+  size_t pcm_start_;
+  std::vector<uint8_t> output_;
+
+  // Frames removed (positive) or inserted (negative) per million played, and
+  // the progress to the next one, in units of 1 / 1000000 frame.
+  int32_t correction_ppm_;
+  int64_t correction_remainder_;
+  double fill_average_frames_;
+  double drift_ppm_;
+
+  Stats stats_;
+  uint64_t latency_total_ms_;
+};
+
+#endif  // BTIF_A2DP_SINK_JITTER_BUFFER_H
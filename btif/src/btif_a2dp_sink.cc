@@ -22,6 +22,7 @@
 #include <atomic>
 #include <cstdio>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -30,14 +31,17 @@
 #include "bt_common.h"
 #include "btif_a2dp.h"
 #include "btif_a2dp_sink.h"
+#include "btif_a2dp_sink_jitter_buffer.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
 #include "btif_avrcp_audio_track.h"
 #include "btif_util.h"
 #include "common/message_loop_thread.h"
+#include "common/time_util.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 
 using bluetooth::common::MessageLoopThread;
 using LockGuard = std::lock_guard<std::mutex>;
@@ -52,6 +56,10 @@ using LockGuard = std::lock_guard<std::mutex>;
 /* In case of A2DP Sink, we will delay start by 5 AVDTP Packets */
 #define MAX_A2DP_DELAYED_START_FRAME_COUNT 5
 
+/* Latency of the jitter buffer, unless set with the property below */
+#define BTIF_A2DP_SINK_DEFAULT_LATENCY_MS 150
+#define BTIF_A2DP_SINK_LATENCY_PROPERTY "persist.bluetooth.a2dp_sink.latency_ms"
+
 enum {
   BTIF_A2DP_SINK_STATE_OFF,
   BTIF_A2DP_SINK_STATE_STARTING_UP,
@@ -77,6 +85,12 @@ typedef struct {
   btif_a2dp_sink_focus_state_t focus_state;
 } tBTIF_MEDIA_SINK_FOCUS_UPDATE;
 
+/* Reception information, in front of the payload of the received packets */
+typedef struct {
+  uint32_t timestamp; /* AVDTP media timestamp */
+  uint64_t arrival_us;
+} tBTIF_MEDIA_SINK_RX_INFO;
+
 /* BTIF A2DP Sink control block */
 class BtifA2dpSinkControlBlock {
  public:
@@ -106,6 +120,7 @@ class BtifA2dpSinkControlBlock {
     sample_rate = 0;
     channel_count = 0;
     decoder_interface = nullptr;
+    jitter_buffer.reset();
   }
 
   MessageLoopThread worker_thread;
@@ -118,6 +133,7 @@ class BtifA2dpSinkControlBlock {
   btif_a2dp_sink_focus_state_t rx_focus_state; /* audio focus state */
   void* audio_track;
   const tA2DP_DECODER_INTERFACE* decoder_interface;
+  std::unique_ptr<BtifA2dpSinkJitterBuffer> jitter_buffer;
 };
 
 // Mutex for below data structures.
@@ -141,7 +157,7 @@ static void btif_a2dp_sink_audio_handle_start_decoding();
 static void btif_a2dp_sink_avk_handle_timer();
 static void btif_a2dp_sink_audio_rx_flush_req();
 /* Handle incoming media packets A2DP SINK streaming */
-static void btif_a2dp_sink_handle_inc_media(BT_HDR* p_msg);
+static bool btif_a2dp_sink_handle_inc_media(BT_HDR* p_msg);
 static void btif_a2dp_sink_decoder_update_event(
     tBTIF_MEDIA_SINK_DECODER_UPDATE* p_buf);
 static void btif_a2dp_sink_clear_track_event();
@@ -325,6 +341,7 @@ static void btif_a2dp_sink_cleanup_delayed() {
 
   fixed_queue_free(btif_a2dp_sink_cb.rx_audio_queue, nullptr);
   btif_a2dp_sink_cb.rx_audio_queue = nullptr;
+  btif_a2dp_sink_cb.jitter_buffer.reset();
   btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
 }
 
@@ -416,6 +433,9 @@ static void btif_a2dp_sink_audio_handle_stop_decoding() {
     LockGuard lock(g_mutex);
     btif_a2dp_sink_cb.rx_flush = true;
     btif_a2dp_sink_audio_rx_flush_req();
+    // The stream may restart with other media timestamps.
+    if (btif_a2dp_sink_cb.jitter_buffer != nullptr)
+      btif_a2dp_sink_cb.jitter_buffer->Flush();
     old_alarm = btif_a2dp_sink_cb.decode_alarm;
     btif_a2dp_sink_cb.decode_alarm = nullptr;
   }
@@ -470,36 +490,36 @@ static void btif_a2dp_sink_audio_handle_start_decoding() {
             btif_decode_alarm_cb, nullptr);
 }
 
+// Called while locked, from the decoding of a packet by the jitter buffer.
 static void btif_a2dp_sink_on_decode_complete(uint8_t* data, uint32_t len) {
+  if (btif_a2dp_sink_cb.jitter_buffer == nullptr) return;
+  btif_a2dp_sink_cb.jitter_buffer->AddPcm(data, len);
+}
+
+// Must be called while locked.
+static void btif_a2dp_sink_write_audio_track(const uint8_t* data, size_t len) {
 #ifndef OS_GENERIC
   BtifAvrcpAudioTrackWriteData(btif_a2dp_sink_cb.audio_track,
-                               reinterpret_cast<void*>(data), len);
+                               const_cast<uint8_t*>(data), len);
 #endif
 }
 
 // Must be called while locked.
-static void btif_a2dp_sink_handle_inc_media(BT_HDR* p_msg) {
+static bool btif_a2dp_sink_handle_inc_media(BT_HDR* p_msg) {
   if ((btif_av_get_peer_sep() == AVDT_TSEP_SNK) ||
       (btif_a2dp_sink_cb.rx_flush)) {
     APPL_TRACE_DEBUG("%s: state changed happened in this tick", __func__);
-    return;
+    return false;
   }
 
   CHECK(btif_a2dp_sink_cb.decoder_interface != nullptr);
-  if (!btif_a2dp_sink_cb.decoder_interface->decode_packet(p_msg)) {
-    LOG_ERROR(LOG_TAG, "%s: decoding failed", __func__);
-  }
+  return btif_a2dp_sink_cb.decoder_interface->decode_packet(p_msg);
 }
 
 static void btif_a2dp_sink_avk_handle_timer() {
   LockGuard lock(g_mutex);
 
   BT_HDR* p_msg;
-  if (fixed_queue_is_empty(btif_a2dp_sink_cb.rx_audio_queue)) {
-    APPL_TRACE_DEBUG("%s: empty queue", __func__);
-    return;
-  }
-
   /* Don't do anything in case of focus not granted */
   if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_NOT_GRANTED) {
     APPL_TRACE_DEBUG("%s: skipping frames since focus is not present",
@@ -508,6 +528,13 @@ static void btif_a2dp_sink_avk_handle_timer() {
   }
   /* Play only in BTIF_A2DP_SINK_FOCUS_GRANTED case */
   if (btif_a2dp_sink_cb.rx_flush) {
+    fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+    if (btif_a2dp_sink_cb.jitter_buffer != nullptr)
+      btif_a2dp_sink_cb.jitter_buffer->Flush();
+    return;
+  }
+  if (btif_a2dp_sink_cb.jitter_buffer == nullptr) {
+    APPL_TRACE_DEBUG("%s: no decoder, dropping frames", __func__);
     fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
     return;
   }
@@ -521,10 +548,15 @@ static void btif_a2dp_sink_avk_handle_timer() {
     APPL_TRACE_DEBUG("%s: number of packets in queue %zu", __func__,
                      fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue));
 
-    /* Queue packet has less frames */
-    btif_a2dp_sink_handle_inc_media(p_msg);
-    osi_free(p_msg);
+    tBTIF_MEDIA_SINK_RX_INFO info;
+    memcpy(&info, p_msg->data, sizeof(info));
+    btif_a2dp_sink_cb.jitter_buffer->Enqueue(p_msg, info.timestamp,
+                                             info.arrival_us);
   }
+  // The playout goes on while no packets arrive: the jitter buffer conceals
+  // the missing media.
+  btif_a2dp_sink_cb.jitter_buffer->Tick(
+      bluetooth::common::time_get_os_boottime_us());
   APPL_TRACE_DEBUG("%s: process frames end", __func__);
 }
 
@@ -541,6 +573,8 @@ static void btif_a2dp_sink_audio_rx_flush_event() {
   LockGuard lock(g_mutex);
   // Flush all received encoded audio buffers
   fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+  if (btif_a2dp_sink_cb.jitter_buffer != nullptr)
+    btif_a2dp_sink_cb.jitter_buffer->Flush();
 }
 
 static void btif_a2dp_sink_decoder_update_event(
@@ -579,6 +613,7 @@ static void btif_a2dp_sink_decoder_update_event(
   btif_a2dp_sink_cb.rx_flush = false;
   APPL_TRACE_DEBUG("%s: reset to Sink role", __func__);
 
+  btif_a2dp_sink_cb.jitter_buffer.reset();
   btif_a2dp_sink_cb.decoder_interface = bta_av_co_get_decoder_interface();
   if (btif_a2dp_sink_cb.decoder_interface == nullptr) {
     LOG_ERROR(LOG_TAG, "%s: cannot stream audio: no source decoder interface",
@@ -592,6 +627,19 @@ static void btif_a2dp_sink_decoder_update_event(
     return;
   }
 
+  // The media timestamps count the samples of the media.
+  BtifA2dpSinkJitterBuffer::Config config;
+  config.sample_rate = sample_rate;
+  config.frame_size = channel_count * bits_per_sample / 8;
+  config.target_latency_ms = osi_property_get_int32(
+      BTIF_A2DP_SINK_LATENCY_PROPERTY, BTIF_A2DP_SINK_DEFAULT_LATENCY_MS);
+  config.max_latency_ms = 3 * config.target_latency_ms;
+  LOG_INFO(LOG_TAG, "%s: jitter buffer latency %u ms", __func__,
+           config.target_latency_ms);
+  btif_a2dp_sink_cb.jitter_buffer.reset(new BtifA2dpSinkJitterBuffer(
+      config, btif_a2dp_sink_handle_inc_media,
+      btif_a2dp_sink_write_audio_track));
+
   APPL_TRACE_DEBUG("%s: create audio track", __func__);
   btif_a2dp_sink_cb.audio_track =
 #ifndef OS_GENERIC
@@ -618,12 +666,17 @@ uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
   }
 
   BTIF_TRACE_VERBOSE("%s +", __func__);
-  /* Allocate and queue this buffer */
-  BT_HDR* p_msg =
-      reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(*p_msg) + p_pkt->len));
+  /* Allocate and queue this buffer, with its reception information */
+  tBTIF_MEDIA_SINK_RX_INFO info;
+  info.timestamp = *((uint32_t*)(p_pkt + 1));
+  info.arrival_us = bluetooth::common::time_get_os_boottime_us();
+  BT_HDR* p_msg = reinterpret_cast<BT_HDR*>(
+      osi_malloc(sizeof(*p_msg) + sizeof(info) + p_pkt->len));
   memcpy(p_msg, p_pkt, sizeof(*p_msg));
-  p_msg->offset = 0;
-  memcpy(p_msg->data, p_pkt->data + p_pkt->offset, p_pkt->len);
+  p_msg->offset = sizeof(info);
+  memcpy(p_msg->data, &info, sizeof(info));
+  memcpy(p_msg->data + p_msg->offset, p_pkt->data + p_pkt->offset,
+         p_pkt->len);
   fixed_queue_enqueue(btif_a2dp_sink_cb.rx_audio_queue, p_msg);
   if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
       MAX_A2DP_DELAYED_START_FRAME_COUNT) {
@@ -647,8 +700,51 @@ void btif_a2dp_sink_audio_rx_flush_req() {
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 }
 
-void btif_a2dp_sink_debug_dump(UNUSED_ATTR int fd) {
-  // Nothing to do
+void btif_a2dp_sink_debug_dump(int fd) {
+  LockGuard lock(g_mutex);
+
+  dprintf(fd, "\nA2DP Sink State:\n");
+  if (btif_a2dp_sink_cb.jitter_buffer == nullptr) {
+    dprintf(fd, "  No decoder\n");
+    return;
+  }
+  const BtifA2dpSinkJitterBuffer::Config& config =
+      btif_a2dp_sink_cb.jitter_buffer->config();
+  BtifA2dpSinkJitterBuffer::Stats stats =
+      btif_a2dp_sink_cb.jitter_buffer->GetStats();
+
+  dprintf(fd, "  Jitter buffer:\n");
+  dprintf(fd,
+          "  Latency in ms (target/max)                              : %u / "
+          "%u\n",
+          config.target_latency_ms, config.max_latency_ms);
+  dprintf(fd,
+          "  Packets (received/decoded/late/overflowed)              : %zu / "
+          "%zu / %zu / %zu\n",
+          stats.packets_received, stats.packets_decoded, stats.packets_late,
+          stats.packets_overflowed);
+  dprintf(fd,
+          "  Frames (played/concealed/inserted/removed)              : %llu / "
+          "%llu / %llu / %llu\n",
+          (unsigned long long)stats.frames_played,
+          (unsigned long long)stats.frames_concealed,
+          (unsigned long long)stats.frames_inserted,
+          (unsigned long long)stats.frames_removed);
+  dprintf(fd,
+          "  Underruns                                               : %zu\n",
+          stats.underruns);
+  dprintf(fd,
+          "  Fill level in ms (last/ave/max)                         : %u / "
+          "%u / %u\n",
+          stats.fill_ms, stats.fill_average_ms, stats.fill_max_ms);
+  dprintf(fd,
+          "  Packet latency in ms (last/ave/max)                     : %u / "
+          "%u / %u\n",
+          stats.latency_last_ms, stats.latency_average_ms,
+          stats.latency_max_ms);
+  dprintf(fd,
+          "  Estimated source clock drift in ppm                     : %d\n",
+          stats.drift_ppm);
 }
 
 void btif_a2dp_sink_set_focus_state_req(btif_a2dp_sink_focus_state_t state) {
@@ -671,6 +767,8 @@ static void btif_a2dp_sink_set_focus_state_event(
   btif_a2dp_sink_cb.rx_focus_state = state;
   if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_NOT_GRANTED) {
     fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+    if (btif_a2dp_sink_cb.jitter_buffer != nullptr)
+      btif_a2dp_sink_cb.jitter_buffer->Flush();
     btif_a2dp_sink_cb.rx_flush = true;
   } else if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_GRANTED) {
     btif_a2dp_sink_cb.rx_flush = false;
@@ -0,0 +1,323 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btif_a2dp_sink_jitter_buffer"
+
+#include "btif_a2dp_sink_jitter_buffer.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <utility>
+
+#include <base/logging.h>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+
+namespace {
+
+// Time constant of the smoothing of the buffered media level.
+constexpr double kFillAverageTimeUs = 2000000;
+
+// Gains of the drift compensation: the frames removed per million played
+// for each millisecond of buffered media above the target, and their
+// increase per second the error lasts. The integral term converges to the
+// drift between the source clock and the local clock. The gains are low
+// enough for the correction to follow the drift rather than the jitter.
+constexpr double kProportionalPpmPerMs = 20;
+constexpr double kIntegralPpmPerMsSecond = 0.1;
+constexpr double kMaxCorrectionPpm = 1000;
+
+// Playout due after a stall of the ticks is capped to this.
+constexpr uint64_t kMaxTickUs = 200000;
+
+}  // namespace
+
+BtifA2dpSinkJitterBuffer::BtifA2dpSinkJitterBuffer(const Config& config,
+                                                   DecodeCallback decode,
+                                                   WriteCallback write)
+    : config_(config),
+      decode_(std::move(decode)),
+      write_(std::move(write)),
+      have_timestamp_(false),
+      newest_timestamp_(0),
+      packet_frames_(0),
+      playing_(false),
+      started_(false),
+      play_timestamp_(0),
+      now_us_(0),
+      last_tick_us_(0),
+      frames_due_remainder_(0),
+      pcm_start_(0),
+      correction_ppm_(0),
+      correction_remainder_(0),
+      fill_average_frames_(0),
+      drift_ppm_(0),
+      latency_total_ms_(0) {
+  CHECK(config_.sample_rate > 0 && config_.frame_size > 0);
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+BtifA2dpSinkJitterBuffer::~BtifA2dpSinkJitterBuffer() {
+  for (Packet& packet : packets_) osi_free(packet.p_pkt);
+}
+
+int64_t BtifA2dpSinkJitterBuffer::UnwrapTimestamp(uint32_t timestamp) {
+  if (!have_timestamp_) {
+    have_timestamp_ = true;
+    newest_timestamp_ = timestamp;
+    return timestamp;
+  }
+  // The 32 bit timestamps wrap around: take the closest to the newest one.
+  int32_t delta = (int32_t)(timestamp - (uint32_t)newest_timestamp_);
+  return newest_timestamp_ + delta;
+}
+
+void BtifA2dpSinkJitterBuffer::Enqueue(BT_HDR* p_pkt, uint32_t timestamp,
+                                       uint64_t arrival_us) {
+  stats_.packets_received++;
+  int64_t unwrapped = UnwrapTimestamp(timestamp);
+
+  if (started_ && unwrapped < play_timestamp_) {
+    LOG_VERBOSE(LOG_TAG, "%s: late packet, timestamp %u", __func__, timestamp);
+    stats_.packets_late++;
+    osi_free(p_pkt);
+    return;
+  }
+
+  // The packets mostly arrive in order: look for their place from the end.
+  auto it = packets_.end();
+  while (it != packets_.begin() && std::prev(it)->timestamp > unwrapped) it--;
+  if (it != packets_.begin() && std::prev(it)->timestamp == unwrapped) {
+    // A retransmission of a packet already buffered
+    stats_.packets_late++;
+    osi_free(p_pkt);
+    return;
+  }
+  packets_.insert(it, {p_pkt, unwrapped, arrival_us});
+  newest_timestamp_ = std::max(newest_timestamp_, unwrapped);
+  // Until a packet is decoded, estimate its media frames from the timestamps.
+  if (packet_frames_ == 0 && packets_.size() > 1) {
+    packet_frames_ = (newest_timestamp_ - packets_.front().timestamp) /
+                     (packets_.size() - 1);
+  }
+
+  // Drop the oldest media above the maximum latency, as when the playout
+  // stopped while the source kept streaming.
+  int64_t max_frames =
+      (int64_t)config_.max_latency_ms * config_.sample_rate / 1000;
+  while (packets_.size() > 1 &&
+         newest_timestamp_ + packet_frames_ - packets_.front().timestamp >
+             max_frames) {
+    osi_free(packets_.front().p_pkt);
+    packets_.pop_front();
+    stats_.packets_overflowed++;
+    // Skip the dropped media rather than concealing it.
+    if (started_)
+      play_timestamp_ = std::max(play_timestamp_, packets_.front().timestamp);
+  }
+}
+
+void BtifA2dpSinkJitterBuffer::AddPcm(const uint8_t* p_data, size_t len) {
+  pcm_.insert(pcm_.end(), p_data, p_data + len);
+}
+
+int64_t BtifA2dpSinkJitterBuffer::BufferedFrames() const {
+  int64_t frames = (pcm_.size() - pcm_start_) / config_.frame_size;
+  if (!packets_.empty()) {
+    int64_t start = playing_ ? play_timestamp_ : packets_.front().timestamp;
+    frames += newest_timestamp_ + packet_frames_ - start;
+  }
+  return frames;
+}
+
+// Decodes the next packet, or conceals the media missing before it.
+// Returns false if there is nothing to play.
+bool BtifA2dpSinkJitterBuffer::DecodeNext() {
+  if (packets_.empty()) return false;
+  Packet packet = packets_.front();
+
+  // Called once the decoded PCM is played: reuse its buffer.
+  pcm_.clear();
+  pcm_start_ = 0;
+
+  if (packet.timestamp > play_timestamp_) {
+    int64_t gap = packet.timestamp - play_timestamp_;
+    if (gap * 1000 > (int64_t)config_.max_latency_ms * config_.sample_rate) {
+      // Not a lost packet: the source restarted its timestamps.
+      LOG_WARN(LOG_TAG, "%s: media timestamp jump of %lld frames", __func__,
+               (long long)gap);
+    } else {
+      LOG_VERBOSE(LOG_TAG, "%s: concealing %lld frames", __func__,
+                  (long long)gap);
+      pcm_.resize(pcm_.size() + gap * config_.frame_size, 0);
+      stats_.frames_concealed += gap;
+    }
+    play_timestamp_ = packet.timestamp;
+    return true;
+  }
+
+  packets_.pop_front();
+  uint64_t latency_us = now_us_ - std::min(now_us_, packet.arrival_us);
+  stats_.latency_last_ms = latency_us / 1000;
+  stats_.latency_max_ms =
+      std::max(stats_.latency_max_ms, stats_.latency_last_ms);
+  latency_total_ms_ += stats_.latency_last_ms;
+
+  if (!decode_(packet.p_pkt)) {
+    LOG_ERROR(LOG_TAG, "%s: decoding failed", __func__);
+  }
+  osi_free(packet.p_pkt);
+  stats_.packets_decoded++;
+
+  int64_t frames = pcm_.size() / config_.frame_size;
+  if (frames > 0) packet_frames_ = frames;
+  play_timestamp_ = packet.timestamp + frames;
+  return true;
+}
+
+// Writes up to |frames_due| frames, removing or inserting frames as the
+// drift compensation requires. Returns the number of frames written.
+size_t BtifA2dpSinkJitterBuffer::WriteFrames(size_t frames_due) {
+  const size_t frame_size = config_.frame_size;
+  output_.clear();
+  size_t written = 0;
+  while (written < frames_due) {
+    if (pcm_.size() - pcm_start_ < frame_size) {
+      if (!DecodeNext()) break;
+      continue;
+    }
+    const uint8_t* p_next = &pcm_[pcm_start_];
+
+    if (correction_remainder_ >= 1000000) {
+      // Remove the next frame.
+      pcm_start_ += frame_size;
+      correction_remainder_ -= 1000000;
+      stats_.frames_removed++;
+      continue;
+    }
+    if (correction_remainder_ <= -1000000) {
+      // Play the next frame twice.
+      output_.insert(output_.end(), p_next, p_next + frame_size);
+      written++;
+      correction_remainder_ += 1000000;
+      stats_.frames_inserted++;
+      continue;
+    }
+
+    // Play the frames up to the next correction.
+    size_t run =
+        std::min(frames_due - written, (pcm_.size() - pcm_start_) / frame_size);
+    if (correction_ppm_ != 0) {
+      int64_t step = std::abs(correction_ppm_);
+      int64_t progress = (correction_ppm_ > 0) ? correction_remainder_
+                                               : -correction_remainder_;
+      run = std::min(run, (size_t)((1000000 - progress + step - 1) / step));
+    }
+    output_.insert(output_.end(), p_next, p_next + run * frame_size);
+    pcm_start_ += run * frame_size;
+    written += run;
+    correction_remainder_ += (int64_t)run * correction_ppm_;
+  }
+  if (!output_.empty()) write_(output_.data(), output_.size());
+  stats_.frames_played += written;
+  return written;
+}
+
+void BtifA2dpSinkJitterBuffer::UpdateDriftCompensation(uint64_t elapsed_us) {
+  double fill = BufferedFrames();
+  double alpha = std::min(1.0, elapsed_us / kFillAverageTimeUs);
+  fill_average_frames_ += (fill - fill_average_frames_) * alpha;
+
+  double error_ms = fill_average_frames_ * 1000 / config_.sample_rate -
+                    config_.target_latency_ms;
+  double correction = drift_ppm_ + kProportionalPpmPerMs * error_ms;
+  // Do not integrate while the correction is saturated, or the estimated
+  // drift runs away during the large errors of the start.
+  if (std::abs(correction) < kMaxCorrectionPpm) {
+    drift_ppm_ += kIntegralPpmPerMsSecond * error_ms * elapsed_us / 1000000;
+  }
+  correction = std::max(-kMaxCorrectionPpm,
+                        std::min(kMaxCorrectionPpm, correction));
+  correction_ppm_ = (int32_t)correction;
+}
+
+void BtifA2dpSinkJitterBuffer::Tick(uint64_t now_us) {
+  now_us_ = now_us;
+  uint64_t elapsed_us = std::min(now_us - std::min(now_us, last_tick_us_),
+                                 kMaxTickUs);
+  last_tick_us_ = now_us;
+
+  if (!playing_) {
+    // Buffer up to the target latency before starting the playout.
+    if (packets_.empty() || BufferedFrames() * 1000 <
+                                (int64_t)config_.target_latency_ms *
+                                    config_.sample_rate) {
+      return;
+    }
+    LOG_INFO(LOG_TAG, "%s: starting the playout", __func__);
+    playing_ = true;
+    started_ = true;
+    play_timestamp_ = packets_.front().timestamp;
+    frames_due_remainder_ = 0;
+    correction_remainder_ = 0;
+    // The buffered media is at the target, but for the part of a packet
+    // buffered over it: do not take that for an error.
+    fill_average_frames_ =
+        (double)config_.target_latency_ms * config_.sample_rate / 1000;
+  }
+
+  uint64_t due = elapsed_us * config_.sample_rate + frames_due_remainder_;
+  size_t frames_due = due / 1000000;
+  frames_due_remainder_ = due % 1000000;
+
+  if (WriteFrames(frames_due) < frames_due) {
+    LOG_WARN(LOG_TAG, "%s: underrun, buffering again", __func__);
+    stats_.underruns++;
+    playing_ = false;
+    return;
+  }
+  UpdateDriftCompensation(elapsed_us);
+
+  uint32_t fill_ms = BufferedFrames() * 1000 / config_.sample_rate;
+  stats_.fill_max_ms = std::max(stats_.fill_max_ms, fill_ms);
+}
+
+void BtifA2dpSinkJitterBuffer::Flush() {
+  for (Packet& packet : packets_) osi_free(packet.p_pkt);
+  packets_.clear();
+  have_timestamp_ = false;
+  playing_ = false;
+  started_ = false;
+  pcm_.clear();
+  pcm_start_ = 0;
+}
+
+BtifA2dpSinkJitterBuffer::Stats BtifA2dpSinkJitterBuffer::GetStats() const {
+  Stats stats = stats_;
+  stats.fill_ms = BufferedFrames() * 1000 / config_.sample_rate;
+  stats.fill_average_ms = fill_average_frames_ * 1000 / config_.sample_rate;
+  stats.drift_ppm = drift_ppm_;
+  if (stats.packets_decoded > 0)
+    stats.latency_average_ms = latency_total_ms_ / stats.packets_decoded;
+  return stats;
+}
@@ -341,7 +341,10 @@ bool btif_a2dp_source_startup(void) {
 
   btif_a2dp_source_cb.Reset();
   btif_a2dp_source_cb.SetState(BtifA2dpSource::kStateStartingUp);
-  btif_a2dp_source_cb.tx_audio_queue = fixed_queue_new(SIZE_MAX);
+  // The depth of the TX queue is bounded by MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ in
+  // btif_a2dp_source_enqueue_callback(), so the lock-free ring never fills up.
+  btif_a2dp_source_cb.tx_audio_queue =
+      fixed_queue_new_ring(MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ + 1);
 
   // Schedule the rest of the operations
   btif_a2dp_source_thread.DoInThread(
@@ -28,6 +28,7 @@
 #include <private/android_filesystem_config.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 #include <mutex>
@@ -74,24 +75,36 @@ using bluetooth::common::AddressObfuscator;
 #if defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "bt_config.bak";
+static const char* CONFIG_FILE_JOURNAL_PATH = "bt_config.conf.journal";
+static const char* CONFIG_BACKUP_JOURNAL_PATH = "bt_config.bak.journal";
 static const char* CONFIG_LEGACY_FILE_PATH = "bt_config.xml";
 #else   // !defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "/data/misc/bluedroid/bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "/data/misc/bluedroid/bt_config.bak";
 static const char* CONFIG_FILE_CHECKSUM_PATH = "/data/misc/bluedroid/bt_config.conf.encrypted-checksum";
 static const char* CONFIG_BACKUP_CHECKSUM_PATH = "/data/misc/bluedroid/bt_config.bak.encrypted-checksum";
+static const char* CONFIG_FILE_JOURNAL_PATH =
+    "/data/misc/bluedroid/bt_config.conf.journal";
+static const char* CONFIG_BACKUP_JOURNAL_PATH =
+    "/data/misc/bluedroid/bt_config.bak.journal";
 static const char* CONFIG_LEGACY_FILE_PATH =
     "/data/misc/bluedroid/bt_config.xml";
 #endif  // defined(OS_GENERIC)
 static const uint64_t CONFIG_SETTLE_PERIOD_MS = 3000;
+// The changes are appended to the journal of the config file, which is
+// compacted into the file once it grows past this size.
+static const size_t CONFIG_JOURNAL_MAX_SIZE = 64 * 1024;
 
 static void timer_config_save_cb(void* data);
 static void btif_config_write(uint16_t event, char* p_param);
 static bool is_factory_reset(void);
 static void delete_config_files(void);
 static void btif_config_remove_unpaired(config_t* config);
+static bool btif_config_is_kept(const section_t& section);
 static void btif_config_remove_restricted(config_t* config);
 static std::unique_ptr<config_t> btif_config_open(const char* filename, const char* checksum_filename);
+static void btif_config_replay_journal(const char* journal_filename);
+static void btif_config_compact(void);
 
 // Key attestation
 static std::string btif_convert_to_encrypt_key(
@@ -188,6 +201,10 @@ static void read_or_set_metrics_salt() {
 static std::recursive_mutex config_lock;  // protects operations on |config|.
 static std::unique_ptr<config_t> config;
 static alarm_t* config_timer;
+// Size of the journal of the config file, and whether the next write must
+// rewrite the config file instead of appending to the journal.
+static size_t config_journal_size;
+static bool config_compaction_needed;
 
 static BtifKeystore btif_keystore(new keystore::KeystoreClientImpl);
 
@@ -228,6 +245,21 @@ static future_t* init(void) {
     file_source = "Empty";
   }
 
+  // The journal of the file loaded holds the latest changes; the others are
+  // stale.
+  config_journal_size = 0;
+  config_compaction_needed = btif_config_source != ORIGINAL;
+  if (btif_config_source == ORIGINAL) {
+    btif_config_replay_journal(CONFIG_FILE_JOURNAL_PATH);
+  } else {
+    remove(CONFIG_FILE_JOURNAL_PATH);
+    if (btif_config_source == BACKUP)
+      btif_config_replay_journal(CONFIG_BACKUP_JOURNAL_PATH);
+    else
+      remove(CONFIG_BACKUP_JOURNAL_PATH);
+  }
+  config_journal_start(config.get(), btif_config_is_kept);
+
   if (!file_source.empty())
     config_set_string(config.get(), INFO_SECTION, FILE_SOURCE, file_source);
 
@@ -305,6 +337,22 @@ static std::unique_ptr<config_t> btif_config_open(const char* filename, const ch
   return config;
 }
 
+static void btif_config_replay_journal(const char* journal_filename) {
+  struct stat st;
+  if (stat(journal_filename, &st) == -1) return;
+
+  // The journal is not covered by the checksum of the file.
+  if (btif_is_niap_mode()) {
+    LOG(WARNING) << __func__ << ": ignoring journal " << journal_filename;
+    remove(journal_filename);
+    config_compaction_needed = true;
+    return;
+  }
+
+  if (config_journal_replay(config.get(), journal_filename))
+    config_journal_size = st.st_size;
+}
+
 static future_t* shut_down(void) {
   btif_config_flush();
   return future_new_immediate(FUTURE_SUCCESS);
@@ -586,7 +634,7 @@ static std::string btif_convert_to_encrypt_key(
   return "";
 }
 
-std::list<section_t>& btif_config_sections() { return config->sections; }
+const std::list<section_t>& btif_config_sections() { return config->sections; }
 
 bool btif_config_remove(const std::string& section, const std::string& key) {
   CHECK(config != NULL);
@@ -622,6 +670,10 @@ bool btif_config_clear(void) {
 
   bool ret = config_save(*config, CONFIG_FILE_PATH);
   btif_config_source = RESET;
+  remove(CONFIG_FILE_JOURNAL_PATH);
+  config_journal_start(config.get(), btif_config_is_kept);
+  config_journal_size = 0;
+  config_compaction_needed = !ret;
 
   // Save encrypted hash
   std::string current_hash = hash_file(CONFIG_FILE_PATH);
@@ -645,16 +697,39 @@ static void btif_config_write(UNUSED_ATTR uint16_t event,
   CHECK(config_timer != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
+  size_t journal_size = config_journal_size + config->journal.size();
+  if (!config_compaction_needed && !btif_is_niap_mode() &&
+      journal_size <= CONFIG_JOURNAL_MAX_SIZE) {
+    if (config_journal_save(config.get(), CONFIG_FILE_JOURNAL_PATH)) {
+      config_journal_size = journal_size;
+      return;
+    }
+  }
+
+  btif_config_compact();
+}
+
+// Rewrites the config file with all the changes, the previous one and its
+// journal becoming the backup.
+static void btif_config_compact(void) {
   rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
   rename(CONFIG_FILE_CHECKSUM_PATH, CONFIG_BACKUP_CHECKSUM_PATH);
+  if (rename(CONFIG_FILE_JOURNAL_PATH, CONFIG_BACKUP_JOURNAL_PATH) == -1)
+    remove(CONFIG_BACKUP_JOURNAL_PATH);
   std::unique_ptr<config_t> config_paired = config_new_clone(*config);
   btif_config_remove_unpaired(config_paired.get());
-  config_save(*config_paired, CONFIG_FILE_PATH);
+  bool saved = config_save(*config_paired, CONFIG_FILE_PATH);
   // Save hash
   std::string current_hash = hash_file(CONFIG_FILE_PATH);
   if (!current_hash.empty()) {
     write_checksum_file(CONFIG_FILE_CHECKSUM_PATH, current_hash);
   }
+
+  if (saved) {
+    config_journal_start(config.get(), btif_config_is_kept);
+    config_journal_size = 0;
+  }
+  config_compaction_needed = !saved;
 }
 
 static void btif_config_remove_unpaired(config_t* conf) {
@@ -665,22 +740,14 @@ static void btif_config_remove_unpaired(config_t* conf) {
   // discovered devices during regular inquiry scans.
   // We remove these now and cache them in memory instead.
   for (auto it = conf->sections.begin(); it != conf->sections.end();) {
-    std::string& section = it->name;
-    if (RawAddress::IsValidAddress(section)) {
-      // TODO: config_has_key loop thorugh all data, maybe just make it so we
-      // loop just once ?
-      if (!config_has_key(*conf, section, "LinkKey") &&
-          !config_has_key(*conf, section, "LE_KEY_PENC") &&
-          !config_has_key(*conf, section, "LE_KEY_PID") &&
-          !config_has_key(*conf, section, "LE_KEY_PCSRK") &&
-          !config_has_key(*conf, section, "LE_KEY_LENC") &&
-          !config_has_key(*conf, section, "LE_KEY_LCSRK")) {
-        it = conf->sections.erase(it);
+    const section_t& section = *it++;
+    if (RawAddress::IsValidAddress(section.name)) {
+      if (!btif_config_is_kept(section)) {
+        config_remove_section(conf, section.name);
         continue;
       }
       paired_devices++;
     }
-    it++;
   }
 
   // should only happen once, at initial load time
@@ -688,6 +755,19 @@ static void btif_config_remove_unpaired(config_t* conf) {
     btif_config_devices_loaded = paired_devices;
 }
 
+// Returns true if |section| is saved to the config file: it is not a device,
+// or the device is paired. The changes of the other sections are not
+// journaled either, they are only kept in memory.
+static bool btif_config_is_kept(const section_t& section) {
+  if (!RawAddress::IsValidAddress(section.name)) return true;
+  return section.entry_index.count("LinkKey") ||
+         section.entry_index.count("LE_KEY_PENC") ||
+         section.entry_index.count("LE_KEY_PID") ||
+         section.entry_index.count("LE_KEY_PCSRK") ||
+         section.entry_index.count("LE_KEY_LENC") ||
+         section.entry_index.count("LE_KEY_LCSRK");
+}
+
 void btif_debug_config_dump(int fd) {
   dprintf(fd, "\nBluetooth Config:\n");
 
@@ -725,15 +805,13 @@ static void btif_config_remove_restricted(config_t* config) {
   CHECK(config != NULL);
 
   for (auto it = config->sections.begin(); it != config->sections.end();) {
-    const std::string& section = it->name;
+    const std::string& section = it++->name;
     if (RawAddress::IsValidAddress(section) &&
         config_has_key(*config, section, "Restricted")) {
       BTIF_TRACE_DEBUG("%s: Removing restricted device %s", __func__,
                        section.c_str());
-      it = config->sections.erase(it);
-      continue;
+      config_remove_section(config, section);
     }
-    it++;
   }
 }
 
@@ -748,6 +826,8 @@ static void delete_config_files(void) {
   remove(CONFIG_BACKUP_PATH);
   remove(CONFIG_FILE_CHECKSUM_PATH);
   remove(CONFIG_BACKUP_CHECKSUM_PATH);
+  remove(CONFIG_FILE_JOURNAL_PATH);
+  remove(CONFIG_BACKUP_JOURNAL_PATH);
   osi_property_set("persist.bluetooth.factoryreset", "false");
 }
 
@@ -24,7 +24,6 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
-#include <vector>
 
 #include <mutex>
 
@@ -84,6 +83,7 @@ typedef struct l2cap_socket {
   unsigned outgoing_congest : 1;  // should we hold?
   unsigned server_psm_sent : 1;   // The server shall only send PSM once.
   bool is_le_coc;                 // is le connection oriented channel?
+  bool is_basic_mode;             // classic channel in basic mode, not ERTM?
   uint16_t rx_mtu;
   uint16_t tx_mtu;
   // Cumulative number of bytes transmitted on this socket
@@ -104,6 +104,9 @@ static int pth = -1;
 static void btsock_l2cap_cbk(tBTA_JV_EVT event, tBTA_JV* p_data,
                              uint32_t l2cap_socket_id);
 
+/* Number of queued packets written to the app per system call. */
+#define MAX_SEND_BATCH 16
+
 /* TODO: Consider to remove this buffer, as we have a buffer in l2cap as well,
  * and we risk
  *       a buffer overflow with this implementation if the socket data is not
@@ -140,20 +143,26 @@ static char packet_get_head_l(l2cap_socket* sock, uint8_t** data,
   return true;
 }
 
-static struct packet* packet_alloc(const uint8_t* data, uint32_t len) {
+/* allocates a packet of len bytes, to be filled by the caller */
+static struct packet* packet_alloc(uint32_t len) {
   struct packet* p = (struct packet*)osi_calloc(sizeof(*p));
   uint8_t* buf = (uint8_t*)osi_malloc(len);
 
   p->data = buf;
   p->len = len;
-  memcpy(p->data, data, len);
   return p;
 }
 
+static void packet_free(struct packet* p) {
+  osi_free(p->data);
+  osi_free(p);
+}
+
 /* makes a copy of the data, returns true on success */
 static char packet_put_head_l(l2cap_socket* sock, const void* data,
                               uint32_t len) {
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
+  struct packet* p = packet_alloc(len);
+  memcpy(p->data, data, len);
 
   /*
    * We do not check size limits here since this is used to undo "getting" a
@@ -177,15 +186,14 @@ static char packet_put_head_l(l2cap_socket* sock, const void* data,
   return true;
 }
 
-/* makes a copy of the data, returns true on success */
-static char packet_put_tail_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
+/* takes ownership of the packet, returns true on success */
+static char packet_put_tail_l(l2cap_socket* sock, struct packet* p) {
   if (sock->bytes_buffered >= L2CAP_MAX_RX_BUFFER) {
     LOG(ERROR) << __func__ << ": buffer overflow";
+    packet_free(p);
     return false;
   }
 
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
   p->next = NULL;
   p->prev = sock->last_packet;
   sock->last_packet = p;
@@ -194,7 +202,7 @@ static char packet_put_tail_l(l2cap_socket* sock, const void* data,
   else
     sock->first_packet = p;
 
-  sock->bytes_buffered += len;
+  sock->bytes_buffered += p->len;
 
   return true;
 }
@@ -715,9 +723,10 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
 
     tBTA_JV_LE_DATA_IND* p_le_data_ind = &evt->le_data_ind;
     BT_HDR* p_buf = p_le_data_ind->p_buf;
-    uint8_t* data = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    struct packet* p = packet_alloc(p_buf->len);
+    memcpy(p->data, (uint8_t*)(p_buf + 1) + p_buf->offset, p_buf->len);
 
-    if (packet_put_tail_l(sock, data, p_buf->len)) {
+    if (packet_put_tail_l(sock, p)) {
       bytes_read = p_buf->len;
       btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
                            sock->id);
@@ -732,19 +741,20 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
     uint32_t count;
 
     if (BTA_JvL2capReady(sock->handle, &count) == BTA_JV_SUCCESS) {
-      std::vector<uint8_t> buffer(count);
-      if (BTA_JvL2capRead(sock->handle, sock->id, buffer.data(), count) ==
+      // read directly into the packet queued for the app
+      struct packet* p = packet_alloc(count);
+      if (BTA_JvL2capRead(sock->handle, sock->id, p->data, count) !=
           BTA_JV_SUCCESS) {
-        if (packet_put_tail_l(sock, buffer.data(), count)) {
-          bytes_read = count;
-          btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
-                               SOCK_THREAD_FD_WR, sock->id);
-        } else {  // connection must be dropped
-          DVLOG(2) << __func__
-                   << ": unable to push data to socket - closing channel";
-          BTA_JvL2capClose(sock->handle);
-          btsock_l2cap_free_l(sock);
-        }
+        packet_free(p);
+      } else if (packet_put_tail_l(sock, p)) {
+        bytes_read = count;
+        btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
+                             SOCK_THREAD_FD_WR, sock->id);
+      } else {  // connection must be dropped
+        DVLOG(2) << __func__
+                 << ": unable to push data to socket - closing channel";
+        BTA_JvL2capClose(sock->handle);
+        btsock_l2cap_free_l(sock);
       }
     }
   }
@@ -865,10 +875,11 @@ static void btsock_l2cap_server_listen(l2cap_socket* sock) {
 
   /* Setup ETM settings: mtu will be set below */
   std::unique_ptr<tL2CAP_CFG_INFO> cfg = std::make_unique<tL2CAP_CFG_INFO>(
-      tL2CAP_CFG_INFO{.fcr_present = true, .fcr = obex_l2c_fcr_opts_def});
+      tL2CAP_CFG_INFO{.fcr_present = !sock->is_basic_mode,
+                      .fcr = obex_l2c_fcr_opts_def});
 
   std::unique_ptr<tL2CAP_ERTM_INFO> ertm_info;
-  if (!sock->is_le_coc) {
+  if (!sock->is_le_coc && !sock->is_basic_mode) {
     ertm_info.reset(new tL2CAP_ERTM_INFO(obex_l2c_etm_opt));
   }
 
@@ -910,6 +921,7 @@ static bt_status_t btsock_l2cap_listen_or_connect(const char* name,
   sock->channel = channel;
   sock->app_uid = app_uid;
   sock->is_le_coc = is_le_coc;
+  sock->is_basic_mode = !is_le_coc && (flags & BTSOCK_FLAG_L2CAP_BASIC_MODE);
   sock->rx_mtu = is_le_coc ? L2CAP_SDU_LENGTH_LE_MAX : L2CAP_SDU_LENGTH_MAX;
 
   /* "role" is never initialized in rfcomm code */
@@ -924,10 +936,11 @@ static bt_status_t btsock_l2cap_listen_or_connect(const char* name,
 
       /* Setup ETM settings: mtu will be set below */
       std::unique_ptr<tL2CAP_CFG_INFO> cfg = std::make_unique<tL2CAP_CFG_INFO>(
-          tL2CAP_CFG_INFO{.fcr_present = true, .fcr = obex_l2c_fcr_opts_def});
+          tL2CAP_CFG_INFO{.fcr_present = !sock->is_basic_mode,
+                          .fcr = obex_l2c_fcr_opts_def});
 
       std::unique_ptr<tL2CAP_ERTM_INFO> ertm_info;
-      if (!sock->is_le_coc) {
+      if (!sock->is_le_coc && !sock->is_basic_mode) {
         ertm_info.reset(new tL2CAP_ERTM_INFO(obex_l2c_etm_opt));
       }
 
@@ -967,25 +980,37 @@ bt_status_t btsock_l2cap_connect(const RawAddress* bd_addr, int channel,
  * (for example: unrecoverable error or no data)
  */
 static bool flush_incoming_que_on_wr_signal_l(l2cap_socket* sock) {
-  uint8_t* buf;
-  uint32_t len;
-
-  while (packet_get_head_l(sock, &buf, &len)) {
-    ssize_t sent;
-    OSI_NO_INTR(sent = send(sock->our_fd, buf, len, MSG_DONTWAIT));
-    int saved_errno = errno;
+  /* The socket is a SOCK_SEQPACKET, each packet is sent as its own message,
+   * MAX_SEND_BATCH of them per system call. */
+  while (sock->first_packet) {
+    struct mmsghdr msgs[MAX_SEND_BATCH];
+    struct iovec iov[MAX_SEND_BATCH];
+    unsigned int count = 0;
+    for (struct packet* p = sock->first_packet; p && count < MAX_SEND_BATCH;
+         p = p->next, count++) {
+      iov[count].iov_base = p->data;
+      iov[count].iov_len = p->len;
+      memset(&msgs[count], 0, sizeof(msgs[count]));
+      msgs[count].msg_hdr.msg_iov = &iov[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+    }
 
-    if (sent == (signed)len)
-      osi_free(buf);
-    else if (sent >= 0) {
-      packet_put_head_l(sock, buf + sent, len - sent);
-      osi_free(buf);
-      if (!sent) /* special case if other end not keeping up */
-        return true;
-    } else {
-      packet_put_head_l(sock, buf, len);
+    int sent;
+    OSI_NO_INTR(sent = sendmmsg(sock->our_fd, msgs, count, MSG_DONTWAIT));
+    if (sent < 0) return errno == EWOULDBLOCK || errno == EAGAIN;
+
+    for (int i = 0; i < sent; i++) {
+      uint8_t* buf;
+      uint32_t len;
+      packet_get_head_l(sock, &buf, &len);
+      if (msgs[i].msg_len < len) {
+        packet_put_head_l(sock, buf + msgs[i].msg_len, len - msgs[i].msg_len);
+        osi_free(buf);
+        /* special case if other end not keeping up */
+        if (!msgs[i].msg_len) return true;
+        break;
+      }
       osi_free(buf);
-      return saved_errno == EWOULDBLOCK || saved_errno == EAGAIN;
     }
   }
 
@@ -26,6 +26,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <mutex>
@@ -818,26 +819,71 @@ static sent_status_t send_data_to_app(int fd, BT_HDR* p_buf) {
   return SENT_PARTIAL;
 }
 
-static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
+// Number of queued buffers written to the app per system call.
+#define MAX_SEND_BATCH 16
+
+// Writes the queued buffers to the app, MAX_SEND_BATCH at a time, until the
+// app socket is full.
+static sent_status_t send_queue_to_app(rfc_slot_t* slot) {
   while (!list_is_empty(slot->incoming_queue)) {
-    BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
-    switch (send_data_to_app(slot->fd, p_buf)) {
-      case SENT_NONE:
-      case SENT_PARTIAL:
-        // monitor the fd to get callback when app is ready to receive data
-        btsock_thread_add_fd(pth, slot->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR,
-                             slot->id);
-        return true;
+    struct iovec iov[MAX_SEND_BATCH];
+    size_t count = 0;
+    size_t total = 0;
+    for (const list_node_t* node = list_begin(slot->incoming_queue);
+         node != list_end(slot->incoming_queue) && count < MAX_SEND_BATCH;
+         node = list_next(node)) {
+      BT_HDR* p_buf = (BT_HDR*)list_node(node);
+      iov[count].iov_base = p_buf->data + p_buf->offset;
+      iov[count].iov_len = p_buf->len;
+      total += p_buf->len;
+      count++;
+    }
 
-      case SENT_ALL:
-        list_remove(slot->incoming_queue, p_buf);
-        break;
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    ssize_t sent = 0;
+    if (total > 0) {
+      OSI_NO_INTR(sent = sendmsg(slot->fd, &msg, MSG_DONTWAIT));
+      if (sent == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return SENT_NONE;
+        LOG_ERROR(LOG_TAG, "%s error writing RFCOMM data back to app: %s",
+                  __func__, strerror(errno));
+        return SENT_FAILED;
+      }
+      if (sent == 0) return SENT_FAILED;
+    }
 
-      case SENT_FAILED:
-        list_remove(slot->incoming_queue, p_buf);
-        return false;
+    // Free the buffers written, and keep the rest of a partial one.
+    for (size_t i = 0; i < count; i++) {
+      BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
+      if (p_buf->len > sent) {
+        p_buf->offset += sent;
+        p_buf->len -= sent;
+        return SENT_PARTIAL;
+      }
+      sent -= p_buf->len;
+      list_remove(slot->incoming_queue, p_buf);
     }
   }
+  return SENT_ALL;
+}
+
+static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
+  switch (send_queue_to_app(slot)) {
+    case SENT_NONE:
+    case SENT_PARTIAL:
+      // monitor the fd to get callback when app is ready to receive data
+      btsock_thread_add_fd(pth, slot->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR,
+                           slot->id);
+      return true;
+
+    case SENT_ALL:
+      break;
+
+    case SENT_FAILED:
+      return false;
+  }
 
   // app is ready to receive data, tell stack to start the data flow
   // fix me: need a jv flow control api to serialize the call in stack
@@ -0,0 +1,311 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btif/include/btif_a2dp_sink_jitter_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "osi/include/allocator.h"
+
+namespace {
+
+constexpr uint32_t kSampleRate = 44100;
+// 7 SBC frames of 16 blocks of 8 subbands.
+constexpr uint32_t kPacketFrames = 896;
+constexpr uint64_t kTickUs = 20000;
+constexpr uint32_t kTargetLatencyMs = 150;
+constexpr uint32_t kMaxLatencyMs = 500;
+
+// A stream of media packets, as received by the sink.
+struct Trace {
+  // Clock drift of the source: positive when its clock is faster.
+  double drift_ppm = 0;
+  // Uniformly distributed extra transmission delay.
+  uint64_t max_jitter_us = 0;
+  // Every |loss_interval| packet is lost, if not 0.
+  size_t loss_interval = 0;
+  uint32_t first_timestamp = 0;
+  uint64_t duration_us = 60000000;
+};
+
+struct ReceivedPacket {
+  uint64_t arrival_us;
+  uint32_t timestamp;
+};
+
+// Packets of |trace|, in arrival order. The jitter comes from a fixed seed:
+// the traces are the same on every run.
+std::vector<ReceivedPacket> MakePackets(const Trace& trace) {
+  std::vector<ReceivedPacket> packets;
+  uint32_t seed = 1;
+  double source_us_per_frame =
+      1000000.0 / kSampleRate / (1 + trace.drift_ppm / 1000000);
+  for (size_t n = 0;; n++) {
+    uint64_t sent_us = n * kPacketFrames * source_us_per_frame;
+    if (sent_us > trace.duration_us) break;
+    if (trace.loss_interval != 0 && n % trace.loss_interval ==
+                                        trace.loss_interval - 1)
+      continue;
+    seed = seed * 1664525 + 1013904223;
+    uint64_t jitter_us =
+        trace.max_jitter_us ? (seed >> 8) % trace.max_jitter_us : 0;
+    packets.push_back({sent_us + jitter_us,
+                       trace.first_timestamp + (uint32_t)(n * kPacketFrames)});
+  }
+  std::stable_sort(packets.begin(), packets.end(),
+                   [](const ReceivedPacket& a, const ReceivedPacket& b) {
+                     return a.arrival_us < b.arrival_us;
+                   });
+  return packets;
+}
+
+// Replays packets to a jitter buffer. The packets carry their media
+// timestamp, and decode to a mono ramp of the media timestamps of their
+// frames, so the output shows what was played.
+class Replay {
+ public:
+  Replay() {
+    BtifA2dpSinkJitterBuffer::Config config = {
+        kSampleRate, sizeof(int16_t), kTargetLatencyMs, kMaxLatencyMs};
+    jitter_buffer_ = std::make_unique<BtifA2dpSinkJitterBuffer>(
+        config,
+        [this](BT_HDR* p_pkt) {
+          uint32_t timestamp;
+          memcpy(&timestamp, p_pkt->data + p_pkt->offset, sizeof(timestamp));
+          int16_t pcm[kPacketFrames];
+          for (uint32_t i = 0; i < kPacketFrames; i++)
+            pcm[i] = (int16_t)(timestamp + i);
+          jitter_buffer_->AddPcm(reinterpret_cast<uint8_t*>(pcm), sizeof(pcm));
+          return true;
+        },
+        [this](const uint8_t* p_data, size_t len) {
+          const int16_t* p_pcm = reinterpret_cast<const int16_t*>(p_data);
+          output_.insert(output_.end(), p_pcm, p_pcm + len / sizeof(int16_t));
+        });
+  }
+
+  // Delivers the packets arrived by |until_us|, and ticks every |kTickUs|.
+  void Run(const std::vector<ReceivedPacket>& packets, uint64_t until_us) {
+    for (; now_us_ <= until_us; now_us_ += kTickUs) {
+      for (; next_ < packets.size() && packets[next_].arrival_us <= now_us_;
+           next_++) {
+        Receive(packets[next_]);
+      }
+      jitter_buffer_->Tick(now_us_);
+    }
+  }
+
+  void Receive(const ReceivedPacket& packet) {
+    BT_HDR* p_pkt =
+        static_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR) + sizeof(uint32_t)));
+    p_pkt->offset = 0;
+    p_pkt->len = sizeof(uint32_t);
+    memcpy(p_pkt->data, &packet.timestamp, sizeof(uint32_t));
+    jitter_buffer_->Enqueue(p_pkt, packet.timestamp, packet.arrival_us);
+  }
+
+  // Number of places the played media does not follow the previous frame.
+  size_t Discontinuities() const {
+    size_t count = 0;
+    for (size_t i = 1; i < output_.size(); i++) {
+      if ((int16_t)(output_[i - 1] + 1) != output_[i]) count++;
+    }
+    return count;
+  }
+
+  BtifA2dpSinkJitterBuffer* jitter_buffer() { return jitter_buffer_.get(); }
+  const std::vector<int16_t>& output() const { return output_; }
+  uint64_t now_us() const { return now_us_; }
+
+ private:
+  std::unique_ptr<BtifA2dpSinkJitterBuffer> jitter_buffer_;
+  std::vector<int16_t> output_;
+  uint64_t now_us_ = 0;
+  size_t next_ = 0;
+};
+
+TEST(BtifA2dpSinkJitterBufferTest, steady_stream_plays_continuously) {
+  Trace trace;
+  Replay replay;
+  replay.Run(MakePackets(trace), trace.duration_us);
+
+  BtifA2dpSinkJitterBuffer::Stats stats = replay.jitter_buffer()->GetStats();
+  EXPECT_EQ(0u, stats.underruns);
+  EXPECT_EQ(0u, stats.packets_late);
+  EXPECT_EQ(0u, stats.frames_concealed);
+  // Only the drift compensation alters the media, and marginally.
+  EXPECT_EQ(stats.frames_removed + stats.frames_inserted,
+            replay.Discontinuities());
+  EXPECT_LT(stats.frames_removed + stats.frames_inserted,
+            stats.frames_played / 100000);
+  // The playout starts once the target latency is buffered.
+  EXPECT_EQ(0, replay.output()[0]);
+  EXPECT_NEAR(kTargetLatencyMs, stats.latency_average_ms, 25);
+  EXPECT_NEAR(kTargetLatencyMs, stats.fill_average_ms, 15);
+}
+
+TEST(BtifA2dpSinkJitterBufferTest, jitter_is_absorbed) {
+  Trace trace;
+  trace.max_jitter_us = 100000;
+  Replay replay;
+  replay.Run(MakePackets(trace), trace.duration_us);
+
+  BtifA2dpSinkJitterBuffer::Stats stats = replay.jitter_buffer()->GetStats();
+  EXPECT_EQ(0u, stats.underruns);
+  EXPECT_EQ(0u, stats.packets_late);
+  EXPECT_EQ(0u, stats.frames_concealed);
+  // The packets are played in order: the media is only altered by the
+  // drift compensation, reacting to the level at the start.
+  EXPECT_EQ(stats.frames_removed + stats.frames_inserted,
+            replay.Discontinuities());
+  EXPECT_LT(stats.latency_max_ms, kTargetLatencyMs + 100);
+}
+
+class BtifA2dpSinkJitterBufferDriftTest
+    : public ::testing::TestWithParam<double> {};
+
+// Over 10 minutes, a drift of 300 ppm adds up to 180 ms.
+TEST_P(BtifA2dpSinkJitterBufferDriftTest, drift_is_compensated) {
+  Trace trace;
+  trace.drift_ppm = GetParam();
+  trace.max_jitter_us = 40000;
+  trace.duration_us = 600000000;
+  std::vector<ReceivedPacket> packets = MakePackets(trace);
+  Replay replay;
+  replay.Run(packets, 300000000);
+  BtifA2dpSinkJitterBuffer::Stats settled = replay.jitter_buffer()->GetStats();
+  replay.Run(packets, trace.duration_us);
+  BtifA2dpSinkJitterBuffer::Stats stats = replay.jitter_buffer()->GetStats();
+
+  EXPECT_EQ(0u, stats.underruns);
+  EXPECT_EQ(0u, stats.packets_late);
+  EXPECT_EQ(0u, stats.packets_overflowed);
+  EXPECT_NEAR(kTargetLatencyMs, stats.fill_average_ms, 10);
+  EXPECT_LT(stats.fill_max_ms, kTargetLatencyMs + 60);
+  EXPECT_NEAR(trace.drift_ppm, stats.drift_ppm, 20);
+
+  // After settling, a frame is removed or inserted for every |drift_ppm|
+  // millionth of the frames played.
+  double played = stats.frames_played - settled.frames_played;
+  double corrected = (double)(stats.frames_removed - settled.frames_removed) -
+                     (double)(stats.frames_inserted - settled.frames_inserted);
+  EXPECT_NEAR(trace.drift_ppm, corrected * 1000000 / played,
+              std::max(10.0, std::abs(trace.drift_ppm) / 10));
+  EXPECT_EQ(stats.frames_removed + stats.frames_inserted,
+            replay.Discontinuities());
+}
+
+INSTANTIATE_TEST_CASE_P(Drifts, BtifA2dpSinkJitterBufferDriftTest,
+                        ::testing::Values(-300.0, -50.0, 0.0, 50.0, 300.0));
+
+TEST(BtifA2dpSinkJitterBufferTest, lost_packets_are_concealed) {
+  Trace trace;
+  trace.loss_interval = 50;
+  Replay replay;
+  replay.Run(MakePackets(trace), trace.duration_us);
+
+  BtifA2dpSinkJitterBuffer::Stats stats = replay.jitter_buffer()->GetStats();
+  EXPECT_EQ(0u, stats.underruns);
+  size_t lost = stats.frames_played / kPacketFrames / trace.loss_interval;
+  EXPECT_NEAR(lost * kPacketFrames, stats.frames_concealed, kPacketFrames);
+  // Silence in place of each lost packet.
+  const std::vector<int16_t>& output = replay.output();
+  size_t silent = std::count(output.begin(), output.end(), 0);
+  EXPECT_GE(silent, stats.frames_concealed);
+}
+
+TEST(BtifA2dpSinkJitterBufferTest, late_packets_are_dropped) {
+  Trace trace;
+  trace.duration_us = 10000000;
+  std::vector<ReceivedPacket> packets = MakePackets(trace);
+  // Delay a packet by half a second.
+  ReceivedPacket late = packets[200];
+  late.arrival_us += 500000;
+  packets.erase(packets.begin() + 200);
+  packets.insert(std::upper_bound(packets.begin(), packets.end(), late,
+                                  [](const ReceivedPacket& a,
+                                     const ReceivedPacket& b) {
+                                    return a.arrival_us < b.arrival_us;
+                                  }),
+                 late);
+  Replay replay;
+  replay.Run(packets, trace.duration_us);
+
+  BtifA2dpSinkJitterBuffer::Stats stats = replay.jitter_buffer()->GetStats();
+  EXPECT_EQ(1u, stats.packets_late);
+  EXPECT_EQ(kPacketFrames, stats.frames_concealed);
+  EXPECT_EQ(0u, stats.underruns);
+}
+
+TEST(BtifA2dpSinkJitterBufferTest, timestamps_wrap_around) {
+  Trace trace;
+  trace.first_timestamp = 0xFFFFFFFF - 100 * kPacketFrames;
+  trace.duration_us = 10000000;
+  Replay replay;
+  replay.Run(MakePackets(trace), trace.duration_us);
+
+  BtifA2dpSinkJitterBuffer::Stats stats = replay.jitter_buffer()->GetStats();
+  EXPECT_EQ(0u, stats.underruns);
+  EXPECT_EQ(0u, stats.packets_late);
+  EXPECT_EQ(0u, stats.frames_concealed);
+  EXPECT_EQ(stats.frames_removed + stats.frames_inserted,
+            replay.Discontinuities());
+}
+
+// When the playout stalls while the source keeps streaming, the media
+// above the maximum latency is dropped.
+TEST(BtifA2dpSinkJitterBufferTest, overflow_drops_the_oldest_media) {
+  Trace trace;
+  trace.duration_us = 10000000;
+  std::vector<ReceivedPacket> packets = MakePackets(trace);
+  Replay replay;
+  replay.Run(packets, 2000000);
+  for (const ReceivedPacket& packet : packets) {
+    if (packet.arrival_us > 2000000 && packet.arrival_us <= 4000000)
+      replay.Receive(packet);
+  }
+  BtifA2dpSinkJitterBuffer::Stats stats = replay.jitter_buffer()->GetStats();
+  EXPECT_GT(stats.packets_overflowed, 0u);
+  EXPECT_LE(stats.fill_ms, kMaxLatencyMs);
+}
+
+TEST(BtifA2dpSinkJitterBufferTest, flush_buffers_again) {
+  Trace trace;
+  trace.duration_us = 4000000;
+  std::vector<ReceivedPacket> packets = MakePackets(trace);
+  Replay replay;
+  replay.Run(packets, 2000000);
+  size_t played = replay.output().size();
+  replay.jitter_buffer()->Flush();
+  EXPECT_EQ(0u, replay.jitter_buffer()->GetStats().fill_ms);
+
+  // Nothing is played until the target latency is buffered again.
+  replay.Run(packets, 2000000 + kTargetLatencyMs * 1000 - kTickUs);
+  EXPECT_EQ(played, replay.output().size());
+  replay.Run(packets, trace.duration_us);
+  EXPECT_GT(replay.output().size(), played);
+  EXPECT_EQ(0u, replay.jitter_buffer()->GetStats().packets_late);
+}
+
+}  // namespace
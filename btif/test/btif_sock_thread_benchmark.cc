@@ -0,0 +1,135 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <future>
+#include <vector>
+
+#include "bt_trace.h"
+#include "bt_types.h"
+#include "btif/include/btif_sock_thread.h"
+#include "osi/include/osi.h"
+
+using ::benchmark::State;
+
+uint8_t appl_trace_level = BT_TRACE_LEVEL_NONE;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+namespace {
+
+// The RFCOMM payload of a 1021 bytes ACL packet.
+constexpr size_t kChunkSize = 990;
+constexpr int kChunksPerSocket = 32;
+constexpr int kSocketType = 1;
+
+// The app ends write, the stack ends are monitored by the socket thread.
+struct Loopback {
+  std::vector<int> app_fds;
+  std::vector<int> stack_fds;
+};
+
+int thread_handle = -1;
+std::atomic<size_t> bytes_received;
+size_t bytes_expected;
+std::promise<void>* all_received;
+
+// Reads the data signaled, the way btsock_rfc_signaled() hands it to the
+// stack, then monitors the socket again.
+void OnSignaled(int fd, int type, int flags, uint32_t user_id) {
+  if (!(flags & SOCK_THREAD_FD_RD)) return;
+
+  uint8_t buffer[kChunkSize * 4];
+  ssize_t received;
+  size_t total = 0;
+  do {
+    OSI_NO_INTR(received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT));
+    if (received > 0) total += received;
+  } while (received > 0);
+
+  btsock_thread_add_fd(thread_handle, fd, kSocketType,
+                       SOCK_THREAD_FD_RD | SOCK_THREAD_ADD_FD_SYNC, user_id);
+  if (total > 0 && bytes_received.fetch_add(total) + total == bytes_expected)
+    all_received->set_value();
+}
+
+void OnCmd(int cmd_fd, int type, int size, uint32_t user_id) {}
+
+Loopback CreateLoopback(int sockets) {
+  Loopback loopback;
+  for (int i = 0; i < sockets; i++) {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    loopback.app_fds.push_back(fds[0]);
+    loopback.stack_fds.push_back(fds[1]);
+    btsock_thread_add_fd(thread_handle, fds[1], kSocketType,
+                         SOCK_THREAD_FD_RD, i);
+  }
+  return loopback;
+}
+
+void CloseLoopback(const Loopback& loopback) {
+  for (int fd : loopback.app_fds) close(fd);
+  for (int fd : loopback.stack_fds)
+    btsock_thread_remove_fd_and_close(thread_handle, fd);
+}
+
+// Every socket sends kChunksPerSocket chunks, the sockets taking turns.
+// Arguments: sockets.
+void BM_LoopbackThroughput(State& state) {
+  btsock_thread_init();
+  thread_handle = btsock_thread_create(OnSignaled, OnCmd);
+  CHECK(thread_handle >= 0);
+  Loopback loopback = CreateLoopback(state.range(0));
+  std::vector<uint8_t> chunk(kChunkSize, 0x5a);
+  bytes_expected = kChunkSize * kChunksPerSocket * loopback.app_fds.size();
+
+  for (auto _ : state) {
+    std::promise<void> promise;
+    all_received = &promise;
+    bytes_received = 0;
+    for (int c = 0; c < kChunksPerSocket; c++) {
+      for (int fd : loopback.app_fds) {
+        ssize_t sent;
+        OSI_NO_INTR(sent = send(fd, chunk.data(), chunk.size(), 0));
+        CHECK(sent == (ssize_t)chunk.size());
+      }
+    }
+    promise.get_future().wait();
+  }
+  state.SetBytesProcessed(state.iterations() * bytes_expected);
+
+  CloseLoopback(loopback);
+  btsock_thread_exit(thread_handle);
+}
+
+BENCHMARK(BM_LoopbackThroughput)
+    ->ArgName("sockets")
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(256)
+    ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
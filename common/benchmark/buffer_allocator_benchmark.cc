@@ -0,0 +1,97 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr size_t kBuffersPerProducer = 50000;
+constexpr size_t kHandOffQueueSize = 256;
+
+// Sizes (BT_HDR included) of the buffers flowing through the stack while
+// streaming A2DP and serving GATT notifications at the same time.
+constexpr size_t kBtHdrSize = 8;
+constexpr size_t kA2dpMediaPacketSize = kBtHdrSize + 660;  // SBC frames
+constexpr size_t kGattNotificationSize = kBtHdrSize + 4 + 251;  // LE ACL
+constexpr size_t kAclPacketSize = kBtHdrSize + 4 + 1021;  // BR/EDR ACL
+
+struct Producer {
+  size_t buffer_size;
+  bool clone;  // Whether the consumer clones it, like l2c_fcr_clone_buf
+};
+
+// The A2DP encoder, the HCI RX path for LE links and the HCI RX path for
+// BR/EDR links each allocate buffers on their own thread; a single consumer
+// standing in for the BTU thread frees them, after cloning the ones that
+// would be retransmittable I-frames.
+const Producer kProducers[] = {
+    {kA2dpMediaPacketSize, false},
+    {kGattNotificationSize, false},
+    {kAclPacketSize, true},
+};
+
+void BM_SustainedLoad(State& state, void* (*alloc)(size_t)) {
+  constexpr size_t num_producers = sizeof(kProducers) / sizeof(kProducers[0]);
+  fixed_queue_t* queue = fixed_queue_new_ring(kHandOffQueueSize);
+  CHECK(queue != nullptr);
+
+  for (auto _ : state) {
+    std::vector<std::thread> threads;
+    for (const Producer& producer : kProducers) {
+      threads.emplace_back([queue, &producer, alloc]() {
+        for (size_t i = 0; i < kBuffersPerProducer; i++) {
+          uint8_t* buffer = static_cast<uint8_t*>(alloc(producer.buffer_size));
+          buffer[0] = producer.clone;
+          memset(buffer + 1, 0, kBtHdrSize - 1);
+          fixed_queue_enqueue(queue, buffer);
+        }
+      });
+    }
+
+    for (size_t i = 0; i < num_producers * kBuffersPerProducer; i++) {
+      uint8_t* buffer = static_cast<uint8_t*>(fixed_queue_dequeue(queue));
+      if (buffer[0]) {
+        uint8_t* clone = static_cast<uint8_t*>(alloc(kAclPacketSize));
+        memcpy(clone, buffer, kAclPacketSize);
+        osi_free(clone);
+      }
+      osi_free(buffer);
+    }
+
+    for (auto& thread : threads) thread.join();
+  }
+
+  fixed_queue_free(queue, osi_free);
+  state.SetItemsProcessed(state.iterations() *
+                          (num_producers + 1) * kBuffersPerProducer);
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_SustainedLoad, osi_malloc, &osi_malloc)->UseRealTime();
+BENCHMARK_CAPTURE(BM_SustainedLoad, osi_pool_malloc, &osi_pool_malloc)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Compacting past this size, as btif_config does.
+constexpr size_t kJournalMaxSize = 64 * 1024;
+
+// The keys of a bonded device in bt_config.conf.
+const std::vector<std::string> kDeviceKeys = {
+    "Name",    "DevClass",    "DevType",   "AddrType", "Manufacturer",
+    "LmpVer",  "LmpSubVer",   "Service",   "LinkKey",  "LinkKeyType",
+    "PinLength", "Timestamp"};
+
+std::string TempPath(const std::string& name) {
+  const char* dir = getenv("TMPDIR");
+  return std::string(dir ? dir : "/data/local/tmp") + "/" + name;
+}
+
+std::string DeviceSection(int device) {
+  char section[18];
+  snprintf(section, sizeof(section), "00:1b:dc:%02x:%02x:%02x",
+           (device >> 16) & 0xff, (device >> 8) & 0xff, device & 0xff);
+  return section;
+}
+
+std::unique_ptr<config_t> MakeConfig(int devices) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_set_string(config.get(), "Adapter", "Address", "00:1b:dc:ff:ff:ff");
+  for (int d = 0; d < devices; d++) {
+    std::string section = DeviceSection(d);
+    for (const std::string& key : kDeviceKeys)
+      config_set_string(config.get(), section, key, key + "-" + section);
+  }
+  return config;
+}
+
+// The pseudo random device touched by each iteration.
+int NextDevice(uint32_t* seed, int devices) {
+  *seed = *seed * 1664525 + 1013904223;
+  return (*seed >> 8) % devices;
+}
+
+// Arguments: devices.
+void BM_Load(State& state) {
+  const std::string filename = TempPath("config_benchmark.conf");
+  CHECK(config_save(*MakeConfig(state.range(0)), filename));
+
+  for (auto _ : state) {
+    std::unique_ptr<config_t> config = config_new(filename.c_str());
+    CHECK(config);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  remove(filename.c_str());
+}
+
+// Arguments: devices.
+void BM_Lookup(State& state) {
+  int devices = state.range(0);
+  std::unique_ptr<config_t> config = MakeConfig(devices);
+  std::vector<std::string> sections;
+  for (int d = 0; d < devices; d++) sections.push_back(DeviceSection(d));
+
+  uint32_t seed = 1;
+  for (auto _ : state) {
+    const std::string& section = sections[NextDevice(&seed, devices)];
+    benchmark::DoNotOptimize(
+        config_get_string(*config, section, "LinkKey", nullptr));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// A change to a device followed by a rewrite of the whole file.
+// Arguments: devices.
+void BM_SaveFull(State& state) {
+  int devices = state.range(0);
+  const std::string filename = TempPath("config_benchmark.conf");
+  std::unique_ptr<config_t> config = MakeConfig(devices);
+
+  int timestamp = 0;
+  uint32_t seed = 1;
+  for (auto _ : state) {
+    config_set_int(config.get(), DeviceSection(NextDevice(&seed, devices)),
+                   "Timestamp", ++timestamp);
+    CHECK(config_save(*config, filename));
+  }
+  state.SetItemsProcessed(state.iterations());
+  remove(filename.c_str());
+}
+
+// A change to a device appended to the journal, the file being rewritten
+// whenever the journal grows past kJournalMaxSize.
+// Arguments: devices.
+void BM_SaveJournal(State& state) {
+  int devices = state.range(0);
+  const std::string filename = TempPath("config_benchmark.conf");
+  const std::string journal = filename + ".journal";
+  std::unique_ptr<config_t> config = MakeConfig(devices);
+  remove(journal.c_str());
+  config_journal_start(config.get());
+
+  size_t journal_size = 0;
+  int compactions = 0;
+  int timestamp = 0;
+  uint32_t seed = 1;
+  for (auto _ : state) {
+    config_set_int(config.get(), DeviceSection(NextDevice(&seed, devices)),
+                   "Timestamp", ++timestamp);
+    if (journal_size + config->journal.size() > kJournalMaxSize) {
+      CHECK(config_save(*config, filename));
+      remove(journal.c_str());
+      config_journal_start(config.get());
+      journal_size = 0;
+      compactions++;
+    } else {
+      journal_size += config->journal.size();
+      CHECK(config_journal_save(config.get(), journal));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["compactions"] = compactions;
+  remove(filename.c_str());
+  remove(journal.c_str());
+}
+
+BENCHMARK(BM_Load)->ArgName("devices")->Arg(1000)->Arg(10000);
+BENCHMARK(BM_Lookup)->ArgName("devices")->Arg(1000)->Arg(10000);
+BENCHMARK(BM_SaveFull)->ArgName("devices")->Arg(1000)->Arg(10000);
+BENCHMARK(BM_SaveJournal)->ArgName("devices")->Arg(1000)->Arg(10000);
+
+}  // namespace
+
+BENCHMARK_MAIN();
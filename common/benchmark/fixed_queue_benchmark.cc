@@ -0,0 +1,128 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "osi/include/fixed_queue.h"
+#include "osi/include/thread.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr size_t kNumMessagesToSend = 100000;
+constexpr size_t kQueueCapacity = 256;
+
+struct Message {
+  std::chrono::steady_clock::time_point enqueued_at;
+};
+
+// Consumer side state, only touched from the reactor thread while running.
+struct Consumer {
+  size_t received = 0;
+  size_t expected = 0;
+  std::vector<int64_t> latencies_ns;
+  std::unique_ptr<std::promise<void>> done;
+};
+
+void ConsumeOne(fixed_queue_t* queue, void* context) {
+  auto consumer = static_cast<Consumer*>(context);
+  auto message = static_cast<Message*>(fixed_queue_try_dequeue(queue));
+  if (message == nullptr) return;
+  auto now = std::chrono::steady_clock::now();
+  consumer->latencies_ns.push_back(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          now - message->enqueued_at)
+          .count());
+  if (++consumer->received == consumer->expected) consumer->done->set_value();
+}
+
+int64_t Percentile(const std::vector<int64_t>& sorted, double percentile) {
+  if (sorted.empty()) return 0;
+  size_t index = static_cast<size_t>(percentile * (sorted.size() - 1));
+  return sorted[index];
+}
+
+// Sends |kNumMessagesToSend| messages from |state.range(0)| producer threads
+// to a consumer registered with fixed_queue_register_dequeue, the same way
+// the stack threads drain their queues, and reports throughput plus the
+// enqueue-to-dequeue latency distribution.
+void BM_FixedQueue(State& state, fixed_queue_t* (*queue_new)(size_t)) {
+  const size_t num_producers = static_cast<size_t>(state.range(0));
+  const size_t per_producer = kNumMessagesToSend / num_producers;
+  const size_t total = per_producer * num_producers;
+
+  std::vector<Message> messages(total);
+  Consumer consumer;
+  consumer.latencies_ns.reserve(total);
+
+  thread_t* consumer_thread = thread_new("fixed_queue_benchmark");
+  CHECK(consumer_thread != nullptr);
+  fixed_queue_t* queue = queue_new(kQueueCapacity);
+  CHECK(queue != nullptr);
+  fixed_queue_register_dequeue(queue, thread_get_reactor(consumer_thread),
+                               ConsumeOne, &consumer);
+
+  for (auto _ : state) {
+    consumer.received = 0;
+    consumer.expected = total;
+    consumer.done = std::make_unique<std::promise<void>>();
+    std::future<void> done = consumer.done->get_future();
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < num_producers; p++) {
+      producers.emplace_back([&messages, queue, p, per_producer]() {
+        for (size_t i = p * per_producer; i < (p + 1) * per_producer; i++) {
+          messages[i].enqueued_at = std::chrono::steady_clock::now();
+          fixed_queue_enqueue(queue, &messages[i]);
+        }
+      });
+    }
+    for (auto& producer : producers) producer.join();
+    done.wait();
+  }
+
+  fixed_queue_unregister_dequeue(queue);
+  thread_free(consumer_thread);
+  fixed_queue_free(queue, nullptr);
+
+  std::sort(consumer.latencies_ns.begin(), consumer.latencies_ns.end());
+  state.SetItemsProcessed(state.iterations() * total);
+  state.counters["p50_ns"] = Percentile(consumer.latencies_ns, 0.50);
+  state.counters["p99_ns"] = Percentile(consumer.latencies_ns, 0.99);
+  state.counters["p999_ns"] = Percentile(consumer.latencies_ns, 0.999);
+  state.counters["max_ns"] =
+      consumer.latencies_ns.empty() ? 0 : consumer.latencies_ns.back();
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_FixedQueue, list_semaphore, &fixed_queue_new)
+    ->DenseRange(1, 4)
+    ->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_FixedQueue, lock_free_ring, &fixed_queue_new_ring)
+    ->DenseRange(1, 4)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -19,6 +19,7 @@
 #include <base/threading/thread.h>
 #include <benchmark/benchmark.h>
 #include <future>
+#include <vector>
 
 #include "common/message_loop_thread.h"
 #include "common/once_timer.h"
@@ -46,6 +47,8 @@ int g_task_counter;
 
 void TimerFire(void*) { g_promise->set_value(); }
 
+void TimerNeverFires(void*) { CHECK(false) << "Far away alarm fired"; }
+
 void AlarmSleepAndCountDelayedTime(void*) {
   auto end_time_us = time_get_os_boottime_us();
   auto time_after_start_ms = (end_time_us - g_start_time) / 1000;
@@ -268,6 +271,70 @@ BENCHMARK_REGISTER_F(BM_AlarmTaskPeriodicTimer, periodic_accuracy)
     ->Iterations(1)
     ->UseRealTime();
 
+// Keeps |state.range(0)| alarms pending far in the future, so that every
+// alarm_set and alarm_cancel has to find its place among them, like the
+// per-link L2CAP, GATT, SMP and BTM timers do with many LE links connected.
+class BM_OsiAlarmScale : public ::benchmark::Fixture {
+ protected:
+  static constexpr uint64_t kFarAwayMs = 3600 * 1000;
+
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    for (int64_t i = 0; i < st.range(0); i++) {
+      alarm_t* alarm = alarm_new("osi_alarm_scale_test");
+      alarm_set(alarm, kFarAwayMs + i, &TimerNeverFires, nullptr);
+      pending_alarms_.push_back(alarm);
+    }
+    probe_alarm_ = alarm_new("osi_alarm_scale_probe");
+  }
+
+  void TearDown(State& st) override {
+    alarm_free(probe_alarm_);
+    probe_alarm_ = nullptr;
+    for (alarm_t* alarm : pending_alarms_) alarm_free(alarm);
+    pending_alarms_.clear();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  std::vector<alarm_t*> pending_alarms_;
+  alarm_t* probe_alarm_ = nullptr;
+};
+
+BENCHMARK_DEFINE_F(BM_OsiAlarmScale, set_cancel)(State& state) {
+  uint64_t offset_ms = 0;
+  for (auto _ : state) {
+    // Land in the middle of the pending alarms rather than at either end
+    alarm_set(probe_alarm_, kFarAwayMs + (offset_ms++ % state.range(0)),
+              &TimerNeverFires, nullptr);
+    alarm_cancel(probe_alarm_);
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+};
+
+BENCHMARK_REGISTER_F(BM_OsiAlarmScale, set_cancel)
+    ->Arg(1000)
+    ->Arg(2000)
+    ->Arg(5000)
+    ->Arg(10000);
+
+BENCHMARK_DEFINE_F(BM_OsiAlarmScale, reschedule)(State& state) {
+  // Re-arm the pending alarms one after the other, the way periodic and
+  // restarted timers are reinserted on every tick.
+  size_t next = 0;
+  for (auto _ : state) {
+    alarm_set(pending_alarms_[next], kFarAwayMs + next, &TimerNeverFires,
+              nullptr);
+    next = (next + 1) % pending_alarms_.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiAlarmScale, reschedule)
+    ->Arg(1000)
+    ->Arg(2000)
+    ->Arg(5000)
+    ->Arg(10000);
+
 int main(int argc, char** argv) {
   // Disable LOG() output from libchrome
   logging::LoggingSettings log_settings;
@@ -65,6 +65,13 @@
 
 #define SBC_NULL 0
 
+/* analysis filterbank kernels, see SBC_Encoder_SetKernels() */
+#define SBC_KERNELS_AUTO 0
+#define SBC_KERNELS_C 1
+#define SBC_KERNELS_SSE2 2
+#define SBC_KERNELS_AVX2 3
+#define SBC_KERNELS_NEON 4
+
 #ifndef SBC_MAX_NUM_FRAME
 #define SBC_MAX_NUM_FRAME 1
 #endif
@@ -138,6 +145,13 @@
 #define SBC_FAST_DCT TRUE
 #endif /*SBC_FAST_DCT */
 
+/* Set SBC_SIMD_OPT to FALSE to always use the scalar analysis filterbank. The
+ * vectorized kernels are only built with the default SBC_IPAQ_OPT arithmetic,
+ * which they reproduce bit for bit. */
+#ifndef SBC_SIMD_OPT
+#define SBC_SIMD_OPT TRUE
+#endif
+
 /* In case we do not use joint stereo mode the flag save some RAM and ROM in
  * case it is set to FALSE */
 #ifndef SBC_JOINT_STE_INCLUDED
@@ -185,6 +199,21 @@ typedef struct SBC_ENC_PARAMS_TAG {
 
   uint16_t FrameHeader;
 
+  /* State of the encoder, set up by SBC_Encoder_Init(). Every instance
+   * encodes independently of the others, so separate instances can be used
+   * from separate threads. */
+  const struct SBC_ANALYSIS_KERNELS_TAG* pAnalysisKernels;
+  int16_t s16ShiftCounter;
+  int16_t s16MaxShiftCounter;
+  /* analysis filter history, as int16_t; 32 bits aligned cf SHIFTUP_X8_2 */
+  int32_t s32X[ENC_VX_BUFFER_SIZE / 2];
+  /* windowed samples of all the blocks of a frame, before the matrixing */
+  int32_t s32DCTY[SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * 2 *
+                  SBC_MAX_NUM_OF_SUBBANDS];
+#if (SBC_JOINT_STE_INCLUDED == TRUE)
+  int32_t s32LRSum[SBC_MAX_NUM_OF_BLOCKS];
+  int32_t s32LRDiff[SBC_MAX_NUM_OF_BLOCKS];
+#endif
 } SBC_ENC_PARAMS;
 
 #ifdef __cplusplus
@@ -197,6 +226,12 @@ extern uint32_t SBC_Encode(SBC_ENC_PARAMS* strEncParams, int16_t* input,
                            uint8_t* output);
 extern void SBC_Encoder_Init(SBC_ENC_PARAMS* strEncParams);
 
+/* Selects the analysis filterbank kernels used by the encoders initialized
+ * after this call. By default (SBC_KERNELS_AUTO) the fastest kernels the CPU
+ * supports are used. All the kernels produce the same bitstream. Returns false
+ * if |kernels| are not available in this build or on this CPU. */
+extern bool SBC_Encoder_SetKernels(int16_t kernels);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,179 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Kernels of the analysis filterbank, and the vectorized versions of them.
+ *
+ ******************************************************************************/
+
+#ifndef SBC_SIMD_H
+#define SBC_SIMD_H
+
+#include "sbc_dct.h"
+#include "sbc_encoder.h"
+
+/* The vectorized kernels implement the 16 bit windowing and the 32x16 bit
+ * fast DCT arithmetic of SBC_IPAQ_OPT only. */
+#if (SBC_SIMD_OPT == TRUE && SBC_ARM_ASM_OPT == FALSE && \
+     SBC_IPAQ_OPT == TRUE && SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE && \
+     SBC_IS_64_MULT_IN_IDCT == FALSE && SBC_FAST_DCT == TRUE)
+#if (defined(__x86_64__) || defined(__i386__))
+#define SBC_SIMD_X86 TRUE
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define SBC_SIMD_NEON TRUE
+#endif
+#endif
+
+#ifndef SBC_SIMD_X86
+#define SBC_SIMD_X86 FALSE
+#endif
+
+#ifndef SBC_SIMD_NEON
+#define SBC_SIMD_NEON FALSE
+#endif
+
+/* Windowing of one block of one channel. |x| points at the 10 * nsb samples
+ * of the channel, newest first, and |y| receives the 2 * nsb partial sums. */
+typedef void (*tSBC_WINDOW)(const int16_t* x, int32_t* y);
+
+/* Matrixing of |count| blocks. Reads 2 * nsb partial sums and writes nsb
+ * subband samples per block. */
+typedef void (*tSBC_MATRIX)(const int32_t* y, int32_t* sb, int32_t count);
+
+typedef struct SBC_ANALYSIS_KERNELS_TAG {
+  tSBC_WINDOW window4;
+  tSBC_WINDOW window8;
+  tSBC_MATRIX dct4;
+  tSBC_MATRIX dct8;
+} tSBC_ANALYSIS_KERNELS;
+
+#if (SBC_SIMD_X86 == TRUE || SBC_SIMD_NEON == TRUE)
+/* Windowing coefficients, with the partial sum of the output m as the sum of
+ * the products of taps j and samples x[j * 2 * nsb + m], for j = 0..4. The
+ * taps of rows j and j + 1 are interleaved for each m, and the fifth row is
+ * padded with zeros:
+ *   gas16WindowTaps8[p * 32 + 2 * m + i] = tap 2 * p + i of output m. */
+extern const int16_t gas16WindowTaps4[3 * 2 * 8];
+extern const int16_t gas16WindowTaps8[3 * 2 * 16];
+#endif
+
+#if (SBC_SIMD_X86 == TRUE)
+extern const tSBC_ANALYSIS_KERNELS sbc_kernels_sse2;
+extern const tSBC_ANALYSIS_KERNELS sbc_kernels_avx2;
+extern bool sbc_cpu_has_sse2(void);
+extern bool sbc_cpu_has_avx2(void);
+#endif
+
+#if (SBC_SIMD_NEON == TRUE)
+extern const tSBC_ANALYSIS_KERNELS sbc_kernels_neon;
+#endif
+
+/* Fast DCT of the SBC_IPAQ_OPT path, on vectors holding the same coefficient
+ * of several blocks. The user defines the vector operations:
+ *   SBC_V_ADD(a, b), SBC_V_SUB(a, b)  32 bit wrapping addition, subtraction
+ *   SBC_V_SRA1(a), SBC_V_SHL1(a)      shift by one bit
+ *   SBC_V_MULT(c, a)                  (int32_t)(((int64_t)c * a) >> 15) for a
+ *                                     constant 0 <= c < 0x8000
+ * and the statements use the very same order of operations as SBC_FastIDCT8
+ * and SBC_FastIDCT4, so the results are bit exact. */
+#define SBC_FAST_IDCT8_LANES(V, in, out)                                     \
+  {                                                                          \
+    V x0, x1, x2, x3, x4, x5, x6, x7, temp;                                  \
+    V even0, even1, even2, even3, odd0, odd1, odd2, odd3;                    \
+    x0 = SBC_V_MULT(SBC_COS_PI_SUR_4, in[4]);                                \
+    x1 = SBC_V_SRA1(SBC_V_ADD(in[3], in[5]));                                \
+    x2 = SBC_V_SRA1(SBC_V_ADD(in[2], in[6]));                                \
+    x3 = SBC_V_SRA1(SBC_V_ADD(in[1], in[7]));                                \
+    x4 = SBC_V_SRA1(SBC_V_ADD(in[0], in[8]));                                \
+    x5 = SBC_V_SRA1(SBC_V_SUB(in[9], in[15]));                               \
+    x6 = SBC_V_SRA1(SBC_V_SUB(in[10], in[14]));                              \
+    x7 = SBC_V_SRA1(SBC_V_SUB(in[11], in[13]));                              \
+                                                                             \
+    temp = x0;                                                               \
+    x0 = SBC_V_MULT(SBC_COS_PI_SUR_4, SBC_V_ADD(x0, x4));                    \
+    x4 = SBC_V_MULT(SBC_COS_PI_SUR_4, SBC_V_SUB(temp, x4));                  \
+                                                                             \
+    x2 = SBC_V_SUB(x2, x6);                                                  \
+    x6 = SBC_V_SHL1(x6);                                                     \
+    x6 = SBC_V_MULT(SBC_COS_PI_SUR_4, x6);                                   \
+    temp = x2;                                                               \
+    x2 = SBC_V_MULT(SBC_COS_PI_SUR_8, SBC_V_ADD(x2, x6));                    \
+    x6 = SBC_V_MULT(SBC_COS_3PI_SUR_8, SBC_V_SUB(temp, x6));                 \
+                                                                             \
+    even0 = SBC_V_ADD(x0, x2);                                               \
+    even1 = SBC_V_ADD(x4, x6);                                               \
+    even2 = SBC_V_SUB(x4, x6);                                               \
+    even3 = SBC_V_SUB(x0, x2);                                               \
+                                                                             \
+    x7 = SBC_V_SHL1(x7);                                                     \
+    x5 = SBC_V_SUB(SBC_V_SHL1(x5), x7);                                      \
+    x3 = SBC_V_SUB(SBC_V_SHL1(x3), x5);                                      \
+    x1 = SBC_V_SUB(x1, SBC_V_SRA1(x3));                                      \
+                                                                             \
+    x5 = SBC_V_MULT(SBC_COS_PI_SUR_4, x5);                                   \
+    temp = x1;                                                               \
+    x1 = SBC_V_ADD(x1, x5);                                                  \
+    x5 = SBC_V_SUB(temp, x5);                                                \
+                                                                             \
+    x3 = SBC_V_SUB(x3, x7);                                                  \
+    x7 = SBC_V_SHL1(x7);                                                     \
+    x7 = SBC_V_MULT(SBC_COS_PI_SUR_4, x7);                                   \
+                                                                             \
+    temp = x3;                                                               \
+    x3 = SBC_V_MULT(SBC_COS_PI_SUR_8, SBC_V_ADD(x3, x7));                    \
+    x7 = SBC_V_MULT(SBC_COS_3PI_SUR_8, SBC_V_SUB(temp, x7));                 \
+                                                                             \
+    odd0 = SBC_V_MULT(SBC_COS_PI_SUR_16, SBC_V_ADD(x1, x3));                 \
+    odd1 = SBC_V_MULT(SBC_COS_3PI_SUR_16, SBC_V_ADD(x5, x7));                \
+    odd2 = SBC_V_MULT(SBC_COS_5PI_SUR_16, SBC_V_SUB(x5, x7));                \
+    odd3 = SBC_V_MULT(SBC_COS_7PI_SUR_16, SBC_V_SUB(x1, x3));                \
+                                                                             \
+    out[0] = SBC_V_ADD(even0, odd0);                                         \
+    out[1] = SBC_V_ADD(even1, odd1);                                         \
+    out[2] = SBC_V_ADD(even2, odd2);                                         \
+    out[3] = SBC_V_ADD(even3, odd3);                                         \
+    out[7] = SBC_V_SUB(even0, odd0);                                         \
+    out[6] = SBC_V_SUB(even1, odd1);                                         \
+    out[5] = SBC_V_SUB(even2, odd2);                                         \
+    out[4] = SBC_V_SUB(even3, odd3);                                         \
+  }
+
+#define SBC_FAST_IDCT4_LANES(V, in, out)                                     \
+  {                                                                          \
+    V temp, x2, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;              \
+    x2 = SBC_V_SRA1(in[2]);                                                  \
+    temp = SBC_V_ADD(in[0], in[4]);                                          \
+    tmp0 = SBC_V_MULT(SBC_COS_PI_SUR_4 >> 1, temp);                          \
+    tmp1 = SBC_V_SUB(x2, tmp0);                                              \
+    tmp0 = SBC_V_ADD(tmp0, x2);                                              \
+    temp = SBC_V_ADD(in[1], in[3]);                                          \
+    tmp3 = SBC_V_MULT(SBC_COS_3PI_SUR_8 >> 1, temp);                         \
+    tmp2 = SBC_V_MULT(SBC_COS_PI_SUR_8 >> 1, temp);                          \
+    temp = SBC_V_SUB(in[5], in[7]);                                          \
+    tmp5 = SBC_V_MULT(SBC_COS_3PI_SUR_8 >> 1, temp);                         \
+    tmp4 = SBC_V_MULT(SBC_COS_PI_SUR_8 >> 1, temp);                          \
+    tmp6 = SBC_V_ADD(tmp2, tmp5);                                            \
+    tmp7 = SBC_V_SUB(tmp3, tmp4);                                            \
+    out[0] = SBC_V_ADD(tmp0, tmp6);                                          \
+    out[1] = SBC_V_ADD(tmp1, tmp7);                                          \
+    out[2] = SBC_V_SUB(tmp1, tmp7);                                          \
+    out[3] = SBC_V_SUB(tmp0, tmp6);                                          \
+  }
+
+#endif
@@ -25,6 +25,7 @@
 #include <string.h>
 #include "sbc_enc_func_declare.h"
 #include "sbc_encoder.h"
+#include "sbc_simd.h"
 /*#include <math.h>*/
 
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
@@ -197,17 +198,6 @@
 #define WIND_8_SUBBANDS_8_2 (int16_t)0x12CF /* 40 = 0x12CF6C75 */
 #endif
 
-#if (SBC_USE_ARM_PRAGMA == TRUE)
-#pragma arm section zidata = "sbc_s32_analysis_section"
-#endif
-static int32_t s32DCTY[16] = {0};
-static int32_t s32X[ENC_VX_BUFFER_SIZE / 2];
-static int16_t* s16X =
-    (int16_t*)s32X; /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
-#if (SBC_USE_ARM_PRAGMA == TRUE)
-#pragma arm section zidata
-#endif
-
 /* This macro is for 4 subbands */
 #define SHIFTUP_X4                                      \
   {                                                     \
@@ -1185,20 +1175,66 @@ static int16_t* s16X =
 #endif
 #endif
 
-static int16_t ShiftCounter = 0;
-extern int16_t EncMaxShiftCounter;
-/****************************************************************************
-* SbcAnalysisFilter - performs Analysis of the input audio stream
-*
-* RETURNS : N/A
-*/
-void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
-  int16_t* ps16PcmBuf;
-  int32_t* ps32SbBuf;
-  int32_t s32Blk, s32Ch;
-  int32_t s32NumOfChannels, s32NumOfBlocks;
-  int32_t i, *ps32X, *ps32X2;
-  int32_t Offset, Offset2, ChOffset;
+#if (SBC_SIMD_X86 == TRUE || SBC_SIMD_NEON == TRUE)
+const int16_t gas16WindowTaps4[3 * 2 * 8] = {
+    /* taps 0 and 1 */
+    0, WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_0, WIND_4_SUBBANDS_1_1,
+    WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_3_0,
+    WIND_4_SUBBANDS_3_1, WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_4_1,
+    WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_3_3, WIND_4_SUBBANDS_2_4,
+    WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_1_4, WIND_4_SUBBANDS_1_3,
+    /* taps 2 and 3 */
+    WIND_4_SUBBANDS_0_2, -WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_2,
+    WIND_4_SUBBANDS_1_3, WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_2_3,
+    WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_3_3, WIND_4_SUBBANDS_4_2,
+    WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_3_1,
+    WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_1_2,
+    WIND_4_SUBBANDS_1_1,
+    /* tap 4 */
+    -WIND_4_SUBBANDS_0_1, 0, WIND_4_SUBBANDS_1_4, 0, WIND_4_SUBBANDS_2_4, 0,
+    WIND_4_SUBBANDS_3_4, 0, WIND_4_SUBBANDS_4_0, 0, WIND_4_SUBBANDS_3_0, 0,
+    WIND_4_SUBBANDS_2_0, 0, WIND_4_SUBBANDS_1_0, 0};
+
+const int16_t gas16WindowTaps8[3 * 2 * 16] = {
+    /* taps 0 and 1 */
+    0, WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_0, WIND_8_SUBBANDS_1_1,
+    WIND_8_SUBBANDS_2_0, WIND_8_SUBBANDS_2_1, WIND_8_SUBBANDS_3_0,
+    WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_4_1,
+    WIND_8_SUBBANDS_5_0, WIND_8_SUBBANDS_5_1, WIND_8_SUBBANDS_6_0,
+    WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_7_1,
+    WIND_8_SUBBANDS_8_0, WIND_8_SUBBANDS_8_1, WIND_8_SUBBANDS_7_4,
+    WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_6_3,
+    WIND_8_SUBBANDS_5_4, WIND_8_SUBBANDS_5_3, WIND_8_SUBBANDS_4_4,
+    WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_3_3,
+    WIND_8_SUBBANDS_2_4, WIND_8_SUBBANDS_2_3, WIND_8_SUBBANDS_1_4,
+    WIND_8_SUBBANDS_1_3,
+    /* taps 2 and 3 */
+    WIND_8_SUBBANDS_0_2, -WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_2,
+    WIND_8_SUBBANDS_1_3, WIND_8_SUBBANDS_2_2, WIND_8_SUBBANDS_2_3,
+    WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_4_2,
+    WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_5_2, WIND_8_SUBBANDS_5_3,
+    WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_7_2,
+    WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_8_2, WIND_8_SUBBANDS_8_1,
+    WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_6_2,
+    WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_5_2, WIND_8_SUBBANDS_5_1,
+    WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_3_2,
+    WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_2_2, WIND_8_SUBBANDS_2_1,
+    WIND_8_SUBBANDS_1_2, WIND_8_SUBBANDS_1_1,
+    /* tap 4 */
+    -WIND_8_SUBBANDS_0_1, 0, WIND_8_SUBBANDS_1_4, 0, WIND_8_SUBBANDS_2_4, 0,
+    WIND_8_SUBBANDS_3_4, 0, WIND_8_SUBBANDS_4_4, 0, WIND_8_SUBBANDS_5_4, 0,
+    WIND_8_SUBBANDS_6_4, 0, WIND_8_SUBBANDS_7_4, 0, WIND_8_SUBBANDS_8_0, 0,
+    WIND_8_SUBBANDS_7_0, 0, WIND_8_SUBBANDS_6_0, 0, WIND_8_SUBBANDS_5_0, 0,
+    WIND_8_SUBBANDS_4_0, 0, WIND_8_SUBBANDS_3_0, 0, WIND_8_SUBBANDS_2_0, 0,
+    WIND_8_SUBBANDS_1_0, 0};
+#endif
+
+/* The WINDOW_ACCU macros read s16X[ChOffset + n] and write s32DCTY[n], so the
+ * scalar kernels shadow those names with their arguments. */
+static void sbc_window4_c(const int16_t* x, int32_t* y) {
+  const int16_t* s16X = x;
+  const int32_t ChOffset = 0;
+  int32_t* s32DCTY = y;
 #if (SBC_ARM_ASM_OPT == TRUE)
   register int32_t s32Hi, s32Hi2;
 #else
@@ -1217,12 +1253,110 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
 #endif
 #endif
 
+  WINDOW_PARTIAL_4
+}
+
+static void sbc_window8_c(const int16_t* x, int32_t* y) {
+  const int16_t* s16X = x;
+  const int32_t ChOffset = 0;
+  int32_t* s32DCTY = y;
+#if (SBC_ARM_ASM_OPT == TRUE)
+  register int32_t s32Hi, s32Hi2;
+#else
+#if (SBC_IPAQ_OPT == TRUE)
+#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
+  register int64_t s64Temp, s64Temp2;
+#else
+  register int32_t s32Temp, s32Temp2;
+#endif
+#else
+#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
+  int64_t s64Temp;
+#endif
+#endif
+#endif
+
+  WINDOW_PARTIAL_8
+}
+
+static void sbc_dct4_c(const int32_t* y, int32_t* sb, int32_t count) {
+  for (; count > 0; count--, y += 2 * SUB_BANDS_4, sb += SUB_BANDS_4)
+    SBC_FastIDCT4((int32_t*)y, sb);
+}
+
+static void sbc_dct8_c(const int32_t* y, int32_t* sb, int32_t count) {
+  for (; count > 0; count--, y += 2 * SUB_BANDS_8, sb += SUB_BANDS_8)
+    SBC_FastIDCT8((int32_t*)y, sb);
+}
+
+static const tSBC_ANALYSIS_KERNELS sbc_kernels_c = {
+    sbc_window4_c, sbc_window8_c, sbc_dct4_c, sbc_dct8_c};
+
+static const tSBC_ANALYSIS_KERNELS* sbc_kernels = NULL;
+
+/****************************************************************************
+* SbcSelectKernels - picks the analysis filterbank kernels
+*
+* RETURNS : the kernels, or NULL if they are not available on this CPU
+*/
+static const tSBC_ANALYSIS_KERNELS* SbcSelectKernels(int16_t kernels) {
+  switch (kernels) {
+    case SBC_KERNELS_AUTO:
+#if (SBC_SIMD_X86 == TRUE)
+      if (sbc_cpu_has_avx2()) return &sbc_kernels_avx2;
+      if (sbc_cpu_has_sse2()) return &sbc_kernels_sse2;
+#endif
+#if (SBC_SIMD_NEON == TRUE)
+      return &sbc_kernels_neon;
+#endif
+      return &sbc_kernels_c;
+    case SBC_KERNELS_C:
+      return &sbc_kernels_c;
+#if (SBC_SIMD_X86 == TRUE)
+    case SBC_KERNELS_SSE2:
+      return sbc_cpu_has_sse2() ? &sbc_kernels_sse2 : NULL;
+    case SBC_KERNELS_AVX2:
+      return sbc_cpu_has_avx2() ? &sbc_kernels_avx2 : NULL;
+#endif
+#if (SBC_SIMD_NEON == TRUE)
+    case SBC_KERNELS_NEON:
+      return &sbc_kernels_neon;
+#endif
+    default:
+      return NULL;
+  }
+}
+
+bool SBC_Encoder_SetKernels(int16_t kernels) {
+  const tSBC_ANALYSIS_KERNELS* selected = SbcSelectKernels(kernels);
+  if (selected == NULL) return false;
+  sbc_kernels = selected;
+  return true;
+}
+
+/****************************************************************************
+* SbcAnalysisFilter - performs Analysis of the input audio stream
+*
+* RETURNS : N/A
+*/
+void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
+  int16_t* ps16PcmBuf;
+  int32_t* ps32Y;
+  int32_t s32Blk, s32Ch;
+  int32_t s32NumOfChannels, s32NumOfBlocks;
+  int32_t i, *ps32X, *ps32X2;
+  int32_t Offset, Offset2, ChOffset;
+  int16_t* s16X = (int16_t*)pstrEncParams->s32X;
+  int16_t ShiftCounter = pstrEncParams->s16ShiftCounter;
+  const int16_t EncMaxShiftCounter = pstrEncParams->s16MaxShiftCounter;
+  const tSBC_ANALYSIS_KERNELS* kernels = pstrEncParams->pAnalysisKernels;
+
   s32NumOfChannels = pstrEncParams->s16NumOfChannels;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 
   ps16PcmBuf = input;
 
-  ps32SbBuf = pstrEncParams->s32SbBuffer;
+  ps32Y = pstrEncParams->s32DCTY;
   Offset2 = (int32_t)(EncMaxShiftCounter + 40);
   for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++) {
     Offset = (int32_t)(EncMaxShiftCounter - ShiftCounter);
@@ -1257,11 +1391,9 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_4
-
-      SBC_FastIDCT4(s32DCTY, ps32SbBuf);
+      kernels->window4(s16X + ChOffset, ps32Y);
 
-      ps32SbBuf += SUB_BANDS_4;
+      ps32Y += 2 * SUB_BANDS_4;
     }
     if (s32NumOfChannels == 1) {
       if (ShiftCounter >= EncMaxShiftCounter) {
@@ -1279,39 +1411,34 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+
+  pstrEncParams->s16ShiftCounter = ShiftCounter;
+
+  /* the matrixing of all the blocks is independent of the sample buffer */
+  kernels->dct4(pstrEncParams->s32DCTY, pstrEncParams->s32SbBuffer,
+                s32NumOfBlocks * s32NumOfChannels);
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
   int16_t* ps16PcmBuf;
-  int32_t* ps32SbBuf;
+  int32_t* ps32Y;
   int32_t s32Blk, s32Ch; /* counter for block*/
   int32_t Offset, Offset2;
   int32_t s32NumOfChannels, s32NumOfBlocks;
   int32_t i, *ps32X, *ps32X2;
   int32_t ChOffset;
-#if (SBC_ARM_ASM_OPT == TRUE)
-  register int32_t s32Hi, s32Hi2;
-#else
-#if (SBC_IPAQ_OPT == TRUE)
-#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
-  register int64_t s64Temp, s64Temp2;
-#else
-  register int32_t s32Temp, s32Temp2;
-#endif
-#else
-#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
-  int64_t s64Temp;
-#endif
-#endif
-#endif
+  int16_t* s16X = (int16_t*)pstrEncParams->s32X;
+  int16_t ShiftCounter = pstrEncParams->s16ShiftCounter;
+  const int16_t EncMaxShiftCounter = pstrEncParams->s16MaxShiftCounter;
+  const tSBC_ANALYSIS_KERNELS* kernels = pstrEncParams->pAnalysisKernels;
 
   s32NumOfChannels = pstrEncParams->s16NumOfChannels;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 
   ps16PcmBuf = input;
 
-  ps32SbBuf = pstrEncParams->s32SbBuffer;
+  ps32Y = pstrEncParams->s32DCTY;
   Offset2 = (int32_t)(EncMaxShiftCounter + 80);
   for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++) {
     Offset = (int32_t)(EncMaxShiftCounter - ShiftCounter);
@@ -1370,11 +1497,9 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_8
-
-      SBC_FastIDCT8(s32DCTY, ps32SbBuf);
+      kernels->window8(s16X + ChOffset, ps32Y);
 
-      ps32SbBuf += SUB_BANDS_8;
+      ps32Y += 2 * SUB_BANDS_8;
     }
     if (s32NumOfChannels == 1) {
       if (ShiftCounter >= EncMaxShiftCounter) {
@@ -1392,9 +1517,17 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+
+  pstrEncParams->s16ShiftCounter = ShiftCounter;
+
+  /* the matrixing of all the blocks is independent of the sample buffer */
+  kernels->dct8(pstrEncParams->s32DCTY, pstrEncParams->s32SbBuffer,
+                s32NumOfBlocks * s32NumOfChannels);
 }
 
-void SbcAnalysisInit(void) {
-  memset(s16X, 0, ENC_VX_BUFFER_SIZE * sizeof(int16_t));
-  ShiftCounter = 0;
+void SbcAnalysisInit(SBC_ENC_PARAMS* pstrEncParams) {
+  memset(pstrEncParams->s32X, 0, sizeof(pstrEncParams->s32X));
+  pstrEncParams->s16ShiftCounter = 0;
+  pstrEncParams->pAnalysisKernels =
+      sbc_kernels ? sbc_kernels : SbcSelectKernels(SBC_KERNELS_AUTO);
 }
@@ -0,0 +1,134 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  NEON kernels of the analysis filterbank. The windowing computes the
+ *  partial sums of 4 outputs at once with widening multiply-accumulates, and
+ *  the matrixing runs the fast DCT of 4 blocks at once with one block per
+ *  32 bit lane.
+ *
+ *  NEON is part of every ARMv8 core and of every ARMv7 core Android runs on,
+ *  so these kernels are used whenever the compiler targets it.
+ *
+ ******************************************************************************/
+
+#include "sbc_simd.h"
+
+#if (SBC_SIMD_NEON == TRUE)
+
+#include <arm_neon.h>
+
+/* Partial sums of outputs m .. m + 3. |taps| points at the interleaved taps of
+ * output m, |n| is 2 * nsb. */
+static inline int32x4_t sbc_window_sum_neon(const int16_t* x,
+                                            const int16_t* taps, int n) {
+  int16x4x2_t t01 = vld2_s16(taps);
+  int16x4x2_t t23 = vld2_s16(taps + 2 * n);
+  int16x4x2_t t4_ = vld2_s16(taps + 4 * n);
+  int32x4_t y = vmull_s16(vld1_s16(x + 0 * n), t01.val[0]);
+  y = vmlal_s16(y, vld1_s16(x + 1 * n), t01.val[1]);
+  y = vmlal_s16(y, vld1_s16(x + 2 * n), t23.val[0]);
+  y = vmlal_s16(y, vld1_s16(x + 3 * n), t23.val[1]);
+  return vmlal_s16(y, vld1_s16(x + 4 * n), t4_.val[0]);
+}
+
+static void sbc_window4_neon(const int16_t* x, int32_t* y) {
+  int m;
+  for (m = 0; m < 8; m += 4)
+    vst1q_s32(y + m, sbc_window_sum_neon(x + m, gas16WindowTaps4 + 2 * m, 8));
+}
+
+static void sbc_window8_neon(const int16_t* x, int32_t* y) {
+  int m;
+  for (m = 0; m < 16; m += 4)
+    vst1q_s32(y + m, sbc_window_sum_neon(x + m, gas16WindowTaps8 + 2 * m, 16));
+}
+
+/* (int32_t)(((int64_t)c * a) >> 15) for 0 <= c < 0x8000, from the signed
+ * upper and unsigned lower halves of a, as in SBC_IDCT_MULT. */
+static inline int32x4_t sbc_mult_neon(int32_t c, int32x4_t a) {
+  int32x4_t hi = vshlq_n_s32(vmulq_n_s32(vshrq_n_s32(a, 16), c), 1);
+  uint32x4_t lo = vandq_u32(vreinterpretq_u32_s32(a), vdupq_n_u32(0xffff));
+  lo = vshrq_n_u32(vmulq_n_u32(lo, (uint32_t)c), 15);
+  return vaddq_s32(hi, vreinterpretq_s32_u32(lo));
+}
+
+#define SBC_V_ADD(a, b) vaddq_s32(a, b)
+#define SBC_V_SUB(a, b) vsubq_s32(a, b)
+#define SBC_V_SRA1(a) vshrq_n_s32(a, 1)
+#define SBC_V_SHL1(a) vshlq_n_s32(a, 1)
+#define SBC_V_MULT(c, a) sbc_mult_neon(c, a)
+
+/* Loads coefficients 4 * q .. 4 * q + 3 of the 4 blocks at |y|, |n| apart,
+ * into one vector per coefficient. */
+static inline void sbc_load4x4_neon(const int32_t* y, int n, int q,
+                                    int32x4_t* v) {
+  int32x4x2_t r01 =
+      vtrnq_s32(vld1q_s32(y + 0 * n + 4 * q), vld1q_s32(y + 1 * n + 4 * q));
+  int32x4x2_t r23 =
+      vtrnq_s32(vld1q_s32(y + 2 * n + 4 * q), vld1q_s32(y + 3 * n + 4 * q));
+  v[0] = vcombine_s32(vget_low_s32(r01.val[0]), vget_low_s32(r23.val[0]));
+  v[1] = vcombine_s32(vget_low_s32(r01.val[1]), vget_low_s32(r23.val[1]));
+  v[2] = vcombine_s32(vget_high_s32(r01.val[0]), vget_high_s32(r23.val[0]));
+  v[3] = vcombine_s32(vget_high_s32(r01.val[1]), vget_high_s32(r23.val[1]));
+}
+
+static inline void sbc_store4x4_neon(int32_t* sb, int n, int q,
+                                     const int32x4_t* v) {
+  int32x4x2_t r01 = vtrnq_s32(v[0], v[1]);
+  int32x4x2_t r23 = vtrnq_s32(v[2], v[3]);
+  vst1q_s32(sb + 0 * n + 4 * q,
+            vcombine_s32(vget_low_s32(r01.val[0]), vget_low_s32(r23.val[0])));
+  vst1q_s32(sb + 1 * n + 4 * q,
+            vcombine_s32(vget_low_s32(r01.val[1]), vget_low_s32(r23.val[1])));
+  vst1q_s32(sb + 2 * n + 4 * q,
+            vcombine_s32(vget_high_s32(r01.val[0]), vget_high_s32(r23.val[0])));
+  vst1q_s32(sb + 3 * n + 4 * q,
+            vcombine_s32(vget_high_s32(r01.val[1]), vget_high_s32(r23.val[1])));
+}
+
+static void sbc_dct4_neon(const int32_t* y, int32_t* sb, int32_t count) {
+  for (; count >= 4; count -= 4, y += 4 * 8, sb += 4 * 4) {
+    int32x4_t in[8], out[4];
+    sbc_load4x4_neon(y, 8, 0, in + 0);
+    sbc_load4x4_neon(y, 8, 1, in + 4);
+    SBC_FAST_IDCT4_LANES(int32x4_t, in, out);
+    sbc_store4x4_neon(sb, 4, 0, out);
+  }
+  for (; count > 0; count--, y += 8, sb += 4) SBC_FastIDCT4((int32_t*)y, sb);
+}
+
+static void sbc_dct8_neon(const int32_t* y, int32_t* sb, int32_t count) {
+  for (; count >= 4; count -= 4, y += 4 * 16, sb += 4 * 8) {
+    int32x4_t in[16], out[8];
+    sbc_load4x4_neon(y, 16, 0, in + 0);
+    sbc_load4x4_neon(y, 16, 1, in + 4);
+    sbc_load4x4_neon(y, 16, 2, in + 8);
+    sbc_load4x4_neon(y, 16, 3, in + 12);
+    SBC_FAST_IDCT8_LANES(int32x4_t, in, out);
+    sbc_store4x4_neon(sb, 8, 0, out + 0);
+    sbc_store4x4_neon(sb, 8, 1, out + 4);
+  }
+  for (; count > 0; count--, y += 16, sb += 8) SBC_FastIDCT8((int32_t*)y, sb);
+}
+
+const tSBC_ANALYSIS_KERNELS sbc_kernels_neon = {
+    sbc_window4_neon, sbc_window8_neon, sbc_dct4_neon, sbc_dct8_neon};
+
+#endif
@@ -0,0 +1,336 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  SSE2 and AVX2 kernels of the analysis filterbank. The windowing computes
+ *  the partial sums of several outputs at once with 16x16 bit multiply-adds,
+ *  and the matrixing runs the fast DCT of 4 (SSE2) or 8 (AVX2) blocks at once
+ *  with one block per 32 bit lane.
+ *
+ *  The kernels are compiled for their instruction set with target attributes
+ *  and only used after checking the CPU, see SBC_Encoder_SetKernels().
+ *
+ ******************************************************************************/
+
+#include "sbc_simd.h"
+
+#if (SBC_SIMD_X86 == TRUE)
+
+#include <immintrin.h>
+
+#define SBC_SSE2 __attribute__((target("sse2")))
+#define SBC_AVX2 __attribute__((target("avx2")))
+
+bool sbc_cpu_has_sse2(void) {
+#if defined(__x86_64__)
+  return true;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool sbc_cpu_has_avx2(void) {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+/*******************************************************************************
+ * SSE2
+ ******************************************************************************/
+
+/* Partial sums of 4 outputs from the sample pairs |x01|, |x23| and |x4_|
+ * interleaved like |taps|, which points at the taps of the first output. */
+static inline SBC_SSE2 __m128i sbc_window_sum_sse2(__m128i x01, __m128i x23,
+                                                   __m128i x4_,
+                                                   const int16_t* taps,
+                                                   int pair_stride) {
+  __m128i y = _mm_madd_epi16(x01, _mm_loadu_si128((const __m128i*)taps));
+  y = _mm_add_epi32(y, _mm_madd_epi16(x23, _mm_loadu_si128((const __m128i*)(
+                                               taps + pair_stride))));
+  return _mm_add_epi32(y, _mm_madd_epi16(x4_, _mm_loadu_si128((
+                                                  const __m128i*)(
+                                                  taps + 2 * pair_stride))));
+}
+
+static SBC_SSE2 void sbc_window4_sse2(const int16_t* x, int32_t* y) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i x0 = _mm_loadu_si128((const __m128i*)(x + 0 * 8));
+  __m128i x1 = _mm_loadu_si128((const __m128i*)(x + 1 * 8));
+  __m128i x2 = _mm_loadu_si128((const __m128i*)(x + 2 * 8));
+  __m128i x3 = _mm_loadu_si128((const __m128i*)(x + 3 * 8));
+  __m128i x4 = _mm_loadu_si128((const __m128i*)(x + 4 * 8));
+
+  _mm_storeu_si128(
+      (__m128i*)(y + 0),
+      sbc_window_sum_sse2(_mm_unpacklo_epi16(x0, x1), _mm_unpacklo_epi16(x2, x3),
+                          _mm_unpacklo_epi16(x4, zero), gas16WindowTaps4 + 0,
+                          16));
+  _mm_storeu_si128(
+      (__m128i*)(y + 4),
+      sbc_window_sum_sse2(_mm_unpackhi_epi16(x0, x1), _mm_unpackhi_epi16(x2, x3),
+                          _mm_unpackhi_epi16(x4, zero), gas16WindowTaps4 + 8,
+                          16));
+}
+
+static SBC_SSE2 void sbc_window8_sse2(const int16_t* x, int32_t* y) {
+  const __m128i zero = _mm_setzero_si128();
+  int half;
+
+  for (half = 0; half < 2; half++) {
+    const int16_t* xh = x + 8 * half;
+    __m128i x0 = _mm_loadu_si128((const __m128i*)(xh + 0 * 16));
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(xh + 1 * 16));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(xh + 2 * 16));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(xh + 3 * 16));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(xh + 4 * 16));
+    const int16_t* taps = gas16WindowTaps8 + 16 * half;
+
+    _mm_storeu_si128((__m128i*)(y + 8 * half),
+                     sbc_window_sum_sse2(_mm_unpacklo_epi16(x0, x1),
+                                         _mm_unpacklo_epi16(x2, x3),
+                                         _mm_unpacklo_epi16(x4, zero), taps,
+                                         32));
+    _mm_storeu_si128((__m128i*)(y + 8 * half + 4),
+                     sbc_window_sum_sse2(_mm_unpackhi_epi16(x0, x1),
+                                         _mm_unpackhi_epi16(x2, x3),
+                                         _mm_unpackhi_epi16(x4, zero), taps + 8,
+                                         32));
+  }
+}
+
+/* (int32_t)(((int64_t)c * a) >> 15) for 0 <= c < 0x8000. With a split into
+ * its signed upper and unsigned lower halves, this is
+ * 2 * c * (a >> 16) + ((c * (a & 0xffff)) >> 15), where both products fit in
+ * 32 bits. */
+static inline SBC_SSE2 __m128i sbc_mult_sse2(int32_t c, __m128i a) {
+  const __m128i c_lo = _mm_set1_epi32(c);
+  __m128i hi = _mm_madd_epi16(a, _mm_set1_epi32(c << 16));
+  __m128i lo = _mm_or_si128(_mm_slli_epi32(_mm_mulhi_epu16(a, c_lo), 16),
+                            _mm_mullo_epi16(a, c_lo));
+  return _mm_add_epi32(_mm_slli_epi32(hi, 1), _mm_srli_epi32(lo, 15));
+}
+
+#define SBC_V_ADD(a, b) _mm_add_epi32(a, b)
+#define SBC_V_SUB(a, b) _mm_sub_epi32(a, b)
+#define SBC_V_SRA1(a) _mm_srai_epi32(a, 1)
+#define SBC_V_SHL1(a) _mm_slli_epi32(a, 1)
+#define SBC_V_MULT(c, a) sbc_mult_sse2(c, a)
+
+static inline SBC_SSE2 void sbc_transpose4_sse2(__m128i* r0, __m128i* r1,
+                                                __m128i* r2, __m128i* r3) {
+  __m128i t0 = _mm_unpacklo_epi32(*r0, *r1);
+  __m128i t1 = _mm_unpacklo_epi32(*r2, *r3);
+  __m128i t2 = _mm_unpackhi_epi32(*r0, *r1);
+  __m128i t3 = _mm_unpackhi_epi32(*r2, *r3);
+  *r0 = _mm_unpacklo_epi64(t0, t1);
+  *r1 = _mm_unpackhi_epi64(t0, t1);
+  *r2 = _mm_unpacklo_epi64(t2, t3);
+  *r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+/* Loads coefficients 4 * q .. 4 * q + 3 of the 4 blocks at |y|, |n| apart,
+ * into one vector per coefficient. */
+static inline SBC_SSE2 void sbc_load4x4_sse2(const int32_t* y, int n, int q,
+                                             __m128i* v) {
+  v[0] = _mm_loadu_si128((const __m128i*)(y + 0 * n + 4 * q));
+  v[1] = _mm_loadu_si128((const __m128i*)(y + 1 * n + 4 * q));
+  v[2] = _mm_loadu_si128((const __m128i*)(y + 2 * n + 4 * q));
+  v[3] = _mm_loadu_si128((const __m128i*)(y + 3 * n + 4 * q));
+  sbc_transpose4_sse2(&v[0], &v[1], &v[2], &v[3]);
+}
+
+static inline SBC_SSE2 void sbc_store4x4_sse2(int32_t* sb, int n, int q,
+                                              __m128i* v) {
+  __m128i r0 = v[0], r1 = v[1], r2 = v[2], r3 = v[3];
+  sbc_transpose4_sse2(&r0, &r1, &r2, &r3);
+  _mm_storeu_si128((__m128i*)(sb + 0 * n + 4 * q), r0);
+  _mm_storeu_si128((__m128i*)(sb + 1 * n + 4 * q), r1);
+  _mm_storeu_si128((__m128i*)(sb + 2 * n + 4 * q), r2);
+  _mm_storeu_si128((__m128i*)(sb + 3 * n + 4 * q), r3);
+}
+
+static SBC_SSE2 void sbc_dct4_sse2(const int32_t* y, int32_t* sb,
+                                   int32_t count) {
+  for (; count >= 4; count -= 4, y += 4 * 8, sb += 4 * 4) {
+    __m128i in[8], out[4];
+    sbc_load4x4_sse2(y, 8, 0, in + 0);
+    sbc_load4x4_sse2(y, 8, 1, in + 4);
+    SBC_FAST_IDCT4_LANES(__m128i, in, out);
+    sbc_store4x4_sse2(sb, 4, 0, out);
+  }
+  for (; count > 0; count--, y += 8, sb += 4) SBC_FastIDCT4((int32_t*)y, sb);
+}
+
+static SBC_SSE2 void sbc_dct8_sse2(const int32_t* y, int32_t* sb,
+                                   int32_t count) {
+  for (; count >= 4; count -= 4, y += 4 * 16, sb += 4 * 8) {
+    __m128i in[16], out[8];
+    sbc_load4x4_sse2(y, 16, 0, in + 0);
+    sbc_load4x4_sse2(y, 16, 1, in + 4);
+    sbc_load4x4_sse2(y, 16, 2, in + 8);
+    sbc_load4x4_sse2(y, 16, 3, in + 12);
+    SBC_FAST_IDCT8_LANES(__m128i, in, out);
+    sbc_store4x4_sse2(sb, 8, 0, out + 0);
+    sbc_store4x4_sse2(sb, 8, 1, out + 4);
+  }
+  for (; count > 0; count--, y += 16, sb += 8) SBC_FastIDCT8((int32_t*)y, sb);
+}
+
+#undef SBC_V_ADD
+#undef SBC_V_SUB
+#undef SBC_V_SRA1
+#undef SBC_V_SHL1
+#undef SBC_V_MULT
+
+const tSBC_ANALYSIS_KERNELS sbc_kernels_sse2 = {
+    sbc_window4_sse2, sbc_window8_sse2, sbc_dct4_sse2, sbc_dct8_sse2};
+
+/*******************************************************************************
+ * AVX2
+ ******************************************************************************/
+
+/* The 256 bit unpacks work within 128 bit lanes, so the low half of each sum
+ * holds outputs 0..3 and the high half outputs 8..11 (unpacklo), or outputs
+ * 4..7 and 12..15 (unpackhi). */
+static inline SBC_AVX2 __m256i sbc_load_taps_avx2(const int16_t* taps) {
+  return _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)taps)),
+      _mm_loadu_si128((const __m128i*)(taps + 16)), 1);
+}
+
+static inline SBC_AVX2 __m256i sbc_window_sum_avx2(__m256i x01, __m256i x23,
+                                                   __m256i x4_,
+                                                   const int16_t* taps) {
+  __m256i y = _mm256_madd_epi16(x01, sbc_load_taps_avx2(taps));
+  y = _mm256_add_epi32(y, _mm256_madd_epi16(x23, sbc_load_taps_avx2(taps + 32)));
+  return _mm256_add_epi32(y,
+                          _mm256_madd_epi16(x4_, sbc_load_taps_avx2(taps + 64)));
+}
+
+static SBC_AVX2 void sbc_window8_avx2(const int16_t* x, int32_t* y) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i x0 = _mm256_loadu_si256((const __m256i*)(x + 0 * 16));
+  __m256i x1 = _mm256_loadu_si256((const __m256i*)(x + 1 * 16));
+  __m256i x2 = _mm256_loadu_si256((const __m256i*)(x + 2 * 16));
+  __m256i x3 = _mm256_loadu_si256((const __m256i*)(x + 3 * 16));
+  __m256i x4 = _mm256_loadu_si256((const __m256i*)(x + 4 * 16));
+
+  __m256i lo = sbc_window_sum_avx2(_mm256_unpacklo_epi16(x0, x1),
+                                   _mm256_unpacklo_epi16(x2, x3),
+                                   _mm256_unpacklo_epi16(x4, zero),
+                                   gas16WindowTaps8 + 0);
+  __m256i hi = sbc_window_sum_avx2(_mm256_unpackhi_epi16(x0, x1),
+                                   _mm256_unpackhi_epi16(x2, x3),
+                                   _mm256_unpackhi_epi16(x4, zero),
+                                   gas16WindowTaps8 + 8);
+
+  _mm256_storeu_si256((__m256i*)(y + 0), _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i*)(y + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+static inline SBC_AVX2 __m256i sbc_mult_avx2(int32_t c, __m256i a) {
+  const __m256i c_lo = _mm256_set1_epi32(c);
+  __m256i hi = _mm256_madd_epi16(a, _mm256_set1_epi32(c << 16));
+  __m256i lo =
+      _mm256_or_si256(_mm256_slli_epi32(_mm256_mulhi_epu16(a, c_lo), 16),
+                      _mm256_mullo_epi16(a, c_lo));
+  return _mm256_add_epi32(_mm256_slli_epi32(hi, 1), _mm256_srli_epi32(lo, 15));
+}
+
+#define SBC_V_ADD(a, b) _mm256_add_epi32(a, b)
+#define SBC_V_SUB(a, b) _mm256_sub_epi32(a, b)
+#define SBC_V_SRA1(a) _mm256_srai_epi32(a, 1)
+#define SBC_V_SHL1(a) _mm256_slli_epi32(a, 1)
+#define SBC_V_MULT(c, a) sbc_mult_avx2(c, a)
+
+static inline SBC_AVX2 void sbc_transpose8_avx2(__m256i* r) {
+  __m256i t[8], u[8];
+  int i;
+
+  for (i = 0; i < 8; i += 2) {
+    t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+  }
+  for (i = 0; i < 8; i += 4) {
+    u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (i = 0; i < 4; i++) {
+    r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+    r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+  }
+}
+
+/* Loads coefficients 8 * q .. 8 * q + 7 of the 8 blocks at |y|, |n| apart,
+ * into one vector per coefficient. */
+static inline SBC_AVX2 void sbc_load8x8_avx2(const int32_t* y, int n, int q,
+                                             __m256i* v) {
+  int i;
+  for (i = 0; i < 8; i++)
+    v[i] = _mm256_loadu_si256((const __m256i*)(y + i * n + 8 * q));
+  sbc_transpose8_avx2(v);
+}
+
+static SBC_AVX2 void sbc_dct8_avx2(const int32_t* y, int32_t* sb,
+                                   int32_t count) {
+  int i;
+
+  for (; count >= 8; count -= 8, y += 8 * 16, sb += 8 * 8) {
+    __m256i in[16], out[8];
+    sbc_load8x8_avx2(y, 16, 0, in + 0);
+    sbc_load8x8_avx2(y, 16, 1, in + 8);
+    SBC_FAST_IDCT8_LANES(__m256i, in, out);
+    sbc_transpose8_avx2(out);
+    for (i = 0; i < 8; i++)
+      _mm256_storeu_si256((__m256i*)(sb + i * 8), out[i]);
+  }
+  sbc_dct8_sse2(y, sb, count);
+}
+
+static SBC_AVX2 void sbc_dct4_avx2(const int32_t* y, int32_t* sb,
+                                   int32_t count) {
+  int i;
+
+  for (; count >= 8; count -= 8, y += 8 * 8, sb += 8 * 4) {
+    __m256i in[8], out[8];
+    sbc_load8x8_avx2(y, 8, 0, in);
+    SBC_FAST_IDCT4_LANES(__m256i, in, out);
+    /* the upper half of the transposed rows is not used */
+    out[4] = out[5] = out[6] = out[7] = _mm256_setzero_si256();
+    sbc_transpose8_avx2(out);
+    for (i = 0; i < 8; i++)
+      _mm_storeu_si128((__m128i*)(sb + i * 4), _mm256_castsi256_si128(out[i]));
+  }
+  sbc_dct4_sse2(y, sb, count);
+}
+
+#undef SBC_V_ADD
+#undef SBC_V_SUB
+#undef SBC_V_SRA1
+#undef SBC_V_SHL1
+#undef SBC_V_MULT
+
+/* the 4 subband windowing only spans 128 bits */
+const tSBC_ANALYSIS_KERNELS sbc_kernels_avx2 = {
+    sbc_window4_sse2, sbc_window8_avx2, sbc_dct4_avx2, sbc_dct8_avx2};
+
+#endif
@@ -27,13 +27,6 @@
 #include "bt_target.h"
 #include "sbc_enc_func_declare.h"
 
-int16_t EncMaxShiftCounter;
-
-#if (SBC_JOINT_STE_INCLUDED == TRUE)
-int32_t s32LRDiff[SBC_MAX_NUM_OF_BLOCKS] = {0};
-int32_t s32LRSum[SBC_MAX_NUM_OF_BLOCKS] = {0};
-#endif
-
 uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
                     uint8_t* output) {
   int32_t s32Ch;                 /* counter for ch*/
@@ -89,8 +82,8 @@ uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
       SbBuffer = pstrEncParams->s32SbBuffer + s32Sb;
       s32MaxValue2 = 0;
       s32MaxValue = 0;
-      pSum = s32LRSum;
-      pDiff = s32LRDiff;
+      pSum = pstrEncParams->s32LRSum;
+      pDiff = pstrEncParams->s32LRDiff;
       for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++) {
         *pSum = (*SbBuffer + *(SbBuffer + s32NumOfSubBands)) >> 1;
         if (abs32(*pSum) > s32MaxValue) s32MaxValue = abs32(*pSum);
@@ -120,8 +113,8 @@ uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
         *(ps16ScfL + s32NumOfSubBands) = (int16_t)u32CountDiff;
 
         SbBuffer = pstrEncParams->s32SbBuffer + s32Sb;
-        pSum = s32LRSum;
-        pDiff = s32LRDiff;
+        pSum = pstrEncParams->s32LRSum;
+        pDiff = pstrEncParams->s32LRDiff;
 
         for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++) {
           *SbBuffer = *pSum;
@@ -244,15 +237,19 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS* pstrEncParams) {
 
   if (pstrEncParams->s16NumOfSubBands == 4) {
     if (pstrEncParams->s16NumOfChannels == 1)
-      EncMaxShiftCounter = ((ENC_VX_BUFFER_SIZE - 4 * 10) >> 2) << 2;
+      pstrEncParams->s16MaxShiftCounter =
+          ((ENC_VX_BUFFER_SIZE - 4 * 10) >> 2) << 2;
     else
-      EncMaxShiftCounter = ((ENC_VX_BUFFER_SIZE - 4 * 10 * 2) >> 3) << 2;
+      pstrEncParams->s16MaxShiftCounter =
+          ((ENC_VX_BUFFER_SIZE - 4 * 10 * 2) >> 3) << 2;
   } else {
     if (pstrEncParams->s16NumOfChannels == 1)
-      EncMaxShiftCounter = ((ENC_VX_BUFFER_SIZE - 8 * 10) >> 3) << 3;
+      pstrEncParams->s16MaxShiftCounter =
+          ((ENC_VX_BUFFER_SIZE - 8 * 10) >> 3) << 3;
     else
-      EncMaxShiftCounter = ((ENC_VX_BUFFER_SIZE - 8 * 10 * 2) >> 4) << 3;
+      pstrEncParams->s16MaxShiftCounter =
+          ((ENC_VX_BUFFER_SIZE - 8 * 10 * 2) >> 4) << 3;
   }
 
-  SbcAnalysisInit();
+  SbcAnalysisInit(pstrEncParams);
 }
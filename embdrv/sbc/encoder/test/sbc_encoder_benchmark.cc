@@ -0,0 +1,91 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <vector>
+
+#include "sbc_encoder.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr int kSampleRate = 44100;
+
+std::vector<int16_t> MakePcm(size_t num_samples) {
+  std::vector<int16_t> pcm(num_samples);
+  uint32_t seed = 1;
+  for (size_t i = 0; i < num_samples; i++) {
+    seed = seed * 1664525 + 1013904223;
+    double v = 16000 * sin((i / 2) * 0.05 * (1 + i % 2)) +
+               (int)((seed >> 16) % 8000) - 4000;
+    pcm[i] = (int16_t)v;
+  }
+  return pcm;
+}
+
+// Encodes one second of joint stereo PCM frame by frame, over and over.
+// Arguments: subbands, blocks, allocation method, kernels.
+void BM_Encode(State& state) {
+  int16_t kernels = state.range(3);
+  if (!SBC_Encoder_SetKernels(kernels)) {
+    state.SkipWithError("kernels not available");
+    return;
+  }
+
+  SBC_ENC_PARAMS params = {};
+  params.s16SamplingFreq = SBC_sf44100;
+  params.s16ChannelMode = SBC_JOINT_STEREO;
+  params.s16NumOfSubBands = state.range(0);
+  params.s16NumOfBlocks = state.range(1);
+  params.s16AllocationMethod = state.range(2);
+  params.u16BitRate = 328;
+  SBC_Encoder_Init(&params);
+
+  size_t frame_samples = params.s16NumOfSubBands * params.s16NumOfBlocks * 2;
+  size_t num_frames = 2 * kSampleRate / frame_samples;
+  std::vector<int16_t> pcm = MakePcm(num_frames * frame_samples);
+  uint8_t frame[512];
+
+  size_t f = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        SBC_Encode(&params, &pcm[f * frame_samples], frame));
+    if (++f == num_frames) f = 0;
+  }
+
+  state.counters["frames/s"] = benchmark::Counter(
+      state.iterations(), benchmark::Counter::kIsRate);
+  state.SetItemsProcessed(state.iterations() * params.s16NumOfSubBands *
+                          params.s16NumOfBlocks);
+  SBC_Encoder_SetKernels(SBC_KERNELS_AUTO);
+}
+
+void AllConfigs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"subbands", "blocks", "alloc", "kernels"});
+  for (int kernels : {SBC_KERNELS_C, SBC_KERNELS_AUTO})
+    for (int subbands : {SUB_BANDS_4, SUB_BANDS_8})
+      for (int blocks : {4, 8, 12, 16})
+        for (int allocation : {SBC_LOUDNESS, SBC_SNR})
+          b->Args({subbands, blocks, allocation, kernels});
+}
+BENCHMARK(BM_Encode)->Apply(AllConfigs);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sbc_encoder.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kNumFrames = 200;
+
+struct Config {
+  int16_t subbands;
+  int16_t blocks;
+  int16_t allocation;
+  int16_t channel_mode;
+};
+
+std::vector<Config> AllConfigs() {
+  std::vector<Config> configs;
+  for (int16_t subbands : {SUB_BANDS_4, SUB_BANDS_8})
+    for (int16_t blocks : {4, 8, 12, 16})
+      for (int16_t allocation : {SBC_LOUDNESS, SBC_SNR})
+        for (int16_t mode : {SBC_MONO, SBC_DUAL, SBC_STEREO, SBC_JOINT_STEREO})
+          configs.push_back({subbands, blocks, allocation, mode});
+  return configs;
+}
+
+// Sines with noise on top, and full scale square waves once in a while to
+// exercise the extremes of the arithmetic.
+std::vector<int16_t> MakePcm(size_t num_samples, int num_channels) {
+  std::vector<int16_t> pcm(num_samples);
+  uint32_t seed = 1;
+  for (size_t i = 0; i < num_samples; i++) {
+    seed = seed * 1664525 + 1013904223;
+    size_t n = i / num_channels;
+    double v = 20000 * sin(n * 0.05 * (1 + i % num_channels)) +
+               (int)((seed >> 16) % 12000) - 6000;
+    if ((n / 512) % 8 == 7) v = (seed & 0x10000) ? 32767 : -32768;
+    pcm[i] = (int16_t)std::max(-32768.0, std::min(32767.0, v));
+  }
+  return pcm;
+}
+
+// Encodes the test signal frame by frame with its own SBC_ENC_PARAMS.
+class Stream {
+ public:
+  explicit Stream(const Config& config) {
+    params_.s16SamplingFreq = SBC_sf44100;
+    params_.s16ChannelMode = config.channel_mode;
+    params_.s16NumOfSubBands = config.subbands;
+    params_.s16NumOfBlocks = config.blocks;
+    params_.s16AllocationMethod = config.allocation;
+    params_.u16BitRate = config.channel_mode == SBC_MONO ? 200 : 328;
+    SBC_Encoder_Init(&params_);
+
+    frame_samples_ = config.subbands * config.blocks * params_.s16NumOfChannels;
+    pcm_ = MakePcm(frame_samples_ * kNumFrames, params_.s16NumOfChannels);
+  }
+
+  bool done() const { return frames_ == kNumFrames; }
+
+  void EncodeFrame() {
+    uint8_t frame[512];
+    uint32_t len =
+        SBC_Encode(&params_, &pcm_[frames_ * frame_samples_], frame);
+    bitstream_.insert(bitstream_.end(), frame, frame + len);
+    frames_++;
+  }
+
+  const std::vector<uint8_t>& bitstream() const { return bitstream_; }
+
+ private:
+  SBC_ENC_PARAMS params_ = {};
+  size_t frame_samples_;
+  std::vector<int16_t> pcm_;
+  int frames_ = 0;
+  std::vector<uint8_t> bitstream_;
+};
+
+std::vector<uint8_t> Encode(int16_t kernels, const Config& config) {
+  EXPECT_TRUE(SBC_Encoder_SetKernels(kernels));
+  Stream stream(config);
+  while (!stream.done()) stream.EncodeFrame();
+  return stream.bitstream();
+}
+
+class SbcEncoderTest : public ::testing::Test {
+ protected:
+  void TearDown() override { SBC_Encoder_SetKernels(SBC_KERNELS_AUTO); }
+
+  void ExpectBitExact(int16_t kernels) {
+    // Not built for this architecture, or not supported by this CPU.
+    if (!SBC_Encoder_SetKernels(kernels)) return;
+    for (const Config& config : AllConfigs()) {
+      SCOPED_TRACE(::testing::Message()
+                   << "subbands " << config.subbands << " blocks "
+                   << config.blocks << " allocation " << config.allocation
+                   << " mode " << config.channel_mode);
+      EXPECT_EQ(Encode(SBC_KERNELS_C, config), Encode(kernels, config));
+    }
+  }
+};
+
+TEST_F(SbcEncoderTest, scalar_and_auto_are_always_available) {
+  EXPECT_TRUE(SBC_Encoder_SetKernels(SBC_KERNELS_C));
+  EXPECT_TRUE(SBC_Encoder_SetKernels(SBC_KERNELS_AUTO));
+  EXPECT_FALSE(SBC_Encoder_SetKernels(-1));
+  EXPECT_FALSE(SBC_Encoder_SetKernels(SBC_KERNELS_NEON + 1));
+}
+
+TEST_F(SbcEncoderTest, auto_is_bit_exact) { ExpectBitExact(SBC_KERNELS_AUTO); }
+
+TEST_F(SbcEncoderTest, sse2_is_bit_exact) { ExpectBitExact(SBC_KERNELS_SSE2); }
+
+TEST_F(SbcEncoderTest, avx2_is_bit_exact) { ExpectBitExact(SBC_KERNELS_AVX2); }
+
+TEST_F(SbcEncoderTest, neon_is_bit_exact) { ExpectBitExact(SBC_KERNELS_NEON); }
+
+// Interleaving the frames of encoders with different configurations must not
+// change their output.
+TEST_F(SbcEncoderTest, instances_are_independent) {
+  std::vector<Config> configs = AllConfigs();
+  for (size_t i = 0; i < configs.size(); i++) {
+    const Config& a = configs[i];
+    const Config& b = configs[(i + 7) % configs.size()];
+    Stream stream_a(a);
+    Stream stream_b(b);
+    while (!stream_a.done()) {
+      stream_a.EncodeFrame();
+      stream_b.EncodeFrame();
+    }
+    EXPECT_EQ(Encode(SBC_KERNELS_AUTO, a), stream_a.bitstream());
+    EXPECT_EQ(Encode(SBC_KERNELS_AUTO, b), stream_b.bitstream());
+  }
+}
+
+TEST_F(SbcEncoderTest, instances_encode_concurrently) {
+  std::vector<Config> configs = AllConfigs();
+  std::vector<std::unique_ptr<Stream>> streams;
+  for (const Config& config : configs)
+    streams.emplace_back(std::make_unique<Stream>(config));
+
+  std::vector<std::thread> threads;
+  for (auto& stream : streams) {
+    threads.emplace_back([&stream] {
+      while (!stream->done()) stream->EncodeFrame();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (size_t i = 0; i < configs.size(); i++)
+    EXPECT_EQ(Encode(SBC_KERNELS_AUTO, configs[i]), streams[i]->bitstream());
+}
+
+}  // namespace
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -35,6 +37,11 @@ class Handler {
   // Create and register a handler on given thread
   explicit Handler(Thread* thread);
 
+  // Create and register a batching handler on given thread. The reactor is only woken up when the queue goes from empty
+  // to non-empty, and each wakeup runs up to |max_batch_size| queued closures. Closures left over when the budget runs
+  // out are run on the next wakeup, after other reactables on the thread had a chance to run.
+  Handler(Thread* thread, size_t max_batch_size);
+
   // Unregister this handler from the thread and release resource. Unhandled events will be discarded and not executed.
   ~Handler();
 
@@ -46,13 +53,21 @@ class Handler {
   // Remove all pending events from the queue of this handler
   void Clear();
 
+  // Number of times this handler was woken up by the reactor to run closures
+  size_t GetWakeupCount() const;
+
  private:
   std::queue<Closure> tasks_;
   Thread* thread_;
+  const bool batching_;
+  const size_t max_batch_size_;
   int fd_;
   Reactor::Reactable* reactable_;
   mutable std::mutex mutex_;
+  std::atomic<size_t> wakeup_count_;
+  std::atomic<size_t> clear_count_;
   void handle_next_event();
+  void handle_next_batch();
 };
 
 }  // namespace os
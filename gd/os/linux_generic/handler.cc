@@ -33,12 +33,29 @@ namespace os {
 
 Handler::Handler(Thread* thread)
   : thread_(thread),
-    fd_(eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK)) {
+    batching_(false),
+    max_batch_size_(1),
+    fd_(eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK)),
+    wakeup_count_(0),
+    clear_count_(0) {
   ASSERT(fd_ != -1);
 
   reactable_ = thread_->GetReactor()->Register(fd_, [this] { this->handle_next_event(); }, nullptr);
 }
 
+Handler::Handler(Thread* thread, size_t max_batch_size)
+  : thread_(thread),
+    batching_(true),
+    max_batch_size_(max_batch_size),
+    fd_(eventfd(0, EFD_NONBLOCK)),
+    wakeup_count_(0),
+    clear_count_(0) {
+  ASSERT(fd_ != -1);
+  ASSERT(max_batch_size_ > 0);
+
+  reactable_ = thread_->GetReactor()->Register(fd_, [this] { this->handle_next_batch(); }, nullptr);
+}
+
 Handler::~Handler() {
   thread_->GetReactor()->Unregister(reactable_);
   reactable_ = nullptr;
@@ -49,10 +66,16 @@ Handler::~Handler() {
 }
 
 void Handler::Post(Closure closure) {
+  bool was_empty;
   {
     std::lock_guard<std::mutex> lock(mutex_);
+    was_empty = tasks_.empty();
     tasks_.emplace(std::move(closure));
   }
+  // A batching handler drains everything queued so far on each wakeup, so it only needs a wakeup for the first closure
+  if (batching_ && !was_empty) {
+    return;
+  }
   uint64_t val = 1;
   auto write_result = eventfd_write(fd_, val);
   ASSERT(write_result != -1);
@@ -63,6 +86,7 @@ void Handler::Clear() {
 
   std::queue<Closure> empty;
   std::swap(tasks_, empty);
+  clear_count_++;
 
   uint64_t val;
   while (eventfd_read(fd_, &val) == 0) {
@@ -86,8 +110,64 @@ void Handler::handle_next_event() {
     closure = std::move(tasks_.front());
     tasks_.pop();
   }
+  wakeup_count_.fetch_add(1, std::memory_order_relaxed);
   closure();
 }
 
+void Handler::handle_next_batch() {
+  uint64_t val = 0;
+  auto read_result = eventfd_read(fd_, &val);
+  if (read_result == -1 && errno == EAGAIN) {
+    // The queue was cleared before we got there
+    return;
+  }
+
+  ASSERT(read_result != -1);
+
+  // Take everything queued so far with a single lock acquisition. Closures posted from now on find the queue empty and
+  // signal the next wakeup themselves.
+  std::queue<Closure> batch;
+  size_t clear_count;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(tasks_, batch);
+    clear_count = clear_count_;
+  }
+  wakeup_count_.fetch_add(1, std::memory_order_relaxed);
+
+  size_t budget = max_batch_size_;
+  while (!batch.empty() && budget > 0) {
+    if (clear_count_ != clear_count) {
+      // Clear() was called by one of the closures or by another thread, the rest of the batch is discarded too
+      return;
+    }
+    Closure closure = std::move(batch.front());
+    batch.pop();
+    budget--;
+    closure();
+  }
+
+  if (batch.empty()) {
+    return;
+  }
+
+  // Out of budget: put the rest back in front of anything posted meanwhile, and come back on the next reactor turn
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (clear_count_ != clear_count) {
+    return;
+  }
+  while (!tasks_.empty()) {
+    batch.emplace(std::move(tasks_.front()));
+    tasks_.pop();
+  }
+  std::swap(tasks_, batch);
+  auto write_result = eventfd_write(fd_, 1);
+  ASSERT(write_result != -1);
+}
+
+size_t Handler::GetWakeupCount() const {
+  return wakeup_count_.load(std::memory_order_relaxed);
+}
+
 }  // namespace os
 }  // namespace bluetooth
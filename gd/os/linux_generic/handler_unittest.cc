@@ -17,7 +17,9 @@
 #include "os/handler.h"
 
 #include <sys/eventfd.h>
+#include <future>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -67,6 +69,79 @@ TEST_F(HandlerTest, post_task_cleared) {
   EXPECT_EQ(val, 1);
 }
 
+class BatchingHandlerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    thread_ = new Thread("test_thread", Thread::Priority::NORMAL);
+    handler_ = new Handler(thread_, kMaxBatchSize);
+  }
+  void TearDown() override {
+    delete handler_;
+    delete thread_;
+  }
+
+  static constexpr size_t kMaxBatchSize = 4;
+  Handler* handler_;
+  Thread* thread_;
+};
+
+TEST_F(BatchingHandlerTest, post_tasks_invoked_in_order) {
+  std::vector<int> order;
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  for (int i = 0; i < 10; i++) {
+    handler_->Post([&order, i]() { order.push_back(i); });
+  }
+  handler_->Post([&promise]() { promise.set_value(); });
+  future.wait();
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST_F(BatchingHandlerTest, wakeups_are_coalesced) {
+  std::promise<void> blocked;
+  std::promise<void> unblock;
+  auto unblock_future = unblock.get_future();
+  handler_->Post([&blocked, &unblock_future]() {
+    blocked.set_value();
+    unblock_future.wait();
+  });
+  blocked.get_future().wait();
+  EXPECT_EQ(handler_->GetWakeupCount(), 1u);
+
+  // Queue up closures while the handler thread is busy, they need 2 more wakeups with a batch size of 4
+  int val = 0;
+  std::promise<void> done;
+  auto done_future = done.get_future();
+  for (int i = 0; i < 7; i++) {
+    handler_->Post([&val]() { val++; });
+  }
+  handler_->Post([&done]() { done.set_value(); });
+  unblock.set_value();
+  done_future.wait();
+  EXPECT_EQ(val, 7);
+  EXPECT_EQ(handler_->GetWakeupCount(), 3u);
+}
+
+TEST_F(BatchingHandlerTest, clear_discards_rest_of_batch) {
+  int val = 0;
+  std::promise<void> blocked;
+  std::promise<void> unblock;
+  auto unblock_future = unblock.get_future();
+  handler_->Post([&blocked, &unblock_future]() {
+    blocked.set_value();
+    unblock_future.wait();
+  });
+  blocked.get_future().wait();
+  handler_->Post([this, &val]() {
+    val++;
+    handler_->Clear();
+  });
+  handler_->Post([]() { ASSERT_TRUE(false); });
+  unblock.set_value();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(val, 1);
+}
+
 }  // namespace
 }  // namespace os
 }  // namespace bluetooth
@@ -73,6 +73,7 @@ class BM_ReactorThread : public BM_ThreadPerformance {
 };
 
 BENCHMARK_DEFINE_F(BM_ReactorThread, batch_enque_dequeue)(State& state) {
+  size_t wakeups_before = handler_->GetWakeupCount();
   for (auto _ : state) {
     num_messages_to_send_ = state.range(0);
     counter_ = 0;
@@ -83,6 +84,10 @@ BENCHMARK_DEFINE_F(BM_ReactorThread, batch_enque_dequeue)(State& state) {
     }
     counter_future.wait();
   }
+  state.counters["posts_per_sec"] =
+      benchmark::Counter(state.iterations() * state.range(0), benchmark::Counter::kIsRate);
+  state.counters["wakeups_per_sec"] =
+      benchmark::Counter(handler_->GetWakeupCount() - wakeups_before, benchmark::Counter::kIsRate);
 };
 
 BENCHMARK_REGISTER_F(BM_ReactorThread, batch_enque_dequeue)
@@ -112,3 +117,68 @@ BENCHMARK_REGISTER_F(BM_ReactorThread, sequential_execution)
     ->Arg(100000)
     ->Iterations(1)
     ->UseRealTime();
+
+class BM_BatchingReactorThread : public BM_ThreadPerformance {
+ protected:
+  void SetUp(State& st) override {
+    BM_ThreadPerformance::SetUp(st);
+    thread_ = std::make_unique<Thread>("BM_BatchingReactorThread thread", Thread::Priority::NORMAL);
+    handler_ = std::make_unique<Handler>(thread_.get(), st.range(1));
+  }
+  void TearDown(State& st) override {
+    handler_ = nullptr;
+    thread_->Stop();
+    thread_ = nullptr;
+    BM_ThreadPerformance::TearDown(st);
+  }
+  std::unique_ptr<Thread> thread_;
+  std::unique_ptr<Handler> handler_;
+};
+
+BENCHMARK_DEFINE_F(BM_BatchingReactorThread, batch_enque_dequeue)(State& state) {
+  size_t wakeups_before = handler_->GetWakeupCount();
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0);
+    counter_ = 0;
+    counter_promise_ = std::promise<void>();
+    std::future<void> counter_future = counter_promise_.get_future();
+    for (int i = 0; i < num_messages_to_send_; i++) {
+      handler_->Post([this]() { callback_batch(); });
+    }
+    counter_future.wait();
+  }
+  state.counters["posts_per_sec"] =
+      benchmark::Counter(state.iterations() * state.range(0), benchmark::Counter::kIsRate);
+  state.counters["wakeups_per_sec"] =
+      benchmark::Counter(handler_->GetWakeupCount() - wakeups_before, benchmark::Counter::kIsRate);
+};
+
+// Second argument is the maximum number of closures run per wakeup
+BENCHMARK_REGISTER_F(BM_BatchingReactorThread, batch_enque_dequeue)
+    ->Args({10, 64})
+    ->Args({1000, 64})
+    ->Args({10000, 64})
+    ->Args({100000, 64})
+    ->Args({100000, 1024})
+    ->Iterations(1)
+    ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_BatchingReactorThread, sequential_execution)(State& state) {
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0);
+    for (int i = 0; i < num_messages_to_send_; i++) {
+      counter_promise_ = std::promise<void>();
+      std::future<void> counter_future = counter_promise_.get_future();
+      handler_->Post([this]() { callback(); });
+      counter_future.wait();
+    }
+  }
+};
+
+BENCHMARK_REGISTER_F(BM_BatchingReactorThread, sequential_execution)
+    ->Args({10, 64})
+    ->Args({1000, 64})
+    ->Args({10000, 64})
+    ->Args({100000, 64})
+    ->Iterations(1)
+    ->UseRealTime();
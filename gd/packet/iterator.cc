@@ -22,13 +22,17 @@ namespace bluetooth {
 namespace packet {
 
 template <bool little_endian>
-Iterator<little_endian>::Iterator(std::forward_list<View> data, size_t offset) {
-  data_ = data;
+Iterator<little_endian>::Iterator(const std::forward_list<View>& data, size_t offset) {
+  data_ = &data;
+  contiguous_ = nullptr;
   index_ = offset;
   length_ = 0;
   for (auto& view : data) {
     length_ += view.size();
   }
+  if (!data.empty() && std::next(data.begin()) == data.end()) {
+    contiguous_ = data.front().data();
+  }
 }
 
 template <bool little_endian>
@@ -94,7 +98,9 @@ Iterator<little_endian>& Iterator<little_endian>::operator--() {
 template <bool little_endian>
 Iterator<little_endian>& Iterator<little_endian>::operator=(const Iterator<little_endian>& itr) {
   data_ = itr.data_;
+  contiguous_ = itr.contiguous_;
   index_ = itr.index_;
+  length_ = itr.length_;
 
   return *this;
 }
@@ -132,9 +138,12 @@ bool Iterator<little_endian>::operator>=(const Iterator<little_endian>& itr) con
 template <bool little_endian>
 uint8_t Iterator<little_endian>::operator*() const {
   ASSERT_LOG(index_ < length_, "Index %zu out of bounds: %zu", index_, length_);
+  if (contiguous_ != nullptr) {
+    return contiguous_[index_];
+  }
   size_t index = index_;
 
-  for (auto view : data_) {
+  for (const auto& view : *data_) {
     if (index < view.size()) {
       return view[index];
     }
@@ -153,6 +162,30 @@ size_t Iterator<little_endian>::NumBytesRemaining() const {
   }
 }
 
+template <bool little_endian>
+void Iterator<little_endian>::CopyTo(uint8_t* destination, size_t length) {
+  ASSERT_LOG(length <= NumBytesRemaining(), "Copying %zu bytes at index %zu out of bounds: %zu", length, index_,
+             length_);
+  size_t index = index_;
+  index_ += length;
+
+  for (const auto& view : *data_) {
+    if (length == 0) {
+      return;
+    }
+    if (index >= view.size()) {
+      index -= view.size();
+      continue;
+    }
+    size_t copied = std::min(length, view.size() - index);
+    view.CopyTo(index, destination, copied);
+    destination += copied;
+    length -= copied;
+    index = 0;
+  }
+  ASSERT_LOG(length == 0, "Out of fragments copying to index %zu", index_);
+}
+
 // Explicit instantiations for both types of Iterators.
 template class Iterator<true>;
 template class Iterator<false>;
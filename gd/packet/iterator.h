@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <forward_list>
 
 #include "packet/view.h"
@@ -25,10 +27,11 @@ namespace bluetooth {
 namespace packet {
 
 // Templated Iterator for endianness
+// Iterators reference the fragments of the PacketView they come from, and must not outlive it.
 template <bool little_endian>
 class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t> {
  public:
-  Iterator(std::forward_list<View> data, size_t offset);
+  Iterator(const std::forward_list<View>& data, size_t offset);
   Iterator(const Iterator& itr) = default;
   virtual ~Iterator() = default;
 
@@ -60,6 +63,9 @@ class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t>
 
   size_t NumBytesRemaining() const;
 
+  // Copy the next length bytes to destination, in the order of the packet
+  void CopyTo(uint8_t* destination, size_t length);
+
   // Get the next sizeof(FixedWidthPODType) bytes and return the filled type
   template <typename FixedWidthPODType>
   FixedWidthPODType extract() {
@@ -67,15 +73,23 @@ class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t>
     FixedWidthPODType extracted_value;
     uint8_t* value_ptr = (uint8_t*)&extracted_value;
 
-    for (size_t i = 0; i < sizeof(FixedWidthPODType); i++) {
-      size_t index = (little_endian ? i : sizeof(FixedWidthPODType) - i - 1);
-      value_ptr[index] = *((*this)++);
+    // Packets held in a single fragment are read with one (unaligned) load.
+    if (contiguous_ != nullptr && index_ <= length_ && length_ - index_ >= sizeof(FixedWidthPODType)) {
+      std::memcpy(value_ptr, contiguous_ + index_, sizeof(FixedWidthPODType));
+      index_ += sizeof(FixedWidthPODType);
+    } else {
+      CopyTo(value_ptr, sizeof(FixedWidthPODType));
+    }
+    if (!little_endian) {
+      std::reverse(value_ptr, value_ptr + sizeof(FixedWidthPODType));
     }
     return extracted_value;
   }
 
  private:
-  std::forward_list<View> data_;
+  const std::forward_list<View>* data_;
+  // The bytes of the only fragment, nullptr if there are several.
+  const uint8_t* contiguous_;
   size_t index_;
   size_t length_;
 };
@@ -53,6 +53,9 @@ uint8_t PacketView<little_endian>::operator[](size_t index) const {
 template <bool little_endian>
 uint8_t PacketView<little_endian>::at(size_t index) const {
   ASSERT_LOG(index < length_, "Index %zu out of bounds", index);
+  if (fragments_.front().size() == length_) {
+    return fragments_.front().data()[index];
+  }
   for (const auto& fragment : fragments_) {
     if (index < fragment.size()) {
       return fragment[index];
@@ -68,6 +71,12 @@ size_t PacketView<little_endian>::size() const {
   return length_;
 }
 
+template <bool little_endian>
+void PacketView<little_endian>::CopyTo(size_t begin, uint8_t* destination, size_t length) const {
+  ASSERT_LOG(begin <= length_, "Index %zu out of bounds", begin);
+  Iterator<little_endian>(fragments_, begin).CopyTo(destination, length);
+}
+
 template <bool little_endian>
 std::forward_list<View> PacketView<little_endian>::GetSubviewList(size_t begin, size_t end) const {
   ASSERT(begin <= end);
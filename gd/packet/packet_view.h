@@ -48,6 +48,9 @@ class PacketView {
 
   size_t size() const;
 
+  // Copy length bytes, starting at begin, to destination.
+  void CopyTo(size_t begin, uint8_t* destination, size_t length) const;
+
   PacketView<true> GetLittleEndianSubview(size_t begin, size_t end) const;
 
   PacketView<false> GetBigEndianSubview(size_t begin, size_t end) const;
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <forward_list>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "common/address.h"
+#include "packet/packet_view.h"
+
+using ::benchmark::State;
+using ::bluetooth::common::Address;
+using ::bluetooth::packet::kLittleEndian;
+using ::bluetooth::packet::PacketView;
+using ::bluetooth::packet::View;
+
+namespace {
+
+constexpr size_t kAclHeaderSize = 4;
+constexpr size_t kL2capHeaderSize = 4;
+
+// Splits the packet in |fragments| views of about the same size.
+PacketView<kLittleEndian> MakePacket(const std::vector<uint8_t>& bytes, size_t fragments) {
+  auto data = std::make_shared<const std::vector<uint8_t>>(bytes);
+  std::forward_list<View> views;
+  auto it = views.before_begin();
+  size_t fragment_size = (bytes.size() + fragments - 1) / fragments;
+  for (size_t begin = 0; begin < bytes.size(); begin += fragment_size) {
+    it = views.insert_after(it, View(data, begin, begin + fragment_size));
+  }
+  return PacketView<kLittleEndian>(views);
+}
+
+// An LE Advertising Report event with a single report of 31 bytes.
+std::vector<uint8_t> LeAdvertisingReport() {
+  std::vector<uint8_t> event = {0x3e, 0x2b, 0x02, 0x01, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x1f};
+  event.resize(event.size() + 31, 0xa5);
+  event.push_back(0xc4);  // RSSI
+  return event;
+}
+
+// An ACL packet carrying an L2CAP basic frame of |payload_size| bytes.
+std::vector<uint8_t> AclPacket(size_t payload_size) {
+  uint16_t l2cap_length = payload_size;
+  uint16_t acl_length = kL2capHeaderSize + payload_size;
+  std::vector<uint8_t> packet = {0x01,
+                                 0x20,
+                                 static_cast<uint8_t>(acl_length),
+                                 static_cast<uint8_t>(acl_length >> 8),
+                                 static_cast<uint8_t>(l2cap_length),
+                                 static_cast<uint8_t>(l2cap_length >> 8),
+                                 0x40,
+                                 0x00};
+  packet.resize(packet.size() + payload_size, 0x5a);
+  return packet;
+}
+
+// Arguments: fragments.
+void BM_ParseLeAdvertisingReport(State& state) {
+  PacketView<kLittleEndian> packet = MakePacket(LeAdvertisingReport(), state.range(0));
+  uint8_t data[31];
+
+  for (auto _ : state) {
+    auto it = packet.begin();
+    benchmark::DoNotOptimize(it.extract<uint8_t>());  // event code
+    benchmark::DoNotOptimize(it.extract<uint8_t>());  // parameter length
+    benchmark::DoNotOptimize(it.extract<uint8_t>());  // subevent code
+    uint8_t num_reports = it.extract<uint8_t>();
+    for (uint8_t i = 0; i < num_reports; i++) {
+      benchmark::DoNotOptimize(it.extract<uint8_t>());  // event type
+      benchmark::DoNotOptimize(it.extract<uint8_t>());  // address type
+      benchmark::DoNotOptimize(it.extract<Address>());
+      uint8_t length = it.extract<uint8_t>();
+      it.CopyTo(data, length);
+      benchmark::DoNotOptimize(it.extract<int8_t>());  // RSSI
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+}
+
+// Arguments: payload size, fragments.
+void BM_ParseAclPayload(State& state) {
+  PacketView<kLittleEndian> packet = MakePacket(AclPacket(state.range(0)), state.range(1));
+  std::vector<uint8_t> payload(state.range(0));
+
+  for (auto _ : state) {
+    auto it = packet.begin();
+    benchmark::DoNotOptimize(it.extract<uint16_t>());  // handle and flags
+    uint16_t acl_length = it.extract<uint16_t>();
+    PacketView<kLittleEndian> l2cap = packet.GetLittleEndianSubview(kAclHeaderSize, kAclHeaderSize + acl_length);
+    auto l2cap_it = l2cap.begin();
+    uint16_t length = l2cap_it.extract<uint16_t>();
+    benchmark::DoNotOptimize(l2cap_it.extract<uint16_t>());  // channel id
+    l2cap_it.CopyTo(payload.data(), length);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+}
+
+// The payload read one byte at a time, the way it was before CopyTo.
+// Arguments: payload size, fragments.
+void BM_ReadAclPayloadByteWise(State& state) {
+  PacketView<kLittleEndian> packet = MakePacket(AclPacket(state.range(0)), state.range(1));
+  std::vector<uint8_t> payload(state.range(0));
+
+  for (auto _ : state) {
+    auto it = packet.begin() + kAclHeaderSize + kL2capHeaderSize;
+    for (auto& byte : payload) {
+      byte = *it++;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+}
+
+// LE (27 and 251 bytes) and BR/EDR (1021 bytes) ACL payloads, in one fragment
+// or split in three.
+void AclSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"payload", "fragments"});
+  for (int fragments : {1, 3}) {
+    for (int payload : {27, 251, 1021}) {
+      b->Args({payload, fragments});
+    }
+  }
+}
+
+BENCHMARK(BM_ParseLeAdvertisingReport)->ArgName("fragments")->Arg(1)->Arg(3);
+BENCHMARK(BM_ParseAclPayload)->Apply(AclSizes);
+BENCHMARK(BM_ReadAclPayloadByteWise)->Apply(AclSizes);
+
+}  // namespace
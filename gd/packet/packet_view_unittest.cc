@@ -461,6 +461,62 @@ TEST(PacketViewMultiViewTest, arrayOperatorTest) {
   ASSERT_DEATH(multi_view[single_view.size()], "");
 }
 
+TEST(PacketViewMultiViewTest, extractTest) {
+  PacketView<true> single_view({View(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size())});
+  PacketView<true> multi_view({
+      View(std::make_shared<const vector<uint8_t>>(count_1), 0, count_1.size()),
+      View(std::make_shared<const vector<uint8_t>>(count_2), 0, count_2.size()),
+      View(std::make_shared<const vector<uint8_t>>(count_3), 0, count_3.size()),
+  });
+  PacketView<false> multi_be_view({
+      View(std::make_shared<const vector<uint8_t>>(count_1), 0, count_1.size()),
+      View(std::make_shared<const vector<uint8_t>>(count_2), 0, count_2.size()),
+      View(std::make_shared<const vector<uint8_t>>(count_3), 0, count_3.size()),
+  });
+  auto single_itr = single_view.begin();
+  auto multi_itr = multi_view.begin();
+  auto multi_be_itr = multi_be_view.begin();
+
+  ASSERT_EQ(single_itr.extract<uint16_t>(), multi_itr.extract<uint16_t>());
+  ASSERT_EQ(0x0001, multi_be_itr.extract<uint16_t>());
+  ASSERT_EQ(single_itr.extract<uint32_t>(), multi_itr.extract<uint32_t>());
+  ASSERT_EQ(0x02030405u, multi_be_itr.extract<uint32_t>());
+  ASSERT_EQ(single_itr.extract<uint64_t>(), multi_itr.extract<uint64_t>());
+  ASSERT_EQ(0x060708090a0b0c0du, multi_be_itr.extract<uint64_t>());
+  ASSERT_EQ(single_itr.extract<Address>(), multi_itr.extract<Address>());
+  ASSERT_EQ(single_itr.NumBytesRemaining(), multi_itr.NumBytesRemaining());
+}
+
+TEST(PacketViewMultiViewTest, copyToTest) {
+  PacketView<true> single_view({View(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size())});
+  PacketView<true> multi_view({
+      View(std::make_shared<const vector<uint8_t>>(count_1), 0, count_1.size()),
+      View(std::make_shared<const vector<uint8_t>>(count_2), 0, count_2.size()),
+      View(std::make_shared<const vector<uint8_t>>(count_3), 0, count_3.size()),
+  });
+  for (size_t begin = 0; begin <= count_all.size(); begin++) {
+    for (size_t length = 0; begin + length <= count_all.size(); length++) {
+      vector<uint8_t> expected(count_all.begin() + begin, count_all.begin() + begin + length);
+      vector<uint8_t> single_copy(length);
+      vector<uint8_t> multi_copy(length);
+      single_view.CopyTo(begin, single_copy.data(), length);
+      multi_view.CopyTo(begin, multi_copy.data(), length);
+      ASSERT_EQ(expected, single_copy);
+      ASSERT_EQ(expected, multi_copy);
+    }
+  }
+
+  uint8_t byte;
+  ASSERT_DEATH(single_view.CopyTo(count_all.size(), &byte, 1), "");
+  ASSERT_DEATH(multi_view.CopyTo(count_all.size(), &byte, 1), "");
+
+  auto multi_itr = multi_view.begin() + 2;
+  vector<uint8_t> copy(4);
+  multi_itr.CopyTo(copy.data(), copy.size());
+  ASSERT_EQ(vector<uint8_t>({0x02, 0x03, 0x04, 0x05}), copy);
+  ASSERT_EQ(0x06, *multi_itr);
+}
+
 TEST(ViewTest, arrayOperatorTest) {
   View view_all(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size());
   size_t past_end = view_all.size();
@@ -16,6 +16,8 @@
 
 #include "packet/view.h"
 
+#include <algorithm>
+
 #include "os/log.h"
 
 namespace bluetooth {
@@ -40,5 +42,14 @@ uint8_t View::operator[](size_t i) const {
 size_t View::size() const {
   return end_ - begin_;
 }
+
+const uint8_t* View::data() const {
+  return data_->data() + begin_;
+}
+
+void View::CopyTo(size_t begin, uint8_t* destination, size_t length) const {
+  ASSERT_LOG(begin <= size() && length <= size() - begin, "Out of bounds copy of %zu bytes at %zu", length, begin);
+  std::copy_n(data() + begin, length, destination);
+}
 }  // namespace packet
 }  // namespace bluetooth
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace bluetooth {
@@ -34,6 +35,12 @@ class View {
 
   size_t size() const;
 
+  // The bytes of the view, valid as long as the view is.
+  const uint8_t* data() const;
+
+  // Copy length bytes, starting at begin, to destination.
+  void CopyTo(size_t begin, uint8_t* destination, size_t length) const;
+
  private:
   std::shared_ptr<const std::vector<uint8_t>> data_;
   size_t begin_;
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "device/include/controller.h"
+#include "hci_internals.h"
+#include "osi/include/allocator.h"
+#include "packet_fragmenter.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Replays the controller to host ACL packets of a btsnoop capture, passed
+// with --btsnoop_file=<path>. Without one, a synthetic capture of an A2DP
+// sink stream over 2-DH5 packets interleaved with a large-MTU OBEX transfer
+// over 3-DH5 packets is replayed instead.
+constexpr char kBtsnoopFileFlag[] = "--btsnoop_file=";
+constexpr size_t kBtsnoopFileHeaderSize = 16;
+constexpr size_t kBtsnoopRecordHeaderSize = 24;
+constexpr uint32_t kBtsnoopDatalinkH4 = 1002;
+constexpr uint32_t kBtsnoopFlagReceived = 0x01;
+constexpr uint32_t kBtsnoopFlagCommandOrEvent = 0x02;
+constexpr uint8_t kH4TypeAcl = 0x02;
+
+constexpr uint16_t kA2dpHandle = 0x0001;
+constexpr uint16_t kA2dpL2capPduSize = 1005;  // SBC media packets
+constexpr uint16_t kTwoDh5AclDataSize = 679;
+constexpr uint16_t kObexHandle = 0x0002;
+constexpr uint16_t kObexL2capPduSize = 4000;
+constexpr uint16_t kThreeDh5AclDataSize = 1021;
+constexpr size_t kSyntheticPdusPerHandle = 2000;
+
+std::string btsnoop_file;
+std::vector<std::vector<uint8_t>> acl_packets;
+size_t acl_bytes;
+
+uint32_t ReadBigEndian32(const uint8_t* data) {
+  return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+         (uint32_t)data[2] << 8 | (uint32_t)data[3];
+}
+
+bool LoadBtsnoopFile(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr) return false;
+
+  uint8_t header[kBtsnoopRecordHeaderSize];
+  if (fread(header, 1, kBtsnoopFileHeaderSize, file) !=
+          kBtsnoopFileHeaderSize ||
+      memcmp(header, "btsnoop", 8) != 0 ||
+      ReadBigEndian32(header + 12) != kBtsnoopDatalinkH4) {
+    fclose(file);
+    return false;
+  }
+
+  while (fread(header, 1, kBtsnoopRecordHeaderSize, file) ==
+         kBtsnoopRecordHeaderSize) {
+    uint32_t included_length = ReadBigEndian32(header + 4);
+    uint32_t flags = ReadBigEndian32(header + 8);
+    std::vector<uint8_t> record(included_length);
+    if (fread(record.data(), 1, included_length, file) != included_length)
+      break;
+
+    if (!(flags & kBtsnoopFlagReceived) ||
+        (flags & kBtsnoopFlagCommandOrEvent) || included_length <= 1 ||
+        record[0] != kH4TypeAcl)
+      continue;
+    acl_packets.emplace_back(record.begin() + 1, record.end());
+  }
+
+  fclose(file);
+  return !acl_packets.empty();
+}
+
+void AddSyntheticPdu(uint16_t handle, uint16_t l2cap_pdu_size,
+                     uint16_t acl_data_size) {
+  size_t total = l2cap_pdu_size + 4;  // L2CAP length and CID
+  for (size_t sent = 0; sent < total; sent += acl_data_size) {
+    uint16_t length = std::min<size_t>(acl_data_size, total - sent);
+    uint16_t flags = sent == 0 ? 0x2000 : 0x1000;
+    std::vector<uint8_t> packet(HCI_ACL_PREAMBLE_SIZE + length,
+                                (uint8_t)sent);
+    uint8_t* stream = packet.data();
+    UINT16_TO_STREAM(stream, handle | flags);
+    UINT16_TO_STREAM(stream, length);
+    if (sent == 0) {
+      UINT16_TO_STREAM(stream, l2cap_pdu_size);
+      UINT16_TO_STREAM(stream, 0x0040);  // First dynamic CID
+    }
+    acl_packets.push_back(std::move(packet));
+  }
+}
+
+void LoadCapture() {
+  if (!acl_packets.empty()) return;
+
+  if (!btsnoop_file.empty()) {
+    CHECK(LoadBtsnoopFile(btsnoop_file)) << "Unable to load " << btsnoop_file;
+  } else {
+    for (size_t i = 0; i < kSyntheticPdusPerHandle; i++) {
+      AddSyntheticPdu(kA2dpHandle, kA2dpL2capPduSize, kTwoDh5AclDataSize);
+      AddSyntheticPdu(kObexHandle, kObexL2capPduSize, kThreeDh5AclDataSize);
+    }
+  }
+
+  acl_bytes = 0;
+  for (const auto& packet : acl_packets) acl_bytes += packet.size();
+}
+
+const packet_fragmenter_t* fragmenter;
+uint32_t checksum;
+
+// Stands in for L2CAP reading the reassembled payload.
+void ReadContiguous(BT_HDR* packet) {
+  const uint8_t* data = packet->data + packet->offset;
+  for (uint16_t i = 0; i < packet->len; i++) checksum += data[i];
+  osi_free(packet);
+}
+
+void ReadChain(packet_chain_t* chain) {
+  for (BT_HDR* fragment : chain->fragments) {
+    const uint8_t* data = fragment->data + fragment->offset;
+    for (uint16_t i = 0; i < fragment->len; i++) checksum += data[i];
+  }
+  fragmenter->free_chain(chain);
+}
+
+void LinearizeChain(packet_chain_t* chain) {
+  ReadContiguous(fragmenter->linearize_chain(chain));
+}
+
+void UnexpectedFragmented(BT_HDR*, bool) { CHECK(false); }
+
+void UnexpectedTransmitFinished(BT_HDR*, bool) { CHECK(false); }
+
+void BM_ReassembleCapture(State& state,
+                          packet_chain_reassembled_cb reassembled_chain) {
+  LoadCapture();
+
+  controller_t controller = {};
+  packet_fragmenter_callbacks_t callbacks = {
+      UnexpectedFragmented, ReadContiguous, UnexpectedTransmitFinished,
+      reassembled_chain};
+  fragmenter =
+      packet_fragmenter_get_test_interface(&controller, &allocator_malloc);
+  fragmenter->init(&callbacks);
+
+  for (auto _ : state) {
+    for (const auto& acl_packet : acl_packets) {
+      // Allocated the way the HCI HAL callbacks hand packets to the stack.
+      BT_HDR* packet = (BT_HDR*)osi_malloc(BT_HDR_SIZE + acl_packet.size());
+      packet->event = MSG_HC_TO_STACK_HCI_ACL;
+      packet->len = acl_packet.size();
+      packet->offset = 0;
+      packet->layer_specific = 0;
+      memcpy(packet->data, acl_packet.data(), acl_packet.size());
+      fragmenter->reassemble_and_dispatch(packet);
+    }
+  }
+
+  fragmenter->cleanup();
+  benchmark::DoNotOptimize(checksum);
+  state.SetBytesProcessed(state.iterations() * acl_bytes);
+  state.SetItemsProcessed(state.iterations() * acl_packets.size());
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_ReassembleCapture, copy_per_fragment, nullptr);
+BENCHMARK_CAPTURE(BM_ReassembleCapture, fragment_chain, &ReadChain);
+BENCHMARK_CAPTURE(BM_ReassembleCapture, fragment_chain_linearized,
+                  &LinearizeChain);
+
+int main(int argc, char** argv) {
+  // Pull out our own flag before google benchmark rejects it.
+  int remaining = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], kBtsnoopFileFlag, strlen(kBtsnoopFileFlag)) == 0) {
+      btsnoop_file = argv[i] + strlen(kBtsnoopFileFlag);
+    } else {
+      argv[remaining++] = argv[i];
+    }
+  }
+  argc = remaining;
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
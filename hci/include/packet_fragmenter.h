@@ -18,12 +18,28 @@
 
 #pragma once
 
+#include <vector>
+
 #include "bt_types.h"
 #include "hci_layer.h"
 #include "osi/include/allocator.h"
 
+// A reassembled ACL packet kept as the HCI buffers it arrived in instead of
+// being copied into a single buffer. The first fragment starts with the ACL
+// preamble and the L2CAP header, and its ACL length is rewritten to cover the
+// whole packet. Every fragment's |offset| and |len| describe the bytes it
+// contributes, so the fragments can be walked as a scatter list (one
+// packet::View per fragment) without copying.
+typedef struct {
+  uint16_t event;
+  // Total number of bytes across all fragments, ACL preamble included.
+  uint16_t len;
+  std::vector<BT_HDR*> fragments;
+} packet_chain_t;
+
 typedef void (*transmit_finished_cb)(BT_HDR* packet, bool all_fragments_sent);
 typedef void (*packet_reassembled_cb)(BT_HDR* packet);
+typedef void (*packet_chain_reassembled_cb)(packet_chain_t* chain);
 typedef void (*packet_fragmented_cb)(BT_HDR* packet,
                                      bool send_transmit_finished);
 
@@ -37,6 +53,13 @@ typedef struct {
   // Called when the fragmenter finishes sending all requested fragments,
   // but the packet has not been entirely sent.
   transmit_finished_cb transmit_finished;
+
+  // Optional. When set, multi-fragment ACL packets are not copied into one
+  // buffer; the fragments are chained and handed over here once the packet
+  // is complete. Ownership of |chain| passes to the callee, which releases it
+  // with |linearize_chain| or |free_chain|. Single-fragment and non-ACL
+  // packets still go to |reassembled|.
+  packet_chain_reassembled_cb reassembled_chain;
 } packet_fragmenter_callbacks_t;
 
 typedef struct packet_fragmenter_t {
@@ -55,6 +78,13 @@ typedef struct packet_fragmenter_t {
   // callback is called
   // with the reassembled data.
   void (*reassemble_and_dispatch)(BT_HDR* packet);
+
+  // Copies the contents of |chain| into a single buffer, as the reassembled
+  // callback would have received it, and releases |chain|.
+  BT_HDR* (*linearize_chain)(packet_chain_t* chain);
+
+  // Releases |chain| and every fragment it holds.
+  void (*free_chain)(packet_chain_t* chain);
 } packet_fragmenter_t;
 
 const packet_fragmenter_t* packet_fragmenter_get_interface();
@@ -35,7 +35,13 @@
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -69,6 +75,7 @@
 #define BTSNOOP_PATH_PROPERTY "persist.bluetooth.btsnooppath"
 #define DEFAULT_BTSNOOP_PATH "/data/misc/bluetooth/logs/btsnoop_hci.log"
 #define BTSNOOP_MAX_PACKETS_PROPERTY "persist.bluetooth.btsnoopsize"
+#define BTSNOOP_ASYNC_PROPERTY "persist.bluetooth.btsnoopasync"
 
 typedef enum {
   kCommandPacket = 1,
@@ -96,6 +103,36 @@ static std::mutex btsnoop_mutex;
 static int32_t packets_per_file;
 static int32_t packet_counter;
 
+// Asynchronous mode. capture() only copies each record into |snoop_ring| and
+// a dedicated writer thread hands batches of records to the kernel, so the
+// HCI data path never waits on a syscall. Producers are serialized by
+// |btsnoop_mutex|; the ring itself is single producer, single consumer. Each
+// record is a uint32_t length followed by the btsnoop header and payload,
+// and may wrap around the end of the ring.
+static const size_t SNOOP_RING_SIZE = 1 << 20;
+
+// Wake the writer early once this many bytes are pending; otherwise it only
+// flushes every SNOOP_FLUSH_INTERVAL.
+static const size_t SNOOP_RING_WAKE_THRESHOLD = SNOOP_RING_SIZE / 4;
+static const std::chrono::milliseconds SNOOP_FLUSH_INTERVAL(100);
+
+// Two iovecs per record, in case it wraps around the end of the ring.
+static const int SNOOP_WRITE_BATCH_IOVS = 256;
+
+static bool is_btsnoop_async;
+static std::unique_ptr<uint8_t[]> snoop_ring;
+// Both only ever increase; the ring offset is the value modulo the size.
+static std::atomic<uint64_t> snoop_ring_head;  // Owned by the writer thread
+static std::atomic<uint64_t> snoop_ring_tail;  // Owned by capture()
+// Records dropped because the ring was full, reported in the header of every
+// following record as the btsnoop format's cumulative drop count.
+static uint32_t dropped_packets;
+
+static std::thread snoop_writer_thread;
+static std::mutex snoop_writer_mutex;
+static std::condition_variable snoop_writer_cv;
+static bool snoop_writer_running;
+
 // Channel tracking variables for filtering.
 
 // Keeps track of L2CAP channels that need to be filtered out of the snoop
@@ -171,6 +208,8 @@ static std::string get_btsnoop_last_log_path(std::string log_path);
 static void open_next_snoop_file();
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us);
+static void start_snoop_writer();
+static void stop_snoop_writer();
 
 // Module lifecycle functions
 
@@ -216,6 +255,9 @@ static future_t* start_up() {
     packets_per_file = osi_property_get_int32(BTSNOOP_MAX_PACKETS_PROPERTY,
                                               DEFAULT_BTSNOOP_SIZE);
     btsnoop_net_open();
+
+    is_btsnoop_async = osi_property_get_bool(BTSNOOP_ASYNC_PROPERTY, false);
+    if (is_btsnoop_async) start_snoop_writer();
   }
 
   return NULL;
@@ -224,6 +266,9 @@ static future_t* start_up() {
 static future_t* shut_down(void) {
   std::lock_guard<std::mutex> lock(btsnoop_mutex);
 
+  // Flushes whatever is still queued before the log file is closed.
+  if (is_btsnoop_async) stop_snoop_writer();
+
   if (is_btsnoop_enabled) {
     if (is_btsnoop_filtered) {
       delete_btsnoop_files(false);
@@ -264,7 +309,8 @@ static void capture(const BT_HDR* buffer, bool is_received) {
 
   btsnoop_mem_capture(buffer, timestamp_us);
 
-  if (logfile_fd == INVALID_FD) return;
+  if (is_btsnoop_async ? snoop_ring == nullptr : logfile_fd == INVALID_FD)
+    return;
 
   switch (buffer->event & MSG_EVT_MASK) {
     case MSG_HC_TO_STACK_HCI_EVT:
@@ -427,8 +473,11 @@ static bool should_filter_log(bool is_received, uint8_t* packet) {
   return false;
 }
 
-static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
-                                 bool is_received, uint64_t timestamp_us) {
+// Fills in |header| for |packet| and returns how many bytes of |packet| are
+// logged after it.
+static uint32_t btsnoop_prepare_header(packet_type_t type, uint8_t* packet,
+                                       bool is_received, uint64_t timestamp_us,
+                                       btsnoop_header_t* header) {
   uint32_t length_he = 0;
   uint32_t flags = 0;
 
@@ -451,24 +500,91 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       break;
   }
 
-  btsnoop_header_t header;
-  header.length_original = htonl(length_he);
+  header->length_original = htonl(length_he);
 
   bool blacklisted = false;
   if (is_btsnoop_filtered && type == kAclPacket) {
     blacklisted = should_filter_log(is_received, packet);
   }
 
-  header.length_captured =
-      blacklisted ? htonl(L2C_HEADER_SIZE) : header.length_original;
+  header->length_captured =
+      blacklisted ? htonl(L2C_HEADER_SIZE) : header->length_original;
   if (blacklisted) length_he = L2C_HEADER_SIZE;
-  header.flags = htonl(flags);
-  header.dropped_packets = 0;
-  header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
-  header.type = type;
+  header->flags = htonl(flags);
+  header->dropped_packets = 0;
+  header->timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
+  header->type = type;
+
+  return length_he - 1;
+}
+
+static void snoop_ring_write(uint64_t position, const void* data,
+                             size_t length) {
+  size_t offset = position & (SNOOP_RING_SIZE - 1);
+  size_t first = std::min(length, SNOOP_RING_SIZE - offset);
+  memcpy(snoop_ring.get() + offset, data, first);
+  memcpy(snoop_ring.get(), static_cast<const uint8_t*>(data) + first,
+         length - first);
+}
+
+static void snoop_ring_read(uint64_t position, void* data, size_t length) {
+  size_t offset = position & (SNOOP_RING_SIZE - 1);
+  size_t first = std::min(length, SNOOP_RING_SIZE - offset);
+  memcpy(data, snoop_ring.get() + offset, first);
+  memcpy(static_cast<uint8_t*>(data) + first, snoop_ring.get(),
+         length - first);
+}
+
+// Points |iov| at |length| bytes of the ring starting at |position| and
+// returns the number of iovecs used.
+static int snoop_ring_iov(uint64_t position, size_t length, iovec* iov) {
+  size_t offset = position & (SNOOP_RING_SIZE - 1);
+  size_t first = std::min(length, SNOOP_RING_SIZE - offset);
+  iov[0] = {snoop_ring.get() + offset, first};
+  if (first == length) return 1;
+
+  iov[1] = {snoop_ring.get(), length - first};
+  return 2;
+}
+
+// Called with |btsnoop_mutex| held.
+static void btsnoop_queue_packet(btsnoop_header_t* header, uint8_t* packet,
+                                 uint32_t length) {
+  uint32_t record_length = sizeof(btsnoop_header_t) + length;
+  uint64_t tail = snoop_ring_tail.load(std::memory_order_relaxed);
+  size_t pending = tail - snoop_ring_head.load(std::memory_order_acquire);
+  size_t needed = sizeof(record_length) + record_length;
+  if (pending + needed > SNOOP_RING_SIZE) {
+    dropped_packets++;
+    return;
+  }
+
+  header->dropped_packets = htonl(dropped_packets);
+  snoop_ring_write(tail, &record_length, sizeof(record_length));
+  snoop_ring_write(tail + sizeof(record_length), header,
+                   sizeof(btsnoop_header_t));
+  snoop_ring_write(tail + sizeof(record_length) + sizeof(btsnoop_header_t),
+                   packet, length);
+  snoop_ring_tail.store(tail + needed, std::memory_order_release);
+
+  if (pending < SNOOP_RING_WAKE_THRESHOLD &&
+      pending + needed >= SNOOP_RING_WAKE_THRESHOLD)
+    snoop_writer_cv.notify_one();
+}
+
+static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
+                                 bool is_received, uint64_t timestamp_us) {
+  btsnoop_header_t header;
+  uint32_t length =
+      btsnoop_prepare_header(type, packet, is_received, timestamp_us, &header);
+
+  if (is_btsnoop_async) {
+    btsnoop_queue_packet(&header, packet, length);
+    return;
+  }
 
   btsnoop_net_write(&header, sizeof(btsnoop_header_t));
-  btsnoop_net_write(packet, length_he - 1);
+  btsnoop_net_write(packet, length);
 
   if (logfile_fd != INVALID_FD) {
     packet_counter++;
@@ -477,7 +593,85 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
     }
 
     iovec iov[] = {{&header, sizeof(btsnoop_header_t)},
-                   {reinterpret_cast<void*>(packet), length_he - 1}};
+                   {reinterpret_cast<void*>(packet), length}};
     TEMP_FAILURE_RETRY(writev(logfile_fd, iov, 2));
   }
 }
+
+// Writes out every record queued so far. Only called on the writer thread, or
+// once it has stopped.
+static void flush_snoop_ring() {
+  uint64_t head = snoop_ring_head.load(std::memory_order_relaxed);
+  uint64_t tail = snoop_ring_tail.load(std::memory_order_acquire);
+
+  iovec iov[SNOOP_WRITE_BATCH_IOVS];
+  int iovcnt = 0;
+  auto write_batch = [&iov, &iovcnt, &head]() {
+    if (iovcnt > 0 && logfile_fd != INVALID_FD)
+      TEMP_FAILURE_RETRY(writev(logfile_fd, iov, iovcnt));
+    iovcnt = 0;
+    snoop_ring_head.store(head, std::memory_order_release);
+  };
+
+  while (head != tail) {
+    uint32_t record_length;
+    snoop_ring_read(head, &record_length, sizeof(record_length));
+    uint64_t record = head + sizeof(record_length);
+
+    if (logfile_fd != INVALID_FD) {
+      packet_counter++;
+      if (packet_counter > packets_per_file) {
+        write_batch();
+        open_next_snoop_file();
+      }
+    }
+
+    if (iovcnt + 2 > SNOOP_WRITE_BATCH_IOVS) write_batch();
+    int count = snoop_ring_iov(record, record_length, iov + iovcnt);
+    for (int i = 0; i < count; i++)
+      btsnoop_net_write(iov[iovcnt + i].iov_base, iov[iovcnt + i].iov_len);
+    iovcnt += count;
+    head = record + record_length;
+  }
+
+  write_batch();
+}
+
+static void snoop_writer_loop() {
+  std::unique_lock<std::mutex> lock(snoop_writer_mutex);
+  while (snoop_writer_running) {
+    snoop_writer_cv.wait_for(lock, SNOOP_FLUSH_INTERVAL);
+    lock.unlock();
+    flush_snoop_ring();
+    lock.lock();
+  }
+}
+
+// Called with |btsnoop_mutex| held, once the first log file is open.
+static void start_snoop_writer() {
+  snoop_ring.reset(new uint8_t[SNOOP_RING_SIZE]);
+  snoop_ring_head = 0;
+  snoop_ring_tail = 0;
+  dropped_packets = 0;
+
+  snoop_writer_running = true;
+  snoop_writer_thread = std::thread(snoop_writer_loop);
+}
+
+// Called with |btsnoop_mutex| held, so no more records can be queued.
+static void stop_snoop_writer() {
+  if (!snoop_writer_thread.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(snoop_writer_mutex);
+    snoop_writer_running = false;
+  }
+  snoop_writer_cv.notify_one();
+  snoop_writer_thread.join();
+
+  flush_snoop_ring();
+  if (dropped_packets > 0)
+    LOG(WARNING) << __func__ << ": dropped " << dropped_packets
+                 << " packets, the writer could not keep up";
+  snoop_ring.reset();
+}
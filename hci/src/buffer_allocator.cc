@@ -23,7 +23,7 @@
 
 static void* buffer_alloc(size_t size) {
   CHECK(size <= BT_DEFAULT_BUFFER_SIZE);
-  return osi_malloc(size);
+  return osi_pool_malloc(size);
 }
 
 static const allocator_t interface = {buffer_alloc, osi_free};
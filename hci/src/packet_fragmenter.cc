@@ -51,11 +51,26 @@ static const packet_fragmenter_callbacks_t* callbacks;
 
 static std::unordered_map<uint16_t /* handle */, BT_HDR*> partial_packets;
 
+// Used instead of |partial_packets| when the upper layer takes fragment chains.
+typedef struct {
+  uint16_t expected_len;
+  packet_chain_t* chain;
+} partial_chain_t;
+
+static std::unordered_map<uint16_t /* handle */, partial_chain_t>
+    partial_chains;
+
+static void free_chain(packet_chain_t* chain);
+
 static void init(const packet_fragmenter_callbacks_t* result_callbacks) {
   callbacks = result_callbacks;
 }
 
-static void cleanup() { partial_packets.clear(); }
+static void cleanup() {
+  partial_packets.clear();
+  for (auto& entry : partial_chains) free_chain(entry.second.chain);
+  partial_chains.clear();
+}
 
 static void fragment_and_dispatch(BT_HDR* packet) {
   CHECK(packet != NULL);
@@ -119,6 +134,73 @@ static bool check_uint16_overflow(uint16_t a, uint16_t b) {
   return (UINT16_MAX - a) < b;
 }
 
+static void drop_partial_chain(uint16_t handle) {
+  auto map_iter = partial_chains.find(handle);
+  if (map_iter == partial_chains.end()) return;
+
+  LOG_WARN(LOG_TAG,
+           "%s found unfinished packet for handle with start packet. "
+           "Dropping old.",
+           __func__);
+  free_chain(map_iter->second.chain);
+  partial_chains.erase(map_iter);
+}
+
+// Starts a chain for |handle| with the start fragment |packet|, whose ACL
+// length is rewritten to |full_length| like the linearized packet's would be.
+static void start_chain(uint16_t handle, BT_HDR* packet,
+                        uint16_t full_length) {
+  uint8_t* stream = packet->data;
+  STREAM_SKIP_UINT16(stream);  // skip the handle
+  UINT16_TO_STREAM(stream, full_length - HCI_ACL_PREAMBLE_SIZE);
+
+  packet_chain_t* chain = new packet_chain_t;
+  chain->event = packet->event;
+  chain->len = packet->len;
+  // Assume the controller keeps sending fragments of the same size.
+  chain->fragments.reserve(
+      (full_length + packet->len - HCI_ACL_PREAMBLE_SIZE - 1) /
+      (packet->len - HCI_ACL_PREAMBLE_SIZE));
+  chain->fragments.push_back(packet);
+
+  partial_chains[handle] = {full_length, chain};
+}
+
+static void append_to_chain(uint16_t handle, BT_HDR* packet) {
+  auto map_iter = partial_chains.find(handle);
+  if (map_iter == partial_chains.end()) {
+    LOG_WARN(LOG_TAG, "%s got continuation for unknown packet. Dropping it.",
+             __func__);
+    buffer_allocator->free(packet);
+    return;
+  }
+  partial_chain_t& partial = map_iter->second;
+  packet_chain_t* chain = partial.chain;
+
+  // Only the payload of a continuation fragment is part of the packet.
+  packet->offset = HCI_ACL_PREAMBLE_SIZE;
+  packet->len -= HCI_ACL_PREAMBLE_SIZE;
+  if (chain->len + packet->len > partial.expected_len) {
+    LOG_WARN(LOG_TAG,
+             "%s got packet which would exceed expected length of %d. "
+             "Truncating.",
+             __func__, partial.expected_len);
+    packet->len = partial.expected_len - chain->len;
+  }
+
+  if (packet->len == 0) {
+    buffer_allocator->free(packet);
+  } else {
+    chain->fragments.push_back(packet);
+    chain->len += packet->len;
+  }
+
+  if (chain->len == partial.expected_len) {
+    partial_chains.erase(map_iter);
+    callbacks->reassembled_chain(chain);
+  }
+}
+
 static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
   if ((packet->event & MSG_EVT_MASK) == MSG_HC_TO_STACK_HCI_ACL) {
     uint8_t* stream = packet->data;
@@ -152,6 +234,7 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
         partial_packets.erase(map_iter);
         buffer_allocator->free(hdl);
       }
+      drop_partial_chain(handle);
 
       if (acl_length < L2CAP_HEADER_PDU_LEN_SIZE) {
         LOG_WARN(LOG_TAG, "%s L2CAP packet too small (%d < %d). Dropping it.",
@@ -184,6 +267,11 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
         return;
       }
 
+      if (callbacks->reassembled_chain != NULL) {
+        start_chain(handle, packet, full_length);
+        return;
+      }
+
       BT_HDR* partial_packet =
           (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
       partial_packet->event = packet->event;
@@ -202,6 +290,11 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
       // Free the old packet buffer, since we don't need it anymore
       buffer_allocator->free(packet);
     } else {
+      if (callbacks->reassembled_chain != NULL) {
+        append_to_chain(handle, packet);
+        return;
+      }
+
       auto map_iter = partial_packets.find(handle);
       if (map_iter == partial_packets.end()) {
         LOG_WARN(LOG_TAG,
@@ -244,10 +337,39 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
   }
 }
 
-static const packet_fragmenter_t interface = {init, cleanup,
+static BT_HDR* linearize_chain(packet_chain_t* chain) {
+  CHECK(chain != NULL);
+
+  BT_HDR* packet =
+      (BT_HDR*)buffer_allocator->alloc(chain->len + sizeof(BT_HDR));
+  packet->event = chain->event;
+  packet->len = chain->len;
+  packet->offset = 0;
+  packet->layer_specific = 0;
+
+  uint8_t* stream = packet->data;
+  for (BT_HDR* fragment : chain->fragments) {
+    memcpy(stream, fragment->data + fragment->offset, fragment->len);
+    stream += fragment->len;
+  }
+
+  free_chain(chain);
+  return packet;
+}
+
+static void free_chain(packet_chain_t* chain) {
+  if (chain == NULL) return;
+
+  for (BT_HDR* fragment : chain->fragments) buffer_allocator->free(fragment);
+  delete chain;
+}
 
+static const packet_fragmenter_t interface = {init,
+                                              cleanup,
                                               fragment_and_dispatch,
-                                              reassemble_and_dispatch};
+                                              reassemble_and_dispatch,
+                                              linearize_chain,
+                                              free_chain};
 
 const packet_fragmenter_t* packet_fragmenter_get_interface() {
   controller = controller_get_interface();
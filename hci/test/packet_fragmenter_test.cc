@@ -32,7 +32,7 @@
 DECLARE_TEST_MODES(init, set_data_sizes, no_fragmentation, fragmentation,
                    ble_no_fragmentation, ble_fragmentation,
                    non_acl_passthrough_fragmentation, no_reassembly, reassembly,
-                   non_acl_passthrough_reassembly);
+                   non_acl_passthrough_reassembly, chain_reassembly);
 
 #define LOCAL_BLE_CONTROLLER_ID 1
 
@@ -256,6 +256,21 @@ DURING(non_acl_passthrough_reassembly) AT_CALL(0) {
 UNEXPECTED_CALL;
 }
 
+STUB_FUNCTION(void, reassembled_chain_callback, (packet_chain_t * chain))
+DURING(chain_reassembly) AT_CALL(0) {
+  // 42 byte ACL packets carry 38 bytes of payload each.
+  size_t expected_fragments = (strlen(sample_data) + 2 + 37) / 38;
+  EXPECT_EQ(expected_fragments, chain->fragments.size());
+  EXPECT_EQ(MSG_HC_TO_STACK_HCI_ACL, chain->event);
+  EXPECT_EQ(strlen(sample_data) + 2 + HCI_ACL_PREAMBLE_SIZE, chain->len);
+  expect_packet_reassembled(MSG_HC_TO_STACK_HCI_ACL,
+                            fragmenter->linearize_chain(chain), sample_data);
+  return;
+}
+
+UNEXPECTED_CALL;
+}
+
 STUB_FUNCTION(void, transmit_finished_callback,
               (UNUSED_ATTR BT_HDR * packet,
                UNUSED_ATTR bool sent_all_fragments))
@@ -283,6 +298,7 @@ return 0;
 static void reset_for(TEST_MODES_T next) {
   RESET_CALL_COUNT(fragmented_callback);
   RESET_CALL_COUNT(reassembled_callback);
+  RESET_CALL_COUNT(reassembled_chain_callback);
   RESET_CALL_COUNT(transmit_finished_callback);
   RESET_CALL_COUNT(get_acl_data_size_classic);
   RESET_CALL_COUNT(get_acl_data_size_ble);
@@ -302,6 +318,7 @@ class PacketFragmenterTest : public AllocationTestHarness {
     callbacks.fragmented = fragmented_callback;
     callbacks.reassembled = reassembled_callback;
     callbacks.transmit_finished = transmit_finished_callback;
+    callbacks.reassembled_chain = NULL;
     controller.get_acl_data_size_classic = get_acl_data_size_classic;
     controller.get_acl_data_size_ble = get_acl_data_size_ble;
 
@@ -394,3 +411,44 @@ TEST_F(PacketFragmenterTest, test_non_acl_passthrough_reasseembly) {
   EXPECT_EQ(strlen(sample_data), data_size_sum);
   EXPECT_CALL_COUNT(reassembled_callback, 1);
 }
+
+TEST_F(PacketFragmenterTest, test_chain_reassembly) {
+  callbacks.reassembled_chain = reassembled_chain_callback;
+  reset_for(chain_reassembly);
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 42,
+                                         sample_data);
+
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 0);
+  EXPECT_CALL_COUNT(reassembled_chain_callback, 1);
+}
+
+TEST_F(PacketFragmenterTest, test_chain_reassembly_single_fragment) {
+  callbacks.reassembled_chain = reassembled_chain_callback;
+  reset_for(no_reassembly);
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 1337,
+                                         small_sample_data);
+
+  EXPECT_EQ(strlen(small_sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+  EXPECT_CALL_COUNT(reassembled_chain_callback, 0);
+}
+
+TEST_F(PacketFragmenterTest, test_chain_dropped_on_cleanup) {
+  callbacks.reassembled_chain = reassembled_chain_callback;
+  reset_for(chain_reassembly);
+
+  BT_HDR* packet = (BT_HDR*)osi_malloc(10 + sizeof(BT_HDR));
+  packet->len = 10;
+  packet->offset = 0;
+  packet->event = MSG_HC_TO_STACK_HCI_ACL;
+  packet->layer_specific = 0;
+  uint8_t* stream = packet->data;
+  UINT16_TO_STREAM(stream, test_handle_start);
+  UINT16_TO_STREAM(stream, 6);
+  UINT16_TO_STREAM(stream, 100);  // l2cap length, never completed
+  fragmenter->reassemble_and_dispatch(packet);
+
+  // The AllocationTestHarness fails the test if cleanup leaks the fragment.
+  EXPECT_CALL_COUNT(reassembled_chain_callback, 0);
+}
@@ -16,10 +16,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <set>
 #include <string>
+#include <vector>
 
-#include <base/callback_forward.h>
+#include <base/bind.h>
+#include <base/callback.h>
 
 #include "avrcp_common.h"
 #include "raw_address.h"
@@ -81,8 +85,9 @@ class MediaCallbacks {
 };
 
 // The classes below are used by the JNI and are loaded dynamically with the
-// Bluetooth library. All classes must be pure virtual otherwise a compiler
-// error occurs when trying to link the function implementation.
+// Bluetooth library. All classes must be pure virtual, or define their
+// functions inline, otherwise a compiler error occurs when trying to link the
+// function implementation.
 
 // MediaInterface defines the class that the AVRCP Service uses in order
 // communicate with the media layer. The media layer will define its own
@@ -143,6 +148,36 @@ class MediaInterface {
 
   MediaInterface() = default;
   virtual ~MediaInterface() = default;
+
+  // Lists the items from |start| to |end| of a folder, along with the number
+  // of items in the folder, so that a device paging through a large folder
+  // doesn't have the whole folder listed for every page. The items past the
+  // end of the folder are left out. Media layers that can list a range of
+  // items should override this, by default the whole folder is listed and
+  // sliced. Declared after the other virtual methods, so that their vtable
+  // slots stay those the media layers were built with.
+  using FolderItemsRangeCallback =
+      base::Callback<void(uint32_t num_items, std::vector<ListItem>)>;
+  virtual void GetFolderItemsRange(uint16_t player_id, std::string media_id,
+                                   uint32_t start, uint32_t end,
+                                   FolderItemsRangeCallback folder_cb) {
+    GetFolderItems(player_id, media_id,
+                   base::Bind(&MediaInterface::SliceFolderItems, start, end,
+                              folder_cb));
+  }
+
+ private:
+  static void SliceFolderItems(uint32_t start, uint32_t end,
+                               FolderItemsRangeCallback folder_cb,
+                               std::vector<ListItem> items) {
+    std::vector<ListItem> range;
+    if (start <= end && start < items.size()) {
+      auto last = items.begin() + std::min<size_t>(end, items.size() - 1) + 1;
+      range.assign(std::make_move_iterator(items.begin() + start),
+                   std::make_move_iterator(last));
+    }
+    folder_cb.Run(items.size(), std::move(range));
+  }
 };
 
 class VolumeInterface {
@@ -24,6 +24,8 @@ __BEGIN_DECLS
 #define BTSOCK_FLAG_AUTH_MITM (1 << 3)
 #define BTSOCK_FLAG_AUTH_16_DIGIT (1 << 4)
 #define BTSOCK_FLAG_LE_COC (1 << 5)
+// Classic L2CAP channel in basic mode, rather than ERTM.
+#define BTSOCK_FLAG_L2CAP_BASIC_MODE (1 << 6)
 
 typedef enum {
   BTSOCK_RFCOMM = 1,
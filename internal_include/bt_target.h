@@ -305,6 +305,17 @@
 #define BTM_INQ_DB_SIZE 40
 #endif
 
+/* The number of LE devices whose advertising data is kept until the scan
+ * response, or the rest of the chain, is received. */
+#ifndef BTM_BLE_ADV_CACHE_SIZE
+#define BTM_BLE_ADV_CACHE_SIZE 128
+#endif
+
+/* The time after which incomplete LE advertising data is dropped. */
+#ifndef BTM_BLE_ADV_CACHE_TIMEOUT_MS
+#define BTM_BLE_ADV_CACHE_TIMEOUT_MS (10 * 1000)
+#endif
+
 /* The default scan mode */
 #ifndef BTM_DEFAULT_SCAN_TYPE
 #define BTM_DEFAULT_SCAN_TYPE BTM_SCAN_TYPE_INTERLACED
@@ -33,6 +33,7 @@ typedef struct {
 // allocator_t abstractions for the osi_*alloc and osi_free functions
 extern const allocator_t allocator_malloc;
 extern const allocator_t allocator_calloc;
+extern const allocator_t allocator_pool;
 
 char* osi_strdup(const char* str);
 char* osi_strndup(const char* str, size_t len);
@@ -41,6 +42,12 @@ void* osi_malloc(size_t size);
 void* osi_calloc(size_t size);
 void osi_free(void* ptr);
 
+// Allocates a packet buffer of |size| bytes from the per-thread size-class
+// pool, falling back to malloc when no size class fits or the class is
+// exhausted. The returned buffer is uninitialized and is released with
+// |osi_free| like any other buffer, on any thread.
+void* osi_pool_malloc(size_t size);
+
 // Free a buffer that was previously allocated with function |osi_malloc|
 // or |osi_calloc| and reset the pointer to that buffer to NULL.
 // |p_ptr| is a pointer to the buffer pointer to be reset.
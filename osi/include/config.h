@@ -15,11 +15,17 @@
 //   empty sections.
 // - Duplicate keys in a section will overwrite previous values.
 // - All strings are case sensitive.
+// - Sections and keys are looked up through hash indexes; the lists keep the
+//   order of the file.
+// - Changes can be recorded in an append-only journal, replayed on top of the
+//   file when it is loaded again, instead of saving the whole file each time.
 
 #include <stdbool.h>
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 // The default section name to use if a key/value pair is not defined within
 // a section.
@@ -33,10 +39,31 @@ struct entry_t {
 struct section_t {
   std::string name;
   std::list<entry_t> entries;
+
+  // Index of |entries| by key. The keys refer to the strings of |entries|, so
+  // a section must not be copied.
+  std::unordered_map<std::string_view, std::list<entry_t>::iterator>
+      entry_index;
 };
 
+// Returns true if the changes of |section| are recorded in the journal.
+typedef bool (*config_journal_filter_t)(const section_t& section);
+
 struct config_t {
+  config_t() = default;
+  config_t(const config_t&) = delete;
+  config_t& operator=(const config_t&) = delete;
+
   std::list<section_t> sections;
+
+  // Index of |sections| by name, referring to the names of |sections|.
+  std::unordered_map<std::string_view, std::list<section_t>::iterator>
+      section_index;
+
+  // Changes not appended to the journal yet, when journaling.
+  bool journaling = false;
+  config_journal_filter_t journal_filter = nullptr;
+  std::string journal;
 };
 
 // Creates a new config object with no entries (i.e. not backed by a file).
@@ -141,3 +168,22 @@ bool config_save(const config_t& config, const std::string& filename);
 // that this could be a destructive operation: if |filename| already exists,
 // it will be overwritten.
 bool checksum_save(const std::string& checksum, const std::string& filename);
+
+// Starts recording the changes made to |config|, dropping the ones recorded
+// before. They are appended to a journal file by |config_journal_save|.
+// If |journal_filter| is not NULL, only the changes of the sections it returns
+// true for are recorded; the current entries of a section are recorded once
+// it starts passing the filter. |config| must not be NULL.
+void config_journal_start(config_t* config,
+                          config_journal_filter_t journal_filter = nullptr);
+
+// Appends the changes recorded in |config| to the journal file |filename|,
+// creating it if needed, and syncs it to disk. On success the recorded changes
+// are dropped; on failure the file is restored to its previous size and the
+// changes are kept. Neither |config| nor |filename| may be NULL.
+bool config_journal_save(config_t* config, const std::string& filename);
+
+// Applies the changes of the journal file |filename| to |config|, without
+// recording them. A truncated last change, left by an interrupted append, is
+// ignored. Returns false if |filename| cannot be read.
+bool config_journal_replay(config_t* config, const std::string& filename);
@@ -36,6 +36,22 @@ typedef void (*fixed_queue_cb)(fixed_queue_t* queue, void* context);
 // the returned queue with |fixed_queue_free|.
 fixed_queue_t* fixed_queue_new(size_t capacity);
 
+// Creates a new fixed queue backed by a preallocated lock-free ring instead of
+// a mutex-protected list. |capacity| is rounded up to the next power of two
+// and must be non-zero and bounded (i.e. not SIZE_MAX). The dequeue fd is an
+// eventfd doorbell that is only signalled when the queue goes from empty to
+// non-empty, so producers do not pay a syscall per element while the consumer
+// is still draining. Returns NULL on failure. The caller must free the
+// returned queue with |fixed_queue_free|.
+//
+// Ring queues support the whole API with the following exceptions:
+// |fixed_queue_try_remove_from_queue|, |fixed_queue_get_list| and
+// |fixed_queue_get_enqueue_fd| must not be called on them, and a blocking
+// |fixed_queue_enqueue| on a full ring yields the CPU until space is made
+// available rather than sleeping on a semaphore. They are intended for hot
+// producer/consumer paths whose depth is already bounded by the caller.
+fixed_queue_t* fixed_queue_new_ring(size_t capacity);
+
 // Frees a queue and (optionally) the enqueued elements.
 // |queue| is the queue to free. If the |free_cb| callback is not null,
 // it is called on each queue element to free it.
@@ -95,11 +111,13 @@ void* fixed_queue_try_peek_last(fixed_queue_t* queue);
 // function will never block the caller. If the queue is empty or NULL, this
 // function returns NULL immediately. |data| may not be NULL. If the |data|
 // element is found in the queue, a pointer to the removed data is returned,
-// otherwise NULL.
+// otherwise NULL. |queue| must not have been created with
+// |fixed_queue_new_ring|.
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data);
 
 // Returns the iterateable list with all entries in the |queue|. This function
-// will never block the caller. |queue| may not be NULL.
+// will never block the caller. |queue| may not be NULL and must not have been
+// created with |fixed_queue_new_ring|.
 //
 // NOTE: The return result of this function is not thread safe: the list could
 // be modified by another thread, and the result would be unpredictable.
@@ -111,7 +129,7 @@ list_t* fixed_queue_get_list(fixed_queue_t* queue);
 // operation on the fd: select(2). If |select| indicates that the file
 // descriptor is readable, the caller may call |fixed_queue_enqueue| without
 // blocking. The caller must not close the returned file descriptor. |queue|
-// may not be NULL.
+// may not be NULL and must not have been created with |fixed_queue_new_ring|.
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue);
 
 // This function returns a valid file descriptor. Callers may perform one
@@ -0,0 +1,47 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Size-class slab allocator used by |osi_pool_malloc| for packet buffers.
+//
+// All blocks live in one lazily-populated arena that is reserved on first
+// use, split into size classes that match the common BT_HDR buffer sizes.
+// Every thread keeps a small cache of free blocks per size class, so the
+// common alloc/free pair does not take a lock even when buffers are freed on
+// a different thread than the one that allocated them.
+//
+// These functions are internal to osi; use |osi_pool_malloc| and |osi_free|.
+
+// Allocates a block of at least |size| bytes. Returns NULL if no size class
+// fits |size| or if the matching size class is exhausted; the caller is
+// expected to fall back to malloc in that case.
+void* slab_allocator_alloc(size_t size);
+
+// Returns true if |ptr| points to a block returned by |slab_allocator_alloc|.
+bool slab_allocator_owns(const void* ptr);
+
+// Returns the block at |ptr| to its size class. |slab_allocator_owns| must be
+// true for |ptr|.
+void slab_allocator_free(void* ptr);
+
+// Dumps per size class hit/miss counters and high watermarks to |fd|.
+void slab_allocator_debug_dump(int fd);
@@ -36,11 +36,12 @@
 
 #include <hardware/bluetooth.h>
 
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/semaphore.h"
@@ -98,6 +99,8 @@ struct alarm_t {
   uint64_t prev_deadline_ms;  // Previous deadline - used for accounting of
                               // periodic timers
   bool is_periodic;
+  size_t heap_index;  // Position in |alarms|, or |NOT_PENDING|
+  uint64_t heap_seq;  // Orders alarms with the same deadline by set time
   fixed_queue_t* queue;  // The processing queue to add this alarm to
   alarm_callback_t callback;
   void* data;
@@ -116,9 +119,16 @@ static const clockid_t CLOCK_ID = CLOCK_BOOTTIME;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| heap.
 static std::mutex alarms_mutex;
-static list_t* alarms;
+
+// Pending alarms, kept in a 4-ary min-heap ordered by deadline. Every alarm
+// stores its own position in the heap, so setting and canceling an alarm is
+// O(log n) instead of a linear walk over all pending alarms.
+static std::vector<alarm_t*>* alarms;
+static uint64_t alarms_next_seq;
+static const size_t NOT_PENDING = SIZE_MAX;
+static const size_t HEAP_ARITY = 4;
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
@@ -140,6 +150,9 @@ static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
                                fixed_queue_t* queue, bool for_msg_loop);
 static void alarm_cancel_internal(alarm_t* alarm);
 static void remove_pending_alarm(alarm_t* alarm);
+static bool is_next_alarm(const alarm_t* alarm);
+static void heap_insert(alarm_t* alarm);
+static void heap_remove(alarm_t* alarm);
 static void schedule_next_instance(alarm_t* alarm);
 static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
@@ -177,6 +190,7 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
   std::shared_ptr<std::recursive_mutex> ptr(new std::recursive_mutex());
   ret->callback_mutex = ptr;
   ret->is_periodic = is_periodic;
+  ret->heap_index = NOT_PENDING;
   ret->stats.name = osi_strdup(name);
 
   ret->for_msg_loop = false;
@@ -260,8 +274,7 @@ void alarm_cancel(alarm_t* alarm) {
 // Internal implementation of canceling an alarm.
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = is_next_alarm(alarm);
 
   remove_pending_alarm(alarm);
 
@@ -301,7 +314,7 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
+  delete alarms;
   alarms = NULL;
 }
 
@@ -315,11 +328,7 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
-  if (!alarms) {
-    LOG_ERROR(LOG_TAG, "%s unable to allocate alarm list.", __func__);
-    goto error;
-  }
+  alarms = new std::vector<alarm_t*>();
 
   if (!timer_create_internal(CLOCK_ID, &timer)) goto error;
   timer_initialized = true;
@@ -382,7 +391,7 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
+  delete alarms;
   alarms = NULL;
 
   return false;
@@ -401,10 +410,86 @@ static uint64_t now_ms(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
-// Remove alarm from internal alarm list and the processing queue
+static bool heap_less(const alarm_t* a, const alarm_t* b) {
+  if (a->deadline_ms != b->deadline_ms) return a->deadline_ms < b->deadline_ms;
+  return a->heap_seq < b->heap_seq;
+}
+
+static void heap_place(alarm_t* alarm, size_t index) {
+  (*alarms)[index] = alarm;
+  alarm->heap_index = index;
+}
+
+static void heap_sift_up(size_t index) {
+  alarm_t* alarm = (*alarms)[index];
+  while (index > 0) {
+    size_t parent = (index - 1) / HEAP_ARITY;
+    if (!heap_less(alarm, (*alarms)[parent])) break;
+    heap_place((*alarms)[parent], index);
+    index = parent;
+  }
+  heap_place(alarm, index);
+}
+
+static void heap_sift_down(size_t index) {
+  alarm_t* alarm = (*alarms)[index];
+  const size_t length = alarms->size();
+  while (true) {
+    size_t first_child = index * HEAP_ARITY + 1;
+    if (first_child >= length) break;
+
+    size_t smallest = first_child;
+    size_t last_child = std::min(first_child + HEAP_ARITY, length);
+    for (size_t child = first_child + 1; child < last_child; child++) {
+      if (heap_less((*alarms)[child], (*alarms)[smallest])) smallest = child;
+    }
+    if (!heap_less((*alarms)[smallest], alarm)) break;
+
+    heap_place((*alarms)[smallest], index);
+    index = smallest;
+  }
+  heap_place(alarm, index);
+}
+
+// The caller must hold the |alarms_mutex|
+static void heap_insert(alarm_t* alarm) {
+  CHECK(alarm->heap_index == NOT_PENDING);
+
+  alarm->heap_seq = alarms_next_seq++;
+  alarms->push_back(alarm);
+  heap_sift_up(alarms->size() - 1);
+}
+
+// The caller must hold the |alarms_mutex|
+static void heap_remove(alarm_t* alarm) {
+  size_t index = alarm->heap_index;
+  if (index == NOT_PENDING) return;
+
+  CHECK(index < alarms->size() && (*alarms)[index] == alarm);
+  alarm->heap_index = NOT_PENDING;
+
+  alarm_t* last = alarms->back();
+  alarms->pop_back();
+  if (last == alarm) return;
+
+  heap_place(last, index);
+  if (index > 0 && heap_less(last, (*alarms)[(index - 1) / HEAP_ARITY])) {
+    heap_sift_up(index);
+  } else {
+    heap_sift_down(index);
+  }
+}
+
+// Returns true if |alarm| is the pending alarm with the earliest deadline.
+// The caller must hold the |alarms_mutex|
+static bool is_next_alarm(const alarm_t* alarm) {
+  return !alarms->empty() && alarms->front() == alarm;
+}
+
+// Remove alarm from internal alarm heap and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  heap_remove(alarm);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -419,10 +504,9 @@ static void remove_pending_alarm(alarm_t* alarm) {
 
 // Must be called with |alarms_mutex| held
 static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
+  // If the alarm is currently set and it's at the top of the heap,
   // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = is_next_alarm(alarm);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -433,26 +517,12 @@ static void schedule_next_instance(alarm_t* alarm) {
         ((just_now_ms - alarm->creation_time_ms) % alarm->period_ms);
   alarm->deadline_ms = just_now_ms + (alarm->period_ms - ms_into_period);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline_ms > alarm->deadline_ms) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline_ms > alarm->deadline_ms) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
+  // Add it into the timer heap (earliest deadline first).
+  heap_insert(alarm);
 
   // If the new alarm has the earliest deadline, we need to re-evaluate our
   // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
+  if (needs_reschedule || is_next_alarm(alarm)) {
     reschedule_root_alarm();
   }
 }
@@ -469,9 +539,9 @@ static void reschedule_root_alarm(void) {
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  if (alarms->empty()) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
+  next = alarms->front();
   next_expiration = next->deadline_ms - now_ms();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
@@ -633,14 +703,13 @@ static void callback_dispatch(UNUSED_ATTR void* context) {
     // Take into account that the alarm may get cancelled before we get to it.
     // We're done here if there are no alarms or the alarm at the front is in
     // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline_ms >
-            now_ms()) {
+    if (alarms->empty() ||
+        (alarm = alarms->front())->deadline_ms > now_ms()) {
       reschedule_root_alarm();
       continue;
     }
 
-    list_remove(alarms, alarm);
+    heap_remove(alarm);
 
     if (alarm->is_periodic) {
       alarm->prev_deadline_ms = alarm->deadline_ms;
@@ -740,12 +809,12 @@ void alarm_debug_dump(int fd) {
 
   uint64_t just_now_ms = now_ms();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "  Total Alarms: %zu\n\n", alarms->size());
 
-  // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
+  // Dump info for each alarm, earliest deadline first
+  std::vector<alarm_t*> sorted_alarms(*alarms);
+  std::sort(sorted_alarms.begin(), sorted_alarms.end(), heap_less);
+  for (alarm_t* alarm : sorted_alarms) {
     alarm_stats_t* stats = &alarm->stats;
 
     dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
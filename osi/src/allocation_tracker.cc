@@ -23,34 +23,112 @@
 #include <base/logging.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
 #include <mutex>
-#include <unordered_map>
 
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/slab_allocator.h"
 
-typedef struct {
+static const size_t canary_size = 8;
+
+// Bookkeeping for a tracked allocation. It lives in front of the memory handed
+// out to the caller, and ends with the leading canary.
+typedef struct allocation_t {
+  // Links in the live allocation list of |shard|
+  struct allocation_t* prev;
+  struct allocation_t* next;
+#if UINTPTR_MAX == UINT32_MAX
+  uint32_t padding[2];
+#endif
+  uint32_t size;
+  uint16_t magic;
   uint8_t allocator_id;
-  void* ptr;
-  size_t size;
-  bool freed;
+  uint8_t shard;
+  char canary[canary_size];
 } allocation_t;
 
-static const size_t canary_size = 8;
+static_assert(sizeof(allocation_t) % 16 == 0,
+              "allocation header must keep the returned memory aligned");
+
+static const uint16_t magic_live = 0xa110;
+static const uint16_t magic_freed = 0xf4ee;
+
+// Allocations are spread over shards by address, so that threads allocating
+// and freeing concurrently rarely contend on the same lock.
+static const size_t num_shards = 64;
+static const uint8_t shard_detached = 0xff;
+
+typedef struct {
+  std::mutex lock;
+  allocation_t* live;
+
+  // Memory allocation statistics
+  size_t alloc_counter;
+  size_t free_counter;
+  size_t alloc_total_size;
+  size_t free_total_size;
+} shard_t;
+
+// Live allocations per allocator id, bucketed by log2 of the requested size.
+static const size_t num_size_buckets = 24;
+
+typedef struct {
+  std::atomic<size_t> live_bytes;
+  std::atomic<size_t> live_count[num_size_buckets];
+} allocator_stats_t;
+
 static char canary[canary_size];
-static std::unordered_map<void*, allocation_t*> allocations;
-static std::mutex tracker_lock;
-static bool enabled = false;
+static shard_t shards[num_shards];
+static allocator_stats_t allocator_stats[256];
+static std::mutex init_lock;
+static std::atomic<bool> enabled(false);
+
+static size_t shard_for_ptr(const void* ptr) {
+  uint64_t hash = (uint64_t)(uintptr_t)ptr >> 4;
+  return (hash * 0x9E3779B97F4A7C15ULL) >> 58;  // Top 6 bits: 64 shards
+}
+
+static size_t size_bucket(size_t size) {
+  size_t bucket = 0;
+  while (size > 1 && bucket < num_size_buckets - 1) {
+    size >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static void account_live(const allocation_t* allocation, bool add) {
+  allocator_stats_t& stats = allocator_stats[allocation->allocator_id];
+  size_t bucket = size_bucket(allocation->size);
+  if (add) {
+    stats.live_bytes.fetch_add(allocation->size, std::memory_order_relaxed);
+    stats.live_count[bucket].fetch_add(1, std::memory_order_relaxed);
+  } else {
+    stats.live_bytes.fetch_sub(allocation->size, std::memory_order_relaxed);
+    stats.live_count[bucket].fetch_sub(1, std::memory_order_relaxed);
+  }
+}
 
-// Memory allocation statistics
-static size_t alloc_counter = 0;
-static size_t free_counter = 0;
-static size_t alloc_total_size = 0;
-static size_t free_total_size = 0;
+// Forgets about all live allocations. They can still be freed afterwards.
+static void detach_all_allocations(void) {
+  for (size_t i = 0; i < num_shards; i++) {
+    std::unique_lock<std::mutex> lock(shards[i].lock);
+    allocation_t* allocation = shards[i].live;
+    while (allocation) {
+      allocation_t* next = allocation->next;
+      account_live(allocation, false);
+      allocation->prev = allocation->next = NULL;
+      allocation->shard = shard_detached;
+      allocation = next;
+    }
+    shards[i].live = NULL;
+  }
+}
 
 void allocation_tracker_init(void) {
-  std::unique_lock<std::mutex> lock(tracker_lock);
+  std::unique_lock<std::mutex> lock(init_lock);
   if (enabled) return;
 
   // randomize the canary contents
@@ -63,34 +141,34 @@ void allocation_tracker_init(void) {
 
 // Test function only. Do not call in the normal course of operations.
 void allocation_tracker_uninit(void) {
-  std::unique_lock<std::mutex> lock(tracker_lock);
+  std::unique_lock<std::mutex> lock(init_lock);
   if (!enabled) return;
 
-  allocations.clear();
+  detach_all_allocations();
   enabled = false;
 }
 
 void allocation_tracker_reset(void) {
-  std::unique_lock<std::mutex> lock(tracker_lock);
+  std::unique_lock<std::mutex> lock(init_lock);
   if (!enabled) return;
 
-  allocations.clear();
+  detach_all_allocations();
 }
 
 size_t allocation_tracker_expect_no_allocations(void) {
-  std::unique_lock<std::mutex> lock(tracker_lock);
   if (!enabled) return 0;
 
   size_t unfreed_memory_size = 0;
 
-  for (const auto& entry : allocations) {
-    allocation_t* allocation = entry.second;
-    if (!allocation->freed) {
+  for (size_t i = 0; i < num_shards; i++) {
+    std::unique_lock<std::mutex> lock(shards[i].lock);
+    for (const allocation_t* allocation = shards[i].live; allocation;
+         allocation = allocation->next) {
       unfreed_memory_size +=
           allocation->size;  // Report back the unfreed byte count
       LOG_ERROR(LOG_TAG,
-                "%s found unfreed allocation. address: 0x%zx size: %zd bytes",
-                __func__, (uintptr_t)allocation->ptr, allocation->size);
+                "%s found unfreed allocation. address: 0x%zx size: %u bytes",
+                __func__, (uintptr_t)(allocation + 1), allocation->size);
     }
   }
 
@@ -99,61 +177,50 @@ size_t allocation_tracker_expect_no_allocations(void) {
 
 void* allocation_tracker_notify_alloc(uint8_t allocator_id, void* ptr,
                                       size_t requested_size) {
-  char* return_ptr;
-  {
-    std::unique_lock<std::mutex> lock(tracker_lock);
-    if (!enabled || !ptr) return ptr;
+  if (!enabled || !ptr) return ptr;
 
-    // Keep statistics
-    alloc_counter++;
-    alloc_total_size += allocation_tracker_resize_for_canary(requested_size);
-
-    return_ptr = ((char*)ptr) + canary_size;
-
-    auto map_entry = allocations.find(return_ptr);
-    allocation_t* allocation;
-    if (map_entry != allocations.end()) {
-      allocation = map_entry->second;
-      CHECK(allocation->freed);  // Must have been freed before
-    } else {
-      allocation = (allocation_t*)calloc(1, sizeof(allocation_t));
-      allocations[return_ptr] = allocation;
-    }
+  allocation_t* allocation = (allocation_t*)ptr;
+  char* return_ptr = (char*)(allocation + 1);
+  size_t shard_index = shard_for_ptr(return_ptr);
+  shard_t& shard = shards[shard_index];
 
-    allocation->allocator_id = allocator_id;
-    allocation->freed = false;
-    allocation->size = requested_size;
-    allocation->ptr = return_ptr;
-  }
+  CHECK(requested_size <= UINT32_MAX);
+  allocation->size = requested_size;
+  allocation->magic = magic_live;
+  allocation->allocator_id = allocator_id;
+  allocation->shard = shard_index;
+  allocation->prev = NULL;
 
   // Add the canary on both sides
-  memcpy(return_ptr - canary_size, canary, canary_size);
+  memcpy(allocation->canary, canary, canary_size);
   memcpy(return_ptr + requested_size, canary, canary_size);
 
+  account_live(allocation, true);
+
+  std::unique_lock<std::mutex> lock(shard.lock);
+
+  // Keep statistics
+  shard.alloc_counter++;
+  shard.alloc_total_size += allocation_tracker_resize_for_canary(requested_size);
+
+  allocation->next = shard.live;
+  if (shard.live) shard.live->prev = allocation;
+  shard.live = allocation;
+
   return return_ptr;
 }
 
 void* allocation_tracker_notify_free(UNUSED_ATTR uint8_t allocator_id,
                                      void* ptr) {
-  std::unique_lock<std::mutex> lock(tracker_lock);
-
   if (!enabled || !ptr) return ptr;
 
-  auto map_entry = allocations.find(ptr);
-  CHECK(map_entry != allocations.end());
-  allocation_t* allocation = map_entry->second;
-  CHECK(allocation);          // Must have been tracked before
-  CHECK(!allocation->freed);  // Must not be a double free
+  allocation_t* allocation = ((allocation_t*)ptr) - 1;
+  CHECK(allocation->magic != magic_freed);  // Must not be a double free
+  CHECK(allocation->magic == magic_live);   // Must have been tracked before
   CHECK(allocation->allocator_id ==
         allocator_id);  // Must be from the same allocator
 
-  // Keep statistics
-  free_counter++;
-  free_total_size += allocation_tracker_resize_for_canary(allocation->size);
-
-  allocation->freed = true;
-
-  UNUSED_ATTR const char* beginning_canary = ((char*)ptr) - canary_size;
+  UNUSED_ATTR const char* beginning_canary = allocation->canary;
   UNUSED_ATTR const char* end_canary = ((char*)ptr) + allocation->size;
 
   for (size_t i = 0; i < canary_size; i++) {
@@ -161,27 +228,71 @@ void* allocation_tracker_notify_free(UNUSED_ATTR uint8_t allocator_id,
     CHECK(end_canary[i] == canary[i]);
   }
 
-  // Free the hash map entry to avoid unlimited memory usage growth.
-  // Double-free of memory is detected with "assert(allocation)" above
-  // as the allocation entry will not be present.
-  allocations.erase(ptr);
-  free(allocation);
+  allocation->magic = magic_freed;
 
-  return ((char*)ptr) - canary_size;
+  // Detached allocations were forgotten by |allocation_tracker_reset| and are
+  // no longer part of any shard's live list or statistics.
+  if (allocation->shard != shard_detached) {
+    CHECK(allocation->shard == shard_for_ptr(ptr));
+    shard_t& shard = shards[allocation->shard];
+    std::unique_lock<std::mutex> lock(shard.lock);
+
+    // Keep statistics
+    shard.free_counter++;
+    shard.free_total_size +=
+        allocation_tracker_resize_for_canary(allocation->size);
+
+    if (allocation->prev)
+      allocation->prev->next = allocation->next;
+    else
+      shard.live = allocation->next;
+    if (allocation->next) allocation->next->prev = allocation->prev;
+
+    account_live(allocation, false);
+  }
+
+  return allocation;
 }
 
 size_t allocation_tracker_resize_for_canary(size_t size) {
-  return (!enabled) ? size : size + (2 * canary_size);
+  return (!enabled) ? size : size + sizeof(allocation_t) + canary_size;
 }
 
 void osi_allocator_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Memory Allocation Statistics:\n");
 
-  std::unique_lock<std::mutex> lock(tracker_lock);
+  size_t alloc_counter = 0;
+  size_t free_counter = 0;
+  size_t alloc_total_size = 0;
+  size_t free_total_size = 0;
+  for (size_t i = 0; i < num_shards; i++) {
+    std::unique_lock<std::mutex> lock(shards[i].lock);
+    alloc_counter += shards[i].alloc_counter;
+    free_counter += shards[i].free_counter;
+    alloc_total_size += shards[i].alloc_total_size;
+    free_total_size += shards[i].free_total_size;
+  }
 
   dprintf(fd, "  Total allocated/free/used counts : %zu / %zu / %zu\n",
           alloc_counter, free_counter, alloc_counter - free_counter);
   dprintf(fd, "  Total allocated/free/used octets : %zu / %zu / %zu\n",
           alloc_total_size, free_total_size,
           alloc_total_size - free_total_size);
+
+  for (size_t id = 0; id < ARRAY_SIZE(allocator_stats); id++) {
+    const allocator_stats_t& stats = allocator_stats[id];
+    size_t live_bytes = stats.live_bytes.load(std::memory_order_relaxed);
+    if (live_bytes == 0) continue;
+
+    dprintf(fd, "  Allocator %zu live octets : %zu\n", id, live_bytes);
+    for (size_t bucket = 0; bucket < num_size_buckets; bucket++) {
+      size_t count = stats.live_count[bucket].load(std::memory_order_relaxed);
+      if (count == 0) continue;
+      dprintf(fd, "    %8zu - %8zu octets : %zu\n",
+              bucket == 0 ? 0 : (size_t)1 << bucket,
+              ((size_t)2 << bucket) - 1, count);
+    }
+  }
+
+  slab_allocator_debug_dump(fd);
 }
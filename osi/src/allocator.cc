@@ -21,6 +21,7 @@
 
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
@@ -69,8 +70,21 @@ void* osi_calloc(size_t size) {
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
 }
 
+void* osi_pool_malloc(size_t size) {
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  void* ptr = slab_allocator_alloc(real_size);
+  if (!ptr) ptr = malloc(real_size);
+  CHECK(ptr);
+  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+}
+
 void osi_free(void* ptr) {
-  free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
+  void* real_ptr = allocation_tracker_notify_free(alloc_allocator_id, ptr);
+  if (slab_allocator_owns(real_ptr)) {
+    slab_allocator_free(real_ptr);
+    return;
+  }
+  free(real_ptr);
 }
 
 void osi_free_and_reset(void** p_ptr) {
@@ -82,3 +96,5 @@ void osi_free_and_reset(void** p_ptr) {
 const allocator_t allocator_calloc = {osi_calloc, osi_free};
 
 const allocator_t allocator_malloc = {osi_malloc, osi_free};
+
+const allocator_t allocator_pool = {osi_pool_malloc, osi_free};
@@ -33,6 +33,8 @@
 #include <sstream>
 #include <type_traits>
 
+#include "osi/include/osi.h"
+
 // Empty definition; this type is aliased to list_node_t.
 struct config_section_iter_t {};
 
@@ -42,9 +44,9 @@ template <typename T,
           class = typename std::enable_if<std::is_same<
               config_t, typename std::remove_const<T>::type>::value>>
 static auto section_find(T& config, const std::string& section) {
-  return std::find_if(
-      config.sections.begin(), config.sections.end(),
-      [&section](const section_t& sec) { return sec.name == section; });
+  auto index = config.section_index.find(section);
+  if (index == config.section_index.end()) return config.sections.end();
+  return decltype(config.sections.end())(index->second);
 }
 
 static const entry_t* entry_find(const config_t& config,
@@ -53,11 +55,42 @@ static const entry_t* entry_find(const config_t& config,
   auto sec = section_find(config, section);
   if (sec == config.sections.end()) return nullptr;
 
-  for (const entry_t& entry : sec->entries) {
-    if (entry.key == key) return &entry;
-  }
+  auto index = sec->entry_index.find(key);
+  if (index == sec->entry_index.end()) return nullptr;
+
+  return &*index->second;
+}
+
+// Journal records are a one letter operation followed by its length prefixed
+// strings, on one line: "s 7:section 3:key 5:value".
+static const char JOURNAL_SET = 's';
+static const char JOURNAL_REMOVE_KEY = 'k';
+static const char JOURNAL_REMOVE_SECTION = 'r';
+
+static void journal_append_string(std::string* journal,
+                                  const std::string& str) {
+  *journal += ' ';
+  *journal += std::to_string(str.size());
+  *journal += ':';
+  *journal += str;
+}
+
+static void journal_record(config_t* config, char op,
+                           const std::string& section,
+                           const std::string* key = nullptr,
+                           const std::string* value = nullptr) {
+  if (!config->journaling) return;
+
+  config->journal += op;
+  journal_append_string(&config->journal, section);
+  if (key) journal_append_string(&config->journal, *key);
+  if (value) journal_append_string(&config->journal, *value);
+  config->journal += '\n';
+}
 
-  return nullptr;
+// Returns true if the changes of |section| are recorded in the journal.
+static bool journal_keeps(const config_t& config, const section_t& section) {
+  return config.journal_filter == nullptr || config.journal_filter(section);
 }
 
 std::unique_ptr<config_t> config_new_empty(void) {
@@ -180,9 +213,11 @@ void config_set_string(config_t* config, const std::string& section,
 
   auto sec = section_find(*config, section);
   if (sec == config->sections.end()) {
-    config->sections.emplace_back(section_t{.name = section});
-    sec = std::prev(config->sections.end());
+    sec = config->sections.emplace(config->sections.end());
+    sec->name = section;
+    config->section_index.emplace(sec->name, sec);
   }
+  bool was_kept = journal_keeps(*config, *sec);
 
   std::string value_no_newline;
   size_t newline_position = value.find('\n');
@@ -193,14 +228,25 @@ void config_set_string(config_t* config, const std::string& section,
     value_no_newline = value;
   }
 
-  for (entry_t& entry : sec->entries) {
-    if (entry.key == key) {
-      entry.value = value_no_newline;
-      return;
-    }
+  auto index = sec->entry_index.find(key);
+  if (index != sec->entry_index.end()) {
+    entry_t& entry = *index->second;
+    if (entry.value == value_no_newline) return;
+    entry.value = value_no_newline;
+  } else {
+    auto entry =
+        sec->entries.emplace(sec->entries.end(),
+                             entry_t{.key = key, .value = value_no_newline});
+    sec->entry_index.emplace(entry->key, entry);
   }
 
-  sec->entries.emplace_back(entry_t{.key = key, .value = value_no_newline});
+  if (was_kept) {
+    journal_record(config, JOURNAL_SET, section, &key, &value_no_newline);
+  } else if (journal_keeps(*config, *sec)) {
+    // The earlier changes of the section were left out of the journal
+    for (const entry_t& entry : sec->entries)
+      journal_record(config, JOURNAL_SET, section, &entry.key, &entry.value);
+  }
 }
 
 bool config_remove_section(config_t* config, const std::string& section) {
@@ -209,6 +255,9 @@ bool config_remove_section(config_t* config, const std::string& section) {
   auto sec = section_find(*config, section);
   if (sec == config->sections.end()) return false;
 
+  if (journal_keeps(*config, *sec))
+    journal_record(config, JOURNAL_REMOVE_SECTION, section);
+  config->section_index.erase(sec->name);
   config->sections.erase(sec);
   return true;
 }
@@ -219,15 +268,15 @@ bool config_remove_key(config_t* config, const std::string& section,
   auto sec = section_find(*config, section);
   if (sec == config->sections.end()) return false;
 
-  for (auto entry = sec->entries.begin(); entry != sec->entries.end();
-       ++entry) {
-    if (entry->key == key) {
-      sec->entries.erase(entry);
-      return true;
-    }
-  }
+  auto index = sec->entry_index.find(key);
+  if (index == sec->entry_index.end()) return false;
 
-  return false;
+  if (journal_keeps(*config, *sec))
+    journal_record(config, JOURNAL_REMOVE_KEY, section, &key);
+  auto entry = index->second;
+  sec->entry_index.erase(index);
+  sec->entries.erase(entry);
+  return true;
 }
 
 bool config_save(const config_t& config, const std::string& filename) {
@@ -446,6 +495,136 @@ error2:
   return false;
 }
 
+void config_journal_start(config_t* config,
+                          config_journal_filter_t journal_filter) {
+  CHECK(config);
+
+  config->journaling = true;
+  config->journal_filter = journal_filter;
+  config->journal.clear();
+}
+
+bool config_journal_save(config_t* config, const std::string& filename) {
+  CHECK(config);
+  CHECK(!filename.empty());
+
+  if (config->journal.empty()) return true;
+
+  int fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+  if (fd < 0) {
+    LOG(ERROR) << __func__ << ": unable to open journal '" << filename
+               << "': " << strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    LOG(ERROR) << __func__ << ": unable to stat journal '" << filename
+               << "': " << strerror(errno);
+    close(fd);
+    return false;
+  }
+
+  const char* data = config->journal.data();
+  size_t remaining = config->journal.size();
+  while (remaining > 0) {
+    ssize_t written;
+    OSI_NO_INTR(written = write(fd, data, remaining));
+    if (written < 0) break;
+    data += written;
+    remaining -= written;
+  }
+
+  // A partial record would hide the ones appended after it.
+  if (remaining > 0 || fsync(fd) < 0) {
+    LOG(ERROR) << __func__ << ": unable to write journal '" << filename
+               << "': " << strerror(errno);
+    if (ftruncate(fd, st.st_size) < 0) {
+      LOG(ERROR) << __func__ << ": unable to truncate journal '" << filename
+                 << "': " << strerror(errno);
+    }
+    close(fd);
+    return false;
+  }
+
+  if (close(fd) < 0) {
+    LOG(ERROR) << __func__ << ": unable to close journal '" << filename
+               << "': " << strerror(errno);
+    return false;
+  }
+
+  config->journal.clear();
+  return true;
+}
+
+// Parses the string starting at |*pos| in |journal|, and moves |*pos| past it.
+static bool journal_parse_string(const std::string& journal, size_t* pos,
+                                 std::string* str) {
+  if (*pos >= journal.size() || journal[*pos] != ' ') return false;
+
+  size_t colon = journal.find(':', *pos + 1);
+  if (colon == std::string::npos || colon == *pos + 1) return false;
+
+  size_t len = 0;
+  for (size_t i = *pos + 1; i < colon; i++) {
+    if (!isdigit(journal[i]) || len > journal.size()) return false;
+    len = len * 10 + (journal[i] - '0');
+  }
+  if (len > journal.size() - colon - 1) return false;
+
+  str->assign(journal, colon + 1, len);
+  *pos = colon + 1 + len;
+  return true;
+}
+
+bool config_journal_replay(config_t* config, const std::string& filename) {
+  CHECK(config);
+  CHECK(!filename.empty());
+
+  std::string journal;
+  if (!base::ReadFileToString(base::FilePath(filename), &journal)) {
+    LOG(ERROR) << __func__ << ": unable to read journal '" << filename << "'";
+    return false;
+  }
+
+  bool journaling = config->journaling;
+  config->journaling = false;
+
+  size_t pos = 0;
+  size_t records = 0;
+  std::string section, key, value;
+  while (pos < journal.size()) {
+    size_t start = pos++;
+    char op = journal[start];
+    bool valid = journal_parse_string(journal, &pos, &section);
+    if (valid && op != JOURNAL_REMOVE_SECTION)
+      valid = journal_parse_string(journal, &pos, &key);
+    if (valid && op == JOURNAL_SET)
+      valid = journal_parse_string(journal, &pos, &value);
+    valid = valid && pos < journal.size() && journal[pos++] == '\n';
+
+    if (!valid || (op != JOURNAL_SET && op != JOURNAL_REMOVE_KEY &&
+                   op != JOURNAL_REMOVE_SECTION)) {
+      LOG(WARNING) << __func__ << ": ignoring journal '" << filename
+                   << "' from offset " << start;
+      break;
+    }
+
+    if (op == JOURNAL_SET)
+      config_set_string(config, section, key, value);
+    else if (op == JOURNAL_REMOVE_KEY)
+      config_remove_key(config, section, key);
+    else
+      config_remove_section(config, section);
+    records++;
+  }
+
+  config->journaling = journaling;
+  VLOG(1) << __func__ << ": replayed " << records << " changes";
+  return true;
+}
+
 static char* trim(char* str) {
   while (isspace(*str)) ++str;
 
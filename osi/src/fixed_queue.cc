@@ -17,8 +17,13 @@
  ******************************************************************************/
 
 #include <base/logging.h>
+#include <poll.h>
+#include <sched.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <mutex>
 
 #include "osi/include/allocator.h"
@@ -28,7 +33,38 @@
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
 
+#if !defined(EFD_SEMAPHORE)
+#define EFD_SEMAPHORE (1 << 0)
+#endif
+
+// A single slot of the lock-free ring. |sequence| tells producers and
+// consumers whose turn it is to touch the slot, so neither side needs a lock
+// and they only contend on their own position counter.
+typedef struct {
+  std::atomic<size_t> sequence;
+  void* data;
+} ring_slot_t;
+
+typedef struct {
+  ring_slot_t* slots;
+  size_t mask;
+
+  alignas(64) std::atomic<size_t> enqueue_pos;
+  alignas(64) std::atomic<size_t> dequeue_pos;
+
+  // Number of published elements not yet consumed. It may transiently drop
+  // below zero when a consumer pops an element before its producer has
+  // accounted for it. Only the 0 -> 1 and 1 -> 0 transitions touch the
+  // doorbell, which keeps the doorbell readable exactly while count > 0.
+  alignas(64) std::atomic<ssize_t> count;
+
+  // EFD_SEMAPHORE eventfd used as the dequeue fd.
+  int doorbell_fd;
+} ring_t;
+
 typedef struct fixed_queue_t {
+  ring_t* ring;  // Non-NULL for queues created by |fixed_queue_new_ring|
+
   list_t* list;
   semaphore_t* enqueue_sem;
   semaphore_t* dequeue_sem;
@@ -42,6 +78,11 @@ typedef struct fixed_queue_t {
 
 static void internal_dequeue_ready(void* context);
 
+static ring_t* ring_new(size_t capacity);
+static void ring_free(ring_t* ring);
+static bool ring_try_push(ring_t* ring, void* data);
+static void* ring_try_pop(ring_t* ring);
+
 fixed_queue_t* fixed_queue_new(size_t capacity) {
   fixed_queue_t* ret =
       static_cast<fixed_queue_t*>(osi_calloc(sizeof(fixed_queue_t)));
@@ -65,11 +106,37 @@ error:
   return NULL;
 }
 
+fixed_queue_t* fixed_queue_new_ring(size_t capacity) {
+  CHECK(capacity > 0);
+  CHECK(capacity <= (SIZE_MAX >> 1) + 1);
+
+  fixed_queue_t* ret =
+      static_cast<fixed_queue_t*>(osi_calloc(sizeof(fixed_queue_t)));
+
+  ret->ring = ring_new(capacity);
+  if (!ret->ring) {
+    osi_free(ret);
+    return NULL;
+  }
+  ret->capacity = ret->ring->mask + 1;
+
+  return ret;
+}
+
 void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
   if (!queue) return;
 
   fixed_queue_unregister_dequeue(queue);
 
+  if (queue->ring) {
+    void* data;
+    while ((data = ring_try_pop(queue->ring)) != NULL)
+      if (free_cb) free_cb(data);
+    ring_free(queue->ring);
+    osi_free(queue);
+    return;
+  }
+
   if (free_cb)
     for (const list_node_t* node = list_begin(queue->list);
          node != list_end(queue->list); node = list_next(node))
@@ -87,7 +154,7 @@ void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 
   while (!fixed_queue_is_empty(queue)) {
     void* data = fixed_queue_try_dequeue(queue);
-    if (free_cb != NULL) {
+    if (free_cb != NULL && data != NULL) {
       free_cb(data);
     }
   }
@@ -96,6 +163,9 @@ void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 bool fixed_queue_is_empty(fixed_queue_t* queue) {
   if (queue == NULL) return true;
 
+  if (queue->ring)
+    return queue->ring->count.load(std::memory_order_acquire) <= 0;
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list);
 }
@@ -103,6 +173,11 @@ bool fixed_queue_is_empty(fixed_queue_t* queue) {
 size_t fixed_queue_length(fixed_queue_t* queue) {
   if (queue == NULL) return 0;
 
+  if (queue->ring) {
+    ssize_t count = queue->ring->count.load(std::memory_order_acquire);
+    return count > 0 ? (size_t)count : 0;
+  }
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_length(queue->list);
 }
@@ -117,6 +192,11 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (queue->ring) {
+    while (!ring_try_push(queue->ring, data)) sched_yield();
+    return;
+  }
+
   semaphore_wait(queue->enqueue_sem);
 
   {
@@ -130,6 +210,27 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_dequeue(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
+  if (queue->ring) {
+    // The doorbell stays readable for as long as the ring is non-empty, so
+    // polling it (rather than reading it) never steals a wakeup from a
+    // reactor registered on the same fd.
+    for (;;) {
+      void* data = ring_try_pop(queue->ring);
+      if (data != NULL) return data;
+      if (queue->ring->count.load(std::memory_order_acquire) > 0) {
+        // An element is being published at the head; it will show up soon.
+        sched_yield();
+        continue;
+      }
+      struct pollfd pfd;
+      pfd.fd = queue->ring->doorbell_fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      int ret;
+      OSI_NO_INTR(ret = poll(&pfd, 1, -1));
+    }
+  }
+
   semaphore_wait(queue->dequeue_sem);
 
   void* ret = NULL;
@@ -148,6 +249,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (queue->ring) return ring_try_push(queue->ring, data);
+
   if (!semaphore_try_wait(queue->enqueue_sem)) return false;
 
   {
@@ -162,6 +265,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) return ring_try_pop(queue->ring);
+
   if (!semaphore_try_wait(queue->dequeue_sem)) return NULL;
 
   void* ret = NULL;
@@ -179,6 +284,14 @@ void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) {
+    ring_t* ring = queue->ring;
+    size_t pos = ring->dequeue_pos.load(std::memory_order_acquire);
+    ring_slot_t* slot = &ring->slots[pos & ring->mask];
+    if (slot->sequence.load(std::memory_order_acquire) != pos + 1) return NULL;
+    return slot->data;
+  }
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_front(queue->list);
 }
@@ -186,6 +299,15 @@ void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) {
+    ring_t* ring = queue->ring;
+    size_t end = ring->enqueue_pos.load(std::memory_order_acquire);
+    if (end == ring->dequeue_pos.load(std::memory_order_acquire)) return NULL;
+    ring_slot_t* slot = &ring->slots[(end - 1) & ring->mask];
+    if (slot->sequence.load(std::memory_order_acquire) != end) return NULL;
+    return slot->data;
+  }
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_back(queue->list);
 }
@@ -193,6 +315,9 @@ void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
   if (queue == NULL) return NULL;
 
+  // Removing from the middle of the ring is not supported.
+  CHECK(queue->ring == NULL);
+
   bool removed = false;
   {
     std::lock_guard<std::mutex> lock(*queue->mutex);
@@ -212,6 +337,7 @@ void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
 
 list_t* fixed_queue_get_list(fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(queue->ring == NULL);
 
   // NOTE: Using the list in this way is not thread-safe.
   // Using this list in any context where threads can call other functions
@@ -221,11 +347,13 @@ list_t* fixed_queue_get_list(fixed_queue_t* queue) {
 
 int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  if (queue->ring) return queue->ring->doorbell_fd;
   return semaphore_get_fd(queue->dequeue_sem);
 }
 
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(queue->ring == NULL);
   return semaphore_get_fd(queue->enqueue_sem);
 }
 
@@ -260,3 +388,93 @@ static void internal_dequeue_ready(void* context) {
   fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
   queue->dequeue_ready(queue, queue->dequeue_context);
 }
+
+static ring_t* ring_new(size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+
+  ring_t* ring = new ring_t;
+  ring->doorbell_fd = eventfd(0, EFD_SEMAPHORE);
+  if (ring->doorbell_fd == INVALID_FD) {
+    delete ring;
+    return NULL;
+  }
+
+  ring->slots = new ring_slot_t[size];
+  for (size_t i = 0; i < size; i++) {
+    ring->slots[i].sequence.store(i, std::memory_order_relaxed);
+    ring->slots[i].data = NULL;
+  }
+  ring->mask = size - 1;
+  ring->enqueue_pos.store(0, std::memory_order_relaxed);
+  ring->dequeue_pos.store(0, std::memory_order_relaxed);
+  ring->count.store(0, std::memory_order_relaxed);
+
+  return ring;
+}
+
+static void ring_free(ring_t* ring) {
+  if (!ring) return;
+
+  close(ring->doorbell_fd);
+  delete[] ring->slots;
+  delete ring;
+}
+
+static bool ring_try_push(ring_t* ring, void* data) {
+  ring_slot_t* slot;
+  size_t pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot = &ring->slots[pos & ring->mask];
+    size_t seq = slot->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (ring->enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false;  // Full
+    } else {
+      pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->data = data;
+  slot->sequence.store(pos + 1, std::memory_order_release);
+
+  if (ring->count.fetch_add(1, std::memory_order_acq_rel) == 0)
+    eventfd_write(ring->doorbell_fd, 1);
+
+  return true;
+}
+
+static void* ring_try_pop(ring_t* ring) {
+  ring_slot_t* slot;
+  size_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot = &ring->slots[pos & ring->mask];
+    size_t seq = slot->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+    if (diff == 0) {
+      if (ring->dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return NULL;  // Empty, or the head element is still being published
+    } else {
+      pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  void* data = slot->data;
+  slot->sequence.store(pos + ring->mask + 1, std::memory_order_release);
+
+  // If the producer that took the doorbell from 0 to 1 has not written it
+  // yet, this read blocks until it does.
+  if (ring->count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    eventfd_t value;
+    eventfd_read(ring->doorbell_fd, &value);
+  }
+
+  return data;
+}
@@ -0,0 +1,291 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_slab_allocator"
+
+#include "osi/include/slab_allocator.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+namespace {
+
+typedef struct {
+  size_t block_size;
+  size_t num_blocks;
+  const char* description;
+} size_class_t;
+
+// Block sizes include room for the BT_HDR header and for the allocation
+// tracker header and canaries (40 octets) when tracking is enabled.
+const size_class_t size_classes[] = {
+    {96, 1024, "HCI events, small ATT PDUs"},
+    {320, 1024, "LE ACL (251 octet data length)"},
+    {720, 512, "BT_SMALL_BUFFER_SIZE, SBC media packets"},
+    {1088, 512, "BR/EDR ACL (HCI_ACL_MAX_SIZE)"},
+    {2048, 256, "L2CAP_MTU_SIZE PDUs, FCR clones"},
+    {4160, 128, "BT_DEFAULT_BUFFER_SIZE"},
+};
+const size_t num_size_classes = ARRAY_SIZE(size_classes);
+
+// Maximum number of free blocks a thread holds on to per size class. When a
+// cache runs empty or full, half of it is moved from/to the shared pool.
+const size_t thread_cache_size = 32;
+const size_t thread_cache_batch = thread_cache_size / 2;
+
+typedef struct free_block_t {
+  struct free_block_t* next;
+} free_block_t;
+
+typedef struct {
+  uint8_t* begin;
+  uint8_t* end;
+
+  // Shared pool of blocks returned by thread caches, plus the high-water
+  // mark of blocks handed out so far. Blocks beyond |carved| have never
+  // been touched, so their pages are not backed by memory yet.
+  std::mutex mutex;
+  free_block_t* free_list;
+  size_t carved;
+
+  std::atomic<size_t> hits;
+  std::atomic<size_t> misses;
+  std::atomic<size_t> in_use;
+  std::atomic<size_t> high_watermark;
+} pool_t;
+
+pool_t pools[num_size_classes];
+std::atomic<uintptr_t> arena_begin(0);
+std::atomic<uintptr_t> arena_end(0);
+std::atomic<size_t> oversize_misses(0);
+std::once_flag arena_once;
+
+// Trivially destructible, so that it can still be read while the thread
+// exits, e.g. by buffers freed from the destructors of other thread_local
+// objects: once |destroyed| is set they go straight to the shared pools.
+struct ThreadCache {
+  free_block_t* blocks[num_size_classes][thread_cache_size];
+  size_t count[num_size_classes];
+  bool guarded;
+  bool destroyed;
+};
+
+thread_local ThreadCache thread_cache;
+static_assert(std::is_trivially_destructible<ThreadCache>::value,
+              "the thread cache must outlive the thread's destructors");
+
+// Returns the blocks of the thread cache to the shared pools when the thread
+// exits. Constructed the first time the thread uses its cache.
+struct ThreadCacheGuard {
+  void Arm() {}
+  ~ThreadCacheGuard();
+};
+
+thread_local ThreadCacheGuard thread_cache_guard;
+
+void arena_init() {
+  size_t total = 0;
+  for (size_t i = 0; i < num_size_classes; i++)
+    total += size_classes[i].block_size * size_classes[i].num_blocks;
+
+  void* arena = mmap(NULL, total, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (arena == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s unable to reserve %zu octets: %s", __func__, total,
+              strerror(errno));
+    return;
+  }
+
+  uint8_t* next = static_cast<uint8_t*>(arena);
+  for (size_t i = 0; i < num_size_classes; i++) {
+    pools[i].begin = next;
+    next += size_classes[i].block_size * size_classes[i].num_blocks;
+    pools[i].end = next;
+  }
+
+  arena_end.store(reinterpret_cast<uintptr_t>(next), std::memory_order_release);
+  arena_begin.store(reinterpret_cast<uintptr_t>(arena),
+                    std::memory_order_release);
+}
+
+size_t size_class_for_size(size_t size) {
+  for (size_t i = 0; i < num_size_classes; i++)
+    if (size <= size_classes[i].block_size) return i;
+  return num_size_classes;
+}
+
+size_t size_class_for_ptr(const void* ptr) {
+  const uint8_t* address = static_cast<const uint8_t*>(ptr);
+  for (size_t i = 0; i < num_size_classes; i++)
+    if (address < pools[i].end) return i;
+  CHECK(false) << __func__ << ": pointer outside of arena";
+  return num_size_classes;
+}
+
+// Moves up to |max| blocks from the shared pool of |index| into |out|.
+size_t pool_take(size_t index, free_block_t** out, size_t max) {
+  pool_t& pool = pools[index];
+  const size_class_t& size_class = size_classes[index];
+  size_t taken = 0;
+
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  while (taken < max && pool.free_list != NULL) {
+    out[taken++] = pool.free_list;
+    pool.free_list = pool.free_list->next;
+  }
+  while (taken < max && pool.carved < size_class.num_blocks) {
+    out[taken++] = reinterpret_cast<free_block_t*>(
+        pool.begin + pool.carved * size_class.block_size);
+    pool.carved++;
+  }
+  return taken;
+}
+
+// Returns |count| blocks from |blocks| to the shared pool of |index|.
+void pool_give(size_t index, free_block_t** blocks, size_t count) {
+  pool_t& pool = pools[index];
+
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  for (size_t i = 0; i < count; i++) {
+    blocks[i]->next = pool.free_list;
+    pool.free_list = blocks[i];
+  }
+}
+
+ThreadCacheGuard::~ThreadCacheGuard() {
+  ThreadCache& cache = thread_cache;
+  for (size_t i = 0; i < num_size_classes; i++) {
+    pool_give(i, cache.blocks[i], cache.count[i]);
+    cache.count[i] = 0;
+  }
+  cache.destroyed = true;
+}
+
+// Returns the cache of the calling thread, or NULL once the thread exits.
+ThreadCache* get_thread_cache() {
+  ThreadCache* cache = &thread_cache;
+  if (cache->destroyed) return NULL;
+  if (!cache->guarded) {
+    cache->guarded = true;
+    thread_cache_guard.Arm();
+  }
+  return cache;
+}
+
+void update_high_watermark(pool_t& pool) {
+  size_t in_use = pool.in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+  size_t high = pool.high_watermark.load(std::memory_order_relaxed);
+  while (in_use > high && !pool.high_watermark.compare_exchange_weak(
+                              high, in_use, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+void* slab_allocator_alloc(size_t size) {
+  size_t index = size_class_for_size(size);
+  if (index == num_size_classes) {
+    oversize_misses.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+  }
+
+  std::call_once(arena_once, arena_init);
+  if (arena_begin.load(std::memory_order_acquire) == 0) return NULL;
+
+  pool_t& pool = pools[index];
+  free_block_t* block = NULL;
+  ThreadCache* cache = get_thread_cache();
+  if (cache == NULL) {
+    pool_take(index, &block, 1);
+  } else {
+    if (cache->count[index] == 0)
+      cache->count[index] =
+          pool_take(index, cache->blocks[index], thread_cache_batch);
+    if (cache->count[index] > 0)
+      block = cache->blocks[index][--cache->count[index]];
+  }
+
+  if (block == NULL) {
+    pool.misses.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+  }
+
+  pool.hits.fetch_add(1, std::memory_order_relaxed);
+  update_high_watermark(pool);
+  return block;
+}
+
+bool slab_allocator_owns(const void* ptr) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  return address >= arena_begin.load(std::memory_order_relaxed) &&
+         address < arena_end.load(std::memory_order_relaxed);
+}
+
+void slab_allocator_free(void* ptr) {
+  CHECK(slab_allocator_owns(ptr));
+
+  size_t index = size_class_for_ptr(ptr);
+  pool_t& pool = pools[index];
+  free_block_t* block = static_cast<free_block_t*>(ptr);
+  CHECK((static_cast<uint8_t*>(ptr) - pool.begin) %
+            size_classes[index].block_size ==
+        0);
+
+  pool.in_use.fetch_sub(1, std::memory_order_relaxed);
+
+  ThreadCache* cache = get_thread_cache();
+  if (cache == NULL) {
+    pool_give(index, &block, 1);
+    return;
+  }
+
+  if (cache->count[index] == thread_cache_size) {
+    cache->count[index] -= thread_cache_batch;
+    pool_give(index, &cache->blocks[index][cache->count[index]],
+              thread_cache_batch);
+  }
+  cache->blocks[index][cache->count[index]++] = block;
+}
+
+void slab_allocator_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Buffer Pool Statistics:\n");
+  dprintf(fd, "  Allocations too large for any size class : %zu\n",
+          oversize_misses.load(std::memory_order_relaxed));
+  dprintf(fd, "  %-6s %-6s %-10s %-10s %-8s %-10s  %s\n", "Size", "Blocks",
+          "Hits", "Misses", "In use", "High mark", "Used for");
+  for (size_t i = 0; i < num_size_classes; i++) {
+    const pool_t& pool = pools[i];
+    dprintf(fd, "  %-6zu %-6zu %-10zu %-10zu %-8zu %-10zu  %s\n",
+            size_classes[i].block_size, size_classes[i].num_blocks,
+            pool.hits.load(std::memory_order_relaxed),
+            pool.misses.load(std::memory_order_relaxed),
+            pool.in_use.load(std::memory_order_relaxed),
+            pool.high_watermark.load(std::memory_order_relaxed),
+            size_classes[i].description);
+  }
+}
@@ -17,8 +17,14 @@
  ******************************************************************************/
 
 #include <gtest/gtest.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
 
 #include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
 
 void allocation_tracker_uninit(void);
 
@@ -62,3 +68,88 @@ TEST(AllocationTrackerTest, test_canaries_on) {
 
   free(dummy_allocation);
 }
+
+TEST(AllocationTrackerTest, test_reset_forgets_allocations) {
+  allocation_tracker_uninit();
+  allocation_tracker_init();
+
+  void* dummy_allocation = malloc(allocation_tracker_resize_for_canary(4));
+  void* useable_ptr =
+      allocation_tracker_notify_alloc(allocator_id, dummy_allocation, 4);
+  EXPECT_EQ(4U, allocation_tracker_expect_no_allocations());
+
+  // Allocations made before the reset can still be freed
+  allocation_tracker_reset();
+  EXPECT_EQ(0U, allocation_tracker_expect_no_allocations());
+  EXPECT_EQ(dummy_allocation,
+            allocation_tracker_notify_free(allocator_id, useable_ptr));
+
+  free(dummy_allocation);
+}
+
+TEST(AllocationTrackerDeathTest, test_double_free) {
+  allocation_tracker_uninit();
+  allocation_tracker_init();
+
+  void* dummy_allocation = malloc(allocation_tracker_resize_for_canary(4));
+  void* useable_ptr =
+      allocation_tracker_notify_alloc(allocator_id, dummy_allocation, 4);
+  allocation_tracker_notify_free(allocator_id, useable_ptr);
+  EXPECT_DEATH(allocation_tracker_notify_free(allocator_id, useable_ptr), "");
+
+  free(dummy_allocation);
+}
+
+TEST(AllocationTrackerDeathTest, test_canary_overwritten) {
+  allocation_tracker_uninit();
+  allocation_tracker_init();
+
+  void* dummy_allocation = malloc(allocation_tracker_resize_for_canary(4));
+  char* useable_ptr = static_cast<char*>(
+      allocation_tracker_notify_alloc(allocator_id, dummy_allocation, 4));
+  useable_ptr[4] = ~useable_ptr[4];
+  EXPECT_DEATH(allocation_tracker_notify_free(allocator_id, useable_ptr), "");
+
+  useable_ptr[4] = ~useable_ptr[4];
+  allocation_tracker_notify_free(allocator_id, useable_ptr);
+  free(dummy_allocation);
+}
+
+TEST(AllocationTrackerTest, test_concurrent_allocations) {
+  allocation_tracker_uninit();
+  allocation_tracker_init();
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([]() {
+      std::vector<void*> ptrs;
+      for (size_t i = 0; i < 1000; i++) ptrs.push_back(osi_malloc(i + 1));
+      for (void* ptr : ptrs) osi_free(ptr);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(0U, allocation_tracker_expect_no_allocations());
+}
+
+TEST(AllocationTrackerTest, test_debug_dump_live_bytes) {
+  allocation_tracker_uninit();
+  allocation_tracker_init();
+
+  void* dummy_allocation = malloc(allocation_tracker_resize_for_canary(100));
+  void* useable_ptr =
+      allocation_tracker_notify_alloc(allocator_id, dummy_allocation, 100);
+
+  FILE* file = tmpfile();
+  ASSERT_TRUE(file != NULL);
+  osi_allocator_debug_dump(fileno(file));
+  char buffer[4096] = {};
+  rewind(file);
+  fread(buffer, 1, sizeof(buffer) - 1, file);
+  fclose(file);
+  EXPECT_NE(nullptr, strstr(buffer, "Allocator 5 live octets : 100"));
+  EXPECT_NE(nullptr, strstr(buffer, "64 -      127 octets : 1"));
+
+  allocation_tracker_notify_free(allocator_id, useable_ptr);
+  free(dummy_allocation);
+}
@@ -16,12 +16,16 @@
  *
  ******************************************************************************/
 #include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "AllocationTestHarness.h"
 
 #include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
 
 class AllocatorTest : public AllocationTestHarness {};
 
@@ -50,3 +54,73 @@ TEST_F(AllocatorTest, test_osi_strndup) {
   EXPECT_EQ(0, strcmp(str, copy_str));
   osi_free(copy_str);
 }
+
+TEST_F(AllocatorTest, test_osi_pool_malloc) {
+  // Typical BT_HDR buffer sizes are served from the pool
+  std::set<void*> buffers;
+  for (size_t size : {8, 64, 280, 660, 1032, 1700, 4112}) {
+    uint8_t* ptr = static_cast<uint8_t*>(osi_pool_malloc(size));
+    ASSERT_TRUE(ptr != NULL);
+    memset(ptr, 0xa5, size);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % sizeof(void*));
+    EXPECT_TRUE(buffers.insert(ptr).second);
+  }
+  for (void* ptr : buffers) osi_free(ptr);
+
+  // Allocations larger than every size class fall back to malloc
+  void* large = osi_pool_malloc(64 * 1024);
+  ASSERT_TRUE(large != NULL);
+  EXPECT_FALSE(slab_allocator_owns(large));
+  osi_free(large);
+
+  // Freed blocks are reused
+  void* first = osi_pool_malloc(100);
+  osi_free(first);
+  void* second = osi_pool_malloc(100);
+  EXPECT_EQ(first, second);
+  osi_free(second);
+}
+
+TEST_F(AllocatorTest, test_osi_pool_malloc_cross_thread_free) {
+  static const size_t kBuffers = 4096;
+  std::vector<void*> buffers;
+  for (size_t i = 0; i < kBuffers; i++) {
+    void* ptr = osi_pool_malloc(i % 2 ? 270 : 1030);
+    ASSERT_TRUE(ptr != NULL);
+    buffers.push_back(ptr);
+  }
+
+  // Buffers are regularly allocated on one thread and freed on another
+  std::thread freeing_thread([&buffers]() {
+    for (void* ptr : buffers) osi_free(ptr);
+  });
+  freeing_thread.join();
+
+  for (size_t i = 0; i < kBuffers; i++) buffers[i] = osi_pool_malloc(270);
+  for (void* ptr : buffers) osi_free(ptr);
+}
+
+// Frees, and allocates again, pool buffers from its destructor, after the
+// thread cache was flushed if it is destroyed last.
+struct ThreadExitFree {
+  void* ptr = NULL;
+  ~ThreadExitFree() {
+    osi_free(ptr);
+    osi_free(osi_pool_malloc(100));
+  }
+};
+
+TEST_F(AllocatorTest, test_osi_pool_free_at_thread_exit) {
+  std::thread exiting_thread([]() {
+    // Constructed before the thread cache is used, so destroyed after it
+    static thread_local ThreadExitFree exit_free;
+    ThreadExitFree* holder = &exit_free;
+    holder->ptr = osi_pool_malloc(100);
+    ASSERT_TRUE(holder->ptr != NULL);
+  });
+  exiting_thread.join();
+
+  void* ptr = osi_pool_malloc(100);
+  EXPECT_TRUE(slab_allocator_owns(ptr));
+  osi_free(ptr);
+}
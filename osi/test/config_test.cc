@@ -1,11 +1,15 @@
 #include <base/files/file_util.h>
 #include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <vector>
 
 #include "AllocationTestHarness.h"
 
 #include "osi/include/config.h"
 
 static const char CONFIG_FILE[] = "/data/local/tmp/config_test.conf";
+static const char CONFIG_JOURNAL[] = "/data/local/tmp/config_test.journal";
 static const char CONFIG_FILE_CONTENT[] =
     "                                                                                    \n\
 first_key=value                                                                      \n\
@@ -57,6 +61,7 @@ class ConfigTest : public AllocationTestHarness {
     FILE* fp = fopen(CONFIG_FILE, "wt");
     fwrite(CONFIG_FILE_CONTENT, 1, sizeof(CONFIG_FILE_CONTENT), fp);
     fclose(fp);
+    unlink(CONFIG_JOURNAL);
   }
 };
 
@@ -195,3 +200,100 @@ TEST_F(ConfigTest, checksum_save) {
 
   EXPECT_TRUE(base::PathExists(file_path));
 }
+
+TEST_F(ConfigTest, config_sections_keep_their_order) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  config_set_string(config.get(), "New", "key", "value");
+  EXPECT_TRUE(config_remove_section(config.get(), "DID"));
+  config_set_string(config.get(), "DID", "productId", "0x1200");
+
+  std::vector<std::string> names;
+  for (const section_t& section : config->sections)
+    names.push_back(section.name);
+  EXPECT_EQ(names, std::vector<std::string>({"Global", "New", "DID"}));
+  EXPECT_EQ(config_get_int(*config, "DID", "productId", 999), 0x1200);
+  EXPECT_FALSE(config_has_key(*config, "DID", "version"));
+}
+
+TEST_F(ConfigTest, config_journal_replay) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  config_journal_start(config.get());
+  config_set_string(config.get(), "DID", "version", "0x2000");
+  config_set_string(config.get(), "New", "key", "a = b");
+  config_set_string(config.get(), "New", "empty", "");
+  EXPECT_TRUE(config_remove_key(config.get(), "DID", "productId"));
+  EXPECT_TRUE(config_remove_section(config.get(), CONFIG_DEFAULT_SECTION));
+  EXPECT_TRUE(config_journal_save(config.get(), CONFIG_JOURNAL));
+  EXPECT_TRUE(config->journal.empty());
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_journal_replay(loaded.get(), CONFIG_JOURNAL));
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x2000);
+  EXPECT_EQ(*config_get_string(*loaded, "New", "key", NULL), "a = b");
+  EXPECT_TRUE(config_has_key(*loaded, "New", "empty"));
+  EXPECT_FALSE(config_has_key(*loaded, "DID", "productId"));
+  EXPECT_FALSE(config_has_section(*loaded, CONFIG_DEFAULT_SECTION));
+  EXPECT_TRUE(loaded->journal.empty());
+}
+
+TEST_F(ConfigTest, config_journal_truncated) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  config_journal_start(config.get());
+  config_set_string(config.get(), "DID", "version", "0x2000");
+  EXPECT_TRUE(config_journal_save(config.get(), CONFIG_JOURNAL));
+  config_set_string(config.get(), "DID", "productId", "0x3000");
+  EXPECT_TRUE(config_journal_save(config.get(), CONFIG_JOURNAL));
+
+  // Interrupted while appending the second change
+  std::string journal;
+  EXPECT_TRUE(base::ReadFileToString(base::FilePath(CONFIG_JOURNAL), &journal));
+  EXPECT_TRUE(truncate(CONFIG_JOURNAL, journal.size() - 2) == 0);
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_journal_replay(loaded.get(), CONFIG_JOURNAL));
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x2000);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "productId", 0), 0x1200);
+}
+
+TEST_F(ConfigTest, config_journal_not_started) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  config_set_string(config.get(), "DID", "version", "0x2000");
+  EXPECT_TRUE(config_journal_save(config.get(), CONFIG_JOURNAL));
+  EXPECT_FALSE(base::PathExists(base::FilePath(CONFIG_JOURNAL)));
+  EXPECT_FALSE(config_journal_replay(config.get(), CONFIG_JOURNAL));
+}
+
+static bool journal_keeps_paired(const section_t& section) {
+  return section.name != "Device" || section.entry_index.count("LinkKey");
+}
+
+TEST_F(ConfigTest, config_journal_filter) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  config_journal_start(config.get(), journal_keeps_paired);
+
+  // Not journaled until the section passes the filter
+  config_set_string(config.get(), "Device", "Name", "Headset");
+  EXPECT_TRUE(config->journal.empty());
+  EXPECT_TRUE(config_remove_key(config.get(), "Device", "Name"));
+  config_set_string(config.get(), "Device", "Name", "Speaker");
+  EXPECT_TRUE(config->journal.empty());
+  config_set_string(config.get(), "Device", "LinkKey", "0123");
+  config_set_string(config.get(), "DID", "version", "0x2000");
+  EXPECT_TRUE(config_journal_save(config.get(), CONFIG_JOURNAL));
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_journal_replay(loaded.get(), CONFIG_JOURNAL));
+  EXPECT_EQ(*config_get_string(*loaded, "Device", "Name", NULL), "Speaker");
+  EXPECT_EQ(*config_get_string(*loaded, "Device", "LinkKey", NULL), "0123");
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x2000);
+
+  // Unpairing is journaled, the changes after it are not
+  EXPECT_TRUE(config_remove_key(config.get(), "Device", "LinkKey"));
+  config_set_string(config.get(), "Device", "Name", "Car");
+  EXPECT_TRUE(config_journal_save(config.get(), CONFIG_JOURNAL));
+
+  loaded = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_journal_replay(loaded.get(), CONFIG_JOURNAL));
+  EXPECT_FALSE(config_has_key(*loaded, "Device", "LinkKey"));
+  EXPECT_EQ(*config_get_string(*loaded, "Device", "Name", NULL), "Speaker");
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
 #include <climits>
+#include <thread>
+#include <vector>
 
 #include "AllocationTestHarness.h"
 
@@ -348,3 +350,136 @@ TEST_F(FixedQueueTest, test_fixed_queue_register_dequeue) {
   thread_free(worker_thread);
   fixed_queue_free(queue, NULL);
 }
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_new_free) {
+  fixed_queue_t* queue = fixed_queue_new_ring(1);
+  EXPECT_TRUE(queue != NULL);
+  EXPECT_EQ((size_t)1, fixed_queue_capacity(queue));
+  fixed_queue_free(queue, NULL);
+
+  // Capacity is rounded up to the next power of two
+  queue = fixed_queue_new_ring(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+  EXPECT_EQ((size_t)16, fixed_queue_capacity(queue));
+
+  // Remaining elements are handed to the free callback
+  test_queue_entry_free_counter = 0;
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_free(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(2, test_queue_entry_free_counter);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_enqueue_dequeue) {
+  fixed_queue_t* queue = fixed_queue_new_ring(4);
+  ASSERT_TRUE(queue != NULL);
+
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+  EXPECT_EQ(NULL, fixed_queue_try_dequeue(queue));
+  EXPECT_EQ(NULL, fixed_queue_try_peek_first(queue));
+  EXPECT_EQ(NULL, fixed_queue_try_peek_last(queue));
+
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_dequeue(queue));
+
+  // Wrap around the ring a few times, checking FIFO order and fullness
+  for (int round = 0; round < 3; round++) {
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING1));
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING2));
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING3));
+    EXPECT_FALSE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+    EXPECT_EQ((size_t)4, fixed_queue_length(queue));
+    EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_try_peek_first(queue));
+    EXPECT_EQ(DUMMY_DATA_STRING3, fixed_queue_try_peek_last(queue));
+
+    EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_try_dequeue(queue));
+    EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_try_dequeue(queue));
+    EXPECT_EQ(DUMMY_DATA_STRING2, fixed_queue_dequeue(queue));
+    EXPECT_EQ(DUMMY_DATA_STRING3, fixed_queue_dequeue(queue));
+    EXPECT_TRUE(fixed_queue_is_empty(queue));
+  }
+
+  fixed_queue_free(queue, NULL);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_doorbell) {
+  fixed_queue_t* queue = fixed_queue_new_ring(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  int dequeue_fd = fixed_queue_get_dequeue_fd(queue);
+  EXPECT_TRUE(dequeue_fd >= 0);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  // The doorbell stays readable until the last element is consumed
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+  fixed_queue_dequeue(queue);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+  fixed_queue_dequeue(queue);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  fixed_queue_flush(queue, NULL);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3);
+  fixed_queue_flush(queue, NULL);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  fixed_queue_free(queue, NULL);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_register_dequeue) {
+  fixed_queue_t* queue = fixed_queue_new_ring(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  received_message_future = future_new();
+  ASSERT_TRUE(received_message_future != NULL);
+
+  thread_t* worker_thread = thread_new("test_fixed_queue_worker_thread");
+  ASSERT_TRUE(worker_thread != NULL);
+
+  fixed_queue_register_dequeue(queue, thread_get_reactor(worker_thread),
+                               fixed_queue_ready, NULL);
+
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING);
+  const char* msg = (const char*)future_await(received_message_future);
+  EXPECT_EQ(DUMMY_DATA_STRING, msg);
+
+  fixed_queue_unregister_dequeue(queue);
+  thread_free(worker_thread);
+  fixed_queue_free(queue, NULL);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_multiple_producers) {
+  static const size_t kProducers = 4;
+  static const size_t kMessagesPerProducer = 10000;
+
+  fixed_queue_t* queue = fixed_queue_new_ring(64);
+  ASSERT_TRUE(queue != NULL);
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < kProducers; p++) {
+    producers.emplace_back([queue, p]() {
+      for (size_t i = 0; i < kMessagesPerProducer; i++) {
+        fixed_queue_enqueue(queue, UINT_TO_PTR((p << 24) | (i + 1)));
+      }
+    });
+  }
+
+  // Elements from each producer must arrive in the order they were sent
+  std::vector<size_t> last_seen(kProducers, 0);
+  for (size_t n = 0; n < kProducers * kMessagesPerProducer; n++) {
+    unsigned int value = PTR_TO_UINT(fixed_queue_dequeue(queue));
+    size_t p = value >> 24;
+    size_t i = value & 0xffffff;
+    ASSERT_LT(p, kProducers);
+    EXPECT_EQ(last_seen[p] + 1, i);
+    last_seen[p] = i;
+  }
+
+  for (auto& producer : producers) producer.join();
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+  EXPECT_FALSE(is_fd_readable(fixed_queue_get_dequeue_fd(queue)));
+
+  fixed_queue_free(queue, NULL);
+}
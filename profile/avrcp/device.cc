@@ -800,12 +800,22 @@ void Device::HandleGetFolderItems(uint8_t label,
           base::Bind(&Device::GetMediaPlayerListResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
-    case Scope::VFS:
-      media_interface_->GetFolderItems(
-          curr_browsed_player_id_, CurrentFolder(),
+    case Scope::VFS: {
+      // A page holds at most one window of items, the items past it can be
+      // requested by the next page.
+      uint32_t start_item = pkt->GetStartItem();
+      uint32_t end_item = std::max(start_item, pkt->GetEndItem());
+      if (end_item - start_item >= FolderItemsCache::kWindowSize) {
+        end_item = start_item + FolderItemsCache::kWindowSize - 1;
+      }
+
+      uint16_t player_id = curr_browsed_player_id_;
+      FetchFolderItems(
+          player_id, CurrentFolder(), start_item, end_item,
           base::Bind(&Device::GetVFSListResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
-      break;
+                     weak_ptr_factory_.GetWeakPtr(), label, pkt, player_id,
+                     CurrentFolder(), end_item));
+    } break;
     case Scope::NOW_PLAYING:
       media_interface_->GetNowPlayingList(
           base::Bind(&Device::GetNowPlayingListResponse,
@@ -837,12 +847,13 @@ void Device::HandleGetTotalNumberOfItems(
                      weak_ptr_factory_.GetWeakPtr(), label));
       break;
     }
-    case Scope::VFS:
-      media_interface_->GetFolderItems(
-          curr_browsed_player_id_, CurrentFolder(),
-          base::Bind(&Device::GetTotalNumberOfItemsVFSResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label));
-      break;
+    case Scope::VFS: {
+      uint16_t player_id = curr_browsed_player_id_;
+      FetchFolderItems(player_id, CurrentFolder(), 0, 0,
+                       base::Bind(&Device::GetTotalNumberOfItemsVFSResponse,
+                                  weak_ptr_factory_.GetWeakPtr(), label,
+                                  player_id, CurrentFolder()));
+    } break;
     case Scope::NOW_PLAYING:
       media_interface_->GetNowPlayingList(
           base::Bind(&Device::GetTotalNumberOfItemsNowPlayingResponse,
@@ -864,11 +875,13 @@ void Device::GetTotalNumberOfItemsMediaPlayersResponse(
 }
 
 void Device::GetTotalNumberOfItemsVFSResponse(uint8_t label,
-                                              std::vector<ListItem> list) {
-  DEVICE_VLOG(2) << __func__ << ": num_items=" << list.size();
+                                              uint16_t player_id,
+                                              std::string folder_id) {
+  uint32_t num_items = vfs_items_.get_num_items(player_id, folder_id);
+  DEVICE_VLOG(2) << __func__ << ": num_items=" << num_items;
 
   auto builder = GetTotalNumberOfItemsResponseBuilder::MakeBuilder(
-      Status::NO_ERROR, 0x0000, list.size());
+      Status::NO_ERROR, 0x0000, num_items);
   send_message(label, true, std::move(builder));
 }
 
@@ -922,19 +935,20 @@ void Device::HandleChangePath(uint8_t label,
                    << "\"";
   }
 
-  media_interface_->GetFolderItems(
-      curr_browsed_player_id_, CurrentFolder(),
+  uint16_t player_id = curr_browsed_player_id_;
+  FetchFolderItems(
+      player_id, CurrentFolder(), 0, 0,
       base::Bind(&Device::ChangePathResponse, weak_ptr_factory_.GetWeakPtr(),
-                 label, pkt));
+                 label, pkt, player_id, CurrentFolder()));
 }
 
 void Device::ChangePathResponse(uint8_t label,
                                 std::shared_ptr<ChangePathRequest> pkt,
-                                std::vector<ListItem> list) {
+                                uint16_t player_id, std::string folder_id) {
   // TODO (apanicke): Reconstruct the VFS ID's here. Right now it gets
   // reconstructed in GetFolderItemsVFS
-  auto builder =
-      ChangePathResponseBuilder::MakeBuilder(Status::NO_ERROR, list.size());
+  auto builder = ChangePathResponseBuilder::MakeBuilder(
+      Status::NO_ERROR, vfs_items_.get_num_items(player_id, folder_id));
   send_message(label, true, std::move(builder));
 }
 
@@ -964,16 +978,24 @@ void Device::HandleGetItemAttributes(
           base::Bind(&Device::GetItemAttributesNowPlayingResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
     } break;
-    case Scope::VFS:
+    case Scope::VFS: {
+      // The items listed stay cached until the UIDs change, the media layer
+      // only has to list the folder again if the item was evicted since.
       // TODO (apanicke): Check the vfs_ids_ here. If the item doesn't exist
-      // then we can auto send the error without calling up. We do this check
-      // later right now though in order to prevent race conditions with updates
-      // on the media layer.
+      // then we can auto send the error without calling up.
+      const ListItem* item =
+          vfs_items_.find_item(curr_browsed_player_id_, CurrentFolder(),
+                               vfs_ids_.get_media_id(pkt->GetUid()));
+      if (item != nullptr) {
+        GetItemAttributesVFSResponse(label, pkt, {*item});
+        break;
+      }
+
       media_interface_->GetFolderItems(
           curr_browsed_player_id_, CurrentFolder(),
           base::Bind(&Device::GetItemAttributesVFSResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
-      break;
+    } break;
     default:
       DEVICE_LOG(ERROR) << "UNKNOWN SCOPE FOR HANDLE GET ITEM ATTRIBUTES";
       break;
@@ -1128,50 +1150,99 @@ std::set<AttributeEntry> filter_attributes_requested(
   return result;
 }
 
+void Device::FetchFolderItems(uint16_t player_id, std::string folder_id,
+                              uint32_t start, uint32_t end,
+                              base::Closure done) {
+  if (vfs_items_.contains(player_id, folder_id, start, end)) {
+    done.Run();
+    return;
+  }
+
+  // Pages straddle windows, only list from the first window missing. The
+  // windows cached before it are marked as used so that they aren't the ones
+  // dropped to make room for it.
+  vfs_items_.touch(player_id, folder_id, start, end);
+  uint32_t window_start = FolderItemsCache::window_start(start);
+  while (window_start < FolderItemsCache::window_start(end) &&
+         vfs_items_.contains(player_id, folder_id, window_start,
+                             window_start)) {
+    window_start += FolderItemsCache::kWindowSize;
+  }
+
+  media_interface_->GetFolderItemsRange(
+      player_id, folder_id, window_start, FolderItemsCache::window_end(end),
+      base::Bind(&Device::FolderItemsRangeResponse,
+                 weak_ptr_factory_.GetWeakPtr(), player_id, folder_id,
+                 window_start, start, end, done));
+}
+
+void Device::FolderItemsRangeResponse(uint16_t player_id,
+                                      std::string folder_id,
+                                      uint32_t list_start, uint32_t start,
+                                      uint32_t end, base::Closure done,
+                                      uint32_t num_items,
+                                      std::vector<ListItem> items) {
+  DEVICE_VLOG(3) << __func__ << ": folder=\"" << folder_id
+                 << "\" list_start=" << list_start
+                 << " num_items=" << num_items;
+  vfs_items_.insert(player_id, folder_id, list_start, num_items,
+                    std::move(items));
+
+  // The windows cached before |list_start| are dropped if the folder changed
+  // size since they were listed, list the whole page again then.
+  uint32_t window_start = FolderItemsCache::window_start(start);
+  if (list_start != window_start &&
+      !vfs_items_.contains(player_id, folder_id, start, end)) {
+    DEVICE_VLOG(3) << __func__ << ": listing again from " << window_start;
+    media_interface_->GetFolderItemsRange(
+        player_id, folder_id, window_start, FolderItemsCache::window_end(end),
+        base::Bind(&Device::FolderItemsRangeResponse,
+                   weak_ptr_factory_.GetWeakPtr(), player_id, folder_id,
+                   window_start, start, end, done));
+    return;
+  }
+
+  done.Run();
+}
+
 void Device::GetVFSListResponse(uint8_t label,
                                 std::shared_ptr<GetFolderItemsRequest> pkt,
-                                std::vector<ListItem> items) {
+                                uint16_t player_id, std::string folder_id,
+                                uint32_t end_item) {
   DEVICE_VLOG(2) << __func__ << ": start_item=" << pkt->GetStartItem()
-                 << " end_item=" << pkt->GetEndItem();
+                 << " end_item=" << end_item;
 
   // The builder will automatically correct the status if there are zero items
   auto builder = GetFolderItemsResponseBuilder::MakeVFSBuilder(
       Status::NO_ERROR, 0x0000, browse_mtu_);
 
-  // TODO (apanicke): Add test that checks if vfs_ids_ is the correct size after
-  // an operation.
-  for (const auto& item : items) {
-    if (item.type == ListItem::FOLDER) {
-      vfs_ids_.insert(item.folder.media_id);
-    } else if (item.type == ListItem::SONG) {
-      vfs_ids_.insert(item.song.media_id);
-    }
-  }
-
   // Add the elements retrieved in the last get folder items request and map
   // them to UIDs The maps will be cleared every time a directory change
   // happens. These items do not need to correspond with the now playing list as
   // the UID's only need to be unique in the context of the current scope and
-  // the current folder
-  for (auto i = pkt->GetStartItem(); i <= pkt->GetEndItem() && i < items.size();
-       i++) {
-    if (items[i].type == ListItem::FOLDER) {
-      auto folder = items[i].folder;
+  // the current folder. Only the items of the page are mapped, the rest of the
+  // folder gets its UIDs when the device asks for it.
+  for (uint64_t i = pkt->GetStartItem(); i <= end_item; i++) {
+    const ListItem* item = vfs_items_.get_item(player_id, folder_id, i);
+    if (item == nullptr) break;
+
+    if (item->type == ListItem::FOLDER) {
+      const auto& folder = item->folder;
       // right now we always use folders of mixed type
-      FolderItem folder_item(vfs_ids_.get_uid(folder.media_id), 0x00,
+      FolderItem folder_item(vfs_ids_.insert(folder.media_id), 0x00,
                              folder.is_playable, folder.name);
       if (!builder->AddFolder(folder_item)) break;
-    } else if (items[i].type == ListItem::SONG) {
-      auto song = items[i].song;
+    } else if (item->type == ListItem::SONG) {
+      const auto& song = item->song;
       auto title =
           song.attributes.find(Attribute::TITLE) != song.attributes.end()
               ? song.attributes.find(Attribute::TITLE)->value()
               : "No Song Info";
-      MediaElementItem song_item(vfs_ids_.get_uid(song.media_id), title,
+      MediaElementItem song_item(vfs_ids_.insert(song.media_id), title,
                                  std::set<AttributeEntry>());
 
       if (pkt->GetNumAttributes() == 0x00) {  // All attributes requested
-        song_item.attributes_ = std::move(song.attributes);
+        song_item.attributes_ = song.attributes;
       } else {
         song_item.attributes_ =
             filter_attributes_requested(song, pkt->GetAttributesRequested());
@@ -1295,6 +1366,9 @@ void Device::SendFolderUpdate(bool available_players, bool addressed_player,
   if (addressed_player) {
     HandleAddressedPlayerUpdate();
   }
+
+  // The folders may not hold the same items anymore
+  if (uids) vfs_items_.clear();
 }
 
 void Device::HandleTrackUpdate() {
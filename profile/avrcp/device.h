@@ -38,6 +38,7 @@
 #include "packet/avrcp/set_addressed_player.h"
 #include "packet/avrcp/set_browsed_player.h"
 #include "packet/avrcp/vendor_packet.h"
+#include "profile/avrcp/folder_items_cache.h"
 #include "profile/avrcp/media_id_map.h"
 #include "raw_address.h"
 
@@ -196,7 +197,8 @@ class Device {
       uint16_t curr_player, std::vector<MediaPlayerInfo> players);
   virtual void GetVFSListResponse(uint8_t label,
                                   std::shared_ptr<GetFolderItemsRequest> pkt,
-                                  std::vector<ListItem> items);
+                                  uint16_t player_id, std::string folder_id,
+                                  uint32_t end_item);
   virtual void GetNowPlayingListResponse(
       uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
       std::string curr_song_id, std::vector<SongInfo> song_list);
@@ -207,7 +209,8 @@ class Device {
   virtual void GetTotalNumberOfItemsMediaPlayersResponse(
       uint8_t label, uint16_t curr_player, std::vector<MediaPlayerInfo> list);
   virtual void GetTotalNumberOfItemsVFSResponse(uint8_t label,
-                                                std::vector<ListItem> items);
+                                                uint16_t player_id,
+                                                std::string folder_id);
   virtual void GetTotalNumberOfItemsNowPlayingResponse(
       uint8_t label, std::string curr_song_id, std::vector<SongInfo> song_list);
 
@@ -233,7 +236,7 @@ class Device {
                                 std::shared_ptr<ChangePathRequest> request);
   virtual void ChangePathResponse(uint8_t label,
                                   std::shared_ptr<ChangePathRequest> request,
-                                  std::vector<ListItem> list);
+                                  uint16_t player_id, std::string folder_id);
 
   // PLAY ITEM
   virtual void HandlePlayItem(uint8_t label,
@@ -282,6 +285,17 @@ class Device {
     active_labels_.erase(label);
     send_message_cb_.Run(label, browse, std::move(message));
   }
+
+  // Runs |done| once the number of items of the folder and its items from
+  // |start| to |end| are in vfs_items_, listing the windows holding them from
+  // the media layer if they aren't cached.
+  void FetchFolderItems(uint16_t player_id, std::string folder_id,
+                        uint32_t start, uint32_t end, base::Closure done);
+  void FolderItemsRangeResponse(uint16_t player_id, std::string folder_id,
+                                uint32_t list_start, uint32_t start,
+                                uint32_t end, base::Closure done,
+                                uint32_t num_items,
+                                std::vector<ListItem> items);
   base::WeakPtrFactory<Device> weak_ptr_factory_;
 
   // TODO (apanicke): Initialize all the variables in the constructor.
@@ -311,6 +325,7 @@ class Device {
   Notification uids_changed_ = Notification(false, 0);
 
   MediaIdMap vfs_ids_;
+  FolderItemsCache vfs_items_;
   MediaIdMap now_playing_ids_;
 
   uint32_t play_pos_interval_ = 0;
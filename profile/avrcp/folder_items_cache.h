@@ -0,0 +1,214 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hardware/avrcp/avrcp.h"
+
+namespace bluetooth {
+namespace avrcp {
+
+// A helper class to keep the folder items listed by the AVRCP Media Interface
+// layer, so that a device paging through a folder does not have the folder
+// listed again for every page. The items are listed and kept by windows of
+// kWindowSize items, at most kMaxWindows of them, the least recently used
+// being dropped first. The cache must be cleared whenever the UIDs change.
+class FolderItemsCache {
+ public:
+  static constexpr uint32_t kWindowSize = 128;
+  static constexpr size_t kMaxWindows = 64;
+
+  // The first and last indexes of the window holding the item at |index|
+  static uint32_t window_start(uint32_t index) {
+    return index - index % kWindowSize;
+  }
+  static uint32_t window_end(uint32_t index) {
+    return window_start(index) + (kWindowSize - 1);
+  }
+
+  void clear() {
+    folders_.clear();
+    num_windows_ = 0;
+  }
+
+  // Returns true if the number of items of the folder is known, and the items
+  // from |start| to |end| in the folder are all cached
+  bool contains(uint16_t player_id, const std::string& folder_id,
+                uint32_t start, uint32_t end) const {
+    const auto& folder_it = folders_.find(Key(player_id, folder_id));
+    if (folder_it == folders_.end()) return false;
+
+    const Folder& folder = folder_it->second;
+    if (start >= folder.num_items) return true;
+    end = std::min(end, folder.num_items - 1);
+    for (uint64_t window = window_start(start); window <= end;
+         window += kWindowSize) {
+      if (folder.windows.find(window) == folder.windows.end()) return false;
+    }
+    return true;
+  }
+
+  // Marks the cached windows holding the items from |start| to |end| of the
+  // folder as just used, so that listing the windows missing around them
+  // doesn't drop them
+  void touch(uint16_t player_id, const std::string& folder_id, uint32_t start,
+             uint32_t end) {
+    auto folder_it = folders_.find(Key(player_id, folder_id));
+    if (folder_it == folders_.end()) return;
+
+    Folder& folder = folder_it->second;
+    if (start >= folder.num_items) return;
+    end = std::min(end, folder.num_items - 1);
+    for (uint64_t window = window_start(start); window <= end;
+         window += kWindowSize) {
+      auto window_it = folder.windows.find(window);
+      if (window_it != folder.windows.end()) {
+        window_it->second.last_used = ++clock_;
+      }
+    }
+  }
+
+  // Adds the |items| listed from |start|, the start of a window, in a folder
+  // of |num_items| items
+  void insert(uint16_t player_id, const std::string& folder_id, uint32_t start,
+              uint32_t num_items, std::vector<ListItem> items) {
+    Folder& folder = folders_[Key(player_id, folder_id)];
+    if (folder.num_items != num_items) {
+      // The folder changed since it was last listed
+      num_windows_ -= folder.windows.size();
+      folder.windows.clear();
+      folder.indexes.clear();
+      folder.num_items = num_items;
+    }
+
+    for (size_t offset = 0; offset < items.size(); offset += kWindowSize) {
+      size_t end = std::min(items.size(), offset + kWindowSize);
+      Window& window = folder.windows[start + offset];
+      if (window.items.empty()) num_windows_++;
+      for (const auto& item : window.items) {
+        folder.indexes.erase(media_id(item));
+      }
+      window.items.assign(std::make_move_iterator(items.begin() + offset),
+                          std::make_move_iterator(items.begin() + end));
+      window.last_used = ++clock_;
+      for (size_t i = 0; i < window.items.size(); i++) {
+        folder.indexes[media_id(window.items[i])] = start + offset + i;
+      }
+    }
+
+    while (num_windows_ > kMaxWindows) evict();
+  }
+
+  // Returns the number of items of the folder, or 0 if it is not cached
+  uint32_t get_num_items(uint16_t player_id,
+                         const std::string& folder_id) const {
+    const auto& folder_it = folders_.find(Key(player_id, folder_id));
+    if (folder_it == folders_.end()) return 0;
+    return folder_it->second.num_items;
+  }
+
+  // Returns the item at |index| of the folder, or nullptr if it is not cached
+  const ListItem* get_item(uint16_t player_id, const std::string& folder_id,
+                           uint32_t index) {
+    auto folder_it = folders_.find(Key(player_id, folder_id));
+    if (folder_it == folders_.end()) return nullptr;
+
+    auto& windows = folder_it->second.windows;
+    auto window_it = windows.find(window_start(index));
+    if (window_it == windows.end()) return nullptr;
+
+    Window& window = window_it->second;
+    if (index - window_start(index) >= window.items.size()) return nullptr;
+    window.last_used = ++clock_;
+    return &window.items[index - window_start(index)];
+  }
+
+  // Returns the item of the folder whose media ID is |media_id|, or nullptr if
+  // it is not cached
+  const ListItem* find_item(uint16_t player_id, const std::string& folder_id,
+                            const std::string& media_id) {
+    auto folder_it = folders_.find(Key(player_id, folder_id));
+    if (folder_it == folders_.end()) return nullptr;
+
+    const auto& index_it = folder_it->second.indexes.find(media_id);
+    if (index_it == folder_it->second.indexes.end()) return nullptr;
+    return get_item(player_id, folder_id, index_it->second);
+  }
+
+ private:
+  using Key = std::pair<uint16_t, std::string>;
+
+  struct Window {
+    std::vector<ListItem> items;
+    uint64_t last_used = 0;
+  };
+
+  struct Folder {
+    uint32_t num_items = 0;
+    // By index of their first item
+    std::unordered_map<uint32_t, Window> windows;
+    // The index of the cached items, by media ID
+    std::unordered_map<std::string, uint32_t> indexes;
+  };
+
+  static const std::string& media_id(const ListItem& item) {
+    return item.type == ListItem::FOLDER ? item.folder.media_id
+                                         : item.song.media_id;
+  }
+
+  // Drops the least recently used window, and its folder if it was the last
+  void evict() {
+    auto oldest_folder = folders_.end();
+    uint32_t oldest_window = 0;
+    uint64_t oldest_use = UINT64_MAX;
+    for (auto folder_it = folders_.begin(); folder_it != folders_.end();
+         folder_it++) {
+      for (const auto& window : folder_it->second.windows) {
+        if (window.second.last_used < oldest_use) {
+          oldest_folder = folder_it;
+          oldest_window = window.first;
+          oldest_use = window.second.last_used;
+        }
+      }
+    }
+    if (oldest_folder == folders_.end()) return;
+
+    Folder& folder = oldest_folder->second;
+    for (const auto& item : folder.windows[oldest_window].items) {
+      folder.indexes.erase(media_id(item));
+    }
+    folder.windows.erase(oldest_window);
+    num_windows_--;
+    if (folder.windows.empty()) folders_.erase(oldest_folder);
+  }
+
+  std::map<Key, Folder> folders_;
+  size_t num_windows_ = 0;
+  uint64_t clock_ = 0;
+};
+
+}  // namespace avrcp
+}  // namespace bluetooth
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/bind.h>
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "avrcp_browse_packet.h"
+#include "device.h"
+#include "stack_config.h"
+#include "tests/packet_test_helper.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace avrcp {
+
+using TestBrowsePacket = TestPacketType<BrowsePacket>;
+
+bool get_pts_avrcp_test(void) { return false; }
+
+const stack_config_t interface = {
+    nullptr, get_pts_avrcp_test, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr};
+
+namespace {
+
+constexpr uint32_t kNumItems = 20000;
+constexpr uint32_t kPageSize = 10;
+
+// A media layer listing a single folder synchronously. Unless it supports
+// ranges, the whole folder is listed for every request.
+class FakeMediaInterface : public MediaInterface {
+ public:
+  explicit FakeMediaInterface(bool supports_range)
+      : supports_range_(supports_range) {
+    for (uint32_t i = 0; i < kNumItems; i++) {
+      std::string id = "song" + std::to_string(i);
+      SongInfo song = {id, {AttributeEntry(Attribute::TITLE, "Song " + id)}};
+      items_.push_back({ListItem::SONG, FolderInfo(), song});
+    }
+  }
+
+  void GetFolderItems(uint16_t player_id, std::string media_id,
+                      FolderItemsCallback folder_cb) override {
+    items_listed_ += items_.size();
+    folder_cb.Run(items_);
+  }
+
+  void GetFolderItemsRange(uint16_t player_id, std::string media_id,
+                           uint32_t start, uint32_t end,
+                           FolderItemsRangeCallback folder_cb) override {
+    if (!supports_range_) {
+      MediaInterface::GetFolderItemsRange(player_id, media_id, start, end,
+                                          folder_cb);
+      return;
+    }
+
+    std::vector<ListItem> range;
+    if (start < items_.size()) {
+      size_t last = std::min<size_t>(end, items_.size() - 1);
+      range.assign(items_.begin() + start, items_.begin() + last + 1);
+    }
+    items_listed_ += range.size();
+    folder_cb.Run(items_.size(), std::move(range));
+  }
+
+  void SendKeyEvent(uint8_t key, KeyState state) override {}
+  void GetSongInfo(SongInfoCallback info_cb) override {}
+  void GetPlayStatus(PlayStatusCallback status_cb) override {}
+  void GetNowPlayingList(NowPlayingCallback now_playing_cb) override {}
+  void GetMediaPlayerList(MediaListCallback list_cb) override {}
+  void SetBrowsedPlayer(uint16_t player_id,
+                        SetBrowsedPlayerCallback browse_cb) override {}
+  void PlayItem(uint16_t player_id, bool now_playing,
+                std::string media_id) override {}
+  void SetActiveDevice(const RawAddress& address) override {}
+  void RegisterUpdateCallback(MediaCallbacks* callback) override {}
+  void UnregisterUpdateCallback(MediaCallbacks* callback) override {}
+
+  size_t items_listed_ = 0;
+
+ private:
+  bool supports_range_;
+  std::vector<ListItem> items_;
+};
+
+class FakeA2dpInterface : public A2dpInterface {
+ public:
+  RawAddress active_peer() override { return RawAddress::kAny; }
+  bool is_peer_in_silence_mode(const RawAddress& peer_address) override {
+    return false;
+  }
+};
+
+void DropResponse(uint8_t label, bool browse,
+                  std::unique_ptr<::bluetooth::PacketBuilder> message) {
+  benchmark::DoNotOptimize(message);
+}
+
+// Pages through the folder kPageSize items at a time, the way a car kit lists
+// a large library, wrapping around at the end of the folder. Invalidating
+// after every page gets the media layer to list the folder for every page, as
+// it was before the items were cached.
+// Arguments: range, invalidate.
+void BM_PageFolder(State& state) {
+  FakeMediaInterface media_interface(state.range(0));
+  FakeA2dpInterface a2dp_interface;
+  bool invalidate = state.range(1);
+
+  Device device(RawAddress::kAny, false, base::Bind(&DropResponse), 0xFFFF,
+                0xFFFF);
+  device.RegisterInterfaces(&media_interface, &a2dp_interface, nullptr);
+
+  std::vector<std::shared_ptr<TestBrowsePacket>> pages;
+  for (uint32_t start = 0; start < kNumItems; start += kPageSize) {
+    auto builder = GetFolderItemsRequestBuilder::MakeBuilder(
+        Scope::VFS, start, start + kPageSize - 1, {});
+    auto request = TestBrowsePacket::Make();
+    builder->Serialize(request);
+    pages.push_back(request);
+  }
+
+  size_t page = 0;
+  for (auto _ : state) {
+    device.BrowseMessageReceived(1, pages[page]);
+    if (invalidate) device.SendFolderUpdate(false, false, true);
+    page = (page + 1) % pages.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["items_listed_per_page"] = benchmark::Counter(
+      media_interface.items_listed_, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_PageFolder)
+    ->ArgNames({"range", "invalidate"})
+    ->Args({0, 1})
+    ->Args({0, 0})
+    ->Args({1, 1})
+    ->Args({1, 0});
+
+}  // namespace
+}  // namespace avrcp
+}  // namespace bluetooth
+
+const stack_config_t* stack_config_get_interface(void) {
+  return &bluetooth::avrcp::interface;
+}
+
+BENCHMARK_MAIN();
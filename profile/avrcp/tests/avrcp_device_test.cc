@@ -801,6 +801,90 @@ TEST_F(AvrcpDeviceTest, getVFSFolderTest) {
   SendBrowseMessage(1, request);
 }
 
+TEST_F(AvrcpDeviceTest, getVFSFolderCachedTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  FolderInfo info = {"test_id", true, "Test Folder"};
+  ListItem item = {ListItem::FOLDER, info, SongInfo()};
+  std::vector<ListItem> list = {item};
+
+  // The second page is served from the cache, the third one is listed again
+  // since the UIDs changed
+  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+      .Times(2)
+      .WillRepeatedly(InvokeCb<2>(list));
+
+  for (uint8_t label = 1; label <= 3; label++) {
+    auto expected_response = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+        Status::NO_ERROR, 0x0000, 0xFFFF);
+    expected_response->AddFolder(FolderItem(1, 0, true, "Test Folder"));
+    EXPECT_CALL(response_cb,
+                Call(label, true, matchPacket(std::move(expected_response))))
+        .Times(1);
+  }
+
+  auto request = TestBrowsePacket::Make(get_folder_items_request_vfs);
+  SendBrowseMessage(1, request);
+  SendBrowseMessage(2, request);
+  test_device->SendFolderUpdate(false, false, true);
+  SendBrowseMessage(3, request);
+}
+
+TEST_F(AvrcpDeviceTest, getVFSFolderStraddlingOldestWindowTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  constexpr uint32_t kWindowSize = 128;
+  constexpr uint32_t kMaxWindows = 64;
+  std::vector<ListItem> list;
+  for (uint32_t i = 0; i < (kMaxWindows + 1) * kWindowSize; i++) {
+    FolderInfo info = {"test_id" + std::to_string(i), true,
+                       "Test Folder" + std::to_string(i)};
+    list.push_back({ListItem::FOLDER, info, SongInfo()});
+  }
+
+  // Every page fills a window of the cache, but the last one which straddles
+  // the first window filled and one never listed
+  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+      .Times(kMaxWindows + 1)
+      .WillRepeatedly(InvokeCb<2>(list));
+  EXPECT_CALL(response_cb, Call(1, true, _)).Times(kMaxWindows);
+
+  for (uint32_t window = 0; window <= kMaxWindows; window++) {
+    if (window == 1) continue;
+    auto folder_request_builder = GetFolderItemsRequestBuilder::MakeBuilder(
+        Scope::VFS, window * kWindowSize, window * kWindowSize, {});
+    auto request = TestBrowsePacket::Make();
+    folder_request_builder->Serialize(request);
+    SendBrowseMessage(1, request);
+  }
+
+  // The oldest window is still cached once the missing one is listed
+  uint32_t start = kWindowSize - 8;
+  uint32_t end = kWindowSize + 7;
+  auto expected_response = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  for (uint32_t i = start; i <= end; i++) {
+    expected_response->AddFolder(FolderItem(kMaxWindows + 1 + i - start, 0,
+                                            true,
+                                            "Test Folder" + std::to_string(i)));
+  }
+  EXPECT_CALL(response_cb,
+              Call(2, true, matchPacket(std::move(expected_response))))
+      .Times(1);
+
+  auto folder_request_builder =
+      GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, start, end, {});
+  auto request = TestBrowsePacket::Make();
+  folder_request_builder->Serialize(request);
+  SendBrowseMessage(2, request);
+}
+
 TEST_F(AvrcpDeviceTest, getFolderItemsMtuTest) {
   auto truncated_packet = GetFolderItemsResponseBuilder::MakeVFSBuilder(
       Status::NO_ERROR, 0x0000, 0xFFFF);
@@ -863,8 +947,9 @@ TEST_F(AvrcpDeviceTest, changePathTest) {
   ListItem item3 = {ListItem::FOLDER, info3, SongInfo()};
   ListItem item4 = {ListItem::FOLDER, info4, SongInfo()};
   std::vector<ListItem> list1 = {item2, item3, item4};
+  // Listed once when changing path down, then cached
   EXPECT_CALL(interface, GetFolderItems(_, "test_id1", _))
-      .Times(3)
+      .Times(1)
       .WillRepeatedly(InvokeCb<2>(list1));
 
   std::vector<ListItem> list2 = {};
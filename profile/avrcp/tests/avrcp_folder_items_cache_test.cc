@@ -0,0 +1,163 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "folder_items_cache.h"
+
+namespace bluetooth {
+namespace avrcp {
+
+constexpr uint16_t kPlayerId = 1;
+constexpr uint32_t kWindowSize = FolderItemsCache::kWindowSize;
+constexpr size_t kMaxWindows = FolderItemsCache::kMaxWindows;
+
+// The songs from |start| of a folder, named after |folder_id| and their index
+std::vector<ListItem> MakeItems(const std::string& folder_id, uint32_t start,
+                                uint32_t count) {
+  std::vector<ListItem> items;
+  for (uint32_t i = start; i < start + count; i++) {
+    ListItem item = {};
+    item.type = ListItem::SONG;
+    item.song.media_id = folder_id + "_" + std::to_string(i);
+    items.push_back(item);
+  }
+  return items;
+}
+
+std::string MediaIdOf(const ListItem* item) {
+  return item == nullptr ? "" : item->song.media_id;
+}
+
+TEST(FolderItemsCacheTest, pageSpanningTwoWindowsTest) {
+  FolderItemsCache cache;
+  uint32_t num_items = 3 * kWindowSize;
+  uint32_t start = kWindowSize - 8;
+  uint32_t end = kWindowSize + 7;
+
+  cache.insert(kPlayerId, "folder", 0, num_items,
+               MakeItems("folder", 0, kWindowSize));
+  ASSERT_FALSE(cache.contains(kPlayerId, "folder", start, end));
+
+  cache.insert(kPlayerId, "folder", kWindowSize, num_items,
+               MakeItems("folder", kWindowSize, kWindowSize));
+  ASSERT_TRUE(cache.contains(kPlayerId, "folder", start, end));
+  for (uint32_t i = start; i <= end; i++) {
+    ASSERT_EQ(MediaIdOf(cache.get_item(kPlayerId, "folder", i)),
+              "folder_" + std::to_string(i));
+  }
+  ASSERT_FALSE(cache.contains(kPlayerId, "folder", start, 2 * kWindowSize));
+}
+
+TEST(FolderItemsCacheTest, evictionBeyondMaxWindowsTest) {
+  FolderItemsCache cache;
+  uint32_t num_items = (kMaxWindows + 1) * kWindowSize;
+  for (uint32_t window = 0; window < kMaxWindows; window++) {
+    cache.insert(kPlayerId, "folder", window * kWindowSize, num_items,
+                 MakeItems("folder", window * kWindowSize, kWindowSize));
+  }
+  // The first window is used again, leaving the second the least recently
+  // used one
+  ASSERT_NE(cache.get_item(kPlayerId, "folder", 0), nullptr);
+
+  uint32_t last = kMaxWindows * kWindowSize;
+  cache.insert(kPlayerId, "folder", last, num_items,
+               MakeItems("folder", last, kWindowSize));
+
+  ASSERT_EQ(cache.get_item(kPlayerId, "folder", kWindowSize), nullptr);
+  ASSERT_FALSE(cache.contains(kPlayerId, "folder", kWindowSize,
+                              2 * kWindowSize - 1));
+  ASSERT_EQ(MediaIdOf(cache.get_item(kPlayerId, "folder", 0)), "folder_0");
+  ASSERT_EQ(MediaIdOf(cache.get_item(kPlayerId, "folder", last)),
+            "folder_" + std::to_string(last));
+  ASSERT_TRUE(cache.contains(kPlayerId, "folder", 2 * kWindowSize,
+                             num_items - 1));
+}
+
+TEST(FolderItemsCacheTest, touchedWindowKeptTest) {
+  FolderItemsCache cache;
+  uint32_t num_items = (kMaxWindows + 1) * kWindowSize;
+  for (uint32_t window = 0; window < kMaxWindows; window++) {
+    cache.insert(kPlayerId, "folder", window * kWindowSize, num_items,
+                 MakeItems("folder", window * kWindowSize, kWindowSize));
+  }
+  // A page straddling the first two windows is about to be served, they
+  // mustn't be the ones dropped to make room for the last window
+  cache.touch(kPlayerId, "folder", kWindowSize - 8, kWindowSize + 7);
+
+  uint32_t last = kMaxWindows * kWindowSize;
+  cache.insert(kPlayerId, "folder", last, num_items,
+               MakeItems("folder", last, kWindowSize));
+
+  ASSERT_TRUE(cache.contains(kPlayerId, "folder", 0, 2 * kWindowSize - 1));
+  ASSERT_FALSE(cache.contains(kPlayerId, "folder", 2 * kWindowSize,
+                              3 * kWindowSize - 1));
+}
+
+TEST(FolderItemsCacheTest, numItemsChangedTest) {
+  FolderItemsCache cache;
+  cache.insert(kPlayerId, "folder", 0, 2 * kWindowSize,
+               MakeItems("folder", 0, kWindowSize));
+  cache.insert(kPlayerId, "folder", kWindowSize, 2 * kWindowSize,
+               MakeItems("folder", kWindowSize, kWindowSize));
+  ASSERT_TRUE(cache.contains(kPlayerId, "folder", 0, 2 * kWindowSize - 1));
+
+  // The folder lost items since it was listed: the windows listed before are
+  // dropped
+  uint32_t num_items = kWindowSize + 10;
+  cache.insert(kPlayerId, "folder", 0, num_items,
+               MakeItems("updated", 0, kWindowSize));
+
+  ASSERT_EQ(cache.get_num_items(kPlayerId, "folder"), num_items);
+  ASSERT_EQ(MediaIdOf(cache.get_item(kPlayerId, "folder", 0)), "updated_0");
+  ASSERT_EQ(cache.get_item(kPlayerId, "folder", kWindowSize), nullptr);
+  ASSERT_FALSE(cache.contains(kPlayerId, "folder", 0, num_items - 1));
+  ASSERT_EQ(cache.find_item(kPlayerId, "folder", "folder_0"), nullptr);
+  ASSERT_EQ(cache.find_item(kPlayerId, "folder",
+                            "folder_" + std::to_string(kWindowSize)),
+            nullptr);
+
+  // Past the end of the folder, nothing needs to be listed
+  ASSERT_TRUE(cache.contains(kPlayerId, "folder", num_items, num_items + 5));
+}
+
+TEST(FolderItemsCacheTest, findItemAfterEvictionTest) {
+  FolderItemsCache cache;
+  cache.insert(kPlayerId, "first", 0, kWindowSize,
+               MakeItems("first", 0, kWindowSize));
+  ASSERT_EQ(MediaIdOf(cache.find_item(kPlayerId, "first", "first_5")),
+            "first_5");
+
+  uint32_t num_items = kMaxWindows * kWindowSize;
+  for (uint32_t window = 0; window < kMaxWindows; window++) {
+    cache.insert(kPlayerId, "second", window * kWindowSize, num_items,
+                 MakeItems("second", window * kWindowSize, kWindowSize));
+  }
+
+  // The only window of the first folder was dropped, and the folder with it
+  ASSERT_EQ(cache.find_item(kPlayerId, "first", "first_5"), nullptr);
+  ASSERT_EQ(cache.get_item(kPlayerId, "first", 5), nullptr);
+  ASSERT_EQ(cache.get_num_items(kPlayerId, "first"), 0u);
+  ASSERT_FALSE(cache.contains(kPlayerId, "first", 0, 0));
+  ASSERT_EQ(MediaIdOf(cache.find_item(kPlayerId, "second", "second_5")),
+            "second_5");
+}
+
+}  // namespace avrcp
+}  // namespace bluetooth
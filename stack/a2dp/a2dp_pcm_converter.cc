@@ -0,0 +1,363 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "a2dp_pcm_converter"
+
+#include "a2dp_pcm_converter.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <base/logging.h>
+
+namespace {
+
+// Kaiser window shape of the filter, for about 90 dB of stopband
+// attenuation with |kTapsPerPhase| taps.
+constexpr double kKaiserBeta = 9.0;
+
+// Cutoff of the filter, relative to the lower of the input and output
+// Nyquist frequencies. The transition band is centered on it.
+constexpr double kCutoff = 0.97;
+
+uint32_t Gcd(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// Modified Bessel function of the first kind, order 0.
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 64; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+    if (term < sum * 1e-12) break;
+  }
+  return sum;
+}
+
+// Dot product of |n| floats, |n| a multiple of 8. The independent partial
+// sums let the compiler vectorize the loop without reassociating floating
+// point additions.
+inline float Dot8(const float* a, const float* b, size_t n) {
+  float acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  for (size_t i = 0; i < n; i += 8) {
+    for (size_t k = 0; k < 8; k++) acc[k] += a[i + k] * b[i + k];
+  }
+  return ((acc[0] + acc[4]) + (acc[1] + acc[5])) +
+         ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+}
+
+void DecodeSamples(A2dpPcmFormat format, const uint8_t* p_src, size_t count,
+                   float* p_dst) {
+  switch (format) {
+    case A2dpPcmFormat::kU8:
+      for (size_t i = 0; i < count; i++)
+        p_dst[i] = (p_src[i] - 128) * (1.0f / 128);
+      break;
+    case A2dpPcmFormat::kS16:
+      for (size_t i = 0; i < count; i++) {
+        int16_t v;
+        memcpy(&v, p_src + 2 * i, sizeof(v));
+        p_dst[i] = v * (1.0f / 32768);
+      }
+      break;
+    case A2dpPcmFormat::kS24Packed:
+      for (size_t i = 0; i < count; i++) {
+        const uint8_t* p = p_src + 3 * i;
+        int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 |
+                              (uint32_t)p[2] << 24) >>
+                    8;
+        p_dst[i] = v * (1.0f / 8388608);
+      }
+      break;
+    case A2dpPcmFormat::kS32:
+      for (size_t i = 0; i < count; i++) {
+        int32_t v;
+        memcpy(&v, p_src + 4 * i, sizeof(v));
+        p_dst[i] = v * (1.0f / 2147483648.0f);
+      }
+      break;
+    case A2dpPcmFormat::kFloat:
+      memcpy(p_dst, p_src, count * sizeof(float));
+      break;
+  }
+}
+
+// Scales |v| to |full_scale|, rounds it, and clamps it to the integer range.
+inline int64_t Quantize(float v, double full_scale) {
+  double scaled = nearbyint(v * full_scale);
+  return (int64_t)std::max(-full_scale, std::min(full_scale - 1, scaled));
+}
+
+}  // namespace
+
+bool A2DP_GetPcmFormat(uint8_t bits_per_sample, A2dpPcmFormat* p_format) {
+  switch (bits_per_sample) {
+    case 8:
+      *p_format = A2dpPcmFormat::kU8;
+      return true;
+    case 16:
+      *p_format = A2dpPcmFormat::kS16;
+      return true;
+    case 24:
+      *p_format = A2dpPcmFormat::kS24Packed;
+      return true;
+    case 32:
+      *p_format = A2dpPcmFormat::kS32;
+      return true;
+    default:
+      return false;
+  }
+}
+
+size_t A2DP_GetPcmSampleSize(A2dpPcmFormat format) {
+  switch (format) {
+    case A2dpPcmFormat::kU8:
+      return 1;
+    case A2dpPcmFormat::kS16:
+      return 2;
+    case A2dpPcmFormat::kS24Packed:
+      return 3;
+    case A2dpPcmFormat::kS32:
+    case A2dpPcmFormat::kFloat:
+      return 4;
+  }
+  return 0;
+}
+
+A2dpPcmConverter::A2dpPcmConverter(const tA2DP_PCM_CONFIG& input,
+                                   const tA2DP_PCM_CONFIG& output)
+    : input_(input), output_(output) {
+  CHECK(input_.sample_rate > 0 && output_.sample_rate > 0);
+  CHECK(input_.channel_count > 0 && output_.channel_count > 0);
+
+  input_frame_size_ = A2DP_GetPcmSampleSize(input_.format) *
+                      input_.channel_count;
+  output_frame_size_ = A2DP_GetPcmSampleSize(output_.format) *
+                       output_.channel_count;
+  work_channels_ = std::min(input_.channel_count, output_.channel_count);
+
+  uint32_t gcd = Gcd(input_.sample_rate, output_.sample_rate);
+  up_ = output_.sample_rate / gcd;
+  down_ = input_.sample_rate / gcd;
+  DesignFilter();
+
+  history_.resize(work_channels_);
+  resampled_.resize(work_channels_);
+  Reset();
+}
+
+void A2dpPcmConverter::DesignFilter() {
+  if (up_ == down_) {
+    phases_ = 1;
+    taps_ = 1;
+    coefs_.assign(1, 1.0f);
+    return;
+  }
+
+  phases_ = std::min(up_, kMaxPhases);
+  taps_ = kTapsPerPhase;
+
+  // The prototype lowpass runs at |phases_| times the input rate.
+  size_t length = phases_ * taps_;
+  double cutoff = kCutoff * 0.5 *
+                  std::min(input_.sample_rate, output_.sample_rate) /
+                  ((double)input_.sample_rate * phases_);
+  double center = (length - 1) / 2.0;
+  double i0_beta = BesselI0(kKaiserBeta);
+  std::vector<double> prototype(length);
+  for (size_t m = 0; m < length; m++) {
+    double t = m - center;
+    double sinc =
+        (t == 0) ? 1.0 : sin(2 * M_PI * cutoff * t) / (2 * M_PI * cutoff * t);
+    double r = t / center;
+    double window = BesselI0(kKaiserBeta * sqrt(1 - r * r)) / i0_beta;
+    prototype[m] = sinc * window;
+  }
+
+  // Phase p applies to the outputs p / |phases_| of an input sample past the
+  // start of their window. The taps are stored in input order, and each
+  // phase is normalized to unity gain.
+  coefs_.resize(length);
+  for (uint32_t p = 0; p < phases_; p++) {
+    float* c = &coefs_[p * taps_];
+    double sum = 0;
+    for (size_t j = 0; j < taps_; j++)
+      sum += prototype[(taps_ - 1 - j) * phases_ + p];
+    for (size_t j = 0; j < taps_; j++)
+      c[j] = prototype[(taps_ - 1 - j) * phases_ + p] / sum;
+  }
+}
+
+void A2dpPcmConverter::Reset() {
+  // Start half a window into zeros, so the output is not delayed by the
+  // filter.
+  history_len_ = taps_ / 2;
+  for (auto& plane : history_) plane.assign(history_len_, 0.0f);
+  position_ = 0;
+  fraction_ = 0;
+}
+
+size_t A2dpPcmConverter::InputFramesFor(size_t output_frames) const {
+  if (output_frames == 0) return 0;
+  uint64_t last = fraction_ + (uint64_t)(output_frames - 1) * down_;
+  uint64_t needed = position_ + last / up_ + taps_;
+  return needed > history_len_ ? needed - history_len_ : 0;
+}
+
+size_t A2dpPcmConverter::Convert(const void* p_input, size_t input_frames,
+                                 void* p_output, size_t max_output_frames) {
+  Decode(static_cast<const uint8_t*>(p_input), input_frames);
+  size_t frames = Resample(max_output_frames);
+  Encode(frames, static_cast<uint8_t*>(p_output));
+  return frames;
+}
+
+void A2dpPcmConverter::Decode(const uint8_t* p_input, size_t input_frames) {
+  // Drop the input no output window needs anymore.
+  if (position_ > 0) {
+    for (auto& plane : history_) {
+      memmove(plane.data(), plane.data() + position_,
+              (history_len_ - position_) * sizeof(float));
+    }
+    history_len_ -= position_;
+    position_ = 0;
+  }
+  if (input_frames == 0) return;
+
+  size_t in_channels = input_.channel_count;
+  decoded_.resize(input_frames * in_channels);
+  DecodeSamples(input_.format, p_input, input_frames * in_channels,
+                decoded_.data());
+
+  for (auto& plane : history_) plane.resize(history_len_ + input_frames);
+  const float* p_src = decoded_.data();
+  if (work_channels_ == 1 && in_channels > 1) {
+    float* p_dst = history_[0].data() + history_len_;
+    float scale = 1.0f / in_channels;
+    for (size_t i = 0; i < input_frames; i++, p_src += in_channels) {
+      float sum = 0;
+      for (size_t c = 0; c < in_channels; c++) sum += p_src[c];
+      p_dst[i] = sum * scale;
+    }
+  } else {
+    for (size_t c = 0; c < work_channels_; c++) {
+      float* p_dst = history_[c].data() + history_len_;
+      for (size_t i = 0; i < input_frames; i++)
+        p_dst[i] = p_src[i * in_channels + c];
+    }
+  }
+  history_len_ += input_frames;
+}
+
+size_t A2dpPcmConverter::Resample(size_t max_output_frames) {
+  size_t available = 0;
+  {
+    // Count the outputs whose window is buffered.
+    uint64_t position = position_;
+    uint64_t fraction = fraction_;
+    while (available < max_output_frames &&
+           position + taps_ <= history_len_) {
+      available++;
+      fraction += down_;
+      position += fraction / up_;
+      fraction %= up_;
+    }
+  }
+  for (auto& plane : resampled_) plane.resize(available);
+  if (available == 0) return 0;
+
+  if (taps_ == 1) {
+    for (size_t c = 0; c < work_channels_; c++) {
+      memcpy(resampled_[c].data(), history_[c].data() + position_,
+             available * sizeof(float));
+    }
+    position_ += available;
+    return available;
+  }
+
+  for (size_t n = 0; n < available; n++) {
+    uint32_t phase = (phases_ == up_)
+                         ? fraction_
+                         : (uint32_t)((uint64_t)fraction_ * phases_ / up_);
+    const float* c = &coefs_[phase * taps_];
+    for (size_t ch = 0; ch < work_channels_; ch++)
+      resampled_[ch][n] = Dot8(c, history_[ch].data() + position_, taps_);
+    fraction_ += down_;
+    position_ += fraction_ / up_;
+    fraction_ %= up_;
+  }
+  return available;
+}
+
+void A2dpPcmConverter::Encode(size_t frames, uint8_t* p_output) {
+  size_t out_channels = output_.channel_count;
+  for (size_t c = 0; c < out_channels; c++) {
+    // Mono is duplicated to every output channel.
+    const float* p_src = resampled_[c % work_channels_].data();
+    switch (output_.format) {
+      case A2dpPcmFormat::kU8: {
+        uint8_t* p_dst = p_output + c;
+        for (size_t i = 0; i < frames; i++)
+          p_dst[i * out_channels] = (uint8_t)(Quantize(p_src[i], 128) + 128);
+        break;
+      }
+      case A2dpPcmFormat::kS16: {
+        uint8_t* p_dst = p_output + 2 * c;
+        for (size_t i = 0; i < frames; i++) {
+          int16_t v = (int16_t)Quantize(p_src[i], 32768);
+          memcpy(p_dst + 2 * i * out_channels, &v, sizeof(v));
+        }
+        break;
+      }
+      case A2dpPcmFormat::kS24Packed: {
+        uint8_t* p_dst = p_output + 3 * c;
+        for (size_t i = 0; i < frames; i++) {
+          int32_t v = (int32_t)Quantize(p_src[i], 8388608);
+          uint8_t* p = p_dst + 3 * i * out_channels;
+          p[0] = v & 0xff;
+          p[1] = (v >> 8) & 0xff;
+          p[2] = (v >> 16) & 0xff;
+        }
+        break;
+      }
+      case A2dpPcmFormat::kS32: {
+        uint8_t* p_dst = p_output + 4 * c;
+        for (size_t i = 0; i < frames; i++) {
+          int32_t v = (int32_t)Quantize(p_src[i], 2147483648.0);
+          memcpy(p_dst + 4 * i * out_channels, &v, sizeof(v));
+        }
+        break;
+      }
+      case A2dpPcmFormat::kFloat: {
+        uint8_t* p_dst = p_output + 4 * c;
+        for (size_t i = 0; i < frames; i++)
+          memcpy(p_dst + 4 * i * out_channels, &p_src[i], sizeof(float));
+        break;
+      }
+    }
+  }
+}
@@ -102,6 +102,17 @@ static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_sbc = {
     nullptr  // set_transmit_queue_length
 };
 
+static const tA2DP_MULTI_ENCODER_INTERFACE a2dp_multi_encoder_interface_sbc = {
+    a2dp_sbc_multi_encoder_init,
+    a2dp_sbc_multi_encoder_cleanup,
+    a2dp_sbc_multi_encoder_session_add,
+    a2dp_sbc_multi_encoder_session_remove,
+    a2dp_sbc_multi_feeding_reset,
+    a2dp_sbc_multi_feeding_flush,
+    a2dp_sbc_get_encoder_interval_ms,
+    a2dp_sbc_multi_send_frames,
+};
+
 static const tA2DP_DECODER_INTERFACE a2dp_decoder_interface_sbc = {
     a2dp_sbc_decoder_init, a2dp_sbc_decoder_cleanup,
     a2dp_sbc_decoder_decode_packet,
@@ -785,6 +796,13 @@ const tA2DP_ENCODER_INTERFACE* A2DP_GetEncoderInterfaceSbc(
   return &a2dp_encoder_interface_sbc;
 }
 
+const tA2DP_MULTI_ENCODER_INTERFACE* A2DP_GetMultiEncoderInterfaceSbc(
+    const uint8_t* p_codec_info) {
+  if (!A2DP_IsSourceCodecValidSbc(p_codec_info)) return NULL;
+
+  return &a2dp_multi_encoder_interface_sbc;
+}
+
 const tA2DP_DECODER_INTERFACE* A2DP_GetDecoderInterfaceSbc(
     const uint8_t* p_codec_info) {
   if (!A2DP_IsSinkCodecValidSbc(p_codec_info)) return NULL;
@@ -21,13 +21,23 @@
 
 #include "a2dp_sbc_encoder.h"
 
+#include <inttypes.h>
 #include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <base/bind.h>
+
+#include "a2dp_pcm_converter.h"
 #include "a2dp_sbc.h"
-#include "a2dp_sbc_up_sample.h"
+#include "a2dp_sbc_pcm_feed.h"
 #include "bt_common.h"
+#include "common/message_loop_thread.h"
 #include "common/time_util.h"
 #include "embdrv/sbc/encoder/include/sbc_encoder.h"
 #include "osi/include/log.h"
@@ -46,6 +56,10 @@
 
 #define A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK 3
 
+// Number of encoder intervals of PCM kept by the multi-session encoder for
+// the sessions that fall behind the others.
+#define A2DP_SBC_MULTI_FEED_TICKS 8
+
 #define A2DP_SBC_MAX_HQ_FRAME_SIZE_44_1 119
 #define A2DP_SBC_MAX_HQ_FRAME_SIZE_48 115
 
@@ -68,7 +82,6 @@
 
 typedef struct {
   uint32_t aa_frame_counter;
-  int32_t aa_feed_counter;
   int32_t aa_feed_residue;
   uint32_t counter;
   uint32_t bytes_per_tick; /* pcm bytes read each media task tick */
@@ -103,25 +116,76 @@ typedef struct {
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_SBC_FEEDING_STATE feeding_state;
   int16_t pcmBuffer[SBC_MAX_PCM_BUFFER_SIZE];
+  // Converts the feeding to the PCM format of the encoder, NULL if they are
+  // the same.
+  A2dpPcmConverter* pcm_converter;
+  uint8_t read_buffer[SBC_MAX_PCM_BUFFER_SIZE * sizeof(int32_t)];
 
   a2dp_sbc_encoder_stats_t stats;
+
+  // The multi-session encoder session this encoder belongs to, or NULL.
+  struct A2dpSbcSession* session;
 } tA2DP_SBC_ENCODER_CB;
 
 static tA2DP_SBC_ENCODER_CB a2dp_sbc_encoder_cb;
 
-static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
+typedef struct {
+  BT_HDR* p_buf;
+  size_t frames_n;
+  uint32_t num_bytes;
+} tA2DP_SBC_PENDING_PACKET;
+
+struct A2dpSbcSession {
+  RawAddress peer_address;
+  const A2dpSbcPcmFeed* feed;
+  uint64_t feed_position;
+  // The packets encoded during the current interval. They are enqueued once
+  // every session is encoded, from the thread calling send_frames.
+  std::vector<tA2DP_SBC_PENDING_PACKET> packets;
+  tA2DP_SBC_ENCODER_CB cb;
+
+  ~A2dpSbcSession() { delete cb.pcm_converter; }
+};
+
+typedef struct {
+  tA2DP_FEEDING_PARAMS feeding_params;
+  tA2DP_SBC_FEEDING_STATE feeding_state;
+  a2dp_source_read_callback_t read_callback;
+  a2dp_source_enqueue_peer_callback_t enqueue_callback;
+  A2dpSbcPcmFeed feed;
+  std::vector<std::unique_ptr<A2dpSbcSession>> sessions;
+  std::vector<std::unique_ptr<bluetooth::common::MessageLoopThread>> workers;
+} tA2DP_SBC_MULTI_ENCODER_CB;
+
+static tA2DP_SBC_MULTI_ENCODER_CB* a2dp_sbc_multi_encoder_cb = nullptr;
+
+static void a2dp_sbc_encoder_update(tA2DP_SBC_ENCODER_CB* p_cb,
+                                    uint16_t peer_mtu,
                                     A2dpCodecConfig* a2dp_codec_config,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated);
-static bool a2dp_sbc_read_feeding(uint32_t* bytes);
-static void a2dp_sbc_encode_frames(uint8_t nb_frame);
-static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
+static void a2dp_sbc_reset_feeding_state(tA2DP_SBC_ENCODER_CB* p_cb);
+static void a2dp_sbc_encode_tick(tA2DP_SBC_ENCODER_CB* p_cb,
+                                 uint64_t timestamp_us);
+static bool a2dp_sbc_read_feeding(tA2DP_SBC_ENCODER_CB* p_cb,
+                                  uint32_t* bytes);
+static void a2dp_sbc_encode_frames(tA2DP_SBC_ENCODER_CB* p_cb,
+                                   uint8_t nb_frame);
+static void a2dp_sbc_get_num_frame_iteration(tA2DP_SBC_ENCODER_CB* p_cb,
+                                             uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
                                              uint64_t timestamp_us);
-static uint8_t calculate_max_frames_per_packet(void);
-static uint16_t a2dp_sbc_source_rate();
-static uint32_t a2dp_sbc_frame_length(void);
+static uint8_t calculate_max_frames_per_packet(tA2DP_SBC_ENCODER_CB* p_cb);
+static uint16_t a2dp_sbc_source_rate(tA2DP_SBC_ENCODER_CB* p_cb);
+static uint32_t a2dp_sbc_frame_length(tA2DP_SBC_ENCODER_CB* p_cb);
+static void a2dp_sbc_update_pcm_converter(tA2DP_SBC_ENCODER_CB* p_cb,
+                                          uint32_t sbc_sampling);
+static uint32_t a2dp_sbc_feeding_bytes_per_frame(tA2DP_SBC_ENCODER_CB* p_cb);
+static uint32_t a2dp_sbc_read(tA2DP_SBC_ENCODER_CB* p_cb, uint8_t* p_buf,
+                              uint32_t len);
+static bool a2dp_sbc_enqueue(tA2DP_SBC_ENCODER_CB* p_cb, BT_HDR* p_buf,
+                             size_t frames_n, uint32_t num_bytes);
 
 bool A2DP_LoadEncoderSbc(void) {
   // Nothing to do - the library is statically linked
@@ -132,40 +196,54 @@ void A2DP_UnloadEncoderSbc(void) {
   // Nothing to do - the library is statically linked
 }
 
-void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
-                           A2dpCodecConfig* a2dp_codec_config,
-                           a2dp_source_read_callback_t read_callback,
-                           a2dp_source_enqueue_callback_t enqueue_callback) {
-  memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
-
-  a2dp_sbc_encoder_cb.stats.session_start_us =
-      bluetooth::common::time_get_os_boottime_us();
-
-  a2dp_sbc_encoder_cb.read_callback = read_callback;
-  a2dp_sbc_encoder_cb.enqueue_callback = enqueue_callback;
-  a2dp_sbc_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_sbc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
-  a2dp_sbc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_sbc_encoder_cb.timestamp = 0;
+// Initializes the encoder |p_cb| for a peer. |read_callback| and
+// |enqueue_callback| are not used by the sessions of the multi-session
+// encoder, which read the shared PCM feed and enqueue their packets after
+// the encoding.
+static void a2dp_sbc_cb_init(tA2DP_SBC_ENCODER_CB* p_cb,
+                             const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+                             A2dpCodecConfig* a2dp_codec_config,
+                             a2dp_source_read_callback_t read_callback,
+                             a2dp_source_enqueue_callback_t enqueue_callback) {
+  delete p_cb->pcm_converter;
+  memset(p_cb, 0, sizeof(*p_cb));
+
+  p_cb->stats.session_start_us = bluetooth::common::time_get_os_boottime_us();
+
+  p_cb->read_callback = read_callback;
+  p_cb->enqueue_callback = enqueue_callback;
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
 
   // NOTE: Ignore the restart_input / restart_output flags - this initization
   // happens when the connection is (re)started.
   bool restart_input = false;
   bool restart_output = false;
   bool config_updated = false;
-  a2dp_sbc_encoder_update(a2dp_sbc_encoder_cb.peer_mtu, a2dp_codec_config,
+  a2dp_sbc_encoder_update(p_cb, p_cb->peer_mtu, a2dp_codec_config,
                           &restart_input, &restart_output, &config_updated);
 }
 
+void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+                           A2dpCodecConfig* a2dp_codec_config,
+                           a2dp_source_read_callback_t read_callback,
+                           a2dp_source_enqueue_callback_t enqueue_callback) {
+  a2dp_sbc_cb_init(&a2dp_sbc_encoder_cb, p_peer_params, a2dp_codec_config,
+                   read_callback, enqueue_callback);
+}
+
 bool A2dpCodecConfigSbcSource::updateEncoderUserConfig(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params, bool* p_restart_input,
     bool* p_restart_output, bool* p_config_updated) {
-  a2dp_sbc_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_sbc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
-  a2dp_sbc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_sbc_encoder_cb.timestamp = 0;
+  tA2DP_SBC_ENCODER_CB* p_cb = &a2dp_sbc_encoder_cb;
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
 
-  if (a2dp_sbc_encoder_cb.peer_mtu == 0) {
+  if (p_cb->peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
               "%s: Cannot update the codec encoder for %s: "
               "invalid peer MTU",
@@ -173,7 +251,7 @@ bool A2dpCodecConfigSbcSource::updateEncoderUserConfig(
     return false;
   }
 
-  a2dp_sbc_encoder_update(a2dp_sbc_encoder_cb.peer_mtu, this, p_restart_input,
+  a2dp_sbc_encoder_update(p_cb, p_cb->peer_mtu, this, p_restart_input,
                           p_restart_output, p_config_updated);
   return true;
 }
@@ -181,12 +259,13 @@ bool A2dpCodecConfigSbcSource::updateEncoderUserConfig(
 // Update the A2DP SBC encoder.
 // |peer_mtu| is the peer MTU.
 // |a2dp_codec_config| is the A2DP codec to use for the update.
-static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
+static void a2dp_sbc_encoder_update(tA2DP_SBC_ENCODER_CB* p_cb,
+                                    uint16_t peer_mtu,
                                     A2dpCodecConfig* a2dp_codec_config,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated) {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint8_t codec_info[AVDT_CODEC_SIZE];
   uint16_t s16SamplingFreq;
   int16_t s16BitPool = 0;
@@ -211,7 +290,7 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   max_bitpool = A2DP_GetMaxBitpoolSbc(p_codec_info);
 
   // The feeding parameters
-  tA2DP_FEEDING_PARAMS* p_feeding_params = &a2dp_sbc_encoder_cb.feeding_params;
+  tA2DP_FEEDING_PARAMS* p_feeding_params = &p_cb->feeding_params;
   p_feeding_params->sample_rate = A2DP_GetTrackSampleRateSbc(p_codec_info);
   p_feeding_params->bits_per_sample =
       a2dp_codec_config->getAudioBitsPerSample();
@@ -219,7 +298,7 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   LOG_DEBUG(LOG_TAG, "%s: sample_rate=%u bits_per_sample=%u channel_count=%u",
             __func__, p_feeding_params->sample_rate,
             p_feeding_params->bits_per_sample, p_feeding_params->channel_count);
-  a2dp_sbc_feeding_reset();
+  a2dp_sbc_reset_feeding_state(p_cb);
 
   // The codec parameters
   p_encoder_params->s16ChannelMode = A2DP_GetChannelModeCodeSbc(p_codec_info);
@@ -252,9 +331,9 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
 
   uint16_t mtu_size = A2DP_SBC_BUFFER_SIZE - A2DP_SBC_OFFSET - sizeof(BT_HDR);
   if (mtu_size < peer_mtu) {
-    a2dp_sbc_encoder_cb.TxAaMtuSize = mtu_size;
+    p_cb->TxAaMtuSize = mtu_size;
   } else {
-    a2dp_sbc_encoder_cb.TxAaMtuSize = peer_mtu;
+    p_cb->TxAaMtuSize = peer_mtu;
   }
 
   if (p_encoder_params->s16SamplingFreq == SBC_sf16000)
@@ -266,12 +345,13 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   else
     s16SamplingFreq = 48000;
 
+  a2dp_sbc_update_pcm_converter(p_cb, s16SamplingFreq);
+
   // Set the initial target bit rate
-  p_encoder_params->u16BitRate = a2dp_sbc_source_rate();
+  p_encoder_params->u16BitRate = a2dp_sbc_source_rate(p_cb);
 
   LOG_DEBUG(LOG_TAG, "%s: MTU=%d, peer_mtu=%d min_bitpool=%d max_bitpool=%d",
-            __func__, a2dp_sbc_encoder_cb.TxAaMtuSize, peer_mtu, min_bitpool,
-            max_bitpool);
+            __func__, p_cb->TxAaMtuSize, peer_mtu, min_bitpool, max_bitpool);
   LOG_DEBUG(LOG_TAG,
             "%s: ChannelMode=%d, NumOfSubBands=%d, NumOfBlocks=%d, "
             "AllocationMethod=%d, BitRate=%d, SamplingFreq=%d BitPool=%d",
@@ -367,87 +447,145 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
             p_encoder_params->u16BitRate, p_encoder_params->s16BitPool);
 
   /* Reset the SBC encoder */
-  SBC_Encoder_Init(&a2dp_sbc_encoder_cb.sbc_encoder_params);
-  a2dp_sbc_encoder_cb.tx_sbc_frames = calculate_max_frames_per_packet();
+  SBC_Encoder_Init(&p_cb->sbc_encoder_params);
+  p_cb->tx_sbc_frames = calculate_max_frames_per_packet(p_cb);
 }
 
 void a2dp_sbc_encoder_cleanup(void) {
+  delete a2dp_sbc_encoder_cb.pcm_converter;
   memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
 }
 
-void a2dp_sbc_feeding_reset(void) {
+// Converts the feeding PCM if the SBC encoder cannot take it as is: the
+// encoder takes 16 bit samples, at |sbc_sampling| Hz.
+static void a2dp_sbc_update_pcm_converter(tA2DP_SBC_ENCODER_CB* p_cb,
+                                          uint32_t sbc_sampling) {
+  const tA2DP_FEEDING_PARAMS* p_feeding_params = &p_cb->feeding_params;
+  tA2DP_PCM_CONFIG input;
+  tA2DP_PCM_CONFIG output;
+
+  delete p_cb->pcm_converter;
+  p_cb->pcm_converter = NULL;
+  p_cb->feeding_state.aa_feed_residue = 0;
+
+  input.sample_rate = p_feeding_params->sample_rate;
+  input.channel_count = p_feeding_params->channel_count;
+  if (!A2DP_GetPcmFormat(p_feeding_params->bits_per_sample, &input.format)) {
+    LOG_ERROR(LOG_TAG, "%s: unsupported feeding of %u bits per sample",
+              __func__, p_feeding_params->bits_per_sample);
+    return;
+  }
+  output.sample_rate = sbc_sampling;
+  output.format = A2dpPcmFormat::kS16;
+  output.channel_count = p_cb->sbc_encoder_params.s16NumOfChannels;
+
+  if (input.sample_rate == output.sample_rate &&
+      input.format == output.format &&
+      input.channel_count == output.channel_count)
+    return;
+
+  LOG_INFO(LOG_TAG,
+           "%s: converting the feeding from %u Hz, %u bits, %u channels "
+           "to %u Hz, 16 bits, %u channels",
+           __func__, input.sample_rate, p_feeding_params->bits_per_sample,
+           input.channel_count, output.sample_rate, output.channel_count);
+  p_cb->pcm_converter = new A2dpPcmConverter(input, output);
+}
+
+// Returns the number of feeding PCM octets encoded in each SBC frame.
+static uint32_t a2dp_sbc_feeding_bytes_per_frame(tA2DP_SBC_ENCODER_CB* p_cb) {
+  uint32_t bytes = p_cb->sbc_encoder_params.s16NumOfSubBands *
+                   p_cb->sbc_encoder_params.s16NumOfBlocks *
+                   p_cb->feeding_params.channel_count *
+                   p_cb->feeding_params.bits_per_sample / 8;
+  if (p_cb->pcm_converter != NULL) {
+    bytes = (uint64_t)bytes * p_cb->pcm_converter->input().sample_rate /
+            p_cb->pcm_converter->output().sample_rate;
+  }
+  return bytes;
+}
+
+static void a2dp_sbc_reset_feeding_state(tA2DP_SBC_ENCODER_CB* p_cb) {
   /* By default, just clear the entire state */
-  memset(&a2dp_sbc_encoder_cb.feeding_state, 0,
-         sizeof(a2dp_sbc_encoder_cb.feeding_state));
-
-  a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick =
-      (a2dp_sbc_encoder_cb.feeding_params.sample_rate *
-       a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_sbc_encoder_cb.feeding_params.channel_count *
-       A2DP_SBC_ENCODER_INTERVAL_MS) /
+  memset(&p_cb->feeding_state, 0, sizeof(p_cb->feeding_state));
+  if (p_cb->pcm_converter != NULL) p_cb->pcm_converter->Reset();
+
+  p_cb->feeding_state.bytes_per_tick =
+      (p_cb->feeding_params.sample_rate *
+       p_cb->feeding_params.bits_per_sample / 8 *
+       p_cb->feeding_params.channel_count * A2DP_SBC_ENCODER_INTERVAL_MS) /
       1000;
 
   LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick);
+            p_cb->feeding_state.bytes_per_tick);
+}
+
+void a2dp_sbc_feeding_reset(void) {
+  a2dp_sbc_reset_feeding_state(&a2dp_sbc_encoder_cb);
 }
 
 void a2dp_sbc_feeding_flush(void) {
   a2dp_sbc_encoder_cb.feeding_state.counter = 0;
   a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
+  if (a2dp_sbc_encoder_cb.pcm_converter != NULL)
+    a2dp_sbc_encoder_cb.pcm_converter->Reset();
 }
 
 uint64_t a2dp_sbc_get_encoder_interval_ms(void) {
   return A2DP_SBC_ENCODER_INTERVAL_MS;
 }
 
-void a2dp_sbc_send_frames(uint64_t timestamp_us) {
+// Encodes and enqueues the frames due at |timestamp_us|.
+static void a2dp_sbc_encode_tick(tA2DP_SBC_ENCODER_CB* p_cb,
+                                 uint64_t timestamp_us) {
   uint8_t nb_frame = 0;
   uint8_t nb_iterations = 0;
 
-  a2dp_sbc_get_num_frame_iteration(&nb_iterations, &nb_frame, timestamp_us);
+  a2dp_sbc_get_num_frame_iteration(p_cb, &nb_iterations, &nb_frame,
+                                   timestamp_us);
   LOG_VERBOSE(LOG_TAG, "%s: Sending %d frames per iteration, %d iterations",
               __func__, nb_frame, nb_iterations);
   if (nb_frame == 0) return;
 
   for (uint8_t counter = 0; counter < nb_iterations; counter++) {
     // Transcode frame and enqueue
-    a2dp_sbc_encode_frames(nb_frame);
+    a2dp_sbc_encode_frames(p_cb, nb_frame);
   }
 }
 
+void a2dp_sbc_send_frames(uint64_t timestamp_us) {
+  a2dp_sbc_encode_tick(&a2dp_sbc_encoder_cb, timestamp_us);
+}
+
 // Obtains the number of frames to send and number of iterations
 // to be used. |num_of_iterations| and |num_of_frames| parameters
 // are used as output param for returning the respective values.
-static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
+static void a2dp_sbc_get_num_frame_iteration(tA2DP_SBC_ENCODER_CB* p_cb,
+                                             uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
                                              uint64_t timestamp_us) {
   uint8_t nof = 0;
   uint8_t noi = 1;
 
   uint32_t projected_nof = 0;
-  uint32_t pcm_bytes_per_frame =
-      a2dp_sbc_encoder_cb.sbc_encoder_params.s16NumOfSubBands *
-      a2dp_sbc_encoder_cb.sbc_encoder_params.s16NumOfBlocks *
-      a2dp_sbc_encoder_cb.feeding_params.channel_count *
-      a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
+  uint32_t pcm_bytes_per_frame = a2dp_sbc_feeding_bytes_per_frame(p_cb);
   LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
               pcm_bytes_per_frame);
 
   uint32_t us_this_tick = A2DP_SBC_ENCODER_INTERVAL_MS * 1000;
   uint64_t now_us = timestamp_us;
-  if (a2dp_sbc_encoder_cb.feeding_state.last_frame_us != 0)
-    us_this_tick = (now_us - a2dp_sbc_encoder_cb.feeding_state.last_frame_us);
-  a2dp_sbc_encoder_cb.feeding_state.last_frame_us = now_us;
+  if (p_cb->feeding_state.last_frame_us != 0)
+    us_this_tick = (now_us - p_cb->feeding_state.last_frame_us);
+  p_cb->feeding_state.last_frame_us = now_us;
 
-  a2dp_sbc_encoder_cb.feeding_state.counter +=
-      a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick * us_this_tick /
+  p_cb->feeding_state.counter +=
+      p_cb->feeding_state.bytes_per_tick * us_this_tick /
       (A2DP_SBC_ENCODER_INTERVAL_MS * 1000);
 
   /* Calculate the number of frames pending for this media tick */
-  projected_nof =
-      a2dp_sbc_encoder_cb.feeding_state.counter / pcm_bytes_per_frame;
+  projected_nof = p_cb->feeding_state.counter / pcm_bytes_per_frame;
   // Update the stats
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_frames += projected_nof;
+  p_cb->stats.media_read_total_expected_frames += projected_nof;
 
   if (projected_nof > MAX_PCM_FRAME_NUM_PER_TICK) {
     LOG_WARN(LOG_TAG, "%s: limiting frames to be sent from %d to %d", __func__,
@@ -455,7 +593,7 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
 
     // Update the stats
     size_t delta = projected_nof - MAX_PCM_FRAME_NUM_PER_TICK;
-    a2dp_sbc_encoder_cb.stats.media_read_total_dropped_frames += delta;
+    p_cb->stats.media_read_total_dropped_frames += delta;
 
     projected_nof = MAX_PCM_FRAME_NUM_PER_TICK;
   }
@@ -463,14 +601,14 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
   LOG_VERBOSE(LOG_TAG, "%s: frames for available PCM data %u", __func__,
               projected_nof);
 
-  if (a2dp_sbc_encoder_cb.is_peer_edr) {
-    if (!a2dp_sbc_encoder_cb.tx_sbc_frames) {
+  if (p_cb->is_peer_edr) {
+    if (!p_cb->tx_sbc_frames) {
       LOG_ERROR(LOG_TAG, "%s: tx_sbc_frames not updated, update from here",
                 __func__);
-      a2dp_sbc_encoder_cb.tx_sbc_frames = calculate_max_frames_per_packet();
+      p_cb->tx_sbc_frames = calculate_max_frames_per_packet(p_cb);
     }
 
-    nof = a2dp_sbc_encoder_cb.tx_sbc_frames;
+    nof = p_cb->tx_sbc_frames;
     if (!nof) {
       LOG_ERROR(LOG_TAG,
                 "%s: number of frames not updated, set calculated values",
@@ -484,8 +622,7 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
           LOG_ERROR(LOG_TAG, "%s: Audio Congestion (iterations:%d > max (%d))",
                     __func__, noi, A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK);
           noi = A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK;
-          a2dp_sbc_encoder_cb.feeding_state.counter =
-              noi * nof * pcm_bytes_per_frame;
+          p_cb->feeding_state.counter = noi * nof * pcm_bytes_per_frame;
         }
         projected_nof = nof;
       } else {
@@ -504,15 +641,14 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
 
       // Update the stats
       size_t delta = projected_nof - MAX_PCM_FRAME_NUM_PER_TICK;
-      a2dp_sbc_encoder_cb.stats.media_read_total_dropped_frames += delta;
+      p_cb->stats.media_read_total_dropped_frames += delta;
 
       projected_nof = MAX_PCM_FRAME_NUM_PER_TICK;
-      a2dp_sbc_encoder_cb.feeding_state.counter =
-          noi * projected_nof * pcm_bytes_per_frame;
+      p_cb->feeding_state.counter = noi * projected_nof * pcm_bytes_per_frame;
     }
     nof = projected_nof;
   }
-  a2dp_sbc_encoder_cb.feeding_state.counter -= noi * nof * pcm_bytes_per_frame;
+  p_cb->feeding_state.counter -= noi * nof * pcm_bytes_per_frame;
   LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
               __func__, nof, noi);
 
@@ -520,8 +656,9 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
   *num_of_iterations = noi;
 }
 
-static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+static void a2dp_sbc_encode_frames(tA2DP_SBC_ENCODER_CB* p_cb,
+                                   uint8_t nb_frame) {
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint8_t remain_nb_frame = nb_frame;
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
@@ -535,19 +672,19 @@ static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
     p_buf->offset = A2DP_SBC_OFFSET;
     p_buf->len = 0;
     p_buf->layer_specific = 0;
-    a2dp_sbc_encoder_cb.stats.media_read_total_expected_packets++;
+    p_cb->stats.media_read_total_expected_packets++;
 
     do {
       /* Fill allocated buffer with 0 */
-      memset(a2dp_sbc_encoder_cb.pcmBuffer, 0,
+      memset(p_cb->pcmBuffer, 0,
              blocm_x_subband * p_encoder_params->s16NumOfChannels);
       //
-      // Read the PCM data and encode it. If necessary, upsample the data.
+      // Read the PCM data and encode it. If necessary, convert the data.
       //
       uint32_t num_bytes = 0;
-      if (a2dp_sbc_read_feeding(&num_bytes)) {
+      if (a2dp_sbc_read_feeding(p_cb, &num_bytes)) {
         uint8_t* output = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-        int16_t* input = a2dp_sbc_encoder_cb.pcmBuffer;
+        int16_t* input = p_cb->pcmBuffer;
         uint16_t output_len = SBC_Encode(p_encoder_params, input, output);
         last_frame_len = output_len;
 
@@ -559,208 +696,131 @@ static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
         bytes_read += num_bytes;
       } else {
         LOG_WARN(LOG_TAG, "%s: underflow %d, %d", __func__, nb_frame,
-                 a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
-        a2dp_sbc_encoder_cb.feeding_state.counter +=
-            nb_frame * p_encoder_params->s16NumOfSubBands *
-            p_encoder_params->s16NumOfBlocks *
-            a2dp_sbc_encoder_cb.feeding_params.channel_count *
-            a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
+                 p_cb->feeding_state.aa_feed_residue);
+        p_cb->feeding_state.counter +=
+            nb_frame * a2dp_sbc_feeding_bytes_per_frame(p_cb);
         /* no more pcm to read */
         nb_frame = 0;
       }
-    } while (
-        ((p_buf->len + last_frame_len) < a2dp_sbc_encoder_cb.TxAaMtuSize) &&
-        (p_buf->layer_specific < 0x0F) && nb_frame);
+    } while (((p_buf->len + last_frame_len) < p_cb->TxAaMtuSize) &&
+             (p_buf->layer_specific < 0x0F) && nb_frame);
 
     if (p_buf->len) {
       /*
        * Timestamp of the media packet header represent the TS of the
        * first SBC frame, i.e the timestamp before including this frame.
        */
-      *((uint32_t*)(p_buf + 1)) = a2dp_sbc_encoder_cb.timestamp;
+      *((uint32_t*)(p_buf + 1)) = p_cb->timestamp;
 
-      a2dp_sbc_encoder_cb.timestamp += p_buf->layer_specific * blocm_x_subband;
+      p_cb->timestamp += p_buf->layer_specific * blocm_x_subband;
 
       uint8_t done_nb_frame = remain_nb_frame - nb_frame;
       remain_nb_frame = nb_frame;
-      if (!a2dp_sbc_encoder_cb.enqueue_callback(p_buf, done_nb_frame,
-                                                bytes_read))
-        return;
+      if (!a2dp_sbc_enqueue(p_cb, p_buf, done_nb_frame, bytes_read)) return;
     } else {
-      a2dp_sbc_encoder_cb.stats.media_read_total_dropped_packets++;
+      p_cb->stats.media_read_total_dropped_packets++;
       osi_free(p_buf);
     }
   }
 }
 
-static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+// Reads the PCM to encode, from the read callback or from the feed of the
+// multi-session encoder.
+static uint32_t a2dp_sbc_read(tA2DP_SBC_ENCODER_CB* p_cb, uint8_t* p_buf,
+                              uint32_t len) {
+  A2dpSbcSession* session = p_cb->session;
+  if (session == nullptr) return p_cb->read_callback(p_buf, len);
+  return session->feed->Read(&session->feed_position, p_buf, len);
+}
+
+// Enqueues an encoded packet, or keeps it until every session of the
+// multi-session encoder is encoded.
+static bool a2dp_sbc_enqueue(tA2DP_SBC_ENCODER_CB* p_cb, BT_HDR* p_buf,
+                             size_t frames_n, uint32_t num_bytes) {
+  A2dpSbcSession* session = p_cb->session;
+  if (session == nullptr)
+    return p_cb->enqueue_callback(p_buf, frames_n, num_bytes);
+  session->packets.push_back({p_buf, frames_n, num_bytes});
+  return true;
+}
+
+static bool a2dp_sbc_read_feeding(tA2DP_SBC_ENCODER_CB* p_cb,
+                                  uint32_t* bytes_read) {
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
+  A2dpPcmConverter* converter = p_cb->pcm_converter;
   uint32_t read_size;
-  uint32_t sbc_sampling = 48000;
-  uint32_t src_samples;
-  uint16_t bytes_needed = blocm_x_subband * p_encoder_params->s16NumOfChannels *
-                          a2dp_sbc_encoder_cb.feeding_params.bits_per_sample /
-                          8;
-  static uint16_t up_sampled_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                                    SBC_MAX_NUM_OF_CHANNELS *
-                                    SBC_MAX_NUM_OF_SUBBANDS * 2];
-  static uint16_t read_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                              SBC_MAX_NUM_OF_CHANNELS *
-                              SBC_MAX_NUM_OF_SUBBANDS];
-  uint32_t src_size_used;
-  uint32_t dst_size_used;
-  bool fract_needed;
-  int32_t fract_max;
-  int32_t fract_threshold;
   uint32_t nb_byte_read;
 
-  /* Get the SBC sampling rate */
-  switch (p_encoder_params->s16SamplingFreq) {
-    case SBC_sf48000:
-      sbc_sampling = 48000;
-      break;
-    case SBC_sf44100:
-      sbc_sampling = 44100;
-      break;
-    case SBC_sf32000:
-      sbc_sampling = 32000;
-      break;
-    case SBC_sf16000:
-      sbc_sampling = 16000;
-      break;
-  }
-
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_reads_count++;
-  if (sbc_sampling == a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
-    read_size =
-        bytes_needed - a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
-    a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
-    nb_byte_read = a2dp_sbc_encoder_cb.read_callback(
-        ((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer) +
-            a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
+  p_cb->stats.media_read_total_expected_reads_count++;
+  if (converter == NULL) {
+    uint16_t bytes_needed = blocm_x_subband *
+                            p_encoder_params->s16NumOfChannels *
+                            p_cb->feeding_params.bits_per_sample / 8;
+    read_size = bytes_needed - p_cb->feeding_state.aa_feed_residue;
+    p_cb->stats.media_read_total_expected_read_bytes += read_size;
+    nb_byte_read = a2dp_sbc_read(
+        p_cb,
+        ((uint8_t*)p_cb->pcmBuffer) + p_cb->feeding_state.aa_feed_residue,
         read_size);
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes +=
-        nb_byte_read;
+    p_cb->stats.media_read_total_actual_read_bytes += nb_byte_read;
 
     *bytes_read = nb_byte_read;
     if (nb_byte_read != read_size) {
-      a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += nb_byte_read;
+      p_cb->feeding_state.aa_feed_residue += nb_byte_read;
       return false;
     }
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
-    a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
+    p_cb->stats.media_read_total_actual_reads_count++;
+    p_cb->feeding_state.aa_feed_residue = 0;
     return true;
   }
 
   /*
-   * Some Feeding PCM frequencies require to split the number of sample
-   * to read.
-   * E.g 128 / 6 = 21.3333 => read 22 and 21 and 21 => max = 2; threshold = 0
+   * Feed the converter until it can produce a whole SBC frame. What was read
+   * stays buffered in the converter if the feeding runs short, and the bytes
+   * of a partial input frame are kept at the start of the read buffer, in
+   * aa_feed_residue, until the rest of the frame is read.
    */
-  fract_needed = false; /* Default */
-  switch (a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
-    case 32000:
-    case 8000:
-      fract_needed = true;
-      fract_max = 2;       /* 0, 1 and 2 */
-      fract_threshold = 0; /* Add one for the first */
-      break;
-    case 16000:
-      fract_needed = true;
-      fract_max = 2;       /* 0, 1 and 2 */
-      fract_threshold = 1; /* Add one for the first two frames*/
-      break;
-  }
-
-  /* Compute number of sample to read from source */
-  src_samples = blocm_x_subband;
-  src_samples *= a2dp_sbc_encoder_cb.feeding_params.sample_rate;
-  src_samples /= sbc_sampling;
-
-  /* The previous division may have a remainder not null */
-  if (fract_needed) {
-    if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter <= fract_threshold) {
-      src_samples++; /* for every read before threshold add one sample */
-    }
-
-    /* do nothing if counter >= threshold */
-    a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter++; /* one more read */
-    if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter > fract_max) {
-      a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter = 0;
-    }
-  }
-
-  /* Compute number of bytes to read from source */
-  read_size = src_samples;
-  read_size *= a2dp_sbc_encoder_cb.feeding_params.channel_count;
-  read_size *= (a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8);
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
-
-  /* Read Data from UIPC channel */
-  nb_byte_read =
-      a2dp_sbc_encoder_cb.read_callback((uint8_t*)read_buffer, read_size);
-  a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
-
-  if (nb_byte_read < read_size) {
-    if (nb_byte_read == 0) return false;
-
-    /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
-    nb_byte_read = read_size;
-  }
-  a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
-
-  /* Initialize PCM up-sampling engine */
-  a2dp_sbc_init_up_sample(a2dp_sbc_encoder_cb.feeding_params.sample_rate,
-                          sbc_sampling,
-                          a2dp_sbc_encoder_cb.feeding_params.bits_per_sample,
-                          a2dp_sbc_encoder_cb.feeding_params.channel_count);
-
-  /*
-   * Re-sample the read buffer.
-   * The output PCM buffer will be stereo, 16 bit per sample.
-   */
-  dst_size_used = a2dp_sbc_up_sample(
-      (uint8_t*)read_buffer,
-      (uint8_t*)up_sampled_buffer +
-          a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      nb_byte_read, sizeof(up_sampled_buffer) -
-                        a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      &src_size_used);
-
-  /* update the residue */
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += dst_size_used;
-
-  /* only copy the pcm sample when we have up-sampled enough PCM */
-  if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue < bytes_needed)
-    return false;
-
-  /* Copy the output pcm samples in SBC encoding buffer */
-  memcpy((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer, (uint8_t*)up_sampled_buffer,
-         bytes_needed);
-  /* update the residue */
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue -= bytes_needed;
-
-  if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue != 0) {
-    memcpy((uint8_t*)up_sampled_buffer,
-           (uint8_t*)up_sampled_buffer + bytes_needed,
-           a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
+  size_t input_frame_size = converter->input_frame_size();
+  *bytes_read = 0;
+  while (true) {
+    size_t input_frames =
+        std::min(converter->InputFramesFor(blocm_x_subband),
+                 sizeof(p_cb->read_buffer) / input_frame_size);
+    if (input_frames == 0) break;
+
+    size_t residue = p_cb->feeding_state.aa_feed_residue;
+    read_size = input_frames * input_frame_size - residue;
+    p_cb->stats.media_read_total_expected_read_bytes += read_size;
+    nb_byte_read =
+        a2dp_sbc_read(p_cb, p_cb->read_buffer + residue, read_size);
+    p_cb->stats.media_read_total_actual_read_bytes += nb_byte_read;
+    *bytes_read += nb_byte_read;
+
+    size_t available = residue + nb_byte_read;
+    size_t converted = available - available % input_frame_size;
+    converter->Convert(p_cb->read_buffer, converted / input_frame_size, NULL,
+                       0);
+    p_cb->feeding_state.aa_feed_residue = available - converted;
+    memmove(p_cb->read_buffer, p_cb->read_buffer + converted,
+            available - converted);
+    if (nb_byte_read != read_size) return false;
   }
+  converter->Convert(NULL, 0, p_cb->pcmBuffer, blocm_x_subband);
+  p_cb->stats.media_read_total_actual_reads_count++;
   return true;
 }
 
-static uint8_t calculate_max_frames_per_packet(void) {
-  uint16_t effective_mtu_size = a2dp_sbc_encoder_cb.TxAaMtuSize;
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+static uint8_t calculate_max_frames_per_packet(tA2DP_SBC_ENCODER_CB* p_cb) {
+  uint16_t effective_mtu_size = p_cb->TxAaMtuSize;
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint16_t result = 0;
   uint32_t frame_len;
 
   LOG_VERBOSE(LOG_TAG, "%s: original AVDTP MTU size: %d", __func__,
-              a2dp_sbc_encoder_cb.TxAaMtuSize);
-  if (a2dp_sbc_encoder_cb.is_peer_edr &&
-      !a2dp_sbc_encoder_cb.peer_supports_3mbps) {
+              p_cb->TxAaMtuSize);
+  if (p_cb->is_peer_edr && !p_cb->peer_supports_3mbps) {
     // This condition would be satisfied only if the remote device is
     // EDR and supports only 2 Mbps, but the effective AVDTP MTU size
     // exceeds the 2DH5 packet size.
@@ -772,7 +832,7 @@ static uint8_t calculate_max_frames_per_packet(void) {
       LOG_WARN(LOG_TAG, "%s: Restricting AVDTP MTU size to %d", __func__,
                MAX_2MBPS_AVDTP_MTU);
       effective_mtu_size = MAX_2MBPS_AVDTP_MTU;
-      a2dp_sbc_encoder_cb.TxAaMtuSize = effective_mtu_size;
+      p_cb->TxAaMtuSize = effective_mtu_size;
     }
   }
 
@@ -792,7 +852,7 @@ static uint8_t calculate_max_frames_per_packet(void) {
     p_encoder_params->s16NumOfChannels = SBC_MAX_NUM_OF_CHANNELS;
   }
 
-  frame_len = a2dp_sbc_frame_length();
+  frame_len = a2dp_sbc_frame_length(p_cb);
 
   LOG_VERBOSE(LOG_TAG, "%s: Effective Tx MTU to be considered: %d", __func__,
               effective_mtu_size);
@@ -829,11 +889,11 @@ static uint8_t calculate_max_frames_per_packet(void) {
   return result;
 }
 
-static uint16_t a2dp_sbc_source_rate() {
+static uint16_t a2dp_sbc_source_rate(tA2DP_SBC_ENCODER_CB* p_cb) {
   uint16_t rate = A2DP_SBC_DEFAULT_BITRATE;
 
   /* restrict bitrate if a2dp link is non-edr */
-  if (!a2dp_sbc_encoder_cb.is_peer_edr) {
+  if (!p_cb->is_peer_edr) {
     rate = A2DP_SBC_NON_EDR_MAX_RATE;
     LOG_VERBOSE(LOG_TAG, "%s: non-edr a2dp sink detected, restrict rate to %d",
                 __func__, rate);
@@ -842,8 +902,8 @@ static uint16_t a2dp_sbc_source_rate() {
   return rate;
 }
 
-static uint32_t a2dp_sbc_frame_length(void) {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+static uint32_t a2dp_sbc_frame_length(tA2DP_SBC_ENCODER_CB* p_cb) {
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint32_t frame_len = 0;
 
   LOG_VERBOSE(LOG_TAG,
@@ -906,6 +966,198 @@ uint32_t a2dp_sbc_get_bitrate() {
   return p_encoder_params->u16BitRate * 1000;
 }
 
+void a2dp_sbc_multi_encoder_init(
+    const tA2DP_FEEDING_PARAMS* p_feeding_params,
+    a2dp_source_read_callback_t read_callback,
+    a2dp_source_enqueue_peer_callback_t enqueue_callback, size_t num_workers) {
+  a2dp_sbc_multi_encoder_cleanup();
+
+  tA2DP_SBC_MULTI_ENCODER_CB* p_multi = new tA2DP_SBC_MULTI_ENCODER_CB();
+  p_multi->feeding_params = *p_feeding_params;
+  p_multi->read_callback = read_callback;
+  p_multi->enqueue_callback = enqueue_callback;
+  a2dp_sbc_multi_encoder_cb = p_multi;
+  a2dp_sbc_multi_feeding_reset();
+
+  for (size_t i = 0; i < num_workers; i++) {
+    auto worker = std::make_unique<bluetooth::common::MessageLoopThread>(
+        "bt_a2dp_sbc_encoder_" + std::to_string(i));
+    worker->StartUp();
+    if (!worker->IsRunning()) {
+      LOG_ERROR(LOG_TAG, "%s: unable to start encoder worker %zu", __func__,
+                i);
+      break;
+    }
+    p_multi->workers.push_back(std::move(worker));
+  }
+}
+
+void a2dp_sbc_multi_encoder_cleanup(void) {
+  tA2DP_SBC_MULTI_ENCODER_CB* p_multi = a2dp_sbc_multi_encoder_cb;
+  if (p_multi == nullptr) return;
+
+  for (auto& worker : p_multi->workers) worker->ShutDown();
+  for (auto& session : p_multi->sessions) {
+    for (auto& packet : session->packets) osi_free(packet.p_buf);
+  }
+  a2dp_sbc_multi_encoder_cb = nullptr;
+  delete p_multi;
+}
+
+bool a2dp_sbc_multi_encoder_session_add(
+    const RawAddress& peer_address,
+    const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+    A2dpCodecConfig* a2dp_codec_config) {
+  tA2DP_SBC_MULTI_ENCODER_CB* p_multi = a2dp_sbc_multi_encoder_cb;
+  if (p_multi == nullptr) {
+    LOG_ERROR(LOG_TAG, "%s: encoder not initialized", __func__);
+    return false;
+  }
+
+  auto session = std::make_unique<A2dpSbcSession>();
+  session->peer_address = peer_address;
+  session->feed = &p_multi->feed;
+  session->feed_position = p_multi->feed.write_position();
+  a2dp_sbc_cb_init(&session->cb, p_peer_params, a2dp_codec_config, nullptr,
+                   nullptr);
+  session->cb.session = session.get();
+
+  // The sessions encode the same PCM, so they cannot resample it.
+  const tA2DP_FEEDING_PARAMS& feeding_params = session->cb.feeding_params;
+  if (feeding_params.sample_rate != p_multi->feeding_params.sample_rate ||
+      feeding_params.bits_per_sample !=
+          p_multi->feeding_params.bits_per_sample ||
+      feeding_params.channel_count != p_multi->feeding_params.channel_count) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot encode for %s: feeding %u/%u/%u instead of %u/%u/%u",
+              __func__, peer_address.ToString().c_str(),
+              feeding_params.sample_rate, feeding_params.bits_per_sample,
+              feeding_params.channel_count,
+              p_multi->feeding_params.sample_rate,
+              p_multi->feeding_params.bits_per_sample,
+              p_multi->feeding_params.channel_count);
+    return false;
+  }
+
+  a2dp_sbc_multi_encoder_session_remove(peer_address);
+  p_multi->sessions.push_back(std::move(session));
+  return true;
+}
+
+void a2dp_sbc_multi_encoder_session_remove(const RawAddress& peer_address) {
+  tA2DP_SBC_MULTI_ENCODER_CB* p_multi = a2dp_sbc_multi_encoder_cb;
+  if (p_multi == nullptr) return;
+
+  auto& sessions = p_multi->sessions;
+  for (auto it = sessions.begin(); it != sessions.end(); ++it) {
+    if ((*it)->peer_address != peer_address) continue;
+    for (auto& packet : (*it)->packets) osi_free(packet.p_buf);
+    sessions.erase(it);
+    return;
+  }
+}
+
+void a2dp_sbc_multi_feeding_reset(void) {
+  tA2DP_SBC_MULTI_ENCODER_CB* p_multi = a2dp_sbc_multi_encoder_cb;
+  if (p_multi == nullptr) return;
+
+  memset(&p_multi->feeding_state, 0, sizeof(p_multi->feeding_state));
+  p_multi->feeding_state.bytes_per_tick =
+      (p_multi->feeding_params.sample_rate *
+       p_multi->feeding_params.bits_per_sample / 8 *
+       p_multi->feeding_params.channel_count * A2DP_SBC_ENCODER_INTERVAL_MS) /
+      1000;
+  p_multi->feed.Reset(std::max<size_t>(
+      1, p_multi->feeding_state.bytes_per_tick * A2DP_SBC_MULTI_FEED_TICKS));
+
+  for (auto& session : p_multi->sessions) {
+    a2dp_sbc_reset_feeding_state(&session->cb);
+    session->feed_position = 0;
+  }
+}
+
+void a2dp_sbc_multi_feeding_flush(void) {
+  tA2DP_SBC_MULTI_ENCODER_CB* p_multi = a2dp_sbc_multi_encoder_cb;
+  if (p_multi == nullptr) return;
+
+  p_multi->feeding_state.counter = 0;
+  for (auto& session : p_multi->sessions) {
+    session->cb.feeding_state.counter = 0;
+    session->cb.feeding_state.aa_feed_residue = 0;
+    if (session->cb.pcm_converter != nullptr)
+      session->cb.pcm_converter->Reset();
+    session->feed_position = p_multi->feed.write_position();
+  }
+}
+
+// Encodes the sessions |first|, |first| + |stride|, ... of |p_multi|.
+static void a2dp_sbc_multi_encode_sessions(tA2DP_SBC_MULTI_ENCODER_CB* p_multi,
+                                           size_t first, size_t stride,
+                                           uint64_t timestamp_us,
+                                           std::promise<void>* p_done) {
+  for (size_t i = first; i < p_multi->sessions.size(); i += stride)
+    a2dp_sbc_encode_tick(&p_multi->sessions[i]->cb, timestamp_us);
+  if (p_done != nullptr) p_done->set_value();
+}
+
+void a2dp_sbc_multi_send_frames(uint64_t timestamp_us) {
+  tA2DP_SBC_MULTI_ENCODER_CB* p_multi = a2dp_sbc_multi_encoder_cb;
+  if (p_multi == nullptr) return;
+
+  // Read the PCM of this interval once, at the rate the sessions consume it,
+  // in whole PCM frames.
+  tA2DP_SBC_FEEDING_STATE* p_state = &p_multi->feeding_state;
+  uint32_t us_this_tick = A2DP_SBC_ENCODER_INTERVAL_MS * 1000;
+  if (p_state->last_frame_us != 0)
+    us_this_tick = (timestamp_us - p_state->last_frame_us);
+  p_state->last_frame_us = timestamp_us;
+  p_state->counter += p_state->bytes_per_tick * us_this_tick /
+                      (A2DP_SBC_ENCODER_INTERVAL_MS * 1000);
+  uint32_t pcm_frame_size = std::max<uint32_t>(
+      1, p_multi->feeding_params.bits_per_sample / 8 *
+             p_multi->feeding_params.channel_count);
+  uint64_t position = p_multi->feed.write_position();
+  p_multi->feed.Fill(p_multi->read_callback,
+                     p_state->counter - p_state->counter % pcm_frame_size);
+  p_state->counter -= p_multi->feed.write_position() - position;
+
+  // Encode the sessions, spread over the workers.
+  size_t num_workers =
+      std::min(p_multi->workers.size(), p_multi->sessions.size());
+  if (num_workers <= 1) {
+    a2dp_sbc_multi_encode_sessions(p_multi, 0, 1, timestamp_us, nullptr);
+  } else {
+    std::vector<std::promise<void>> done(num_workers);
+    for (size_t i = 0; i < num_workers; i++) {
+      if (!p_multi->workers[i]->DoInThread(
+              FROM_HERE, base::BindOnce(&a2dp_sbc_multi_encode_sessions,
+                                        p_multi, i, num_workers, timestamp_us,
+                                        &done[i]))) {
+        a2dp_sbc_multi_encode_sessions(p_multi, i, num_workers, timestamp_us,
+                                       &done[i]);
+      }
+    }
+    for (auto& promise : done) promise.get_future().wait();
+  }
+
+  // Enqueue the packets in session order. Once a peer refuses a packet, the
+  // rest of its packets for this interval are dropped.
+  for (auto& session : p_multi->sessions) {
+    bool enqueued = true;
+    for (auto& packet : session->packets) {
+      if (enqueued) {
+        enqueued = p_multi->enqueue_callback(session->peer_address,
+                                             packet.p_buf, packet.frames_n,
+                                             packet.num_bytes);
+      } else {
+        session->cb.stats.media_read_total_dropped_packets++;
+        osi_free(packet.p_buf);
+      }
+    }
+    session->packets.clear();
+  }
+}
+
 uint64_t A2dpCodecConfigSbcSource::encoderIntervalMs() const {
   return a2dp_sbc_get_encoder_interval_ms();
 }
@@ -0,0 +1,66 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "a2dp_sbc_pcm_feed"
+
+#include "a2dp_sbc_pcm_feed.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "osi/include/log.h"
+
+void A2dpSbcPcmFeed::Reset(size_t capacity) {
+  ring_.assign(capacity, 0);
+  write_position_ = 0;
+}
+
+void A2dpSbcPcmFeed::Fill(a2dp_source_read_callback_t read_callback,
+                          uint32_t len) {
+  while (len > 0) {
+    size_t offset = write_position_ % ring_.size();
+    uint32_t chunk = std::min<size_t>(len, ring_.size() - offset);
+    uint32_t nb_byte_read = read_callback(&ring_[offset], chunk);
+    write_position_ += nb_byte_read;
+    len -= nb_byte_read;
+    if (nb_byte_read < chunk) break;
+  }
+}
+
+uint32_t A2dpSbcPcmFeed::Read(uint64_t* position, uint8_t* p_buf,
+                              uint32_t len) const {
+  uint64_t oldest =
+      write_position_ > ring_.size() ? write_position_ - ring_.size() : 0;
+  if (*position < oldest) {
+    LOG_WARN(LOG_TAG, "%s: session fell behind, dropping %" PRIu64 " octets",
+             __func__, oldest - *position);
+    *position = oldest;
+  }
+
+  uint32_t copied = std::min<uint64_t>(len, write_position_ - *position);
+  for (uint32_t done = 0; done < copied;) {
+    size_t offset = (*position + done) % ring_.size();
+    size_t chunk = std::min<size_t>(copied - done, ring_.size() - offset);
+    memcpy(p_buf + done, &ring_[offset], chunk);
+    done += chunk;
+  }
+  *position += copied;
+  return copied;
+}
@@ -25,16 +25,26 @@
 #include <base/bind.h>
 #include <string.h>
 
+#include <vector>
+
 #include "bt_types.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "gap_api.h"
 #include "hcimsgs.h"
 
 #include "btm_ble_int.h"
+#include "stack/btm/btm_ble_rpa_resolver.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
+/* IRKs of the security records, in the order of btm_cb.sec_dev_rec, and the
+ * records they belong to. Rebuilt on the first resolution after a change. */
+static BleRpaResolver rpa_resolver;
+static std::vector<tBTM_SEC_DEV_REC*> rpa_resolver_dev_recs;
+static bool rpa_resolver_valid = false;
+
 /* This function generates Resolvable Private Address (RPA) from Identity
  * Resolving Key |irk| and |random|*/
 RawAddress generate_rpa_from_irk_and_rand(const Octet16& irk,
@@ -162,6 +172,7 @@ bool btm_ble_init_pseudo_addr(tBTM_SEC_DEV_REC* p_dev_rec,
                               const RawAddress& new_pseudo_addr) {
   if (p_dev_rec->ble.pseudo_addr.IsEmpty()) {
     p_dev_rec->ble.pseudo_addr = new_pseudo_addr;
+    btm_sec_dev_rec_keys_changed(p_dev_rec);
     return true;
   }
 
@@ -211,30 +222,37 @@ bool btm_ble_addr_resolvable(const RawAddress& rpa,
   return false;
 }
 
-/** This function match the random address to the appointed device record,
- * starting from calculating IRK. If the record index exceeds the maximum record
- * number, matching failed and send a callback. */
-static bool btm_ble_match_random_bda(void* data, void* context) {
-  BTM_TRACE_EVENT("%s next iteration", __func__);
-  RawAddress* random_bda = (RawAddress*)context;
-
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-
-  BTM_TRACE_DEBUG("sec_flags = %02x device_type = %d", p_dev_rec->sec_flags,
-                  p_dev_rec->device_type);
+/** This function is called when the IRK of a security record changes, or a
+ * record is removed. */
+void btm_ble_rpa_resolver_invalidate(void) {
+  rpa_resolver_valid = false;
+  rpa_resolver.Clear();
+  rpa_resolver_dev_recs.clear();
+}
 
-  if (!(p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) ||
-      !(p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
-    return true;
+static void btm_ble_rpa_resolver_update(void) {
+  if (rpa_resolver_valid) return;
 
-  if (rpa_matches_irk(*random_bda, p_dev_rec->ble.keys.irk)) {
-    BTM_TRACE_EVENT("match is found");
-    // if it was match, finish iteration, otherwise continue
-    return false;
+  rpa_resolver.Clear();
+  rpa_resolver_dev_recs.clear();
+  list_node_t* end = list_end(btm_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+       node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_dev_rec =
+        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+    if (!(p_dev_rec->ble.key_type & BTM_LE_KEY_PID)) continue;
+    rpa_resolver.AddIrk(p_dev_rec->ble.keys.irk);
+    rpa_resolver_dev_recs.push_back(p_dev_rec);
   }
+  rpa_resolver_valid = true;
+  BTM_TRACE_DEBUG("%s: %zu IRKs", __func__, rpa_resolver.size());
+}
 
-  // not a match, continue iteration
-  return true;
+/** Returns true if the random address can be resolved with the IRK of the
+ * record. The device type may change without changing the IRK. */
+static bool btm_ble_rpa_resolver_accepts(tBTM_SEC_DEV_REC* p_dev_rec) {
+  return (p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+         (p_dev_rec->ble.key_type & BTM_LE_KEY_PID);
 }
 
 /** This function is called to resolve a random address.
@@ -244,13 +262,23 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   BTM_TRACE_EVENT("%s", __func__);
 
-  /* start to resolve random address */
-  /* check for next security record */
+  btm_ble_rpa_resolver_update();
+
+  /* the cache keeps the first IRK matching, whatever the state of its record */
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  int index;
+  if (!rpa_resolver.LookUp(random_bda, now_ms, &index)) {
+    index = rpa_resolver.FindIrk(random_bda);
+    rpa_resolver.Remember(random_bda, index, now_ms);
+  }
+  while (index != BleRpaResolver::kNoMatch &&
+         !btm_ble_rpa_resolver_accepts(rpa_resolver_dev_recs[index])) {
+    index = rpa_resolver.FindIrk(random_bda, index + 1);
+  }
 
-  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, btm_ble_match_random_bda,
-                                (void*)&random_bda);
   tBTM_SEC_DEV_REC* p_dev_rec = nullptr;
-  if (n != nullptr) p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (index != BleRpaResolver::kNoMatch)
+    p_dev_rec = rpa_resolver_dev_recs[index];
 
   BTM_TRACE_EVENT("%s:  %sresolved", __func__,
                   (p_dev_rec == nullptr ? "not " : ""));
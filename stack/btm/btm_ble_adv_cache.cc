@@ -0,0 +1,135 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/btm/btm_ble_adv_cache.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <base/logging.h>
+
+BleAdvertisingCache::BleAdvertisingCache(size_t capacity, uint64_t timeout_ms)
+    : capacity_(capacity), timeout_ms_(timeout_ms), stats_() {
+  CHECK(capacity_ > 0);
+  map_.reserve(capacity_);
+}
+
+const std::vector<uint8_t>& BleAdvertisingCache::Set(uint8_t addr_type,
+                                                     const RawAddress& addr,
+                                                     uint8_t sid,
+                                                     const uint8_t* data,
+                                                     size_t len,
+                                                     uint64_t now_ms) {
+  auto it = Get(Key(addr_type, addr, sid), now_ms);
+  if (it->packets != 0) {
+    /* The scan response, or the rest of the chain, never came */
+    stats_.incomplete_chains++;
+    it->data.clear();
+    it->packets = 0;
+    it->first_ms = now_ms;
+  }
+  it->data.assign(data, data + len);
+  it->packets++;
+  return it->data;
+}
+
+const std::vector<uint8_t>& BleAdvertisingCache::Append(uint8_t addr_type,
+                                                        const RawAddress& addr,
+                                                        uint8_t sid,
+                                                        const uint8_t* data,
+                                                        size_t len,
+                                                        uint64_t now_ms) {
+  auto it = Get(Key(addr_type, addr, sid), now_ms);
+  it->data.insert(it->data.end(), data, data + len);
+  it->packets++;
+  return it->data;
+}
+
+void BleAdvertisingCache::Clear(uint8_t addr_type, const RawAddress& addr,
+                                uint8_t sid, uint64_t now_ms) {
+  auto map_it = map_.find(Key(addr_type, addr, sid));
+  if (map_it == map_.end()) return;
+
+  auto it = map_it->second;
+  if (it->packets > 1) {
+    uint64_t latency_ms = now_ms - it->first_ms;
+    stats_.completed_chains++;
+    stats_.completion_latency_total_ms += latency_ms;
+    stats_.completion_latency_max_ms =
+        std::max(stats_.completion_latency_max_ms, latency_ms);
+  }
+  map_.erase(map_it);
+  Recycle(it);
+}
+
+uint64_t BleAdvertisingCache::Key(uint8_t addr_type, const RawAddress& addr,
+                                  uint8_t sid) {
+  uint64_t key = 0;
+  memcpy(&key, addr.address, sizeof(addr.address));
+  return key | (uint64_t)addr_type << 48 | (uint64_t)sid << 56;
+}
+
+BleAdvertisingCache::ItemList::iterator BleAdvertisingCache::Get(
+    uint64_t key, uint64_t now_ms) {
+  Expire(now_ms);
+
+  auto map_it = map_.find(key);
+  if (map_it != map_.end()) {
+    auto it = map_it->second;
+    it->last_ms = now_ms;
+    items_.splice(items_.begin(), items_, it);
+    return it;
+  }
+
+  if (map_.size() == capacity_) {
+    auto oldest = std::prev(items_.end());
+    stats_.evictions++;
+    stats_.incomplete_chains++;
+    map_.erase(oldest->key);
+    Recycle(oldest);
+  }
+
+  if (free_.empty()) {
+    items_.emplace_front();
+  } else {
+    items_.splice(items_.begin(), free_, free_.begin());
+  }
+  auto it = items_.begin();
+  it->key = key;
+  it->first_ms = now_ms;
+  it->last_ms = now_ms;
+  it->packets = 0;
+  map_[key] = it;
+  return it;
+}
+
+void BleAdvertisingCache::Expire(uint64_t now_ms) {
+  while (!items_.empty() && now_ms - items_.back().last_ms > timeout_ms_) {
+    auto oldest = std::prev(items_.end());
+    stats_.expirations++;
+    stats_.incomplete_chains++;
+    map_.erase(oldest->key);
+    Recycle(oldest);
+  }
+}
+
+void BleAdvertisingCache::Recycle(ItemList::iterator it) {
+  it->data.clear();
+  free_.splice(free_.begin(), items_, it);
+}
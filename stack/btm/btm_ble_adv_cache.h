@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BTM_BLE_ADV_CACHE_H
+#define BTM_BLE_ADV_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "types/raw_address.h"
+
+/* Advertising data of the devices waiting for a scan response, or for the
+ * chained packets on the secondary channel.
+ *
+ * The devices are keyed by address type, address and advertising SID. The
+ * least recently updated one is evicted when the cache is full, and the
+ * devices not updated for the timeout are dropped. The entries, and their
+ * data buffers, are recycled.
+ */
+class BleAdvertisingCache {
+ public:
+  struct Stats {
+    /* Devices dropped to make room for another one */
+    uint64_t evictions;
+    /* Devices dropped after the timeout */
+    uint64_t expirations;
+    /* Data dropped before being complete: evicted, expired, or restarted */
+    uint64_t incomplete_chains;
+    /* Data of more than one packet completed, and the time it took */
+    uint64_t completed_chains;
+    uint64_t completion_latency_total_ms;
+    uint64_t completion_latency_max_ms;
+  };
+
+  BleAdvertisingCache(size_t capacity, uint64_t timeout_ms);
+
+  /* Sets the data to the |len| bytes at |data| for device
+   * |addr_type, addr, sid|, received at |now_ms| */
+  const std::vector<uint8_t>& Set(uint8_t addr_type, const RawAddress& addr,
+                                  uint8_t sid, const uint8_t* data, size_t len,
+                                  uint64_t now_ms);
+
+  /* Appends the |len| bytes at |data| for device |addr_type, addr, sid| */
+  const std::vector<uint8_t>& Append(uint8_t addr_type, const RawAddress& addr,
+                                     uint8_t sid, const uint8_t* data,
+                                     size_t len, uint64_t now_ms);
+
+  /* Clears the data for device |addr_type, addr, sid|, once reported at
+   * |now_ms| */
+  void Clear(uint8_t addr_type, const RawAddress& addr, uint8_t sid,
+             uint64_t now_ms);
+
+  size_t size() const { return map_.size(); }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Item {
+    uint64_t key;
+    uint64_t first_ms;
+    uint64_t last_ms;
+    size_t packets;
+    std::vector<uint8_t> data;
+  };
+
+  using ItemList = std::list<Item>;
+
+  static uint64_t Key(uint8_t addr_type, const RawAddress& addr, uint8_t sid);
+
+  /* Returns the item of |key|, moved to the front, or a new empty one */
+  ItemList::iterator Get(uint64_t key, uint64_t now_ms);
+  void Expire(uint64_t now_ms);
+  void Recycle(ItemList::iterator it);
+
+  size_t capacity_;
+  uint64_t timeout_ms_;
+  /* Most recently updated first */
+  ItemList items_;
+  /* Unused items, with the capacity of their buffers kept */
+  ItemList free_;
+  std::unordered_map<uint64_t, ItemList::iterator> map_;
+  Stats stats_;
+};
+
+#endif  // BTM_BLE_ADV_CACHE_H
@@ -30,12 +30,12 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
-#include <list>
 #include <vector>
 
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
+#include "common/time_util.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
@@ -65,80 +65,17 @@
 
 namespace {
 
-class AdvertisingCache {
- public:
-  /* Set the data to |data| for device |addr_type, addr| */
-  const std::vector<uint8_t>& Set(uint8_t addr_type, const RawAddress& addr,
-                                  std::vector<uint8_t> data) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      it->data = std::move(data);
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
-    }
-
-    items.emplace_front(addr_type, addr, std::move(data));
-    return items.front().data;
-  }
-
-  /* Append |data| for device |addr_type, addr| */
-  const std::vector<uint8_t>& Append(uint8_t addr_type, const RawAddress& addr,
-                                     std::vector<uint8_t> data) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      it->data.insert(it->data.end(), data.begin(), data.end());
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
-    }
-
-    items.emplace_front(addr_type, addr, std::move(data));
-    return items.front().data;
-  }
-
-  /* Clear data for device |addr_type, addr| */
-  void Clear(uint8_t addr_type, const RawAddress& addr) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      items.erase(it);
-    }
-  }
-
- private:
-  struct Item {
-    uint8_t addr_type;
-    RawAddress addr;
-    std::vector<uint8_t> data;
-
-    Item(uint8_t addr_type, const RawAddress& addr, std::vector<uint8_t> data)
-        : addr_type(addr_type), addr(addr), data(data) {}
-  };
-
-  std::list<Item>::iterator Find(uint8_t addr_type, const RawAddress& addr) {
-    for (auto it = items.begin(); it != items.end(); it++) {
-      if (it->addr_type == addr_type && it->addr == addr) {
-        return it;
-      }
-    }
-    return items.end();
-  }
-
-  /* we keep maximum 7 devices in the cache */
-  const size_t cache_max = 7;
-  std::list<Item> items;
-};
-
 /* Devices in this cache are waiting for eiter scan response, or chained packets
  * on secondary channel */
-AdvertisingCache cache;
+BleAdvertisingCache cache(BTM_BLE_ADV_CACHE_SIZE,
+                          BTM_BLE_ADV_CACHE_TIMEOUT_MS);
 
 }  // namespace
 
+const BleAdvertisingCache::Stats& btm_ble_adv_cache_stats(void) {
+  return cache.stats();
+}
+
 #if (BLE_VND_INCLUDED == TRUE)
 static tBTM_BLE_CTRL_FEATURES_CBACK* p_ctrl_le_feature_rd_cmpl_cback = NULL;
 #endif
@@ -1912,24 +1849,24 @@ static void btm_ble_process_adv_pkt_cont(
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
   bool update = true;
 
-  std::vector<uint8_t> tmp;
-  if (data_len != 0) tmp.insert(tmp.begin(), data, data + data_len);
-
   bool is_scannable = ble_evt_type_is_scannable(evt_type);
   bool is_scan_resp = ble_evt_type_is_scan_resp(evt_type);
 
   bool is_start =
       ble_evt_type_is_legacy(evt_type) && is_scannable && !is_scan_resp;
 
+  size_t len = data_len;
   if (ble_evt_type_is_legacy(evt_type))
-    AdvertiseDataParser::RemoveTrailingZeros(tmp);
+    len = AdvertiseDataParser::LengthWithoutTrailingZeros(data, data_len);
 
   // We might have send scan request to this device before, but didn't get the
   // response. In such case make sure data is put at start, not appended to
   // already existing data.
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
   std::vector<uint8_t> const& adv_data =
-      is_start ? cache.Set(addr_type, bda, std::move(tmp))
-               : cache.Append(addr_type, bda, std::move(tmp));
+      is_start
+          ? cache.Set(addr_type, bda, advertising_sid, data, len, now_ms)
+          : cache.Append(addr_type, bda, advertising_sid, data, len, now_ms);
 
   bool data_complete = (ble_evt_type_data_status(evt_type) != 0x01);
 
@@ -1990,7 +1927,7 @@ static void btm_ble_process_adv_pkt_cont(
 
   uint8_t result = btm_ble_is_discoverable(bda, adv_data);
   if (result == 0) {
-    cache.Clear(addr_type, bda);
+    cache.Clear(addr_type, bda, advertising_sid, now_ms);
     LOG_WARN(LOG_TAG,
              "%s device no longer discoverable, discarding advertising packet",
              __func__);
@@ -2034,7 +1971,7 @@ static void btm_ble_process_adv_pkt_cont(
                        const_cast<uint8_t*>(adv_data.data()), adv_data.size());
   }
 
-  cache.Clear(addr_type, bda);
+  cache.Clear(addr_type, bda, advertising_sid, now_ms);
 }
 
 void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
@@ -28,6 +28,7 @@
 
 #include "bt_common.h"
 #include "bt_target.h"
+#include "btm_ble_adv_cache.h"
 #include "btm_ble_api.h"
 #include "btm_ble_int_types.h"
 #include "btm_int.h"
@@ -40,6 +41,7 @@ extern void btm_ble_refresh_raddr_timer_timeout(void* data);
 extern void btm_ble_process_adv_pkt(uint8_t len, uint8_t* p);
 extern void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* p);
 extern void btm_ble_process_ext_adv_pkt(uint8_t len, uint8_t* p);
+extern const BleAdvertisingCache::Stats& btm_ble_adv_cache_stats(void);
 extern void btm_ble_proc_scan_rsp_rpt(uint8_t* p);
 extern tBTM_STATUS btm_ble_read_remote_name(const RawAddress& remote_bda,
                                             tBTM_CMPL_CB* p_cb);
@@ -138,6 +140,7 @@ extern void btm_gen_non_resolvable_private_addr(tBTM_BLE_ADDR_CBACK* p_cback,
                                                 void* p);
 extern tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(
     const RawAddress& random_bda);
+extern void btm_ble_rpa_resolver_invalidate(void);
 extern void btm_gen_resolve_paddr_low(const RawAddress& address);
 
 /*  privacy function */
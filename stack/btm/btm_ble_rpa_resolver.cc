@@ -0,0 +1,112 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/btm/btm_ble_rpa_resolver.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+/* IRKs matched with one call of aes_128_encrypt_multi_key() */
+constexpr int kBatchSize = 32;
+
+}  // namespace
+
+BleRpaResolver::BleRpaResolver(size_t cache_size, uint64_t cache_timeout_ms)
+    : max_cache_size_(cache_size), cache_timeout_ms_(cache_timeout_ms) {}
+
+void BleRpaResolver::Clear() {
+  schedules_.clear();
+  cache_.clear();
+  cache_map_.clear();
+}
+
+int BleRpaResolver::AddIrk(const Octet16& irk) {
+  schedules_.emplace_back();
+  crypto_toolbox::aes_128_expand_key(irk, &schedules_.back());
+  // A cached failure may now resolve.
+  cache_.clear();
+  cache_map_.clear();
+  return schedules_.size() - 1;
+}
+
+int BleRpaResolver::FindIrk(const RawAddress& rpa, int first) const {
+  /* The address is prand (most significant octets) followed by
+   * hash = AES(irk, padding | prand), truncated to 24 bits. In the byte
+   * order of FIPS-197, prand is at the end of the block, and so is the hash
+   * in the output. */
+  uint8_t block[OCTET16_LEN] = {0};
+  memcpy(&block[OCTET16_LEN - 3], &rpa.address[0], 3);
+
+  uint8_t out[kBatchSize][OCTET16_LEN];
+  int count = schedules_.size();
+  for (int i = std::max(first, 0); i < count; i += kBatchSize) {
+    int batch = std::min(kBatchSize, count - i);
+    crypto_toolbox::aes_128_encrypt_multi_key(&schedules_[i], batch, block,
+                                              out);
+    for (int j = 0; j < batch; j++) {
+      if (memcmp(&out[j][OCTET16_LEN - 3], &rpa.address[3], 3) == 0)
+        return i + j;
+    }
+  }
+  return kNoMatch;
+}
+
+bool BleRpaResolver::LookUp(const RawAddress& rpa, uint64_t now_ms,
+                            int* p_index) {
+  auto it = cache_map_.find(rpa);
+  if (it == cache_map_.end()) return false;
+
+  if (now_ms - it->second->time_ms > cache_timeout_ms_) {
+    cache_.erase(it->second);
+    cache_map_.erase(it);
+    return false;
+  }
+  cache_.splice(cache_.begin(), cache_, it->second);
+  *p_index = it->second->index;
+  return true;
+}
+
+void BleRpaResolver::Remember(const RawAddress& rpa, int index,
+                              uint64_t now_ms) {
+  if (max_cache_size_ == 0) return;
+  Forget(rpa);
+  if (cache_.size() == max_cache_size_) {
+    cache_map_.erase(cache_.back().rpa);
+    cache_.pop_back();
+  }
+  cache_.push_front({rpa, index, now_ms});
+  cache_map_[rpa] = cache_.begin();
+}
+
+void BleRpaResolver::Forget(const RawAddress& rpa) {
+  auto it = cache_map_.find(rpa);
+  if (it == cache_map_.end()) return;
+  cache_.erase(it->second);
+  cache_map_.erase(it);
+}
+
+size_t BleRpaResolver::AddressHash::operator()(
+    const RawAddress& address) const {
+  /* The hash part of the RPAs is uniformly distributed */
+  uint64_t value = 0;
+  memcpy(&value, address.address, sizeof(address.address));
+  return std::hash<uint64_t>{}(value);
+}
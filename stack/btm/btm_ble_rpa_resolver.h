@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BTM_BLE_RPA_RESOLVER_H
+#define BTM_BLE_RPA_RESOLVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "stack/crypto_toolbox/aes_multi_key.h"
+#include "stack/include/bt_types.h"
+#include "types/raw_address.h"
+
+/* Resolves Resolvable Private Addresses against a set of IRKs.
+ *
+ * The IRKs are kept expanded in a contiguous array, and an address is
+ * matched against all of them in batches. The outcome of the recent
+ * resolutions, including the failed ones, is kept in an LRU cache for the
+ * lifetime of the addresses. Any change of the IRKs must go through Clear()
+ * and AddIrk(), which also drop the cache.
+ */
+class BleRpaResolver {
+ public:
+  /* The IRKs are referred to by the index they were added at */
+  static constexpr int kNoMatch = -1;
+
+  /* Default lifetime of the RPAs in the cache, and number of RPAs kept */
+  static constexpr uint64_t kCacheTimeoutMs = 15 * 60 * 1000;
+  static constexpr size_t kCacheSize = 256;
+
+  explicit BleRpaResolver(size_t cache_size = kCacheSize,
+                          uint64_t cache_timeout_ms = kCacheTimeoutMs);
+
+  /* Drops the IRKs and the cache */
+  void Clear();
+
+  /* Adds |irk|, least significant octet first. Returns its index. */
+  int AddIrk(const Octet16& irk);
+
+  size_t size() const { return schedules_.size(); }
+
+  /* Returns the index of the first IRK, from the one at |first|, that
+   * resolves |rpa|, or kNoMatch. Does not use the cache. */
+  int FindIrk(const RawAddress& rpa, int first = 0) const;
+
+  /* Looks |rpa| up in the cache, as resolved at |now_ms| or before. On a
+   * hit, |*p_index| is the index of the IRK resolving it, or kNoMatch. */
+  bool LookUp(const RawAddress& rpa, uint64_t now_ms, int* p_index);
+
+  /* Caches the result of the resolution of |rpa| at |now_ms| */
+  void Remember(const RawAddress& rpa, int index, uint64_t now_ms);
+
+  /* Drops |rpa| from the cache */
+  void Forget(const RawAddress& rpa);
+
+  size_t cache_size() const { return cache_.size(); }
+
+ private:
+  struct CacheEntry {
+    RawAddress rpa;
+    int index;
+    uint64_t time_ms;
+  };
+
+  struct AddressHash {
+    size_t operator()(const RawAddress& address) const;
+  };
+
+  std::vector<crypto_toolbox::Aes128KeySchedule> schedules_;
+
+  size_t max_cache_size_;
+  uint64_t cache_timeout_ms_;
+  /* Most recently used first */
+  std::list<CacheEntry> cache_;
+  std::unordered_map<RawAddress, std::list<CacheEntry>::iterator, AddressHash>
+      cache_map_;
+};
+
+#endif  // BTM_BLE_RPA_RESOLVER_H
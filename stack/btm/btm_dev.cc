@@ -30,12 +30,23 @@
 #include "bt_common.h"
 #include "bt_types.h"
 #include "btm_api.h"
+#include "btm_ble_int.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
+#include "stack/btm/btm_sec_dev_rec_index.h"
+
+/* Index of btm_cb.sec_dev_rec by address and by connection handle */
+static SecDevRecIndex<tBTM_SEC_DEV_REC> dev_rec_index;
+
+static SecDevRecIndex<tBTM_SEC_DEV_REC>::Keys dev_rec_keys(
+    const tBTM_SEC_DEV_REC* p_dev_rec) {
+  return {p_dev_rec->bd_addr, p_dev_rec->ble.pseudo_addr,
+          p_dev_rec->hci_handle, p_dev_rec->ble_hci_handle};
+}
 
 /*******************************************************************************
  *
@@ -73,6 +84,7 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 
     p_dev_rec->bd_addr = bd_addr;
     p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
+    btm_sec_dev_rec_keys_changed(p_dev_rec);
 
     /* use default value for background connection params */
     /* update conn params, use default value for background connection params */
@@ -152,6 +164,8 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
   p_dev_rec->link_key.fill(0);
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_ble_rpa_resolver_invalidate();
+  dev_rec_index.Remove(p_dev_rec);
   list_remove(btm_cb.sec_dev_rec, p_dev_rec);
 }
 
@@ -260,6 +274,7 @@ tBTM_SEC_DEV_REC* btm_sec_alloc_dev(const RawAddress& bd_addr) {
 
   p_dev_rec->ble_hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_LE);
   p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
+  btm_sec_dev_rec_keys_changed(p_dev_rec);
 
   return (p_dev_rec);
 }
@@ -310,16 +325,6 @@ bool btm_dev_support_switch(const RawAddress& bd_addr) {
   return (false);
 }
 
-bool is_handle_equal(void* data, void* context) {
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-  uint16_t* handle = static_cast<uint16_t*>(context);
-
-  if (p_dev_rec->hci_handle == *handle || p_dev_rec->ble_hci_handle == *handle)
-    return false;
-
-  return true;
-}
-
 /*******************************************************************************
  *
  * Function         btm_find_dev_by_handle
@@ -331,22 +336,7 @@ bool is_handle_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
-  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
-
-  return NULL;
-}
-
-bool is_address_equal(void* data, void* context) {
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-  const RawAddress* bd_addr = ((RawAddress*)context);
-
-  if (p_dev_rec->bd_addr == *bd_addr) return false;
-  // If a LE random address is looking for device record
-  if (p_dev_rec->ble.pseudo_addr == *bd_addr) return false;
-
-  if (btm_ble_addr_resolvable(*bd_addr, p_dev_rec)) return false;
-  return true;
+  return dev_rec_index.FindByHandle(handle);
 }
 
 /*******************************************************************************
@@ -360,11 +350,34 @@ bool is_address_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
-  list_node_t* n =
-      list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  tBTM_SEC_DEV_REC* p_dev_rec = dev_rec_index.FindByAddress(bd_addr);
+
+  /* a resolvable private address may match the IRK of an earlier record */
+  if (BTM_BLE_IS_RESOLVE_BDA(bd_addr)) {
+    tBTM_SEC_DEV_REC* p_resolved = btm_ble_resolve_random_addr(bd_addr);
+    if (p_resolved != NULL &&
+        (p_dev_rec == NULL || dev_rec_index.IsBefore(p_resolved, p_dev_rec))) {
+      p_dev_rec = p_resolved;
+      btm_ble_init_pseudo_addr(p_dev_rec, bd_addr);
+    }
+  }
 
-  return NULL;
+  return p_dev_rec;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_dev_rec_keys_changed
+ *
+ * Description      Update the lookup index of the device database after the
+ *                  address, pseudo address or one of the connection handles
+ *                  of a record changed
+ *
+ * Returns          none
+ *
+ ******************************************************************************/
+void btm_sec_dev_rec_keys_changed(tBTM_SEC_DEV_REC* p_dev_rec) {
+  dev_rec_index.Update(p_dev_rec, dev_rec_keys(p_dev_rec));
 }
 
 /*******************************************************************************
@@ -405,6 +418,7 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
           temp_rec.new_encryption_key_is_p256;
       p_target_rec->no_smp_on_br = temp_rec.no_smp_on_br;
       p_target_rec->bond_type = temp_rec.bond_type;
+      btm_sec_dev_rec_keys_changed(p_target_rec);
 
       /* remove the combined record */
       wipe_secrets_and_remove(p_dev_rec);
@@ -520,6 +534,7 @@ tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void) {
   p_dev_rec->bond_type = BOND_TYPE_UNKNOWN;
   p_dev_rec->timestamp = btm_cb.dev_rec_count++;
   p_dev_rec->rmt_io_caps = BTM_IO_CAP_UNKNOWN;
+  dev_rec_index.Add(p_dev_rec, dev_rec_keys(p_dev_rec));
 
   return p_dev_rec;
 }
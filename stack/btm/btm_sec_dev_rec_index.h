@@ -0,0 +1,180 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BTM_SEC_DEV_REC_INDEX_H
+#define BTM_SEC_DEV_REC_INDEX_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <base/logging.h>
+
+#include "types/raw_address.h"
+
+/* Index of the security device records by address and by connection handle.
+ *
+ * The records stay owned, and ordered, by their list. The index keeps the
+ * order they were added in, so that a lookup returns the same record as a
+ * scan of the list would: the first one matching. The keys of a record are
+ * copied when it is added, and must be updated whenever they change.
+ */
+template <typename Record>
+class SecDevRecIndex {
+ public:
+  struct Keys {
+    RawAddress bd_addr;
+    RawAddress pseudo_addr;
+    uint16_t hci_handle;
+    uint16_t ble_hci_handle;
+  };
+
+  /* Adds |record|, after all the records already indexed */
+  void Add(Record* record, const Keys& keys) {
+    auto result = records_.emplace(record, Indexed{next_order_++, keys});
+    CHECK(result.second);
+    Insert(record, result.first->second);
+  }
+
+  /* Moves |record| to the buckets of |keys|, if they changed */
+  void Update(Record* record, const Keys& keys) {
+    auto it = records_.find(record);
+    if (it == records_.end()) return;
+
+    Indexed& indexed = it->second;
+    if (SameKeys(indexed.keys, keys)) return;
+    Erase(indexed);
+    indexed.keys = keys;
+    Insert(record, indexed);
+  }
+
+  void Remove(Record* record) {
+    auto it = records_.find(record);
+    if (it == records_.end()) return;
+
+    Erase(it->second);
+    records_.erase(it);
+  }
+
+  void Clear() {
+    records_.clear();
+    by_address_.clear();
+    by_handle_.clear();
+  }
+
+  size_t size() const { return records_.size(); }
+
+  /* Returns the first record whose address or pseudo address is |address|,
+   * or nullptr */
+  Record* FindByAddress(const RawAddress& address) const {
+    auto it = by_address_.find(address);
+    return it == by_address_.end() ? nullptr : it->second.front().record;
+  }
+
+  /* Returns the first record whose BR/EDR or LE handle is |handle|, or
+   * nullptr */
+  Record* FindByHandle(uint16_t handle) const {
+    auto it = by_handle_.find(handle);
+    return it == by_handle_.end() ? nullptr : it->second.front().record;
+  }
+
+  /* Returns true if |a| was added before |b| */
+  bool IsBefore(const Record* a, const Record* b) const {
+    return records_.at(a).order < records_.at(b).order;
+  }
+
+ private:
+  struct Indexed {
+    uint64_t order;
+    Keys keys;
+  };
+
+  struct Entry {
+    uint64_t order;
+    Record* record;
+  };
+
+  struct AddressHash {
+    size_t operator()(const RawAddress& address) const {
+      uint64_t value = 0;
+      memcpy(&value, address.address, sizeof(address.address));
+      return std::hash<uint64_t>{}(value);
+    }
+  };
+
+  /* Ordered by |order|. Most records are alone in their buckets, but the
+   * unset keys are shared by many. */
+  using Bucket = std::vector<Entry>;
+
+  static bool SameKeys(const Keys& a, const Keys& b) {
+    return a.bd_addr == b.bd_addr && a.pseudo_addr == b.pseudo_addr &&
+           a.hci_handle == b.hci_handle && a.ble_hci_handle == b.ble_hci_handle;
+  }
+
+  static typename Bucket::iterator Position(Bucket& bucket, uint64_t order) {
+    return std::lower_bound(
+        bucket.begin(), bucket.end(), order,
+        [](const Entry& entry, uint64_t order) { return entry.order < order; });
+  }
+
+  static void InsertEntry(Bucket& bucket, Record* record, uint64_t order) {
+    bucket.insert(Position(bucket, order), Entry{order, record});
+  }
+
+  template <typename Map, typename Key>
+  static void EraseEntry(Map& map, const Key& key, uint64_t order) {
+    auto map_it = map.find(key);
+    CHECK(map_it != map.end());
+
+    Bucket& bucket = map_it->second;
+    auto it = Position(bucket, order);
+    CHECK(it != bucket.end() && it->order == order);
+    bucket.erase(it);
+    if (bucket.empty()) map.erase(map_it);
+  }
+
+  void Insert(Record* record, const Indexed& indexed) {
+    const Keys& keys = indexed.keys;
+    InsertEntry(by_address_[keys.bd_addr], record, indexed.order);
+    if (keys.pseudo_addr != keys.bd_addr)
+      InsertEntry(by_address_[keys.pseudo_addr], record, indexed.order);
+    InsertEntry(by_handle_[keys.hci_handle], record, indexed.order);
+    if (keys.ble_hci_handle != keys.hci_handle)
+      InsertEntry(by_handle_[keys.ble_hci_handle], record, indexed.order);
+  }
+
+  void Erase(const Indexed& indexed) {
+    const Keys& keys = indexed.keys;
+    EraseEntry(by_address_, keys.bd_addr, indexed.order);
+    if (keys.pseudo_addr != keys.bd_addr)
+      EraseEntry(by_address_, keys.pseudo_addr, indexed.order);
+    EraseEntry(by_handle_, keys.hci_handle, indexed.order);
+    if (keys.ble_hci_handle != keys.hci_handle)
+      EraseEntry(by_handle_, keys.ble_hci_handle, indexed.order);
+  }
+
+  uint64_t next_order_ = 0;
+  std::unordered_map<const Record*, Indexed> records_;
+  std::unordered_map<RawAddress, Bucket, AddressHash> by_address_;
+  std::unordered_map<uint16_t, Bucket> by_handle_;
+};
+
+#endif  // BTM_SEC_DEV_REC_INDEX_H
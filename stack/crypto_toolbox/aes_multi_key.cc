@@ -0,0 +1,204 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* AES-128 of one block under many expanded keys, as needed to resolve a
+ * Resolvable Private Address against every known IRK.
+ *
+ * The hardware implementations encrypt with several keys at once: the
+ * rounds of the independent blocks are interleaved, to hide the latency of
+ * the AES instructions. The x86 one is compiled with target attributes and
+ * only used after checking the CPU. The ARMv8 one is only built when the
+ * compiler targets the Cryptography Extension.
+ */
+
+#include "stack/crypto_toolbox/aes_multi_key.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AES_MULTI_KEY_AESNI
+#include <immintrin.h>
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+#elif defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)
+#define AES_MULTI_KEY_ARMV8
+#include <arm_neon.h>
+#endif
+
+namespace crypto_toolbox {
+
+namespace {
+
+constexpr int kAes128Rounds = 10;
+
+/* Keys encrypted with at once by the hardware implementations */
+constexpr size_t kLanes = 4;
+
+using EncryptMultiKeyFn = void (*)(const Aes128KeySchedule* schedules,
+                                   size_t count,
+                                   const uint8_t block[OCTET16_LEN],
+                                   uint8_t (*out)[OCTET16_LEN]);
+
+void encrypt_multi_key_software(const Aes128KeySchedule* schedules,
+                                size_t count, const uint8_t block[OCTET16_LEN],
+                                uint8_t (*out)[OCTET16_LEN]) {
+  for (size_t i = 0; i < count; i++) {
+    aes_encrypt(block, out[i], &schedules[i].ctx);
+  }
+}
+
+#if defined(AES_MULTI_KEY_AESNI)
+
+bool cpu_has_aesni() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+}
+
+template <size_t lanes>
+AESNI_TARGET inline void encrypt_lanes_aesni(const Aes128KeySchedule* schedules,
+                                             __m128i block,
+                                             uint8_t (*out)[OCTET16_LEN]) {
+  __m128i state[lanes];
+  for (size_t j = 0; j < lanes; j++) {
+    const __m128i* keys =
+        reinterpret_cast<const __m128i*>(schedules[j].ctx.ksch);
+    state[j] = _mm_xor_si128(block, _mm_load_si128(keys));
+  }
+  for (int round = 1; round < kAes128Rounds; round++) {
+    for (size_t j = 0; j < lanes; j++) {
+      const __m128i* keys =
+          reinterpret_cast<const __m128i*>(schedules[j].ctx.ksch);
+      state[j] = _mm_aesenc_si128(state[j], _mm_load_si128(keys + round));
+    }
+  }
+  for (size_t j = 0; j < lanes; j++) {
+    const __m128i* keys =
+        reinterpret_cast<const __m128i*>(schedules[j].ctx.ksch);
+    state[j] =
+        _mm_aesenclast_si128(state[j], _mm_load_si128(keys + kAes128Rounds));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out[j]), state[j]);
+  }
+}
+
+AESNI_TARGET void encrypt_multi_key_aesni(const Aes128KeySchedule* schedules,
+                                          size_t count,
+                                          const uint8_t block[OCTET16_LEN],
+                                          uint8_t (*out)[OCTET16_LEN]) {
+  __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    encrypt_lanes_aesni<kLanes>(&schedules[i], input, &out[i]);
+  }
+  for (; i < count; i++) {
+    encrypt_lanes_aesni<1>(&schedules[i], input, &out[i]);
+  }
+}
+
+#endif  // AES_MULTI_KEY_AESNI
+
+#if defined(AES_MULTI_KEY_ARMV8)
+
+template <size_t lanes>
+inline void encrypt_lanes_armv8(const Aes128KeySchedule* schedules,
+                                uint8x16_t block,
+                                uint8_t (*out)[OCTET16_LEN]) {
+  uint8x16_t state[lanes];
+  for (size_t j = 0; j < lanes; j++) state[j] = block;
+  /* AESE adds the round key before the substitution: the last round key is
+   * added on its own. */
+  for (int round = 0; round < kAes128Rounds - 1; round++) {
+    for (size_t j = 0; j < lanes; j++) {
+      uint8x16_t key = vld1q_u8(schedules[j].ctx.ksch + round * N_BLOCK);
+      state[j] = vaesmcq_u8(vaeseq_u8(state[j], key));
+    }
+  }
+  for (size_t j = 0; j < lanes; j++) {
+    const uint8_t* keys = schedules[j].ctx.ksch;
+    state[j] = vaeseq_u8(state[j],
+                         vld1q_u8(keys + (kAes128Rounds - 1) * N_BLOCK));
+    state[j] = veorq_u8(state[j], vld1q_u8(keys + kAes128Rounds * N_BLOCK));
+    vst1q_u8(out[j], state[j]);
+  }
+}
+
+void encrypt_multi_key_armv8(const Aes128KeySchedule* schedules, size_t count,
+                             const uint8_t block[OCTET16_LEN],
+                             uint8_t (*out)[OCTET16_LEN]) {
+  uint8x16_t input = vld1q_u8(block);
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    encrypt_lanes_armv8<kLanes>(&schedules[i], input, &out[i]);
+  }
+  for (; i < count; i++) {
+    encrypt_lanes_armv8<1>(&schedules[i], input, &out[i]);
+  }
+}
+
+#endif  // AES_MULTI_KEY_ARMV8
+
+EncryptMultiKeyFn select_implementation(AesImplementation implementation) {
+  switch (implementation) {
+    case AesImplementation::kAuto:
+#if defined(AES_MULTI_KEY_AESNI)
+      if (cpu_has_aesni()) return encrypt_multi_key_aesni;
+#endif
+#if defined(AES_MULTI_KEY_ARMV8)
+      return encrypt_multi_key_armv8;
+#endif
+      return encrypt_multi_key_software;
+    case AesImplementation::kSoftware:
+      return encrypt_multi_key_software;
+    case AesImplementation::kAesNi:
+#if defined(AES_MULTI_KEY_AESNI)
+      if (cpu_has_aesni()) return encrypt_multi_key_aesni;
+#endif
+      return nullptr;
+    case AesImplementation::kArmv8:
+#if defined(AES_MULTI_KEY_ARMV8)
+      return encrypt_multi_key_armv8;
+#endif
+      return nullptr;
+  }
+  return nullptr;
+}
+
+EncryptMultiKeyFn& current_implementation() {
+  static EncryptMultiKeyFn implementation =
+      select_implementation(AesImplementation::kAuto);
+  return implementation;
+}
+
+}  // namespace
+
+void aes_128_expand_key(const Octet16& key, Aes128KeySchedule* schedule) {
+  Octet16 key_reversed;
+  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
+  aes_set_key(key_reversed.data(), key_reversed.size(), &schedule->ctx);
+}
+
+void aes_128_encrypt_multi_key(const Aes128KeySchedule* schedules,
+                               size_t count, const uint8_t block[OCTET16_LEN],
+                               uint8_t (*out)[OCTET16_LEN]) {
+  current_implementation()(schedules, count, block, out);
+}
+
+bool aes_128_set_implementation(AesImplementation implementation) {
+  EncryptMultiKeyFn selected = select_implementation(implementation);
+  if (selected == nullptr) return false;
+  current_implementation() = selected;
+  return true;
+}
+
+}  // namespace crypto_toolbox
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stack/crypto_toolbox/aes.h"
+#include "stack/include/bt_types.h"
+
+namespace crypto_toolbox {
+
+/* AES-128 key, expanded once to encrypt with it many times */
+struct Aes128KeySchedule {
+  /* Round keys in the byte order of FIPS-197, as used by aes_encrypt() */
+  alignas(16) aes_context ctx;
+};
+
+/* Expands |key|, given in the byte order of aes_128(): least significant
+ * octet first. */
+extern void aes_128_expand_key(const Octet16& key,
+                               Aes128KeySchedule* schedule);
+
+/* Encrypts |block| with each of the |count| keys of |schedules|, into the
+ * matching block of |out|. |block| and |out| are in the byte order of
+ * FIPS-197, unlike the parameters of aes_128(). */
+extern void aes_128_encrypt_multi_key(const Aes128KeySchedule* schedules,
+                                      size_t count,
+                                      const uint8_t block[OCTET16_LEN],
+                                      uint8_t (*out)[OCTET16_LEN]);
+
+enum class AesImplementation {
+  kAuto,     /* The fastest one supported by the CPU */
+  kSoftware, /* aes_encrypt() */
+  kAesNi,    /* x86 AES-NI instructions */
+  kArmv8,    /* ARMv8 Cryptography Extension */
+};
+
+/* Selects the implementation of aes_128_encrypt_multi_key(), for the tests
+ * and the benchmarks. Returns false if the CPU, or the build, does not
+ * support it. */
+extern bool aes_128_set_implementation(AesImplementation implementation);
+
+}  // namespace crypto_toolbox
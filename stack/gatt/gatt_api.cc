@@ -291,6 +291,7 @@ uint16_t GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
     elem.sdp_handle = 0;
   }
 
+  gatt_sr_rebuild_index();
   gatt_update_last_srv_info();
 
   VLOG(1) << __func__ << ": allocated el s_hdl=" << loghex(elem.s_hdl)
@@ -390,6 +391,7 @@ void GATTS_StopService(uint16_t service_handle) {
   }
 
   gatt_cb.srv_list_info->erase(it);
+  gatt_sr_rebuild_index();
   gatt_update_last_srv_info();
 }
 /*******************************************************************************
@@ -29,6 +29,7 @@
 #include <base/strings/stringprintf.h>
 #include <string.h>
 #include <list>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -263,6 +264,26 @@ typedef struct {
   bool is_primary;
 } tGATT_SRV_LIST_ELEM;
 
+/* An attribute of a started service, as kept in tGATT_SRV_INDEX */
+typedef struct {
+  uint16_t handle;
+  tGATT_ATTR* p_attr;
+  tGATT_SRV_LIST_ELEM* p_srv;
+} tGATT_SRV_ATTR_REF;
+
+/* Indexes over the started services, rebuilt by gatt_sr_rebuild_index()
+ * whenever srv_list_info changes. A service database is complete before the
+ * service starts, so the attribute pointers stay valid until it stops. */
+typedef struct {
+  /* srv_list_info elements, sorted by s_hdl */
+  std::vector<std::list<tGATT_SRV_LIST_ELEM>::iterator> services;
+  /* attributes of all services, sorted by handle */
+  std::vector<tGATT_SRV_ATTR_REF> attrs;
+  /* attributes of all services by attribute type, each sorted by handle */
+  std::unordered_map<bluetooth::Uuid, std::vector<tGATT_SRV_ATTR_REF>>
+      attrs_by_type;
+} tGATT_SRV_INDEX;
+
 typedef struct {
   std::queue<tGATT_CLCB*> pending_enc_clcb; /* pending encryption channel q */
   tGATT_SEC_ACTION sec_act;
@@ -361,6 +382,7 @@ typedef struct {
   tGATT_IF gatt_if;
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
+  tGATT_SRV_INDEX srv_index;
 
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
@@ -471,8 +493,14 @@ extern bool gatt_auto_connect_dev_remove(tGATT_IF gatt_if,
                                          const RawAddress& bd_addr);
 
 /* server function */
+extern void gatt_sr_rebuild_index(void);
 extern std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle);
+extern std::vector<std::list<tGATT_SRV_LIST_ELEM>::iterator>::const_iterator
+gatt_sr_find_first_srv_from(uint16_t handle);
+extern std::vector<tGATT_SRV_ATTR_REF>::const_iterator gatt_sr_lower_bound(
+    const std::vector<tGATT_SRV_ATTR_REF>& attrs, uint16_t handle);
+extern const tGATT_SRV_ATTR_REF* gatt_sr_find_attr_by_handle(uint16_t handle);
 extern tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
                                             uint32_t trans_id, uint8_t op_code,
                                             tGATT_STATUS status,
@@ -555,10 +583,10 @@ extern uint16_t gatts_add_characteristic(tGATT_SVC_DB& db, tGATT_PERM perm,
 extern uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
                                      const bluetooth::Uuid& dscp_uuid);
 extern tGATT_STATUS gatts_db_read_attr_value_by_type(
-    tGATT_TCB& tcb, tGATT_SVC_DB* p_db, uint8_t op_code, BT_HDR* p_rsp,
-    uint16_t s_handle, uint16_t e_handle, const bluetooth::Uuid& type,
-    uint16_t* p_len, tGATT_SEC_FLAG sec_flag, uint8_t key_size,
-    uint32_t trans_id, uint16_t* p_cur_handle);
+    tGATT_TCB& tcb, uint8_t op_code, BT_HDR* p_rsp, uint16_t s_handle,
+    uint16_t e_handle, const bluetooth::Uuid& type, uint16_t* p_len,
+    tGATT_SEC_FLAG sec_flag, uint8_t key_size, uint32_t trans_id,
+    uint16_t* p_cur_handle);
 extern tGATT_STATUS gatts_read_attr_value_by_handle(
     tGATT_TCB& tcb, tGATT_SVC_DB* p_db, uint8_t op_code, uint16_t handle,
     uint16_t offset, uint8_t* p_value, uint16_t* p_len, uint16_t mtu,
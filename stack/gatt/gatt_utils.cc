@@ -26,6 +26,7 @@
 #include "osi/include/osi.h"
 
 #include <string.h>
+#include <algorithm>
 #include "bt_common.h"
 #include "stdio.h"
 
@@ -652,25 +653,112 @@ void gatt_ind_ack_timeout(void* data) {
   p_tcb->ind_count = 0;
   attp_send_cl_msg(*p_tcb, nullptr, GATT_HANDLE_VALUE_CONF, NULL);
 }
+/*******************************************************************************
+ *
+ * Function         gatt_sr_rebuild_index
+ *
+ * Description      Rebuilds the service, handle and attribute type indexes of
+ *                  the started services. Must be called whenever an element
+ *                  is added to or removed from srv_list_info.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_rebuild_index(void) {
+  tGATT_SRV_INDEX& index = gatt_cb.srv_index;
+  index.services.clear();
+  index.attrs.clear();
+  index.attrs_by_type.clear();
+
+  /* srv_list_info is kept sorted by s_hdl, and so is each database */
+  for (auto it = gatt_cb.srv_list_info->begin();
+       it != gatt_cb.srv_list_info->end(); it++) {
+    index.services.push_back(it);
+    if (!it->p_db) continue;
+
+    for (tGATT_ATTR& attr : it->p_db->attr_list) {
+      tGATT_SRV_ATTR_REF ref = {attr.handle, &attr, &*it};
+      index.attrs.push_back(ref);
+      index.attrs_by_type[attr.uuid].push_back(ref);
+    }
+  }
+}
+
 /*******************************************************************************
  *
  * Description      Search for a service that owns a specific handle.
  *
- * Returns          GATT_MAX_SR_PROFILES if not found. Otherwise the index of
- *                  the service.
+ * Returns          gatt_cb.srv_list_info->end() if not found. Otherwise the
+ *                  service.
  *
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
+  const auto& services = gatt_cb.srv_index.services;
+  auto it = std::upper_bound(
+      services.begin(), services.end(), handle,
+      [](uint16_t handle, const std::list<tGATT_SRV_LIST_ELEM>::iterator& srv) {
+        return handle < srv->s_hdl;
+      });
+
+  /* the candidate is the last service starting at or before the handle */
+  if (it == services.begin()) return gatt_cb.srv_list_info->end();
+  --it;
+  if ((*it)->e_hdl < handle) return gatt_cb.srv_list_info->end();
+  return *it;
+}
 
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
-  }
+/*******************************************************************************
+ *
+ * Function         gatt_sr_find_first_srv_from
+ *
+ * Description      Search for the first service starting at or after a handle.
+ *
+ * Returns          Position in gatt_cb.srv_index.services.
+ *
+ ******************************************************************************/
+std::vector<std::list<tGATT_SRV_LIST_ELEM>::iterator>::const_iterator
+gatt_sr_find_first_srv_from(uint16_t handle) {
+  const auto& services = gatt_cb.srv_index.services;
+  return std::lower_bound(
+      services.begin(), services.end(), handle,
+      [](const std::list<tGATT_SRV_LIST_ELEM>::iterator& srv, uint16_t handle) {
+        return srv->s_hdl < handle;
+      });
+}
 
-  return it;
+/*******************************************************************************
+ *
+ * Function         gatt_sr_lower_bound
+ *
+ * Description      Search a handle sorted attribute list of the index for the
+ *                  first attribute at or after a handle.
+ *
+ * Returns          Position in the list.
+ *
+ ******************************************************************************/
+std::vector<tGATT_SRV_ATTR_REF>::const_iterator gatt_sr_lower_bound(
+    const std::vector<tGATT_SRV_ATTR_REF>& attrs, uint16_t handle) {
+  return std::lower_bound(attrs.begin(), attrs.end(), handle,
+                          [](const tGATT_SRV_ATTR_REF& ref, uint16_t handle) {
+                            return ref.handle < handle;
+                          });
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_find_attr_by_handle
+ *
+ * Description      Search the started services for an attribute.
+ *
+ * Returns          NULL if not found. Otherwise the attribute and its service.
+ *
+ ******************************************************************************/
+const tGATT_SRV_ATTR_REF* gatt_sr_find_attr_by_handle(uint16_t handle) {
+  const auto& attrs = gatt_cb.srv_index.attrs;
+  auto it = gatt_sr_lower_bound(attrs, handle);
+  if (it == attrs.end() || it->handle != handle) return NULL;
+  return &*it;
 }
 
 /*******************************************************************************
@@ -540,6 +540,64 @@ typedef struct {
   void (*set_transmit_queue_length)(size_t transmit_queue_length);
 } tA2DP_ENCODER_INTERFACE;
 
+// Prototype for a callback to enqueue the A2DP Source packets of one of the
+// sessions of a |tA2DP_MULTI_ENCODER_INTERFACE|.
+// |peer_address| is the address of the peer the packet is for. The other
+// parameters are as for |a2dp_source_enqueue_callback_t|.
+// Returns true if the packet was enqueued, otherwise false.
+typedef bool (*a2dp_source_enqueue_peer_callback_t)(
+    const RawAddress& peer_address, BT_HDR* p_buf, size_t frames_n,
+    uint32_t num_bytes);
+
+//
+// A2DP multi-session encoder callbacks interface.
+// Encodes one PCM feed for several peers at once, each with its own codec
+// configuration and bitpool. All the functions must be called from the same
+// thread.
+//
+typedef struct {
+  // Initialize the A2DP encoder.
+  // |p_feeding_params| is the format of the PCM read by |read_callback|.
+  // |enqueue_callback| is the callback for enqueueing the encoded audio data
+  // of every session.
+  // |num_workers| is the number of threads encoding the sessions. If zero,
+  // the sessions are encoded one after the other by |send_frames|.
+  void (*encoder_init)(const tA2DP_FEEDING_PARAMS* p_feeding_params,
+                       a2dp_source_read_callback_t read_callback,
+                       a2dp_source_enqueue_peer_callback_t enqueue_callback,
+                       size_t num_workers);
+
+  // Cleanup the A2DP encoder and all its sessions.
+  void (*encoder_cleanup)(void);
+
+  // Add a session encoding for the peer |peer_address|, replacing any
+  // previous session for the same peer.
+  // |p_peer_params| contains the A2DP peer information
+  // The A2DP codec config of the peer is in |a2dp_codec_config|.
+  // Returns true on success, or false if the codec config does not use the
+  // feeding parameters of the encoder.
+  bool (*session_add)(const RawAddress& peer_address,
+                      const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+                      A2dpCodecConfig* a2dp_codec_config);
+
+  // Remove the session encoding for the peer |peer_address|.
+  void (*session_remove)(const RawAddress& peer_address);
+
+  // Reset the feeding for the A2DP encoder.
+  void (*feeding_reset)(void);
+
+  // Flush the feeding for the A2DP encoder.
+  void (*feeding_flush)(void);
+
+  // Get the A2DP encoder interval (in milliseconds).
+  uint64_t (*get_encoder_interval_ms)(void);
+
+  // Read the PCM due at |timestamp_us| once, then prepare and send the A2DP
+  // encoded frames of every session.
+  // |timestamp_us| is the current timestamp (in microseconds).
+  void (*send_frames)(uint64_t timestamp_us);
+} tA2DP_MULTI_ENCODER_INTERFACE;
+
 // Prototype for a callback to receive decoded audio data from a
 // tA2DP_DECODER_INTERFACE|.
 // |buf| is a pointer to the data.
@@ -685,6 +743,14 @@ bool A2DP_BuildCodecHeader(const uint8_t* p_codec_info, BT_HDR* p_buf,
 const tA2DP_ENCODER_INTERFACE* A2DP_GetEncoderInterface(
     const uint8_t* p_codec_info);
 
+// Gets the A2DP multi-session encoder interface that can be used to encode
+// the same audio for several peers - see |tA2DP_MULTI_ENCODER_INTERFACE|.
+// |p_codec_info| contains the codec information.
+// Returns the A2DP multi-session encoder interface if the |p_codec_info| is
+// valid and supported, otherwise NULL.
+const tA2DP_MULTI_ENCODER_INTERFACE* A2DP_GetMultiEncoderInterface(
+    const uint8_t* p_codec_info);
+
 // Gets the A2DP decoder interface that can be used to decode received A2DP
 // packets - see |tA2DP_DECODER_INTERFACE|.
 // |p_codec_info| contains the codec information.
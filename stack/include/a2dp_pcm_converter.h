@@ -0,0 +1,133 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//
+// PCM sample rate, sample format and channel count conversion for the A2DP
+// encoders.
+//
+
+#ifndef A2DP_PCM_CONVERTER_H
+#define A2DP_PCM_CONVERTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Sample formats of interleaved, little endian PCM.
+enum class A2dpPcmFormat {
+  kU8,         // Unsigned 8 bit
+  kS16,        // Signed 16 bit
+  kS24Packed,  // Signed 24 bit, 3 octets per sample
+  kS32,        // Signed 32 bit
+  kFloat,      // 32 bit float, full scale is [-1.0, 1.0]
+};
+
+typedef struct {
+  uint32_t sample_rate;
+  A2dpPcmFormat format;
+  uint8_t channel_count;
+} tA2DP_PCM_CONFIG;
+
+// Gets the format of the integer PCM with |bits_per_sample| bits per sample
+// the audio HAL feeds to the A2DP encoders.
+// Returns true on success, or false if |bits_per_sample| is not supported.
+bool A2DP_GetPcmFormat(uint8_t bits_per_sample, A2dpPcmFormat* p_format);
+
+// Gets the size of a sample in |format|, in octets.
+size_t A2DP_GetPcmSampleSize(A2dpPcmFormat format);
+
+// Converts a stream of PCM to another sample rate, sample format and channel
+// count.
+//
+// The sample rate is converted with a polyphase windowed sinc FIR. Ratios of
+// rates that reduce to at most |kMaxPhases| phases, which include all the
+// usual rates, are converted exactly. Other ratios use the nearest of
+// |kMaxPhases| phases. Mono is duplicated to all the output channels, and
+// downmixing to mono averages the input channels; other channel count
+// changes keep the first channels.
+class A2dpPcmConverter {
+ public:
+  // Number of taps of each phase of the filter.
+  static constexpr size_t kTapsPerPhase = 64;
+  // Maximum number of phases of the filter.
+  static constexpr uint32_t kMaxPhases = 512;
+
+  A2dpPcmConverter(const tA2DP_PCM_CONFIG& input,
+                   const tA2DP_PCM_CONFIG& output);
+
+  const tA2DP_PCM_CONFIG& input() const { return input_; }
+  const tA2DP_PCM_CONFIG& output() const { return output_; }
+
+  // Sizes of an input and of an output frame (one sample of each channel),
+  // in octets.
+  size_t input_frame_size() const { return input_frame_size_; }
+  size_t output_frame_size() const { return output_frame_size_; }
+
+  // Returns the number of input frames still needed to produce
+  // |output_frames| output frames.
+  size_t InputFramesFor(size_t output_frames) const;
+
+  // Converts the |input_frames| frames at |p_input|, and writes at most
+  // |max_output_frames| frames to |p_output|. All the input is consumed: the
+  // output that does not fit is produced by the next calls.
+  // Returns the number of frames written to |p_output|.
+  size_t Convert(const void* p_input, size_t input_frames, void* p_output,
+                 size_t max_output_frames);
+
+  // Drops the buffered input, as at construction.
+  void Reset();
+
+ private:
+  void DesignFilter();
+  void Decode(const uint8_t* p_input, size_t input_frames);
+  void Encode(size_t frames, uint8_t* p_output);
+  size_t Resample(size_t max_output_frames);
+
+  tA2DP_PCM_CONFIG input_;
+  tA2DP_PCM_CONFIG output_;
+  size_t input_frame_size_;
+  size_t output_frame_size_;
+  // Channels carried through the filter: the smaller of the input and output
+  // channel counts.
+  uint8_t work_channels_;
+
+  // Sample rate ratio |up_| / |down_|, reduced.
+  uint32_t up_;
+  uint32_t down_;
+  // Phases of |coefs_|, |taps_| coefficients each. Without sample rate
+  // conversion there is a single phase of a single tap.
+  uint32_t phases_;
+  size_t taps_;
+  std::vector<float> coefs_;
+
+  // Buffered input of each work channel, and the position of the next output
+  // in it: the first input sample of its window, and the fraction of an
+  // input sample past it, in units of 1 / |up_|.
+  std::vector<std::vector<float>> history_;
+  size_t history_len_;
+  size_t position_;
+  uint32_t fraction_;
+
+  // The output before encoding, one plane per work channel.
+  std::vector<std::vector<float>> resampled_;
+  // The input of Decode() as float, before mixing.
+  std::vector<float> decoded_;
+};
+
+#endif  // A2DP_PCM_CONVERTER_H
@@ -238,6 +238,14 @@ std::string A2DP_CodecInfoStringSbc(const uint8_t* p_codec_info);
 const tA2DP_ENCODER_INTERFACE* A2DP_GetEncoderInterfaceSbc(
     const uint8_t* p_codec_info);
 
+// Gets the A2DP SBC multi-session encoder interface - see
+// |tA2DP_MULTI_ENCODER_INTERFACE|.
+// |p_codec_info| contains the codec information.
+// Returns the A2DP SBC multi-session encoder interface if the |p_codec_info|
+// is valid and supported, otherwise NULL.
+const tA2DP_MULTI_ENCODER_INTERFACE* A2DP_GetMultiEncoderInterfaceSbc(
+    const uint8_t* p_codec_info);
+
 // Gets the A2DP SBC decoder interface that can be used to decode received A2DP
 // packets - see |tA2DP_DECODER_INTERFACE|.
 // |p_codec_info| contains the codec information.
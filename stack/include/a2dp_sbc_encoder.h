@@ -62,4 +62,41 @@ void a2dp_sbc_send_frames(uint64_t timestamp_us);
 // Get SBC bitrate
 // Returns |uint32_t| bitrate in bits per second
 uint32_t a2dp_sbc_get_bitrate();
+
+// Initialize the A2DP SBC multi-session encoder.
+// |p_feeding_params| is the format of the PCM read by |read_callback|.
+// |enqueue_callback| is the callback for enqueueing the encoded audio data.
+// |num_workers| is the number of encoding threads, zero to encode on the
+// caller thread.
+void a2dp_sbc_multi_encoder_init(
+    const tA2DP_FEEDING_PARAMS* p_feeding_params,
+    a2dp_source_read_callback_t read_callback,
+    a2dp_source_enqueue_peer_callback_t enqueue_callback, size_t num_workers);
+
+// Cleanup the A2DP SBC multi-session encoder.
+void a2dp_sbc_multi_encoder_cleanup(void);
+
+// Add a session of the A2DP SBC multi-session encoder for |peer_address|.
+// |p_peer_params| contains the A2DP peer information
+// The A2DP codec config of the peer is in |a2dp_codec_config|.
+// Returns true on success, otherwise false.
+bool a2dp_sbc_multi_encoder_session_add(
+    const RawAddress& peer_address,
+    const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+    A2dpCodecConfig* a2dp_codec_config);
+
+// Remove the session of the A2DP SBC multi-session encoder for
+// |peer_address|.
+void a2dp_sbc_multi_encoder_session_remove(const RawAddress& peer_address);
+
+// Reset the feeding for the A2DP SBC multi-session encoder.
+void a2dp_sbc_multi_feeding_reset(void);
+
+// Flush the feeding for the A2DP SBC multi-session encoder.
+void a2dp_sbc_multi_feeding_flush(void);
+
+// Read the PCM once, then prepare and send the A2DP SBC encoded frames of
+// every session.
+// |timestamp_us| is the current timestamp (in microseconds).
+void a2dp_sbc_multi_send_frames(uint64_t timestamp_us);
 #endif  // A2DP_SBC_ENCODER_H
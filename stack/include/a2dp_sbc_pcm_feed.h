@@ -0,0 +1,60 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//
+// The PCM shared by the sessions of the A2DP SBC multi-session encoder.
+//
+
+#ifndef A2DP_SBC_PCM_FEED_H
+#define A2DP_SBC_PCM_FEED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "a2dp_codec_api.h"
+
+// The PCM shared by the sessions of the multi-session encoder. It is read
+// once per encoder interval, and each session encodes it from its own
+// position, so a session that sends fewer frames during congestion does not
+// hold back the others.
+class A2dpSbcPcmFeed {
+ public:
+  // Empties the feed, and keeps the last |capacity| octets from now on.
+  void Reset(size_t capacity);
+
+  // The number of octets appended since the feed was reset.
+  uint64_t write_position() const { return write_position_; }
+
+  // Appends up to |len| octets read with |read_callback|.
+  void Fill(a2dp_source_read_callback_t read_callback, uint32_t len);
+
+  // Copies up to |len| octets from |*position| to |p_buf| and advances
+  // |*position|. A |*position| older than the octets kept is moved to the
+  // oldest octet kept. Safe to call from several threads, each with its own
+  // |position|, while the feed is not being filled.
+  // Returns the number of octets copied.
+  uint32_t Read(uint64_t* position, uint8_t* p_buf, uint32_t len) const;
+
+ private:
+  std::vector<uint8_t> ring_;
+  uint64_t write_position_ = 0;
+};
+
+#endif  // A2DP_SBC_PCM_FEED_H
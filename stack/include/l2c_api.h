@@ -1284,4 +1284,18 @@ extern uint16_t L2CA_GetDisconnectReason(const RawAddress& remote_bda,
 extern void L2CA_AdjustConnectionIntervals(uint16_t* min_interval,
                                            uint16_t* max_interval,
                                            uint16_t floor_interval);
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_l2cap_link_dump
+ *
+ * Description      Dumps the queueing delay and buffer credit utilization of
+ *                  the ACL links, when the deficit round robin scheduler is in
+ *                  use.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void stack_debug_l2cap_link_dump(int fd);
+
 #endif /* L2C_API_H */
@@ -355,7 +355,7 @@ BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
    */
   buf_size += sizeof(uint32_t);
 #endif
-  BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(buf_size);
+  BT_HDR* p_buf2 = (BT_HDR*)osi_pool_malloc(buf_size);
 
   p_buf2->offset = new_offset;
   p_buf2->len = no_of_bytes;
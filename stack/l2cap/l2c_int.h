@@ -74,6 +74,20 @@ static_assert(L2CAP_LE_CREDIT_THRESHOLD < L2CAP_LE_CREDIT_DEFAULT,
 #define L2CAP_BLE_LINK_CONNECT_TIMEOUT_MS (30 * 1000)  /* 30 seconds */
 #define L2CAP_FCR_ACK_TIMEOUT_MS 200                   /* 200 milliseconds */
 
+/* Sizes of the lookup tables kept next to the control block pools. Handles
+ * range from 0x0000 to 0x0EFF; the hash sizes must be powers of two.
+*/
+#define L2C_NUM_HCI_HANDLES 0x0F00
+#define L2C_LCB_ADDR_HASH_SIZE 32
+#define L2C_RCB_PSM_HASH_SIZE 32
+
+/* Property enabling the deficit round robin ACL scheduler, and the number of
+ * controller buffers each link may send per round, by ACL priority.
+*/
+#define L2C_LINK_SCHEDULER_PROPERTY "persist.bluetooth.l2cap_drr_scheduler"
+#define L2C_LINK_SCHEDULER_WEIGHT_HIGH 4
+#define L2C_LINK_SCHEDULER_WEIGHT_NORMAL 1
+
 /* Define the possible L2CAP channel states. The names of
  * the states may seem a bit strange, but they are taken from
  * the Bluetooth specification.
@@ -246,6 +260,7 @@ typedef struct {
   uint16_t real_psm; /* This may be a dummy RCB for an o/b connection but */
                      /* this is the real PSM that we need to connect to */
   tL2CAP_APPL_INFO api;
+  uint8_t next_psm_hash; /* Next RCB (index + 1) in the same PSM hash bucket */
 } tL2C_RCB;
 
 #ifndef L2CAP_CBB_DEFAULT_DATA_RATE_BUFF_QUOTA
@@ -394,6 +409,7 @@ typedef struct t_l2c_linkcb {
   tL2C_CCB* p_pending_ccb;  /* ccb of waiting channel during link disconnect */
   alarm_t* info_resp_timer; /* Timer entry for info resp timeout evt */
   RawAddress remote_bd_addr; /* The BD address of the remote */
+  uint8_t next_addr_hash; /* Next LCB (index + 1) in the same address bucket */
 
   uint8_t link_role; /* Master or slave */
   uint8_t id;
@@ -475,6 +491,13 @@ typedef struct {
   tL2C_CCB ccb_pool[MAX_L2CAP_CHANNELS]; /* Channel Control Block pool */
   tL2C_RCB rcb_pool[MAX_L2CAP_CLIENTS];  /* Registration info pool */
 
+  /* Lookup tables for the pools above, maintained by l2cu_allocate_* and
+   * l2cu_release_*. Entries hold the pool index plus one, 0 meaning none.
+   * CCBs need no table as the local CID is derived from the pool index. */
+  uint8_t lcb_by_handle[L2C_NUM_HCI_HANDLES];
+  uint8_t lcb_addr_hash[L2C_LCB_ADDR_HASH_SIZE];
+  uint8_t rcb_psm_hash[L2C_RCB_PSM_HASH_SIZE];
+
   tL2C_CCB* p_free_ccb_first; /* Pointer to first free CCB */
   tL2C_CCB* p_free_ccb_last;  /* Pointer to last  free CCB */
 
@@ -514,6 +537,7 @@ typedef struct {
   uint16_t ble_round_robin_unacked; /* Round-robin unacked */
   bool ble_check_round_robin;       /* Do a round robin check */
   tL2C_RCB ble_rcb_pool[BLE_MAX_L2CAP_CLIENTS]; /* Registration info pool */
+  uint8_t ble_rcb_psm_hash[L2C_RCB_PSM_HASH_SIZE];
 
   tL2CA_ECHO_DATA_CB* p_echo_data_cb; /* Echo data callback */
 
@@ -594,6 +618,7 @@ extern void l2cu_release_lcb(tL2C_LCB* p_lcb);
 extern tL2C_LCB* l2cu_find_lcb_by_bd_addr(const RawAddress& p_bd_addr,
                                           tBT_TRANSPORT transport);
 extern tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle);
+extern void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle);
 extern void l2cu_update_lcb_4_bonding(const RawAddress& p_bd_addr,
                                       bool is_bonding);
 
@@ -729,6 +754,9 @@ extern void l2c_pin_code_request(const RawAddress& bd_addr);
 extern void l2c_link_adjust_chnl_allocation(void);
 
 extern void l2c_link_processs_ble_num_bufs(uint16_t num_lm_acl_bufs);
+extern void l2c_link_scheduler_init(void);
+extern void l2c_link_scheduler_free(void);
+extern void l2c_link_scheduler_release_lcb(tL2C_LCB* p_lcb);
 
 #if (L2CAP_WAKE_PARKED_LINK == TRUE)
 extern bool l2c_link_check_power_mode(tL2C_LCB* p_lcb);
@@ -35,17 +35,27 @@
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
 #include "l2c_int.h"
+#include "l2c_link_scheduler.h"
 #include "l2cdefs.h"
 #include "log/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
+
+using bluetooth::l2cap::LinkScheduler;
 
 static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
                                    tL2C_TX_COMPLETE_CB_INFO* p_cbi);
 
+/* Weighted deficit round robin scheduler for ACL data, used instead of the
+ * quota/round-robin walk of l2c_link_check_send_pkts when
+ * L2C_LINK_SCHEDULER_PROPERTY is set. NULL when disabled. */
+static LinkScheduler* link_scheduler = NULL;
+
 /*******************************************************************************
  *
  * Function         l2c_link_hci_conn_req
@@ -180,10 +190,11 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
     return (false);
   }
 
-  /* Save the handle */
-  p_lcb->handle = handle;
-
   if (ci.status == HCI_SUCCESS) {
+    /* Save the handle. A failed connection may carry the handle of another
+     * link, so only a successful one is mapped. */
+    l2cu_set_lcb_handle(p_lcb, handle);
+
     /* Connected OK. Change state to connected */
     p_lcb->link_state = LST_CONNECTED;
 
@@ -233,7 +244,7 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
   else if ((ci.status == HCI_ERR_MAX_NUM_OF_CONNECTIONS) &&
            l2cu_lcb_disconnecting()) {
     p_lcb->link_state = LST_CONNECT_HOLDING;
-    p_lcb->handle = HCI_INVALID_HANDLE;
+    l2cu_set_lcb_handle(p_lcb, HCI_INVALID_HANDLE);
   } else {
     /* Just in case app decides to try again in the callback context */
     p_lcb->link_state = LST_DISCONNECTING;
@@ -456,7 +467,10 @@ bool l2c_link_hci_disc_comp(uint16_t handle, uint8_t reason) {
     p_lcb->p_pending_ccb = NULL;
 
     /* Release the LCB */
-    if (lcb_is_free) l2cu_release_lcb(p_lcb);
+    if (lcb_is_free)
+      l2cu_release_lcb(p_lcb);
+    else /* The controller may hand the old handle to another link */
+      l2cu_set_lcb_handle(p_lcb, HCI_INVALID_HANDLE);
   }
 
   /* Now that we have a free acl connection, see if any lcbs are pending */
@@ -954,6 +968,204 @@ bool l2c_link_check_power_mode(tL2C_LCB* p_lcb) {
 }
 #endif /* L2CAP_WAKE_PARKED_LINK == TRUE) */
 
+/*******************************************************************************
+ *
+ * Function         l2c_link_scheduler_init
+ *
+ * Description      Creates the deficit round robin ACL scheduler if it is
+ *                  enabled by L2C_LINK_SCHEDULER_PROPERTY.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2c_link_scheduler_init(void) {
+  l2c_link_scheduler_free();
+  if (!osi_property_get_bool(L2C_LINK_SCHEDULER_PROPERTY, false)) return;
+
+  L2CAP_TRACE_EVENT("%s: using deficit round robin ACL scheduler", __func__);
+  link_scheduler = new LinkScheduler(MAX_L2CAP_LINKS);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_scheduler_free
+ *
+ * Description      Frees the ACL scheduler, if any.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2c_link_scheduler_free(void) {
+  delete link_scheduler;
+  link_scheduler = NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_scheduler_release_lcb
+ *
+ * Description      Removes a released LCB from the ACL scheduler.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2c_link_scheduler_release_lcb(tL2C_LCB* p_lcb) {
+  if (link_scheduler == NULL) return;
+  link_scheduler->RemoveLink(p_lcb - l2cb.lcb_pool);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_scheduler_ready
+ *
+ * Description      Refreshes the scheduling parameters of a link from its LCB
+ *                  and puts it in the round of its controller buffer pool.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2c_link_scheduler_ready(tL2C_LCB* p_lcb, uint64_t now_us) {
+  size_t link = p_lcb - l2cb.lcb_pool;
+  LinkScheduler::Pool pool = (p_lcb->transport == BT_TRANSPORT_LE)
+                                 ? LinkScheduler::kLe
+                                 : LinkScheduler::kBrEdr;
+  uint16_t weight = (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH)
+                        ? L2C_LINK_SCHEDULER_WEIGHT_HIGH
+                        : L2C_LINK_SCHEDULER_WEIGHT_NORMAL;
+
+  /* Links without a quota of their own share the round-robin quota; let them
+   * have one buffer at a time and leave the rest to the controller window */
+  link_scheduler->ConfigureLink(link, pool, weight, p_lcb->link_xmit_quota,
+                                now_us);
+  link_scheduler->MarkReady(link, now_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_scheduler_service
+ *
+ * Description      Hands free controller buffers of a pool to the links picked
+ *                  by the ACL scheduler, until the pool or the links run dry.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2c_link_scheduler_service(LinkScheduler::Pool pool,
+                                       uint64_t now_us) {
+  uint16_t* p_window = (pool == LinkScheduler::kLe)
+                           ? &l2cb.controller_le_xmit_window
+                           : &l2cb.controller_xmit_window;
+
+  while (*p_window > 0) {
+    int link = link_scheduler->Next(pool);
+    if (link == LinkScheduler::kNoLink) break;
+
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[link];
+    /* These links are put back in the round by the l2c_link_check_send_pkts
+     * call that follows the state change */
+    if ((!p_lcb->in_use) || (p_lcb->partial_segment_being_sent) ||
+        (p_lcb->link_state != LST_CONNECTED) ||
+        (p_lcb->link_xmit_quota != 0 &&
+         p_lcb->sent_not_acked >= p_lcb->link_xmit_quota) ||
+        (L2C_LINK_CHECK_POWER_MODE(p_lcb))) {
+      link_scheduler->MarkIdle(link);
+      continue;
+    }
+
+    BT_HDR* p_buf;
+    tL2C_TX_COMPLETE_CB_INFO cbi;
+    tL2C_TX_COMPLETE_CB_INFO* p_cbi = NULL;
+    if (!list_is_empty(p_lcb->link_xmit_data_q)) {
+      p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
+      list_remove(p_lcb->link_xmit_data_q, p_buf);
+    } else {
+      p_buf = l2cu_get_next_buffer_to_send(p_lcb, &cbi);
+      p_cbi = &cbi;
+    }
+    if (p_buf == NULL) {
+      link_scheduler->MarkIdle(link);
+      continue;
+    }
+
+    uint16_t sent_not_acked = p_lcb->sent_not_acked;
+    l2c_link_send_to_lower(p_lcb, p_buf, p_cbi);
+    link_scheduler->OnSent(link, p_lcb->sent_not_acked - sent_not_acked,
+                           now_us);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_scheduler_check_send_pkts
+ *
+ * Description      l2c_link_check_send_pkts for the deficit round robin
+ *                  scheduler.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2c_link_scheduler_check_send_pkts(tL2C_LCB* p_lcb,
+                                               tL2C_CCB* p_ccb,
+                                               BT_HDR* p_buf) {
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+
+  if (p_buf) {
+    p_buf->event = (p_ccb != NULL) ? p_ccb->local_cid : 0;
+    p_buf->layer_specific = 0;
+    list_append(p_lcb->link_xmit_data_q, p_buf);
+  }
+
+  /* Like the legacy round robin, the links without a quota of their own only
+   * get buffers while the round-robin quota is not all outstanding */
+  link_scheduler->SetRoundRobinQuota(LinkScheduler::kBrEdr,
+                                     l2cb.round_robin_quota);
+  link_scheduler->SetRoundRobinQuota(LinkScheduler::kLe,
+                                     l2cb.ble_round_robin_quota);
+  if (p_lcb != NULL && p_lcb->in_use) l2c_link_scheduler_ready(p_lcb, now_us);
+
+  /* The link is served once the congestion callbacks have returned */
+  if (l2cb.is_cong_cback_context) return;
+
+  l2c_link_scheduler_service(LinkScheduler::kBrEdr, now_us);
+  l2c_link_scheduler_service(LinkScheduler::kLe, now_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_l2cap_link_dump
+ *
+ * Description      Dumps the per-link statistics of the ACL scheduler.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void stack_debug_l2cap_link_dump(int fd) {
+  if (link_scheduler == NULL) return;
+
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  dprintf(fd, "\nL2CAP ACL Scheduler:\n");
+  dprintf(fd, "  Controller window: BR/EDR %d LE %d\n",
+          l2cb.controller_xmit_window, l2cb.controller_le_xmit_window);
+
+  for (size_t i = 0; i < MAX_L2CAP_LINKS; i++) {
+    const tL2C_LCB& lcb = l2cb.lcb_pool[i];
+    if (!lcb.in_use) continue;
+
+    LinkScheduler::LinkStats stats = link_scheduler->GetStats(i, now_us);
+    dprintf(fd, "  Link handle: 0x%04x transport: %d priority: %d\n",
+            lcb.handle, lcb.transport, lcb.acl_priority);
+    dprintf(fd, "    Buffers in flight: %d quota: %d\n", lcb.sent_not_acked,
+            lcb.link_xmit_quota);
+    dprintf(fd, "    Buffers sent: %llu\n",
+            (unsigned long long)stats.packets_sent);
+    dprintf(fd, "    Queueing delay avg/max (us): %llu / %llu\n",
+            (unsigned long long)stats.AverageWaitUs(),
+            (unsigned long long)stats.wait_max_us);
+    dprintf(fd, "    Buffer credit utilization: %u%%\n",
+            stats.CreditUtilizationPercent());
+  }
+}
+
 /*******************************************************************************
  *
  * Function         l2c_link_check_send_pkts
@@ -969,6 +1181,11 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   int xx;
   bool single_write = false;
 
+  if (link_scheduler != NULL) {
+    l2c_link_scheduler_check_send_pkts(p_lcb, p_ccb, p_buf);
+    return;
+  }
+
   /* Save the channel ID for faster counting */
   if (p_buf) {
     if (p_ccb != NULL) {
@@ -1275,6 +1492,12 @@ void l2c_link_process_num_completed_pkts(uint8_t* p, uint8_t evt_len) {
       else
         p_lcb->sent_not_acked = 0;
 
+      if (link_scheduler != NULL) {
+        link_scheduler->OnCompleted(
+            p_lcb - l2cb.lcb_pool, num_sent,
+            bluetooth::common::time_get_os_boottime_us());
+      }
+
       l2c_link_check_send_pkts(p_lcb, NULL, NULL);
 
       /* If we were doing round-robin for low priority links, check 'em */
@@ -0,0 +1,286 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "l2c_link_scheduler.h"
+
+#include <base/logging.h>
+#include <algorithm>
+
+namespace bluetooth {
+namespace l2cap {
+
+LinkScheduler::LinkScheduler(size_t max_links) : links_(max_links) {
+  for (auto& link : links_) link.state = kUnused;
+  for (int pool = 0; pool < kNumPools; pool++) {
+    cursor_[pool] = kNoLink;
+    round_robin_quota_[pool] = UINT16_MAX;
+    round_robin_in_flight_[pool] = 0;
+    round_robin_next_[pool] = 0;
+  }
+}
+
+void LinkScheduler::ConfigureLink(size_t link, Pool pool, uint16_t weight,
+                                  uint16_t max_in_flight, uint64_t now_us) {
+  CHECK(link < links_.size());
+  Link& l = links_[link];
+
+  if (l.state == kUnused) {
+    l = {};
+    l.state = kIdle;
+    l.accounted_until_us = now_us;
+  }
+  Account(l, now_us);
+
+  bool in_round = l.state == kReady;
+  if (in_round && l.pool != pool) {
+    RemoveFromRound(link);
+    in_round = false;
+  }
+  Pool old_pool = l.pool;
+  bool was_round_robin = l.round_robin;
+  if (was_round_robin) round_robin_in_flight_[old_pool] -= l.in_flight;
+  l.pool = pool;
+  l.weight = std::max<uint16_t>(weight, 1);
+  l.max_in_flight = std::max<uint16_t>(max_in_flight, 1);
+  l.round_robin = max_in_flight == 0;
+  if (l.round_robin) round_robin_in_flight_[pool] += l.in_flight;
+
+  if (l.state != kIdle) {
+    if (IsBlocked(l)) {
+      if (in_round) RemoveFromRound(link);
+      l.state = kBlocked;
+    } else {
+      if (!in_round) AddToRound(link);
+      l.state = kReady;
+    }
+  }
+
+  // Moving buffers in or out of a round-robin quota may block or unblock the
+  // other links sharing it
+  if (l.in_flight > 0 && (was_round_robin || l.round_robin)) {
+    UpdateRoundRobinLinks(old_pool);
+    if (pool != old_pool) UpdateRoundRobinLinks(pool);
+  }
+}
+
+void LinkScheduler::SetRoundRobinQuota(Pool pool, uint16_t quota) {
+  if (round_robin_quota_[pool] == quota) return;
+  round_robin_quota_[pool] = quota;
+  UpdateRoundRobinLinks(pool);
+}
+
+void LinkScheduler::RemoveLink(size_t link) {
+  CHECK(link < links_.size());
+  Link& l = links_[link];
+  if (l.state == kUnused) return;
+  if (l.state == kReady) RemoveFromRound(link);
+  l.state = kUnused;
+
+  // Its buffers are not reported completed anymore
+  if (l.round_robin && l.in_flight > 0) {
+    round_robin_in_flight_[l.pool] -=
+        std::min(round_robin_in_flight_[l.pool], l.in_flight);
+    UpdateRoundRobinLinks(l.pool);
+  }
+}
+
+void LinkScheduler::MarkReady(size_t link, uint64_t now_us) {
+  CHECK(link < links_.size());
+  Link& l = links_[link];
+  CHECK(l.state != kUnused) << "link " << link << " is not configured";
+  if (l.state != kIdle) return;
+
+  l.backlogged_since_us = now_us;
+  if (IsBlocked(l)) {
+    l.state = kBlocked;
+  } else {
+    l.state = kReady;
+    AddToRound(link);
+  }
+}
+
+void LinkScheduler::MarkIdle(size_t link) {
+  CHECK(link < links_.size());
+  Link& l = links_[link];
+  if (l.state == kUnused || l.state == kIdle) return;
+
+  if (l.state == kReady) RemoveFromRound(link);
+  l.state = kIdle;
+  // Unused credit is not carried over to the next busy period, but debt from
+  // a segmented PDU is, so links cannot dodge it by going idle.
+  l.deficit = std::min<int32_t>(l.deficit, 0);
+}
+
+int LinkScheduler::Next(Pool pool) {
+  // Every lap over the ready list credits each link with at least one buffer,
+  // so this ends even when all of them start in debt.
+  while (cursor_[pool] != kNoLink) {
+    Link& l = links_[cursor_[pool]];
+    if (!l.visited) {
+      l.deficit += l.weight;
+      l.visited = true;
+    }
+    if (l.deficit > 0) return cursor_[pool];
+    Advance(pool);
+  }
+  return kNoLink;
+}
+
+void LinkScheduler::OnSent(size_t link, uint16_t num_bufs, uint64_t now_us) {
+  CHECK(link < links_.size());
+  Link& l = links_[link];
+  if (l.state == kUnused || num_bufs == 0) return;
+
+  uint64_t wait_us = now_us - l.backlogged_since_us;
+  l.stats.packets_sent += num_bufs;
+  l.stats.wait_samples++;
+  l.stats.wait_total_us += wait_us;
+  l.stats.wait_max_us = std::max(l.stats.wait_max_us, wait_us);
+  l.backlogged_since_us = now_us;
+
+  Account(l, now_us);
+  l.in_flight += num_bufs;
+  l.deficit -= num_bufs;
+  if (l.round_robin) {
+    bool was_full =
+        round_robin_in_flight_[l.pool] >= round_robin_quota_[l.pool];
+    round_robin_in_flight_[l.pool] += num_bufs;
+    round_robin_next_[l.pool] = (link + 1) % links_.size();
+    // The other round-robin links wait for the quota to be completed
+    if (!was_full &&
+        round_robin_in_flight_[l.pool] >= round_robin_quota_[l.pool]) {
+      UpdateRoundRobinLinks(l.pool);
+    }
+  }
+
+  if (l.state != kReady) return;
+  if (IsBlocked(l)) {
+    RemoveFromRound(link);
+    l.state = kBlocked;
+    l.deficit = std::min<int32_t>(l.deficit, 0);
+  } else if (l.deficit <= 0 && cursor_[l.pool] == (int)link) {
+    Advance(l.pool);
+  }
+}
+
+void LinkScheduler::OnCompleted(size_t link, uint16_t num_bufs,
+                                uint64_t now_us) {
+  CHECK(link < links_.size());
+  Link& l = links_[link];
+  if (l.state == kUnused) return;
+
+  Account(l, now_us);
+  num_bufs = std::min(l.in_flight, num_bufs);
+  l.in_flight -= num_bufs;
+  if (l.round_robin) {
+    bool was_full =
+        round_robin_in_flight_[l.pool] >= round_robin_quota_[l.pool];
+    round_robin_in_flight_[l.pool] -=
+        std::min(round_robin_in_flight_[l.pool], num_bufs);
+    if (was_full &&
+        round_robin_in_flight_[l.pool] < round_robin_quota_[l.pool]) {
+      UpdateRoundRobinLinks(l.pool);
+    }
+  }
+
+  if (l.state == kBlocked && !IsBlocked(l)) {
+    l.state = kReady;
+    AddToRound(link);
+  }
+}
+
+LinkScheduler::LinkStats LinkScheduler::GetStats(size_t link,
+                                                 uint64_t now_us) const {
+  CHECK(link < links_.size());
+  Link l = links_[link];
+  if (l.state == kUnused) return {};
+  Account(l, now_us);
+  return l.stats;
+}
+
+// Inserts |link| at the tail of its pool's round, i.e. right behind the link
+// being served.
+void LinkScheduler::AddToRound(size_t link) {
+  Link& l = links_[link];
+  int& cursor = cursor_[l.pool];
+  l.visited = false;
+
+  if (cursor == kNoLink) {
+    l.next = l.prev = link;
+    cursor = link;
+    return;
+  }
+  Link& head = links_[cursor];
+  l.next = cursor;
+  l.prev = head.prev;
+  links_[head.prev].next = link;
+  head.prev = link;
+}
+
+void LinkScheduler::RemoveFromRound(size_t link) {
+  Link& l = links_[link];
+  int& cursor = cursor_[l.pool];
+
+  if (l.next == (int)link) {
+    cursor = kNoLink;
+  } else {
+    if (cursor == (int)link) cursor = l.next;
+    links_[l.prev].next = l.next;
+    links_[l.next].prev = l.prev;
+  }
+  l.visited = false;
+}
+
+void LinkScheduler::Advance(Pool pool) {
+  Link& l = links_[cursor_[pool]];
+  l.visited = false;
+  cursor_[pool] = l.next;
+}
+
+bool LinkScheduler::IsBlocked(const Link& link) const {
+  return link.in_flight >= link.max_in_flight ||
+         (link.round_robin &&
+          round_robin_in_flight_[link.pool] >= round_robin_quota_[link.pool]);
+}
+
+// Takes the round-robin links of |pool| out of the round while its quota is
+// outstanding, and puts them back once it is not.
+void LinkScheduler::UpdateRoundRobinLinks(Pool pool) {
+  for (size_t i = 0; i < links_.size(); i++) {
+    size_t link = (round_robin_next_[pool] + i) % links_.size();
+    Link& l = links_[link];
+    if (!l.round_robin || l.pool != pool) continue;
+    if (l.state == kReady && IsBlocked(l)) {
+      RemoveFromRound(link);
+      l.state = kBlocked;
+      l.deficit = std::min<int32_t>(l.deficit, 0);
+    } else if (l.state == kBlocked && !IsBlocked(l)) {
+      l.state = kReady;
+      AddToRound(link);
+    }
+  }
+}
+
+void LinkScheduler::Account(Link& link, uint64_t now_us) {
+  if (now_us <= link.accounted_until_us) return;
+  uint64_t elapsed_us = now_us - link.accounted_until_us;
+  link.stats.in_flight_us += elapsed_us * link.in_flight;
+  link.stats.credit_us += elapsed_us * link.max_in_flight;
+  link.accounted_until_us = now_us;
+}
+
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bluetooth {
+namespace l2cap {
+
+/* LinkScheduler decides which ACL link gets the next controller buffer, using
+ * weighted deficit round robin over the links that have data queued.
+ *
+ * Each controller buffer pool (BR/EDR and LE) keeps a circular ready list of
+ * backlogged links, so picking the next link never scans idle ones. A link
+ * earns |weight| buffers of credit each time the round reaches it and is
+ * charged for every ACL segment it sends, so a segmented PDU may leave it in
+ * debt until later rounds. A link that has |max_in_flight| buffers
+ * outstanding in the controller leaves its ready list until the controller
+ * completes some of them. Links configured without a |max_in_flight| of their
+ * own share the pool's round-robin quota of buffers, and all of them leave
+ * the ready list while that quota is outstanding.
+ *
+ * The scheduler does not know about LCBs or the controller; the caller maps
+ * links to small indexes and passes in the time, which keeps it deterministic
+ * for the simulation tests.
+ */
+class LinkScheduler {
+ public:
+  enum Pool { kBrEdr = 0, kLe = 1, kNumPools = 2 };
+
+  static constexpr int kNoLink = -1;
+
+  struct LinkStats {
+    uint64_t packets_sent;
+    uint64_t wait_samples;
+    uint64_t wait_total_us;  // Time the link was backlogged before service
+    uint64_t wait_max_us;
+    uint64_t in_flight_us;  // Integral of the outstanding buffers over time
+    uint64_t credit_us;     // Integral of |max_in_flight| over time
+
+    uint64_t AverageWaitUs() const {
+      return wait_samples ? wait_total_us / wait_samples : 0;
+    }
+
+    // Share of the link's buffer credits that were outstanding, in percent.
+    unsigned CreditUtilizationPercent() const {
+      return credit_us ? (unsigned)(in_flight_us * 100 / credit_us) : 0;
+    }
+  };
+
+  explicit LinkScheduler(size_t max_links);
+
+  // Sets the pool, weight and in-flight cap of |link|. May be called again at
+  // any time, e.g. when the link priority or quotas change. A |max_in_flight|
+  // of 0 makes the link one buffer at a time out of the round-robin quota.
+  void ConfigureLink(size_t link, Pool pool, uint16_t weight,
+                     uint16_t max_in_flight, uint64_t now_us);
+
+  // Sets the number of buffers of |pool| the round-robin links may have
+  // outstanding together. Unlimited until set.
+  void SetRoundRobinQuota(Pool pool, uint16_t quota);
+
+  // Forgets |link|, including its statistics.
+  void RemoveLink(size_t link);
+
+  // Signals that |link| has data queued.
+  void MarkReady(size_t link, uint64_t now_us);
+
+  // Signals that |link| has nothing it can send right now.
+  void MarkIdle(size_t link);
+
+  // Returns the link that should send the next buffer of |pool|, or kNoLink.
+  // The link stays at the head of the round until it runs out of credit, so
+  // callers report what they sent with OnSent before calling Next again.
+  int Next(Pool pool);
+
+  // |num_bufs| controller buffers were handed to the controller for |link|.
+  void OnSent(size_t link, uint16_t num_bufs, uint64_t now_us);
+
+  // The controller reported |num_bufs| completed packets for |link|.
+  void OnCompleted(size_t link, uint16_t num_bufs, uint64_t now_us);
+
+  bool IsReady(size_t link) const { return links_[link].state == kReady; }
+  uint16_t InFlight(size_t link) const { return links_[link].in_flight; }
+  uint16_t RoundRobinInFlight(Pool pool) const {
+    return round_robin_in_flight_[pool];
+  }
+
+  // Returns the statistics of |link| accumulated up to |now_us|.
+  LinkStats GetStats(size_t link, uint64_t now_us) const;
+
+ private:
+  enum State { kUnused, kIdle, kReady, kBlocked };
+
+  struct Link {
+    State state;
+    Pool pool;
+    uint16_t weight;
+    uint16_t max_in_flight;
+    uint16_t in_flight;
+    bool round_robin;  // Whether it shares the pool's round-robin quota
+    int32_t deficit;
+    bool visited;  // Whether |deficit| got this round's quantum already
+    int next;
+    int prev;
+    uint64_t backlogged_since_us;
+    uint64_t accounted_until_us;
+    LinkStats stats;
+  };
+
+  void AddToRound(size_t link);
+  void RemoveFromRound(size_t link);
+  void Advance(Pool pool);
+  bool IsBlocked(const Link& link) const;
+  void UpdateRoundRobinLinks(Pool pool);
+  static void Account(Link& link, uint64_t now_us);
+
+  std::vector<Link> links_;
+  int cursor_[kNumPools];
+  uint16_t round_robin_quota_[kNumPools];
+  uint16_t round_robin_in_flight_[kNumPools];
+  // The round-robin links rejoin the round in order from the one after the
+  // last one served, so that none of them is always put back first.
+  size_t round_robin_next_[kNumPools];
+};
+
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -920,11 +920,14 @@ void l2c_init(void) {
   CHECK(l2cb.rcv_pending_q != NULL);
 
   l2cb.receive_hold_timer = alarm_new("l2c.receive_hold_timer");
+
+  l2c_link_scheduler_init();
 }
 
 void l2c_free(void) {
   list_free(l2cb.rcv_pending_q);
   l2cb.rcv_pending_q = NULL;
+  l2c_link_scheduler_free();
 }
 
 void l2c_receive_hold_timer_timeout(UNUSED_ATTR void* data) {
@@ -40,6 +40,83 @@
 #include "l2cdefs.h"
 #include "osi/include/allocator.h"
 
+static_assert(MAX_L2CAP_LINKS < UINT8_MAX && MAX_L2CAP_CLIENTS < UINT8_MAX &&
+                  BLE_MAX_L2CAP_CLIENTS < UINT8_MAX,
+              "L2CAP lookup tables store pool indexes in a uint8_t");
+
+/* Address and PSM hash buckets. Each bucket is a singly linked list threaded
+ * through the control blocks, holding pool indexes plus one. */
+static uint8_t* l2cu_lcb_addr_bucket(const RawAddress& bd_addr) {
+  uint32_t hash = (bd_addr.address[3] << 16) | (bd_addr.address[4] << 8) |
+                  bd_addr.address[5];
+  hash ^= hash >> 5;
+  return &l2cb.lcb_addr_hash[hash & (L2C_LCB_ADDR_HASH_SIZE - 1)];
+}
+
+static void l2cu_hash_lcb(tL2C_LCB* p_lcb) {
+  uint8_t* p_bucket = l2cu_lcb_addr_bucket(p_lcb->remote_bd_addr);
+  p_lcb->next_addr_hash = *p_bucket;
+  *p_bucket = p_lcb - l2cb.lcb_pool + 1;
+}
+
+static void l2cu_unhash_lcb(tL2C_LCB* p_lcb) {
+  uint8_t index = p_lcb - l2cb.lcb_pool + 1;
+  uint8_t* p_link = l2cu_lcb_addr_bucket(p_lcb->remote_bd_addr);
+  while (*p_link != 0) {
+    if (*p_link == index) {
+      *p_link = p_lcb->next_addr_hash;
+      p_lcb->next_addr_hash = 0;
+      return;
+    }
+    p_link = &l2cb.lcb_pool[*p_link - 1].next_addr_hash;
+  }
+}
+
+/* The handle may already have been handed to a newer link if this one was
+ * kept around after a disconnection, in which case the entry is left alone. */
+static void l2cu_unmap_lcb_handle(tL2C_LCB* p_lcb) {
+  uint8_t index = p_lcb - l2cb.lcb_pool + 1;
+  if (p_lcb->handle < L2C_NUM_HCI_HANDLES &&
+      l2cb.lcb_by_handle[p_lcb->handle] == index)
+    l2cb.lcb_by_handle[p_lcb->handle] = 0;
+}
+
+static uint8_t* l2cu_rcb_psm_bucket(uint8_t* p_hash, uint16_t psm) {
+  /* PSMs are odd, the lowest bit carries no information */
+  return &p_hash[((psm >> 1) ^ (psm >> 6)) & (L2C_RCB_PSM_HASH_SIZE - 1)];
+}
+
+static void l2cu_hash_rcb(tL2C_RCB* p_pool, uint8_t* p_hash,
+                          tL2C_RCB* p_rcb) {
+  uint8_t* p_bucket = l2cu_rcb_psm_bucket(p_hash, p_rcb->psm);
+  p_rcb->next_psm_hash = *p_bucket;
+  *p_bucket = p_rcb - p_pool + 1;
+}
+
+static void l2cu_unhash_rcb(tL2C_RCB* p_pool, uint8_t* p_hash,
+                            tL2C_RCB* p_rcb) {
+  uint8_t index = p_rcb - p_pool + 1;
+  uint8_t* p_link = l2cu_rcb_psm_bucket(p_hash, p_rcb->psm);
+  while (*p_link != 0) {
+    if (*p_link == index) {
+      *p_link = p_rcb->next_psm_hash;
+      p_rcb->next_psm_hash = 0;
+      return;
+    }
+    p_link = &p_pool[*p_link - 1].next_psm_hash;
+  }
+}
+
+static tL2C_RCB* l2cu_find_hashed_rcb(tL2C_RCB* p_pool, uint8_t* p_hash,
+                                      uint16_t psm) {
+  for (uint8_t index = *l2cu_rcb_psm_bucket(p_hash, psm); index != 0;
+       index = p_pool[index - 1].next_psm_hash) {
+    tL2C_RCB* p_rcb = &p_pool[index - 1];
+    if (p_rcb->in_use && p_rcb->psm == psm) return p_rcb;
+  }
+  return NULL;
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_can_allocate_lcb
@@ -91,6 +168,7 @@ tL2C_LCB* l2cu_allocate_lcb(const RawAddress& p_bd_addr, bool is_bonding,
       p_lcb->tx_data_len =
           controller_get_interface()->get_ble_default_data_packet_length();
       p_lcb->le_sec_pending_q = fixed_queue_new(SIZE_MAX);
+      l2cu_hash_lcb(p_lcb);
 
       if (transport == BT_TRANSPORT_LE) {
         l2cb.num_ble_links_active++;
@@ -141,6 +219,9 @@ void l2cu_update_lcb_4_bonding(const RawAddress& p_bd_addr, bool is_bonding) {
 void l2cu_release_lcb(tL2C_LCB* p_lcb) {
   tL2C_CCB* p_ccb;
 
+  l2cu_unmap_lcb_handle(p_lcb);
+  l2cu_unhash_lcb(p_lcb);
+  l2c_link_scheduler_release_lcb(p_lcb);
   p_lcb->in_use = false;
   p_lcb->is_bonding = false;
 
@@ -244,10 +325,10 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_bd_addr(const RawAddress& p_bd_addr,
                                    tBT_TRANSPORT transport) {
-  int xx;
-  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
+  uint8_t index = *l2cu_lcb_addr_bucket(p_bd_addr);
 
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
+  for (; index != 0; index = l2cb.lcb_pool[index - 1].next_addr_hash) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[index - 1];
     if ((p_lcb->in_use) && p_lcb->transport == transport &&
         (p_lcb->remote_bd_addr == p_bd_addr)) {
       return (p_lcb);
@@ -1688,6 +1769,7 @@ tL2C_RCB* l2cu_allocate_rcb(uint16_t psm) {
     if (!p_rcb->in_use) {
       p_rcb->in_use = true;
       p_rcb->psm = psm;
+      l2cu_hash_rcb(l2cb.rcb_pool, l2cb.rcb_psm_hash, p_rcb);
       return (p_rcb);
     }
   }
@@ -1714,6 +1796,7 @@ tL2C_RCB* l2cu_allocate_ble_rcb(uint16_t psm) {
     if (!p_rcb->in_use) {
       p_rcb->in_use = true;
       p_rcb->psm = psm;
+      l2cu_hash_rcb(l2cb.ble_rcb_pool, l2cb.ble_rcb_psm_hash, p_rcb);
       return (p_rcb);
     }
   }
@@ -1732,6 +1815,7 @@ tL2C_RCB* l2cu_allocate_ble_rcb(uint16_t psm) {
  *
  ******************************************************************************/
 void l2cu_release_rcb(tL2C_RCB* p_rcb) {
+  l2cu_unhash_rcb(l2cb.rcb_pool, l2cb.rcb_psm_hash, p_rcb);
   p_rcb->in_use = false;
   p_rcb->psm = 0;
 }
@@ -1747,6 +1831,7 @@ void l2cu_release_rcb(tL2C_RCB* p_rcb) {
  ******************************************************************************/
 void l2cu_release_ble_rcb(tL2C_RCB* p_rcb) {
   L2CA_FreeLePSM(p_rcb->psm);
+  l2cu_unhash_rcb(l2cb.ble_rcb_pool, l2cb.ble_rcb_psm_hash, p_rcb);
   p_rcb->in_use = false;
   p_rcb->psm = 0;
 }
@@ -1791,15 +1876,7 @@ void l2cu_disconnect_chnl(tL2C_CCB* p_ccb) {
  *
  ******************************************************************************/
 tL2C_RCB* l2cu_find_rcb_by_psm(uint16_t psm) {
-  tL2C_RCB* p_rcb = &l2cb.rcb_pool[0];
-  uint16_t xx;
-
-  for (xx = 0; xx < MAX_L2CAP_CLIENTS; xx++, p_rcb++) {
-    if ((p_rcb->in_use) && (p_rcb->psm == psm)) return (p_rcb);
-  }
-
-  /* If here, no match found */
-  return (NULL);
+  return l2cu_find_hashed_rcb(l2cb.rcb_pool, l2cb.rcb_psm_hash, psm);
 }
 
 /*******************************************************************************
@@ -1813,15 +1890,7 @@ tL2C_RCB* l2cu_find_rcb_by_psm(uint16_t psm) {
  *
  ******************************************************************************/
 tL2C_RCB* l2cu_find_ble_rcb_by_psm(uint16_t psm) {
-  tL2C_RCB* p_rcb = &l2cb.ble_rcb_pool[0];
-  uint16_t xx;
-
-  for (xx = 0; xx < BLE_MAX_L2CAP_CLIENTS; xx++, p_rcb++) {
-    if ((p_rcb->in_use) && (p_rcb->psm == psm)) return (p_rcb);
-  }
-
-  /* If here, no match found */
-  return (NULL);
+  return l2cu_find_hashed_rcb(l2cb.ble_rcb_pool, l2cb.ble_rcb_psm_hash, psm);
 }
 
 /*******************************************************************************
@@ -3041,6 +3110,13 @@ void l2cu_send_peer_ble_credit_based_disconn_req(tL2C_CCB* p_ccb) {
  *
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
+  if (handle < L2C_NUM_HCI_HANDLES) {
+    uint8_t index = l2cb.lcb_by_handle[handle];
+    if (index == 0) return (NULL);
+    return (&l2cb.lcb_pool[index - 1]);
+  }
+
+  /* Links that are not connected yet all share HCI_INVALID_HANDLE */
   int xx;
   tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
 
@@ -3054,6 +3130,36 @@ tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_set_lcb_handle
+ *
+ * Description      Set the HCI handle of an LCB, keeping the handle lookup
+ *                  table in step. Must be used instead of writing
+ *                  p_lcb->handle directly.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle) {
+  l2cu_unmap_lcb_handle(p_lcb);
+
+  p_lcb->handle = handle;
+  if (handle >= L2C_NUM_HCI_HANDLES) return;
+
+  /* Never take the handle of another live link */
+  uint8_t owner = l2cb.lcb_by_handle[handle];
+  if (owner != 0 && &l2cb.lcb_pool[owner - 1] != p_lcb) {
+    tL2C_LCB* p_owner = &l2cb.lcb_pool[owner - 1];
+    if (p_owner->in_use && p_owner->handle == handle) {
+      L2CAP_TRACE_ERROR("%s: handle 0x%04x already used by another link",
+                        __func__, handle);
+      return;
+    }
+  }
+  l2cb.lcb_by_handle[handle] = p_lcb - l2cb.lcb_pool + 1;
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_find_ccb_by_cid
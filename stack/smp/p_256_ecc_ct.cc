@@ -0,0 +1,489 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the constant-time P-256 point multiplications used for
+ *  LE Secure Connections.
+ *
+ *  Field elements are kept in Montgomery form, with 64-bit limbs when the
+ *  compiler has 128-bit integers and 32-bit limbs otherwise. Points are in
+ *  homogeneous projective coordinates, and are added with the complete
+ *  formulas of Renes, Costello and Batina ("Complete addition formulas for
+ *  prime order elliptic curves", 2016): the point at infinity and the
+ *  doubling need no special case. None of the branches or memory accesses
+ *  depend on the scalar.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "p_256_ecc_pp.h"
+
+namespace {
+
+#if defined(__SIZEOF_INT128__)
+typedef uint64_t limb_t;
+typedef unsigned __int128 dlimb_t;
+#define P256_LIMB_BITS 64
+#else
+typedef uint32_t limb_t;
+typedef uint64_t dlimb_t;
+#define P256_LIMB_BITS 32
+#endif
+
+constexpr int kLimbs = 256 / P256_LIMB_BITS;
+
+struct Fe {
+  limb_t v[kLimbs];
+};
+
+/* Field elements from their 64-bit words, least significant first */
+#if P256_LIMB_BITS == 64
+#define P256_FE(w0, w1, w2, w3) \
+  {                             \
+    { w0, w1, w2, w3 }          \
+  }
+#else
+#define P256_FE(w0, w1, w2, w3)                                      \
+  {                                                                  \
+    {                                                                \
+      (uint32_t)(w0), (uint32_t)((w0) >> 32), (uint32_t)(w1),        \
+          (uint32_t)((w1) >> 32), (uint32_t)(w2),                    \
+          (uint32_t)((w2) >> 32), (uint32_t)(w3), (uint32_t)((w3) >> 32) \
+    }                                                                \
+  }
+#endif
+
+/* p = 2^256 - 2^224 + 2^192 + 2^96 - 1 */
+const Fe kP = P256_FE(0xffffffffffffffffULL, 0x00000000ffffffffULL,
+                      0x0000000000000000ULL, 0xffffffff00000001ULL);
+
+/* 2^512 mod p, to convert into the Montgomery form */
+const Fe kRR = P256_FE(0x0000000000000003ULL, 0xfffffffbffffffffULL,
+                       0xfffffffffffffffeULL, 0x00000004fffffffdULL);
+
+/* 2^256 mod p, 1 in the Montgomery form */
+const Fe kOne = P256_FE(0x0000000000000001ULL, 0xffffffff00000000ULL,
+                        0xffffffffffffffffULL, 0x00000000fffffffeULL);
+
+const Fe kB = P256_FE(0x3bce3c3e27d2604bULL, 0x651d06b0cc53b0f6ULL,
+                      0xb3ebbd55769886bcULL, 0x5ac635d8aa3a93e7ULL);
+
+const Fe kGx = P256_FE(0xf4a13945d898c296ULL, 0x77037d812deb33a0ULL,
+                       0xf8bce6e563a440f2ULL, 0x6b17d1f2e12c4247ULL);
+
+const Fe kGy = P256_FE(0xcbb6406837bf51f5ULL, 0x2bce33576b315eceULL,
+                       0x8ee7eb4a7c0f9e16ULL, 0x4fe342e2fe1a7f9bULL);
+
+/* All ones if |bit| is 1, zero if it is 0 */
+inline limb_t mask_of(limb_t bit) { return (limb_t)0 - bit; }
+
+/* Returns a - b, and the borrow */
+inline limb_t fe_sub_raw(Fe* r, const Fe& a, const Fe& b) {
+  limb_t borrow = 0;
+  for (int i = 0; i < kLimbs; i++) {
+    dlimb_t d = (dlimb_t)a.v[i] - b.v[i] - borrow;
+    r->v[i] = (limb_t)d;
+    borrow = (limb_t)(d >> P256_LIMB_BITS) & 1;
+  }
+  return borrow;
+}
+
+/* r = a if |mask| is all ones, b if it is zero */
+inline void fe_select(Fe* r, limb_t mask, const Fe& a, const Fe& b) {
+  for (int i = 0; i < kLimbs; i++) {
+    r->v[i] = (a.v[i] & mask) | (b.v[i] & ~mask);
+  }
+}
+
+/* r = (a + b) mod p, a < p, b < p */
+void fe_add(Fe* r, const Fe& a, const Fe& b) {
+  Fe sum;
+  limb_t carry = 0;
+  for (int i = 0; i < kLimbs; i++) {
+    dlimb_t s = (dlimb_t)a.v[i] + b.v[i] + carry;
+    sum.v[i] = (limb_t)s;
+    carry = (limb_t)(s >> P256_LIMB_BITS);
+  }
+  Fe reduced;
+  limb_t borrow = fe_sub_raw(&reduced, sum, kP);
+  /* keep the sum if it is below p */
+  fe_select(r, mask_of(carry | (borrow ^ 1)), reduced, sum);
+}
+
+/* r = (a - b) mod p, a < p, b < p */
+void fe_sub(Fe* r, const Fe& a, const Fe& b) {
+  Fe diff;
+  limb_t mask = mask_of(fe_sub_raw(&diff, a, b));
+  limb_t carry = 0;
+  for (int i = 0; i < kLimbs; i++) {
+    dlimb_t s = (dlimb_t)diff.v[i] + (kP.v[i] & mask) + carry;
+    r->v[i] = (limb_t)s;
+    carry = (limb_t)(s >> P256_LIMB_BITS);
+  }
+}
+
+/* r = a * b / 2^256 mod p, a < p, b < p. Montgomery multiplication with
+ * interleaved reduction; -1/p mod 2^w is 1, as p = -1 mod 2^96. */
+void fe_mul(Fe* r, const Fe& a, const Fe& b) {
+  limb_t t[kLimbs + 2] = {0};
+  for (int i = 0; i < kLimbs; i++) {
+    limb_t carry = 0;
+    for (int j = 0; j < kLimbs; j++) {
+      dlimb_t s = (dlimb_t)a.v[j] * b.v[i] + t[j] + carry;
+      t[j] = (limb_t)s;
+      carry = (limb_t)(s >> P256_LIMB_BITS);
+    }
+    dlimb_t s = (dlimb_t)t[kLimbs] + carry;
+    t[kLimbs] = (limb_t)s;
+    t[kLimbs + 1] = (limb_t)(s >> P256_LIMB_BITS);
+
+    limb_t m = t[0];
+    s = (dlimb_t)m * kP.v[0] + t[0];
+    carry = (limb_t)(s >> P256_LIMB_BITS);
+    for (int j = 1; j < kLimbs; j++) {
+      s = (dlimb_t)m * kP.v[j] + t[j] + carry;
+      t[j - 1] = (limb_t)s;
+      carry = (limb_t)(s >> P256_LIMB_BITS);
+    }
+    s = (dlimb_t)t[kLimbs] + carry;
+    t[kLimbs - 1] = (limb_t)s;
+    t[kLimbs] = t[kLimbs + 1] + (limb_t)(s >> P256_LIMB_BITS);
+  }
+
+  /* t < 2p */
+  Fe sum, reduced;
+  memcpy(sum.v, t, sizeof(sum.v));
+  limb_t borrow = fe_sub_raw(&reduced, sum, kP);
+  fe_select(r, mask_of(t[kLimbs] | (borrow ^ 1)), reduced, sum);
+}
+
+inline void fe_sqr(Fe* r, const Fe& a) { fe_mul(r, a, a); }
+
+/* r = a^(2^n) */
+void fe_sqr_n(Fe* r, const Fe& a, int n) {
+  *r = a;
+  for (int i = 0; i < n; i++) fe_sqr(r, *r);
+}
+
+/* r = 1 / a, or 0 if a is 0: a^(p - 2), with the exponent
+ * ffffffff 00000001 00000000 00000000 00000000 ffffffff ffffffff fffffffd
+ * built from xn = a^(2^n - 1). */
+void fe_inv(Fe* r, const Fe& a) {
+  Fe x2, x4, x6, x8, x14, x16, x30, x32, t;
+
+  fe_sqr(&t, a);
+  fe_mul(&x2, t, a);
+  fe_sqr_n(&t, x2, 2);
+  fe_mul(&x4, t, x2);
+  fe_sqr_n(&t, x4, 2);
+  fe_mul(&x6, t, x2);
+  fe_sqr_n(&t, x6, 2);
+  fe_mul(&x8, t, x2);
+  fe_sqr_n(&t, x8, 6);
+  fe_mul(&x14, t, x6);
+  fe_sqr_n(&t, x14, 2);
+  fe_mul(&x16, t, x2);
+  fe_sqr_n(&t, x16, 14);
+  fe_mul(&x30, t, x14);
+  fe_sqr_n(&t, x30, 2);
+  fe_mul(&x32, t, x2);
+
+  fe_sqr_n(&t, x32, 32);
+  fe_mul(&t, t, a);
+  fe_sqr_n(&t, t, 128);
+  fe_mul(&t, t, x32);
+  fe_sqr_n(&t, t, 32);
+  fe_mul(&t, t, x32);
+  fe_sqr_n(&t, t, 30);
+  fe_mul(&t, t, x30);
+  fe_sqr_n(&t, t, 2);
+  fe_mul(r, t, a);
+}
+
+inline void fe_to_mont(Fe* r, const Fe& a) { fe_mul(r, a, kRR); }
+
+/* From the 32-bit words of the Point structures, into the Montgomery form */
+void fe_from_words(Fe* r, const uint32_t* words) {
+  Fe a;
+  memset(&a, 0, sizeof(a));
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+    a.v[i * 32 / P256_LIMB_BITS] |= (limb_t)words[i]
+                                    << (i * 32 % P256_LIMB_BITS);
+  }
+  fe_to_mont(r, a);
+}
+
+void fe_to_words(uint32_t* words, const Fe& a) {
+  Fe one, r;
+  memset(&one, 0, sizeof(one));
+  one.v[0] = 1;
+  fe_mul(&r, a, one);
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+    words[i] = (uint32_t)(r.v[i * 32 / P256_LIMB_BITS] >>
+                          (i * 32 % P256_LIMB_BITS));
+  }
+}
+
+/* Homogeneous projective coordinates: x = X / Z, y = Y / Z */
+struct ProjectivePoint {
+  Fe X;
+  Fe Y;
+  Fe Z;
+};
+
+const Fe& b_mont() {
+  static const Fe b = [] {
+    Fe r;
+    fe_to_mont(&r, kB);
+    return r;
+  }();
+  return b;
+}
+
+void point_set_infinity(ProjectivePoint* p) {
+  memset(&p->X, 0, sizeof(p->X));
+  p->Y = kOne;
+  memset(&p->Z, 0, sizeof(p->Z));
+}
+
+/* r = p + q, complete for a = -3 (algorithm 4 of the paper). r may alias. */
+void point_add(ProjectivePoint* r, const ProjectivePoint& p,
+               const ProjectivePoint& q) {
+  const Fe& b = b_mont();
+  Fe t0, t1, t2, t3, t4, X3, Y3, Z3;
+
+  fe_mul(&t0, p.X, q.X);
+  fe_mul(&t1, p.Y, q.Y);
+  fe_mul(&t2, p.Z, q.Z);
+  fe_add(&t3, p.X, p.Y);
+  fe_add(&t4, q.X, q.Y);
+  fe_mul(&t3, t3, t4);
+  fe_add(&t4, t0, t1);
+  fe_sub(&t3, t3, t4);
+  fe_add(&t4, p.Y, p.Z);
+  fe_add(&X3, q.Y, q.Z);
+  fe_mul(&t4, t4, X3);
+  fe_add(&X3, t1, t2);
+  fe_sub(&t4, t4, X3);
+  fe_add(&X3, p.X, p.Z);
+  fe_add(&Y3, q.X, q.Z);
+  fe_mul(&X3, X3, Y3);
+  fe_add(&Y3, t0, t2);
+  fe_sub(&Y3, X3, Y3);
+  fe_mul(&Z3, b, t2);
+  fe_sub(&X3, Y3, Z3);
+  fe_add(&Z3, X3, X3);
+  fe_add(&X3, X3, Z3);
+  fe_sub(&Z3, t1, X3);
+  fe_add(&X3, t1, X3);
+  fe_mul(&Y3, b, Y3);
+  fe_add(&t1, t2, t2);
+  fe_add(&t2, t1, t2);
+  fe_sub(&Y3, Y3, t2);
+  fe_sub(&Y3, Y3, t0);
+  fe_add(&t1, Y3, Y3);
+  fe_add(&Y3, t1, Y3);
+  fe_add(&t1, t0, t0);
+  fe_add(&t0, t1, t0);
+  fe_sub(&t0, t0, t2);
+  fe_mul(&t1, t4, Y3);
+  fe_mul(&t2, t0, Y3);
+  fe_mul(&Y3, X3, Z3);
+  fe_add(&Y3, Y3, t2);
+  fe_mul(&X3, t3, X3);
+  fe_sub(&X3, X3, t1);
+  fe_mul(&Z3, t4, Z3);
+  fe_mul(&t1, t3, t0);
+  fe_add(&Z3, Z3, t1);
+
+  r->X = X3;
+  r->Y = Y3;
+  r->Z = Z3;
+}
+
+/* r = 2p, complete for a = -3 (algorithm 6 of the paper). r may alias. */
+void point_double(ProjectivePoint* r, const ProjectivePoint& p) {
+  const Fe& b = b_mont();
+  Fe t0, t1, t2, t3, X3, Y3, Z3;
+
+  fe_sqr(&t0, p.X);
+  fe_sqr(&t1, p.Y);
+  fe_sqr(&t2, p.Z);
+  fe_mul(&t3, p.X, p.Y);
+  fe_add(&t3, t3, t3);
+  fe_mul(&Z3, p.X, p.Z);
+  fe_add(&Z3, Z3, Z3);
+  fe_mul(&Y3, b, t2);
+  fe_sub(&Y3, Y3, Z3);
+  fe_add(&X3, Y3, Y3);
+  fe_add(&Y3, X3, Y3);
+  fe_sub(&X3, t1, Y3);
+  fe_add(&Y3, t1, Y3);
+  fe_mul(&Y3, X3, Y3);
+  fe_mul(&X3, X3, t3);
+  fe_add(&t3, t2, t2);
+  fe_add(&t2, t2, t3);
+  fe_mul(&Z3, b, Z3);
+  fe_sub(&Z3, Z3, t2);
+  fe_sub(&Z3, Z3, t0);
+  fe_add(&t3, Z3, Z3);
+  fe_add(&Z3, Z3, t3);
+  fe_add(&t3, t0, t0);
+  fe_add(&t0, t3, t0);
+  fe_sub(&t0, t0, t2);
+  fe_mul(&t0, t0, Z3);
+  fe_add(&Y3, Y3, t0);
+  fe_mul(&t0, p.Y, p.Z);
+  fe_add(&t0, t0, t0);
+  fe_mul(&Z3, t0, Z3);
+  fe_sub(&X3, X3, Z3);
+  fe_mul(&Z3, t0, t1);
+  fe_add(&Z3, Z3, Z3);
+  fe_add(&Z3, Z3, Z3);
+
+  r->X = X3;
+  r->Y = Y3;
+  r->Z = Z3;
+}
+
+/* r = table[index], reading every entry */
+void point_select(ProjectivePoint* r, const ProjectivePoint* table,
+                  uint32_t size, uint32_t index) {
+  memset(r, 0, sizeof(*r));
+  for (uint32_t i = 0; i < size; i++) {
+    limb_t mask = mask_of(((i ^ index) - 1) >> 31);
+    for (int j = 0; j < kLimbs; j++) {
+      r->X.v[j] |= table[i].X.v[j] & mask;
+      r->Y.v[j] |= table[i].Y.v[j] & mask;
+      r->Z.v[j] |= table[i].Z.v[j] & mask;
+    }
+  }
+}
+
+void point_from_affine(ProjectivePoint* r, const uint32_t* x,
+                       const uint32_t* y) {
+  fe_from_words(&r->X, x);
+  fe_from_words(&r->Y, y);
+  r->Z = kOne;
+}
+
+/* The point at infinity is returned as (0, 0) */
+void point_to_affine(Point* q, const ProjectivePoint& p) {
+  Fe z_inv, x, y;
+  fe_inv(&z_inv, p.Z);
+  fe_mul(&x, p.X, z_inv);
+  fe_mul(&y, p.Y, z_inv);
+  fe_to_words(q->x, x);
+  fe_to_words(q->y, y);
+  memset(q->z, 0, sizeof(q->z));
+  q->z[0] = 1;
+}
+
+/* Bits |bit|, |bit| + 64, |bit| + 128 and |bit| + 192 of |n|: the teeth of
+ * the comb */
+inline uint32_t comb_index(const uint32_t* n, int bit) {
+  uint32_t index = 0;
+  for (int tooth = 0; tooth < 4; tooth++) {
+    int i = bit + tooth * 64;
+    index |= ((n[i / 32] >> (i % 32)) & 1) << tooth;
+  }
+  return index;
+}
+
+/* Fixed-base comb of the base point with 4 teeth 64 bits apart, split in
+ * two blocks of 32 bits. table[0][i] is the sum of the 2^(64 t) G for the
+ * bits t of i, table[1][i] is 2^32 table[0][i]. */
+struct CombTable {
+  ProjectivePoint table[2][16];
+};
+
+const CombTable& comb_table() {
+  static const CombTable comb = [] {
+    CombTable c;
+    ProjectivePoint teeth[4];
+    fe_to_mont(&teeth[0].X, kGx);
+    fe_to_mont(&teeth[0].Y, kGy);
+    teeth[0].Z = kOne;
+    for (int t = 1; t < 4; t++) {
+      teeth[t] = teeth[t - 1];
+      for (int i = 0; i < 64; i++) point_double(&teeth[t], teeth[t]);
+    }
+
+    for (uint32_t i = 0; i < 16; i++) {
+      point_set_infinity(&c.table[0][i]);
+      for (int t = 0; t < 4; t++) {
+        if (i & (1 << t)) point_add(&c.table[0][i], c.table[0][i], teeth[t]);
+      }
+      c.table[1][i] = c.table[0][i];
+      for (int j = 0; j < 32; j++) point_double(&c.table[1][i], c.table[1][i]);
+    }
+    return c;
+  }();
+  return comb;
+}
+
+}  // namespace
+
+void ECC_PointMult_Window(Point* q, const Point* p, const uint32_t* n) {
+  /* table[i] = i p */
+  ProjectivePoint table[16];
+  point_set_infinity(&table[0]);
+  point_from_affine(&table[1], p->x, p->y);
+  for (int i = 2; i < 16; i++) point_add(&table[i], table[i - 1], table[1]);
+
+  ProjectivePoint r, t;
+  point_set_infinity(&r);
+  for (int i = 63; i >= 0; i--) {
+    for (int j = 0; j < 4; j++) point_double(&r, r);
+    point_select(&t, table, 16, (n[i / 8] >> (i % 8 * 4)) & 0x0f);
+    point_add(&r, r, t);
+  }
+  point_to_affine(q, r);
+}
+
+void ECC_PointMult_Base(Point* q, const uint32_t* n) {
+  const CombTable& comb = comb_table();
+
+  ProjectivePoint r, t;
+  point_set_infinity(&r);
+  for (int i = 31; i >= 0; i--) {
+    point_double(&r, r);
+    point_select(&t, comb.table[1], 16, comb_index(n, i + 32));
+    point_add(&r, r, t);
+    point_select(&t, comb.table[0], 16, comb_index(n, i));
+    point_add(&r, r, t);
+  }
+  point_to_affine(q, r);
+}
+
+void ECC_PointMult_P256(Point* q, Point* p, uint32_t* n, uint32_t keyLength) {
+  if (keyLength != KEY_LENGTH_DWORDS_P256) {
+    ECC_PointMult_Bin_NAF(q, p, n, keyLength);
+    return;
+  }
+
+  /* The points are public */
+  if (memcmp(p->x, curve_p256.G.x, sizeof(p->x)) == 0 &&
+      memcmp(p->y, curve_p256.G.y, sizeof(p->y)) == 0) {
+    ECC_PointMult_Base(q, n);
+  } else {
+    ECC_PointMult_Window(q, p, n);
+  }
+}
@@ -58,9 +58,21 @@ extern elliptic_curve_t curve_p256;
 
 bool ECC_ValidatePoint(const Point& p);
 
+// Variable-time multiplication; |n| is cleared.
 void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n, uint32_t keyLength);
 
+// Constant-time multiplications on P-256, with a fixed 4-bit window for any
+// point and a fixed-base comb for the base point. |n| is left unchanged, and
+// |q| is affine, with z = 1.
+void ECC_PointMult_Window(Point* q, const Point* p, const uint32_t* n);
+void ECC_PointMult_Base(Point* q, const uint32_t* n);
+
+// Uses ECC_PointMult_Base() for the base point and ECC_PointMult_Window()
+// for the others on P-256, ECC_PointMult_Bin_NAF() on other curves. On P-256
+// |n| is left unchanged, the callers clear their copies of a private key.
+void ECC_PointMult_P256(Point* q, Point* p, uint32_t* n, uint32_t keyLength);
+
 #define ECC_PointMult(q, p, n, keyLength) \
-  ECC_PointMult_Bin_NAF(q, p, n, keyLength)
+  ECC_PointMult_P256(q, p, n, keyLength)
 
 void p_256_init_curve(uint32_t keyLength);
@@ -54,6 +54,13 @@ static void smp_process_private_key(tSMP_CB* p_cb);
 
 #define SMP_PASSKEY_MASK 0xfff00000
 
+/* Clears the copy of a secret, without the stores being optimized out as
+ * dead. ECC_PointMult() leaves the scalar unchanged. */
+static void smp_clear_secret(void* p, size_t len) {
+  volatile uint8_t* v = (volatile uint8_t*)p;
+  while (len--) *v++ = 0;
+}
+
 void smp_debug_print_nbyte_little_endian(uint8_t* p, const char* key_name,
                                          uint8_t len) {
 #if (SMP_DEBUG == TRUE)
@@ -693,6 +700,7 @@ void smp_process_private_key(tSMP_CB* p_cb) {
   memcpy(private_key, p_cb->private_key, BT_OCTET32_LEN);
   ECC_PointMult(&public_key, &(curve_p256.G), (uint32_t*)private_key,
                 KEY_LENGTH_DWORDS_P256);
+  smp_clear_secret(private_key, sizeof(private_key));
   memcpy(p_cb->loc_publ_key.x, public_key.x, BT_OCTET32_LEN);
   memcpy(p_cb->loc_publ_key.y, public_key.y, BT_OCTET32_LEN);
 
@@ -730,8 +738,10 @@ void smp_compute_dhkey(tSMP_CB* p_cb) {
 
   ECC_PointMult(&new_publ_key, &peer_publ_key, (uint32_t*)private_key,
                 KEY_LENGTH_DWORDS_P256);
+  smp_clear_secret(private_key, sizeof(private_key));
 
   memcpy(p_cb->dhkey, new_publ_key.x, BT_OCTET32_LEN);
+  smp_clear_secret(&new_publ_key, sizeof(new_publ_key));
 
   smp_debug_print_nbyte_little_endian(p_cb->dhkey, "Old DHKey", BT_OCTET32_LEN);
 
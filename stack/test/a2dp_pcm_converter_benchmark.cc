@@ -0,0 +1,82 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+
+#include <vector>
+
+#include "a2dp_pcm_converter.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Output frames of an SBC frame of 16 blocks of 8 subbands.
+constexpr size_t kOutputFrames = 128;
+
+// Converts stereo 16 bit PCM one SBC frame at a time, as the SBC encoder
+// does.
+// Arguments: input rate, output rate, input bits per sample.
+void BM_Convert(State& state) {
+  tA2DP_PCM_CONFIG input = {(uint32_t)state.range(0), A2dpPcmFormat::kS16, 2};
+  tA2DP_PCM_CONFIG output = {(uint32_t)state.range(1), A2dpPcmFormat::kS16, 2};
+  if (!A2DP_GetPcmFormat(state.range(2), &input.format)) {
+    state.SkipWithError("unsupported bits per sample");
+    return;
+  }
+  A2dpPcmConverter converter(input, output);
+
+  // One second of noise, fed over and over.
+  size_t input_size = input.sample_rate * converter.input_frame_size();
+  std::vector<uint8_t> pcm(input_size + 4096 * converter.input_frame_size());
+  uint32_t seed = 1;
+  for (uint8_t& octet : pcm) {
+    seed = seed * 1664525 + 1013904223;
+    octet = seed >> 24;
+  }
+  std::vector<uint8_t> out(kOutputFrames * converter.output_frame_size());
+
+  size_t offset = 0;
+  size_t input_frames_total = 0;
+  for (auto _ : state) {
+    size_t input_frames = converter.InputFramesFor(kOutputFrames);
+    benchmark::DoNotOptimize(converter.Convert(&pcm[offset], input_frames,
+                                               out.data(), kOutputFrames));
+    input_frames_total += input_frames;
+    offset += input_frames * converter.input_frame_size();
+    if (offset >= input_size) offset = 0;
+  }
+
+  state.SetItemsProcessed(state.iterations() * kOutputFrames);
+  state.SetBytesProcessed(input_frames_total * converter.input_frame_size());
+}
+
+void Conversions(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"in_rate", "out_rate", "bits"});
+  b->Args({44100, 44100, 24});
+  b->Args({44100, 48000, 16});
+  b->Args({48000, 44100, 16});
+  b->Args({32000, 48000, 16});
+  b->Args({44100, 48000, 24});
+  b->Args({44100, 48000, 32});
+}
+BENCHMARK(BM_Convert)->Apply(Conversions);
+
+}  // namespace
+
+BENCHMARK_MAIN();
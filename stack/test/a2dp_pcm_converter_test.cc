@@ -0,0 +1,267 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "a2dp_pcm_converter.h"
+
+namespace {
+
+constexpr double kToneHz = 1000;
+constexpr double kToneAmplitude = 0.5;
+
+// Interleaved float sines of |frames| frames, channel c at (c + 1) times the
+// tone frequency.
+std::vector<float> MakeTone(uint32_t sample_rate, uint8_t channels,
+                            size_t frames) {
+  std::vector<float> pcm(frames * channels);
+  for (size_t i = 0; i < frames; i++) {
+    for (uint8_t c = 0; c < channels; c++) {
+      pcm[i * channels + c] =
+          kToneAmplitude * sin(2 * M_PI * kToneHz * (c + 1) * i / sample_rate);
+    }
+  }
+  return pcm;
+}
+
+// Converts |input| in one call, and returns the output.
+std::vector<uint8_t> ConvertAll(A2dpPcmConverter* converter,
+                                const void* p_input, size_t input_frames) {
+  size_t max_frames = (uint64_t)input_frames *
+                          converter->output().sample_rate /
+                          converter->input().sample_rate +
+                      1;
+  std::vector<uint8_t> output(max_frames * converter->output_frame_size());
+  size_t frames =
+      converter->Convert(p_input, input_frames, output.data(), max_frames);
+  output.resize(frames * converter->output_frame_size());
+  return output;
+}
+
+// Returns the ratio of the power of what is not a sine at |frequency|, to
+// the power of the sine, in dB. The sine is fit by least squares.
+double ThdPlusNoiseDb(const std::vector<double>& samples, double frequency) {
+  // Solve the normal equations of x ~ a sin + b cos + dc.
+  double m[3][4] = {};
+  for (size_t i = 0; i < samples.size(); i++) {
+    double basis[3] = {sin(2 * M_PI * frequency * i),
+                       cos(2 * M_PI * frequency * i), 1.0};
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) m[r][c] += basis[r] * basis[c];
+      m[r][3] += basis[r] * samples[i];
+    }
+  }
+  for (int p = 0; p < 3; p++) {
+    for (int r = p + 1; r < 3; r++) {
+      double f = m[r][p] / m[p][p];
+      for (int c = p; c < 4; c++) m[r][c] -= f * m[p][c];
+    }
+  }
+  double coef[3];
+  for (int r = 2; r >= 0; r--) {
+    double v = m[r][3];
+    for (int c = r + 1; c < 3; c++) v -= m[r][c] * coef[c];
+    coef[r] = v / m[r][r];
+  }
+
+  double signal = 0;
+  double residual = 0;
+  for (size_t i = 0; i < samples.size(); i++) {
+    double fit = coef[0] * sin(2 * M_PI * frequency * i) +
+                 coef[1] * cos(2 * M_PI * frequency * i) + coef[2];
+    signal += fit * fit;
+    residual += (samples[i] - fit) * (samples[i] - fit);
+  }
+  return 10 * log10(residual / signal);
+}
+
+// Converts one second of a mono tone from |input_rate| to |output_rate| in
+// |output_format|, and returns the THD+N of the output in dB.
+double MeasureThdPlusNoise(uint32_t input_rate, uint32_t output_rate,
+                           A2dpPcmFormat output_format) {
+  A2dpPcmConverter converter({input_rate, A2dpPcmFormat::kFloat, 1},
+                             {output_rate, output_format, 1});
+  std::vector<float> input = MakeTone(input_rate, 1, input_rate);
+  std::vector<uint8_t> output =
+      ConvertAll(&converter, input.data(), input_rate);
+
+  // Skip the start, where the filter window was partly before the tone.
+  std::vector<double> samples;
+  size_t frames = output.size() / converter.output_frame_size();
+  for (size_t i = A2dpPcmConverter::kTapsPerPhase; i < frames; i++) {
+    if (output_format == A2dpPcmFormat::kFloat) {
+      float v;
+      memcpy(&v, &output[i * sizeof(v)], sizeof(v));
+      samples.push_back(v);
+    } else {
+      int16_t v;
+      memcpy(&v, &output[i * sizeof(v)], sizeof(v));
+      samples.push_back(v / 32768.0);
+    }
+  }
+  return ThdPlusNoiseDb(samples, kToneHz / output_rate);
+}
+
+TEST(A2dpPcmConverterTest, pcm_formats) {
+  A2dpPcmFormat format;
+  EXPECT_TRUE(A2DP_GetPcmFormat(8, &format));
+  EXPECT_EQ(A2dpPcmFormat::kU8, format);
+  EXPECT_TRUE(A2DP_GetPcmFormat(16, &format));
+  EXPECT_EQ(A2dpPcmFormat::kS16, format);
+  EXPECT_TRUE(A2DP_GetPcmFormat(24, &format));
+  EXPECT_EQ(A2dpPcmFormat::kS24Packed, format);
+  EXPECT_TRUE(A2DP_GetPcmFormat(32, &format));
+  EXPECT_EQ(A2dpPcmFormat::kS32, format);
+  EXPECT_FALSE(A2DP_GetPcmFormat(12, &format));
+
+  EXPECT_EQ(1u, A2DP_GetPcmSampleSize(A2dpPcmFormat::kU8));
+  EXPECT_EQ(2u, A2DP_GetPcmSampleSize(A2dpPcmFormat::kS16));
+  EXPECT_EQ(3u, A2DP_GetPcmSampleSize(A2dpPcmFormat::kS24Packed));
+  EXPECT_EQ(4u, A2DP_GetPcmSampleSize(A2dpPcmFormat::kS32));
+  EXPECT_EQ(4u, A2DP_GetPcmSampleSize(A2dpPcmFormat::kFloat));
+}
+
+TEST(A2dpPcmConverterTest, same_rate_is_bit_exact) {
+  std::vector<int16_t> input(4410 * 2);
+  for (size_t i = 0; i < input.size(); i++) input[i] = (int16_t)(i * 7919);
+
+  A2dpPcmConverter converter({44100, A2dpPcmFormat::kS16, 2},
+                             {44100, A2dpPcmFormat::kS16, 2});
+  std::vector<uint8_t> output =
+      ConvertAll(&converter, input.data(), input.size() / 2);
+  ASSERT_EQ(input.size() * sizeof(int16_t), output.size());
+  EXPECT_EQ(0, memcmp(input.data(), output.data(), output.size()));
+}
+
+// 16 bit samples survive the trip through every other format but 8 bit.
+TEST(A2dpPcmConverterTest, format_round_trip) {
+  std::vector<int16_t> input(1000);
+  for (size_t i = 0; i < input.size(); i++) input[i] = (int16_t)(i * 7919);
+
+  for (A2dpPcmFormat format :
+       {A2dpPcmFormat::kS24Packed, A2dpPcmFormat::kS32,
+        A2dpPcmFormat::kFloat}) {
+    A2dpPcmConverter to({48000, A2dpPcmFormat::kS16, 1}, {48000, format, 1});
+    std::vector<uint8_t> converted =
+        ConvertAll(&to, input.data(), input.size());
+    A2dpPcmConverter from({48000, format, 1}, {48000, A2dpPcmFormat::kS16, 1});
+    std::vector<uint8_t> output =
+        ConvertAll(&from, converted.data(), input.size());
+    ASSERT_EQ(input.size() * sizeof(int16_t), output.size());
+    EXPECT_EQ(0, memcmp(input.data(), output.data(), output.size()));
+  }
+
+  // 8 bit keeps the most significant octet.
+  A2dpPcmConverter to({48000, A2dpPcmFormat::kS16, 1},
+                      {48000, A2dpPcmFormat::kU8, 1});
+  int16_t samples[] = {0, 256, -256, 32767, -32768};
+  std::vector<uint8_t> output = ConvertAll(&to, samples, 5);
+  EXPECT_EQ((std::vector<uint8_t>{128, 129, 127, 255, 0}), output);
+}
+
+TEST(A2dpPcmConverterTest, channel_mixing) {
+  int16_t stereo[] = {1000, 3000, -2000, -4000};
+  A2dpPcmConverter downmix({48000, A2dpPcmFormat::kS16, 2},
+                           {48000, A2dpPcmFormat::kS16, 1});
+  std::vector<uint8_t> output = ConvertAll(&downmix, stereo, 2);
+  int16_t mono[2];
+  ASSERT_EQ(sizeof(mono), output.size());
+  memcpy(mono, output.data(), sizeof(mono));
+  EXPECT_EQ(2000, mono[0]);
+  EXPECT_EQ(-3000, mono[1]);
+
+  A2dpPcmConverter upmix({48000, A2dpPcmFormat::kS16, 1},
+                         {48000, A2dpPcmFormat::kS16, 2});
+  output = ConvertAll(&upmix, mono, 2);
+  int16_t duplicated[4];
+  ASSERT_EQ(sizeof(duplicated), output.size());
+  memcpy(duplicated, output.data(), sizeof(duplicated));
+  EXPECT_EQ(2000, duplicated[0]);
+  EXPECT_EQ(2000, duplicated[1]);
+  EXPECT_EQ(-3000, duplicated[2]);
+  EXPECT_EQ(-3000, duplicated[3]);
+}
+
+TEST(A2dpPcmConverterTest, thd_plus_noise_44100_to_48000) {
+  EXPECT_LT(MeasureThdPlusNoise(44100, 48000, A2dpPcmFormat::kFloat), -100);
+  EXPECT_LT(MeasureThdPlusNoise(44100, 48000, A2dpPcmFormat::kS16), -88);
+}
+
+TEST(A2dpPcmConverterTest, thd_plus_noise_48000_to_44100) {
+  EXPECT_LT(MeasureThdPlusNoise(48000, 44100, A2dpPcmFormat::kFloat), -100);
+  EXPECT_LT(MeasureThdPlusNoise(48000, 44100, A2dpPcmFormat::kS16), -88);
+}
+
+TEST(A2dpPcmConverterTest, rates_without_common_divisor) {
+  // 44100 / 47999 needs more phases than the filter has.
+  EXPECT_LT(MeasureThdPlusNoise(44100, 47999, A2dpPcmFormat::kFloat), -70);
+}
+
+// Feeding the input in chunks, as the encoders do, produces the same output
+// as converting it at once.
+TEST(A2dpPcmConverterTest, chunked_conversion_is_bit_exact) {
+  const size_t kInputFrames = 44100;
+  const size_t kChunkFrames = 128;
+  std::vector<float> tone = MakeTone(44100, 2, kInputFrames);
+  std::vector<int16_t> input(tone.size());
+  for (size_t i = 0; i < tone.size(); i++) input[i] = tone[i] * 32767;
+
+  tA2DP_PCM_CONFIG in_config = {44100, A2dpPcmFormat::kS16, 2};
+  tA2DP_PCM_CONFIG out_config = {48000, A2dpPcmFormat::kS16, 2};
+  A2dpPcmConverter whole(in_config, out_config);
+  std::vector<uint8_t> expected =
+      ConvertAll(&whole, input.data(), kInputFrames);
+
+  A2dpPcmConverter chunked(in_config, out_config);
+  std::vector<uint8_t> output;
+  size_t consumed = 0;
+  std::vector<uint8_t> chunk(kChunkFrames * chunked.output_frame_size());
+  while (true) {
+    size_t input_frames = chunked.InputFramesFor(kChunkFrames);
+    if (consumed + input_frames > kInputFrames) break;
+    size_t frames = chunked.Convert(&input[consumed * 2], input_frames,
+                                    chunk.data(), kChunkFrames);
+    consumed += input_frames;
+    EXPECT_EQ(kChunkFrames, frames);
+    output.insert(output.end(), chunk.begin(), chunk.end());
+  }
+  ASSERT_LE(output.size(), expected.size());
+  EXPECT_GT(output.size(), expected.size() - chunk.size() * 2);
+  expected.resize(output.size());
+  EXPECT_EQ(expected, output);
+}
+
+TEST(A2dpPcmConverterTest, reset_drops_buffered_input) {
+  std::vector<float> tone = MakeTone(44100, 1, 4410);
+  tA2DP_PCM_CONFIG in_config = {44100, A2dpPcmFormat::kFloat, 1};
+  tA2DP_PCM_CONFIG out_config = {48000, A2dpPcmFormat::kS16, 1};
+
+  A2dpPcmConverter fresh(in_config, out_config);
+  std::vector<uint8_t> expected = ConvertAll(&fresh, tone.data(), tone.size());
+
+  A2dpPcmConverter reset(in_config, out_config);
+  reset.Convert(tone.data(), 100, nullptr, 0);
+  EXPECT_EQ(0u, reset.InputFramesFor(1));
+  reset.Reset();
+  EXPECT_EQ(expected, ConvertAll(&reset, tone.data(), tone.size()));
+}
+
+}  // namespace
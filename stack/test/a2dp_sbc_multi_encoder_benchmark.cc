@@ -0,0 +1,116 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "a2dp_codec_api.h"
+#include "a2dp_sbc_encoder.h"
+#include "osi/include/allocator.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr uint64_t kIntervalUs = 20 * 1000;
+
+// SBC sink capability: 44.1/48 kHz, all channel modes, blocks, subbands and
+// allocation methods, bitpool 2 - 53.
+const uint8_t kSbcSinkCapability[AVDT_CODEC_SIZE] = {
+    6, 0, 0, 0x20 | 0x10 | 0x0F, 0xF0 | 0x0C | 0x03, 2, 53};
+
+uint32_t pcm_phase;
+
+// A stereo 16 bit sine, 1 kHz at 44.1 kHz.
+uint32_t ReadPcm(uint8_t* p_buf, uint32_t len) {
+  int16_t* samples = reinterpret_cast<int16_t*>(p_buf);
+  for (uint32_t i = 0; i < len / 4; i++, pcm_phase++) {
+    int16_t v = 16000 * sin(pcm_phase * 2 * M_PI * 1000 / 44100);
+    samples[2 * i] = v;
+    samples[2 * i + 1] = -v;
+  }
+  return len;
+}
+
+size_t enqueued_bytes;
+
+bool EnqueuePacket(const RawAddress& peer_address, BT_HDR* p_buf,
+                   size_t frames_n, uint32_t num_bytes) {
+  enqueued_bytes += p_buf->len;
+  osi_free(p_buf);
+  return true;
+}
+
+// Encodes the same PCM for a number of peers, half of them EDR (bitrate 328)
+// and half of them BR (bitrate 229, so a different bitpool), one encoder
+// interval per iteration.
+// Arguments: peers, encoding threads.
+void BM_EncodeForPeers(State& state) {
+  size_t num_peers = state.range(0);
+  size_t num_workers = state.range(1);
+
+  A2dpCodecs codecs{std::vector<btav_a2dp_codec_config_t>()};
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  if (!codecs.init() ||
+      !codecs.setCodecConfig(kSbcSinkCapability, true /* is_capability */,
+                             codec_info, true /* select_current_codec */)) {
+    state.SkipWithError("cannot configure SBC");
+    return;
+  }
+  A2dpCodecConfig* codec_config = codecs.getCurrentCodecConfig();
+
+  const tA2DP_MULTI_ENCODER_INTERFACE* encoder =
+      A2DP_GetMultiEncoderInterface(codec_info);
+  tA2DP_FEEDING_PARAMS feeding_params = {44100, 16, 2};
+  encoder->encoder_init(&feeding_params, ReadPcm, EnqueuePacket, num_workers);
+  for (size_t i = 0; i < num_peers; i++) {
+    RawAddress peer_address = {{0x00, 0x11, 0x22, 0x33, 0x44, (uint8_t)i}};
+    tA2DP_ENCODER_INIT_PEER_PARAMS peer_params = {};
+    peer_params.is_peer_edr = (i % 2 == 0);
+    peer_params.peer_supports_3mbps = peer_params.is_peer_edr;
+    peer_params.peer_mtu = 895;
+    encoder->session_add(peer_address, &peer_params, codec_config);
+  }
+
+  uint64_t timestamp_us = kIntervalUs;
+  enqueued_bytes = 0;
+  for (auto _ : state) {
+    encoder->send_frames(timestamp_us);
+    timestamp_us += kIntervalUs;
+  }
+  encoder->encoder_cleanup();
+
+  state.SetItemsProcessed(state.iterations() * num_peers);
+  state.SetBytesProcessed(enqueued_bytes);
+}
+
+void PeersAndWorkers(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"peers", "workers"});
+  int max_workers = std::max(2u, std::thread::hardware_concurrency());
+  for (int peers : {1, 2, 4, 8}) {
+    b->Args({peers, 0});
+    if (peers > 1) b->Args({peers, std::min(peers, max_workers)});
+  }
+}
+BENCHMARK(BM_EncodeForPeers)->Apply(PeersAndWorkers)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <map>
+#include <vector>
+
+#include "a2dp_codec_api.h"
+#include "a2dp_sbc_encoder.h"
+#include "a2dp_sbc_pcm_feed.h"
+#include "osi/include/allocator.h"
+
+namespace {
+
+constexpr uint64_t kIntervalUs = 20 * 1000;
+constexpr size_t kPcmFrameSize = 4;
+
+// SBC sink capability: 44.1/48 kHz, all channel modes, blocks, subbands and
+// allocation methods, bitpool 2 - 53.
+const uint8_t kSbcSinkCapability[AVDT_CODEC_SIZE] = {
+    6, 0, 0, 0x20 | 0x10 | 0x0F, 0xF0 | 0x0C | 0x03, 2, 53};
+
+const RawAddress kPeers[] = {
+    {{0x00, 0x11, 0x22, 0x33, 0x44, 0x00}},
+    {{0x00, 0x11, 0x22, 0x33, 0x44, 0x01}},
+    {{0x00, 0x11, 0x22, 0x33, 0x44, 0x02}},
+    {{0x00, 0x11, 0x22, 0x33, 0x44, 0x03}},
+};
+
+// The PCM frame read next. The PCM only depends on its position, so that an
+// encoder reading from a given position always gets the same PCM.
+uint64_t pcm_frame;
+
+// A stereo 16 bit sine, 1 kHz at 44.1 kHz.
+uint32_t ReadPcm(uint8_t* p_buf, uint32_t len) {
+  int16_t* samples = reinterpret_cast<int16_t*>(p_buf);
+  for (uint32_t i = 0; i < len / kPcmFrameSize; i++, pcm_frame++) {
+    int16_t v = 16000 * sin(pcm_frame * 2 * M_PI * 1000 / 44100);
+    samples[2 * i] = v;
+    samples[2 * i + 1] = -v;
+  }
+  return len;
+}
+
+// The RTP timestamp and the SBC frames of an encoded packet.
+std::vector<uint8_t> PacketBytes(const BT_HDR* p_buf) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(p_buf + 1);
+  std::vector<uint8_t> bytes(data, data + sizeof(uint32_t));
+  bytes.insert(bytes.end(), data + p_buf->offset,
+               data + p_buf->offset + p_buf->len);
+  return bytes;
+}
+
+std::vector<std::vector<uint8_t>> single_packets;
+
+bool EnqueueSinglePacket(BT_HDR* p_buf, size_t frames_n, uint32_t num_bytes) {
+  single_packets.push_back(PacketBytes(p_buf));
+  osi_free(p_buf);
+  return true;
+}
+
+// The peers of the packets, in the order they were enqueued, and the packets
+// of each peer.
+std::vector<RawAddress> peer_order;
+std::map<RawAddress, std::vector<std::vector<uint8_t>>> peer_packets;
+
+bool EnqueuePeerPacket(const RawAddress& peer_address, BT_HDR* p_buf,
+                       size_t frames_n, uint32_t num_bytes) {
+  peer_order.push_back(peer_address);
+  peer_packets[peer_address].push_back(PacketBytes(p_buf));
+  osi_free(p_buf);
+  return true;
+}
+
+// Half of the peers are EDR (bitrate 328) and half are BR (bitrate 229, so a
+// different bitpool).
+tA2DP_ENCODER_INIT_PEER_PARAMS PeerParams(size_t peer) {
+  tA2DP_ENCODER_INIT_PEER_PARAMS peer_params = {};
+  peer_params.is_peer_edr = (peer % 2 == 0);
+  peer_params.peer_supports_3mbps = peer_params.is_peer_edr;
+  peer_params.peer_mtu = 895;
+  return peer_params;
+}
+
+}  // namespace
+
+class A2dpSbcPcmFeedTest : public ::testing::Test {
+ protected:
+  void SetUp() override { pcm_frame = 0; }
+};
+
+TEST_F(A2dpSbcPcmFeedTest, test_read_wraps_around) {
+  A2dpSbcPcmFeed feed;
+  feed.Reset(10 * kPcmFrameSize);
+
+  std::vector<uint8_t> expected(16 * kPcmFrameSize);
+  ReadPcm(expected.data(), expected.size());
+  pcm_frame = 0;
+
+  uint64_t position = 0;
+  std::vector<uint8_t> read(expected.size());
+  feed.Fill(ReadPcm, 7 * kPcmFrameSize);
+  EXPECT_EQ(feed.Read(&position, read.data(), 7 * kPcmFrameSize),
+            7 * kPcmFrameSize);
+
+  // The second fill and read wrap around the end of the ring.
+  feed.Fill(ReadPcm, 9 * kPcmFrameSize);
+  EXPECT_EQ(feed.write_position(), 16 * kPcmFrameSize);
+  EXPECT_EQ(feed.Read(&position, read.data() + 7 * kPcmFrameSize,
+                      100 * kPcmFrameSize),
+            9 * kPcmFrameSize);
+  EXPECT_EQ(position, 16 * kPcmFrameSize);
+  EXPECT_EQ(read, expected);
+}
+
+TEST_F(A2dpSbcPcmFeedTest, test_readers_keep_their_position) {
+  A2dpSbcPcmFeed feed;
+  feed.Reset(10 * kPcmFrameSize);
+  feed.Fill(ReadPcm, 8 * kPcmFrameSize);
+
+  uint64_t first = 0;
+  uint64_t second = 0;
+  uint8_t first_buf[8 * kPcmFrameSize];
+  uint8_t second_buf[8 * kPcmFrameSize];
+  EXPECT_EQ(feed.Read(&first, first_buf, sizeof(first_buf)),
+            sizeof(first_buf));
+  EXPECT_EQ(feed.Read(&second, second_buf, 3 * kPcmFrameSize),
+            3 * kPcmFrameSize);
+  EXPECT_EQ(feed.Read(&second, second_buf + 3 * kPcmFrameSize,
+                      5 * kPcmFrameSize),
+            5 * kPcmFrameSize);
+  EXPECT_EQ(memcmp(first_buf, second_buf, sizeof(first_buf)), 0);
+
+  // Nothing left to read.
+  EXPECT_EQ(feed.Read(&first, first_buf, sizeof(first_buf)), 0u);
+}
+
+TEST_F(A2dpSbcPcmFeedTest, test_reader_behind_skips_overwritten_pcm) {
+  A2dpSbcPcmFeed feed;
+  feed.Reset(10 * kPcmFrameSize);
+
+  std::vector<uint8_t> expected(25 * kPcmFrameSize);
+  ReadPcm(expected.data(), expected.size());
+  pcm_frame = 0;
+
+  uint64_t position = 0;
+  feed.Fill(ReadPcm, 25 * kPcmFrameSize);
+
+  // Only the last 10 frames are kept.
+  std::vector<uint8_t> read(25 * kPcmFrameSize);
+  EXPECT_EQ(feed.Read(&position, read.data(), read.size()),
+            10 * kPcmFrameSize);
+  EXPECT_EQ(position, 25 * kPcmFrameSize);
+  EXPECT_EQ(memcmp(read.data(), expected.data() + 15 * kPcmFrameSize,
+                   10 * kPcmFrameSize),
+            0);
+}
+
+class A2dpSbcMultiEncoderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    pcm_frame = 0;
+    single_packets.clear();
+    peer_order.clear();
+    peer_packets.clear();
+
+    codecs_.reset(new A2dpCodecs(std::vector<btav_a2dp_codec_config_t>()));
+    ASSERT_TRUE(codecs_->init());
+    ASSERT_TRUE(codecs_->setCodecConfig(
+        kSbcSinkCapability, true /* is_capability */, codec_info_,
+        true /* select_current_codec */));
+    codec_config_ = codecs_->getCurrentCodecConfig();
+    ASSERT_NE(codec_config_, nullptr);
+    encoder_ = A2DP_GetMultiEncoderInterface(codec_info_);
+    ASSERT_NE(encoder_, nullptr);
+  }
+
+  void TearDown() override {
+    if (encoder_ != nullptr) encoder_->encoder_cleanup();
+  }
+
+  void Init(size_t num_workers) {
+    tA2DP_FEEDING_PARAMS feeding_params = {44100, 16, 2};
+    encoder_->encoder_init(&feeding_params, ReadPcm, EnqueuePeerPacket,
+                           num_workers);
+  }
+
+  void AddSession(size_t peer) {
+    tA2DP_ENCODER_INIT_PEER_PARAMS peer_params = PeerParams(peer);
+    ASSERT_TRUE(
+        encoder_->session_add(kPeers[peer], &peer_params, codec_config_));
+  }
+
+  // Returns the packets the single-session encoder sends for |peer| in
+  // |num_ticks| intervals from |timestamp_us|, reading the PCM from PCM
+  // frame |first_pcm_frame|.
+  std::vector<std::vector<uint8_t>> EncodeSingleSession(
+      size_t peer, uint64_t first_pcm_frame, uint64_t timestamp_us,
+      size_t num_ticks) {
+    const tA2DP_ENCODER_INTERFACE* encoder =
+        A2DP_GetEncoderInterface(codec_info_);
+    tA2DP_ENCODER_INIT_PEER_PARAMS peer_params = PeerParams(peer);
+    encoder->encoder_init(&peer_params, codec_config_, ReadPcm,
+                          EnqueueSinglePacket);
+    encoder->feeding_reset();
+
+    uint64_t saved_pcm_frame = pcm_frame;
+    pcm_frame = first_pcm_frame;
+    single_packets.clear();
+    for (size_t i = 0; i < num_ticks; i++) {
+      encoder->send_frames(timestamp_us);
+      timestamp_us += kIntervalUs;
+    }
+    encoder->encoder_cleanup();
+    pcm_frame = saved_pcm_frame;
+    return single_packets;
+  }
+
+  std::unique_ptr<A2dpCodecs> codecs_;
+  uint8_t codec_info_[AVDT_CODEC_SIZE];
+  A2dpCodecConfig* codec_config_ = nullptr;
+  const tA2DP_MULTI_ENCODER_INTERFACE* encoder_ = nullptr;
+};
+
+TEST_F(A2dpSbcMultiEncoderTest, test_sessions_match_single_session_encoder) {
+  Init(0);
+  AddSession(0);
+  AddSession(1);
+
+  uint64_t timestamp_us = kIntervalUs;
+  for (int i = 0; i < 50; i++) {
+    encoder_->send_frames(timestamp_us);
+    timestamp_us += kIntervalUs;
+  }
+
+  for (size_t peer : {0, 1}) {
+    SCOPED_TRACE(peer);
+    EXPECT_FALSE(peer_packets[kPeers[peer]].empty());
+    EXPECT_EQ(peer_packets[kPeers[peer]],
+              EncodeSingleSession(peer, 0, kIntervalUs, 50));
+  }
+  // The EDR and BR peers use a different bitpool.
+  EXPECT_NE(peer_packets[kPeers[0]], peer_packets[kPeers[1]]);
+}
+
+TEST_F(A2dpSbcMultiEncoderTest, test_add_and_remove_sessions_while_encoding) {
+  Init(0);
+  AddSession(0);
+
+  uint64_t timestamp_us = kIntervalUs;
+  for (int i = 0; i < 10; i++) {
+    encoder_->send_frames(timestamp_us);
+    timestamp_us += kIntervalUs;
+  }
+
+  // The added session starts from the PCM read next.
+  uint64_t added_pcm_frame = pcm_frame;
+  uint64_t added_us = timestamp_us;
+  AddSession(1);
+  for (int i = 0; i < 10; i++) {
+    encoder_->send_frames(timestamp_us);
+    timestamp_us += kIntervalUs;
+  }
+
+  encoder_->session_remove(kPeers[0]);
+  size_t removed_packets = peer_packets[kPeers[0]].size();
+  for (int i = 0; i < 10; i++) {
+    encoder_->send_frames(timestamp_us);
+    timestamp_us += kIntervalUs;
+  }
+
+  EXPECT_EQ(peer_packets[kPeers[0]].size(), removed_packets);
+  EXPECT_EQ(peer_packets[kPeers[0]],
+            EncodeSingleSession(0, 0, kIntervalUs, 20));
+  EXPECT_EQ(peer_packets[kPeers[1]],
+            EncodeSingleSession(1, added_pcm_frame, added_us, 20));
+}
+
+TEST_F(A2dpSbcMultiEncoderTest, test_workers_enqueue_in_session_order) {
+  Init(2);
+  for (size_t peer = 0; peer < 4; peer++) AddSession(peer);
+
+  uint64_t timestamp_us = kIntervalUs;
+  for (int i = 0; i < 20; i++) {
+    size_t first = peer_order.size();
+    encoder_->send_frames(timestamp_us);
+    timestamp_us += kIntervalUs;
+
+    // Every packet of a session is enqueued before the next session's.
+    for (size_t j = first + 1; j < peer_order.size(); j++) {
+      EXPECT_LE(peer_order[j - 1], peer_order[j]);
+    }
+  }
+
+  for (size_t peer = 0; peer < 4; peer++) {
+    SCOPED_TRACE(peer);
+    EXPECT_FALSE(peer_packets[kPeers[peer]].empty());
+    EXPECT_EQ(peer_packets[kPeers[peer]],
+              EncodeSingleSession(peer, 0, kIntervalUs, 20));
+  }
+}
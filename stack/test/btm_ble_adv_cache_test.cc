@@ -0,0 +1,129 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "stack/btm/btm_ble_adv_cache.h"
+
+namespace {
+
+constexpr uint8_t kPublic = 0x00;
+constexpr uint8_t kRandom = 0x01;
+constexpr uint8_t kNoSid = 0xff;
+
+const RawAddress kAddr({0x00, 0x11, 0x22, 0x33, 0x44, 0x55});
+const RawAddress kOtherAddr({0x00, 0x11, 0x22, 0x33, 0x44, 0x66});
+
+const std::vector<uint8_t> kAdv = {0x02, 0x01, 0x06};
+const std::vector<uint8_t> kScanRsp = {0x03, 0x09, 'A', 'B'};
+
+std::vector<uint8_t> Concat(const std::vector<uint8_t>& a,
+                            const std::vector<uint8_t>& b) {
+  std::vector<uint8_t> result = a;
+  result.insert(result.end(), b.begin(), b.end());
+  return result;
+}
+
+}  // namespace
+
+TEST(BleAdvertisingCacheTest, scan_response_is_appended) {
+  BleAdvertisingCache cache(8, 1000);
+
+  EXPECT_EQ(kAdv, cache.Set(kPublic, kAddr, kNoSid, kAdv.data(), kAdv.size(),
+                            0));
+  EXPECT_EQ(Concat(kAdv, kScanRsp),
+            cache.Append(kPublic, kAddr, kNoSid, kScanRsp.data(),
+                         kScanRsp.size(), 10));
+  cache.Clear(kPublic, kAddr, kNoSid, 10);
+
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(1u, cache.stats().completed_chains);
+  EXPECT_EQ(10u, cache.stats().completion_latency_total_ms);
+  EXPECT_EQ(10u, cache.stats().completion_latency_max_ms);
+  EXPECT_EQ(0u, cache.stats().incomplete_chains);
+}
+
+TEST(BleAdvertisingCacheTest, keys_are_distinct) {
+  BleAdvertisingCache cache(8, 1000);
+
+  cache.Set(kPublic, kAddr, kNoSid, kAdv.data(), kAdv.size(), 0);
+  cache.Set(kRandom, kAddr, kNoSid, kScanRsp.data(), kScanRsp.size(), 0);
+  cache.Set(kPublic, kAddr, 1, kScanRsp.data(), kScanRsp.size(), 0);
+  cache.Set(kPublic, kOtherAddr, kNoSid, kScanRsp.data(), kScanRsp.size(), 0);
+  EXPECT_EQ(4u, cache.size());
+
+  EXPECT_EQ(kAdv, cache.Append(kPublic, kAddr, kNoSid, nullptr, 0, 0));
+}
+
+TEST(BleAdvertisingCacheTest, set_restarts_the_data) {
+  BleAdvertisingCache cache(8, 1000);
+
+  cache.Set(kPublic, kAddr, kNoSid, kAdv.data(), kAdv.size(), 0);
+  EXPECT_EQ(kScanRsp, cache.Set(kPublic, kAddr, kNoSid, kScanRsp.data(),
+                                kScanRsp.size(), 100));
+  EXPECT_EQ(1u, cache.stats().incomplete_chains);
+
+  // The latency is counted from the restart
+  cache.Append(kPublic, kAddr, kNoSid, kAdv.data(), kAdv.size(), 150);
+  cache.Clear(kPublic, kAddr, kNoSid, 150);
+  EXPECT_EQ(50u, cache.stats().completion_latency_max_ms);
+}
+
+TEST(BleAdvertisingCacheTest, single_packets_are_not_chains) {
+  BleAdvertisingCache cache(8, 1000);
+
+  cache.Append(kPublic, kAddr, kNoSid, kAdv.data(), kAdv.size(), 0);
+  cache.Clear(kPublic, kAddr, kNoSid, 0);
+  EXPECT_EQ(0u, cache.stats().completed_chains);
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(BleAdvertisingCacheTest, least_recently_updated_is_evicted) {
+  BleAdvertisingCache cache(2, 1000);
+  RawAddress addrs[3] = {kAddr, kOtherAddr, kAddr};
+  addrs[2].address[5] = 0x77;
+
+  cache.Set(kPublic, addrs[0], kNoSid, kAdv.data(), kAdv.size(), 0);
+  cache.Set(kPublic, addrs[1], kNoSid, kAdv.data(), kAdv.size(), 0);
+  cache.Append(kPublic, addrs[0], kNoSid, kScanRsp.data(), kScanRsp.size(), 0);
+  cache.Set(kPublic, addrs[2], kNoSid, kAdv.data(), kAdv.size(), 0);
+
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ(1u, cache.stats().evictions);
+  EXPECT_EQ(1u, cache.stats().incomplete_chains);
+  // addrs[1] is gone, addrs[0] kept its data
+  EXPECT_EQ(Concat(kAdv, kScanRsp),
+            cache.Append(kPublic, addrs[0], kNoSid, nullptr, 0, 0));
+  EXPECT_EQ(kScanRsp, cache.Append(kPublic, addrs[1], kNoSid, kScanRsp.data(),
+                                   kScanRsp.size(), 0));
+  EXPECT_EQ(2u, cache.stats().evictions);
+}
+
+TEST(BleAdvertisingCacheTest, stale_data_expires) {
+  BleAdvertisingCache cache(8, 1000);
+
+  cache.Set(kPublic, kAddr, kNoSid, kAdv.data(), kAdv.size(), 0);
+  cache.Set(kPublic, kOtherAddr, kNoSid, kAdv.data(), kAdv.size(), 500);
+  EXPECT_EQ(kScanRsp, cache.Append(kPublic, kAddr, kNoSid, kScanRsp.data(),
+                                   kScanRsp.size(), 1001));
+  EXPECT_EQ(1u, cache.stats().expirations);
+  EXPECT_EQ(1u, cache.stats().incomplete_chains);
+  EXPECT_EQ(2u, cache.size());
+}
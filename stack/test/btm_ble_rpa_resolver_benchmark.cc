@@ -0,0 +1,150 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include <base/logging.h>
+
+#include "stack/btm/btm_ble_rpa_resolver.h"
+#include "stack/crypto_toolbox/aes_multi_key.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::State;
+using crypto_toolbox::AesImplementation;
+
+namespace {
+
+// Advertisers in range, advertising over and over.
+constexpr size_t kAdvertisers = 64;
+
+std::vector<Octet16> MakeIrks(size_t count, uint32_t* seed) {
+  std::vector<Octet16> irks(count);
+  for (Octet16& irk : irks) {
+    for (uint8_t& octet : irk) {
+      *seed = *seed * 1664525 + 1013904223;
+      octet = *seed >> 24;
+    }
+  }
+  return irks;
+}
+
+// RPAs of devices which are not bonded: every IRK is tried for each.
+std::vector<RawAddress> MakeUnknownRpas(size_t count, uint32_t* seed) {
+  std::vector<RawAddress> rpas(count);
+  for (RawAddress& rpa : rpas) {
+    for (uint8_t& octet : rpa.address) {
+      *seed = *seed * 1664525 + 1013904223;
+      octet = *seed >> 24;
+    }
+    rpa.address[0] = (rpa.address[0] & 0x3f) | 0x40;
+  }
+  return rpas;
+}
+
+// The former resolution: the key is expanded again for every IRK tried.
+bool RpaMatchesIrk(const RawAddress& rpa, const Octet16& irk) {
+  uint8_t rand[3] = {rpa.address[2], rpa.address[1], rpa.address[0]};
+  Octet16 x = crypto_toolbox::aes_128(irk, rand, sizeof(rand));
+  uint8_t hash[3] = {rpa.address[5], rpa.address[4], rpa.address[3]};
+  return memcmp(x.data(), hash, sizeof(hash)) == 0;
+}
+
+// Arguments: bonded IRKs.
+void BM_ResolveAes128(State& state) {
+  uint32_t seed = 1;
+  std::vector<Octet16> irks = MakeIrks(state.range(0), &seed);
+  std::vector<RawAddress> rpas = MakeUnknownRpas(kAdvertisers, &seed);
+
+  size_t next = 0;
+  for (auto _ : state) {
+    const RawAddress& rpa = rpas[next++ % rpas.size()];
+    for (const Octet16& irk : irks) {
+      if (RpaMatchesIrk(rpa, irk)) break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Arguments: bonded IRKs, AesImplementation.
+void BM_FindIrk(State& state) {
+  if (!crypto_toolbox::aes_128_set_implementation(
+          static_cast<AesImplementation>(state.range(1)))) {
+    state.SkipWithError("implementation not supported");
+    return;
+  }
+  uint32_t seed = 1;
+  BleRpaResolver resolver;
+  for (const Octet16& irk : MakeIrks(state.range(0), &seed))
+    resolver.AddIrk(irk);
+  std::vector<RawAddress> rpas = MakeUnknownRpas(kAdvertisers, &seed);
+
+  size_t next = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(resolver.FindIrk(rpas[next++ % rpas.size()]));
+  }
+  state.SetItemsProcessed(state.iterations());
+  crypto_toolbox::aes_128_set_implementation(AesImplementation::kAuto);
+}
+
+// The same advertisers reporting over and over, as while scanning.
+// Arguments: bonded IRKs.
+void BM_ResolveCached(State& state) {
+  uint32_t seed = 1;
+  BleRpaResolver resolver;
+  for (const Octet16& irk : MakeIrks(state.range(0), &seed))
+    resolver.AddIrk(irk);
+  std::vector<RawAddress> rpas = MakeUnknownRpas(kAdvertisers, &seed);
+
+  size_t next = 0;
+  for (auto _ : state) {
+    const RawAddress& rpa = rpas[next++ % rpas.size()];
+    int index;
+    if (!resolver.LookUp(rpa, 0, &index)) {
+      index = resolver.FindIrk(rpa);
+      resolver.Remember(rpa, index, 0);
+    }
+    benchmark::DoNotOptimize(index);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void Irks(benchmark::internal::Benchmark* b) {
+  b->ArgName("irks");
+  for (int irks : {1, 16, 128, 512}) b->Arg(irks);
+}
+
+void IrksAndImplementations(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"irks", "implementation"});
+  for (int irks : {1, 16, 128, 512}) {
+    for (AesImplementation implementation :
+         {AesImplementation::kSoftware, AesImplementation::kAesNi,
+          AesImplementation::kArmv8}) {
+      b->Args({irks, static_cast<int>(implementation)});
+    }
+  }
+}
+
+BENCHMARK(BM_ResolveAes128)->Apply(Irks);
+BENCHMARK(BM_FindIrk)->Apply(IrksAndImplementations);
+BENCHMARK(BM_ResolveCached)->Apply(Irks);
+
+}  // namespace
+
+BENCHMARK_MAIN();
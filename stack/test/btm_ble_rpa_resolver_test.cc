@@ -0,0 +1,212 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <base/logging.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "stack/btm/btm_ble_rpa_resolver.h"
+#include "stack/crypto_toolbox/aes_multi_key.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using crypto_toolbox::AesImplementation;
+
+namespace {
+
+class Random {
+ public:
+  uint8_t Next() {
+    seed_ = seed_ * 1664525 + 1013904223;
+    return seed_ >> 24;
+  }
+
+  Octet16 NextOctet16() {
+    Octet16 value;
+    for (uint8_t& octet : value) octet = Next();
+    return value;
+  }
+
+ private:
+  uint32_t seed_ = 1;
+};
+
+/* Generates an RPA of |irk| with the reference AES implementation */
+RawAddress MakeRpa(const Octet16& irk, Random* random) {
+  uint8_t prand[3] = {random->Next(), random->Next(), random->Next()};
+  prand[2] = (prand[2] & 0x3f) | 0x40;
+  Octet16 hash = crypto_toolbox::aes_128(irk, prand, sizeof(prand));
+
+  RawAddress rpa;
+  rpa.address[0] = prand[2];
+  rpa.address[1] = prand[1];
+  rpa.address[2] = prand[0];
+  rpa.address[3] = hash[2];
+  rpa.address[4] = hash[1];
+  rpa.address[5] = hash[0];
+  return rpa;
+}
+
+class AesMultiKeyTest : public ::testing::TestWithParam<AesImplementation> {
+ protected:
+  void TearDown() override {
+    crypto_toolbox::aes_128_set_implementation(AesImplementation::kAuto);
+  }
+};
+
+TEST_P(AesMultiKeyTest, matches_aes_128) {
+  // Nothing to test if the implementation is not supported here.
+  if (!crypto_toolbox::aes_128_set_implementation(GetParam())) return;
+
+  Random random;
+  // Every remainder of the keys encrypted at once.
+  for (size_t count = 0; count <= 9; count++) {
+    std::vector<Octet16> keys;
+    std::vector<crypto_toolbox::Aes128KeySchedule> schedules(count);
+    for (size_t i = 0; i < count; i++) {
+      keys.push_back(random.NextOctet16());
+      crypto_toolbox::aes_128_expand_key(keys[i], &schedules[i]);
+    }
+    Octet16 message = random.NextOctet16();
+    uint8_t block[OCTET16_LEN];
+    std::reverse_copy(message.begin(), message.end(), block);
+
+    std::vector<uint8_t> out(count * OCTET16_LEN + 1, 0xA5);
+    crypto_toolbox::aes_128_encrypt_multi_key(
+        schedules.data(), count, block,
+        reinterpret_cast<uint8_t(*)[OCTET16_LEN]>(out.data()));
+
+    for (size_t i = 0; i < count; i++) {
+      Octet16 expected = crypto_toolbox::aes_128(keys[i], message);
+      std::reverse(expected.begin(), expected.end());
+      EXPECT_EQ(0,
+                memcmp(expected.data(), &out[i * OCTET16_LEN], OCTET16_LEN))
+          << "key " << i << " of " << count;
+    }
+    EXPECT_EQ(0xA5, out.back());
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Implementations, AesMultiKeyTest,
+                        ::testing::Values(AesImplementation::kSoftware,
+                                          AesImplementation::kAesNi,
+                                          AesImplementation::kArmv8));
+
+TEST(BleRpaResolverTest, finds_the_irk) {
+  Random random;
+  BleRpaResolver resolver;
+  std::vector<Octet16> irks;
+  for (int i = 0; i < 100; i++) {
+    irks.push_back(random.NextOctet16());
+    EXPECT_EQ(i, resolver.AddIrk(irks.back()));
+  }
+  EXPECT_EQ(100u, resolver.size());
+
+  for (int i = 0; i < 100; i++) {
+    RawAddress rpa = MakeRpa(irks[i], &random);
+    EXPECT_EQ(i, resolver.FindIrk(rpa));
+    EXPECT_EQ(i, resolver.FindIrk(rpa, i));
+    EXPECT_EQ(BleRpaResolver::kNoMatch, resolver.FindIrk(rpa, i + 1));
+  }
+
+  RawAddress unknown = MakeRpa(random.NextOctet16(), &random);
+  EXPECT_EQ(BleRpaResolver::kNoMatch, resolver.FindIrk(unknown));
+
+  resolver.Clear();
+  EXPECT_EQ(BleRpaResolver::kNoMatch,
+            resolver.FindIrk(MakeRpa(irks[0], &random)));
+}
+
+TEST(BleRpaResolverTest, first_of_duplicate_irks) {
+  Random random;
+  BleRpaResolver resolver;
+  Octet16 irk = random.NextOctet16();
+  resolver.AddIrk(random.NextOctet16());
+  resolver.AddIrk(irk);
+  resolver.AddIrk(irk);
+
+  RawAddress rpa = MakeRpa(irk, &random);
+  EXPECT_EQ(1, resolver.FindIrk(rpa));
+  EXPECT_EQ(2, resolver.FindIrk(rpa, 2));
+}
+
+TEST(BleRpaResolverTest, cache_expires) {
+  Random random;
+  BleRpaResolver resolver(4, 1000);
+  RawAddress rpa = MakeRpa(random.NextOctet16(), &random);
+  int index = 0;
+
+  EXPECT_FALSE(resolver.LookUp(rpa, 0, &index));
+  resolver.Remember(rpa, BleRpaResolver::kNoMatch, 100);
+  EXPECT_TRUE(resolver.LookUp(rpa, 1100, &index));
+  EXPECT_EQ(BleRpaResolver::kNoMatch, index);
+  EXPECT_FALSE(resolver.LookUp(rpa, 1101, &index));
+  EXPECT_EQ(0u, resolver.cache_size());
+}
+
+TEST(BleRpaResolverTest, cache_evicts_the_least_recently_used) {
+  Random random;
+  BleRpaResolver resolver(2, 1000);
+  RawAddress a = MakeRpa(random.NextOctet16(), &random);
+  RawAddress b = MakeRpa(random.NextOctet16(), &random);
+  RawAddress c = MakeRpa(random.NextOctet16(), &random);
+  int index = BleRpaResolver::kNoMatch;
+
+  resolver.Remember(a, 1, 0);
+  resolver.Remember(b, 2, 0);
+  EXPECT_TRUE(resolver.LookUp(a, 0, &index));
+  EXPECT_EQ(1, index);
+  resolver.Remember(c, 3, 0);
+
+  EXPECT_EQ(2u, resolver.cache_size());
+  EXPECT_FALSE(resolver.LookUp(b, 0, &index));
+  EXPECT_TRUE(resolver.LookUp(a, 0, &index));
+  EXPECT_TRUE(resolver.LookUp(c, 0, &index));
+  EXPECT_EQ(3, index);
+
+  resolver.Forget(c);
+  EXPECT_FALSE(resolver.LookUp(c, 0, &index));
+}
+
+TEST(BleRpaResolverTest, irk_changes_drop_the_cache) {
+  Random random;
+  BleRpaResolver resolver;
+  Octet16 irk = random.NextOctet16();
+  RawAddress rpa = MakeRpa(irk, &random);
+  int index = 0;
+
+  resolver.Remember(rpa, resolver.FindIrk(rpa), 0);
+  EXPECT_TRUE(resolver.LookUp(rpa, 0, &index));
+  EXPECT_EQ(BleRpaResolver::kNoMatch, index);
+
+  // The address failing to resolve may now resolve.
+  resolver.AddIrk(irk);
+  EXPECT_FALSE(resolver.LookUp(rpa, 0, &index));
+  resolver.Remember(rpa, resolver.FindIrk(rpa), 0);
+  EXPECT_TRUE(resolver.LookUp(rpa, 0, &index));
+  EXPECT_EQ(0, index);
+
+  resolver.Clear();
+  EXPECT_FALSE(resolver.LookUp(rpa, 0, &index));
+}
+
+}  // namespace
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "bt_types.h"
+#include "btm_ble_int.h"
+#include "btm_int.h"
+#include "osi/include/allocator.h"
+#include "osi/include/list.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Legacy event types
+constexpr uint8_t kAdvInd = 0x00;
+constexpr uint8_t kAdvNonconnInd = 0x03;
+constexpr uint8_t kScanRsp = 0x04;
+
+// Extended event types: non-connectable and non-scannable, with the data
+// status in bits 5 and 6
+constexpr uint16_t kExtComplete = 0x0000;
+constexpr uint16_t kExtIncomplete = 0x0020;
+
+constexpr uint8_t kPublicAddress = 0x00;
+constexpr uint8_t kFragmentLength = 200;
+constexpr int kFragmentsPerChain = 3;
+
+size_t reported;
+
+void OnResult(tBTM_INQ_RESULTS* p_inq_results, uint8_t* p_eir,
+              uint16_t eir_len) {
+  reported++;
+}
+
+void StartObserving() {
+  btm_cb.trace_level = BT_TRACE_LEVEL_NONE;
+  if (btm_cb.sec_dev_rec == nullptr) btm_cb.sec_dev_rec = list_new(osi_free);
+  btm_cb.ble_ctr_cb.scan_activity = BTM_LE_OBSERVE_ACTIVE;
+  btm_cb.ble_ctr_cb.inq_var.scan_type = BTM_BLE_SCAN_MODE_ACTI;
+  btm_cb.ble_ctr_cb.p_obs_results_cb = OnResult;
+  reported = 0;
+}
+
+RawAddress DeviceAddress(int device) {
+  return RawAddress({0x00, 0x1b, 0xdc, (uint8_t)(device >> 16),
+                     (uint8_t)(device >> 8), (uint8_t)device});
+}
+
+// An LE Advertising Report event holding a single report.
+std::vector<uint8_t> LegacyReport(uint8_t event_type, int device) {
+  // Flags, and a complete local name padded with zeros to 31 octets
+  std::vector<uint8_t> data = {0x02, 0x01, 0x06, 0x09, 0x09, 'D', 'e',
+                               'v', 'i',  'c',  'e',  ' ',  'A'};
+  data.resize(31, 0);
+
+  std::vector<uint8_t> event(1 + 1 + 1 + 6 + 1 + data.size() + 1);
+  uint8_t* p = event.data();
+  UINT8_TO_STREAM(p, 1);
+  UINT8_TO_STREAM(p, event_type);
+  UINT8_TO_STREAM(p, kPublicAddress);
+  BDADDR_TO_STREAM(p, DeviceAddress(device));
+  UINT8_TO_STREAM(p, data.size());
+  ARRAY_TO_STREAM(p, data.data(), (int)data.size());
+  INT8_TO_STREAM(p, -60);
+  return event;
+}
+
+// An LE Extended Advertising Report event holding a single report, with one
+// manufacturer specific data field.
+std::vector<uint8_t> ExtendedReport(uint16_t event_type, int device) {
+  std::vector<uint8_t> data(kFragmentLength, 0xa5);
+  data[0] = kFragmentLength - 1;
+  data[1] = 0xff;
+
+  std::vector<uint8_t> event(1 + 24 + data.size());
+  uint8_t* p = event.data();
+  UINT8_TO_STREAM(p, 1);
+  UINT16_TO_STREAM(p, event_type);
+  UINT8_TO_STREAM(p, kPublicAddress);
+  BDADDR_TO_STREAM(p, DeviceAddress(device));
+  UINT8_TO_STREAM(p, PHY_LE_1M);
+  UINT8_TO_STREAM(p, PHY_LE_2M);
+  UINT8_TO_STREAM(p, device % 16); /* SID */
+  INT8_TO_STREAM(p, TX_POWER_NOT_PRESENT);
+  INT8_TO_STREAM(p, -60);
+  UINT16_TO_STREAM(p, 0); /* periodic advertising interval */
+  UINT8_TO_STREAM(p, 0);  /* direct address type */
+  BDADDR_TO_STREAM(p, RawAddress::kEmpty);
+  UINT8_TO_STREAM(p, data.size());
+  ARRAY_TO_STREAM(p, data.data(), (int)data.size());
+  return event;
+}
+
+void Process(std::vector<uint8_t>& event) {
+  btm_ble_process_adv_pkt(event.size(), event.data());
+}
+
+void ProcessExtended(std::vector<uint8_t>& event) {
+  btm_ble_process_ext_adv_pkt(event.size(), event.data());
+}
+
+void ReportCounters(State& state, size_t expected) {
+  const BleAdvertisingCache::Stats& stats = btm_ble_adv_cache_stats();
+  state.counters["reported"] = benchmark::Counter(
+      (double)reported / expected, benchmark::Counter::kAvgIterations);
+  state.counters["evictions"] = stats.evictions;
+  state.counters["incomplete"] = stats.incomplete_chains;
+}
+
+// Active scanning: every device sends ADV_IND, answered by a SCAN_RSP.
+// |in_flight| devices advertise before their scan responses come back.
+// Arguments: devices, in_flight.
+void BM_LegacyActiveScan(State& state) {
+  StartObserving();
+  int devices = state.range(0);
+  int in_flight = state.range(1);
+
+  std::vector<std::vector<uint8_t>> events;
+  for (int first = 0; first < devices; first += in_flight) {
+    int last = std::min(first + in_flight, devices);
+    for (int d = first; d < last; d++)
+      events.push_back(LegacyReport(kAdvInd, d));
+    for (int d = first; d < last; d++)
+      events.push_back(LegacyReport(kScanRsp, d));
+  }
+
+  for (auto _ : state) {
+    for (auto& event : events) Process(event);
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+  ReportCounters(state, devices);
+}
+
+// Passive scanning of beacons: each report is complete on its own.
+// Arguments: devices.
+void BM_LegacyNonConnectable(State& state) {
+  StartObserving();
+  btm_cb.ble_ctr_cb.inq_var.scan_type = BTM_BLE_SCAN_MODE_PASS;
+  int devices = state.range(0);
+
+  std::vector<std::vector<uint8_t>> events;
+  for (int d = 0; d < devices; d++)
+    events.push_back(LegacyReport(kAdvNonconnInd, d));
+
+  for (auto _ : state) {
+    for (auto& event : events) Process(event);
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+  ReportCounters(state, devices);
+}
+
+// Extended advertising with chains of kFragmentsPerChain reports, the
+// fragments of |in_flight| devices interleaved.
+// Arguments: devices, in_flight.
+void BM_ExtendedChains(State& state) {
+  StartObserving();
+  int devices = state.range(0);
+  int in_flight = state.range(1);
+
+  std::vector<std::vector<uint8_t>> events;
+  for (int first = 0; first < devices; first += in_flight) {
+    int last = std::min(first + in_flight, devices);
+    for (int f = 0; f < kFragmentsPerChain; f++) {
+      uint16_t event_type =
+          f + 1 < kFragmentsPerChain ? kExtIncomplete : kExtComplete;
+      for (int d = first; d < last; d++)
+        events.push_back(ExtendedReport(event_type, d));
+    }
+  }
+
+  for (auto _ : state) {
+    for (auto& event : events) ProcessExtended(event);
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+  ReportCounters(state, devices);
+}
+
+void DevicesInFlight(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"devices", "in_flight"});
+  for (int in_flight : {1, 8, 32, 128}) b->Args({1000, in_flight});
+  b->Args({5000, 128});
+}
+
+BENCHMARK(BM_LegacyActiveScan)->Apply(DevicesInFlight);
+BENCHMARK(BM_LegacyNonConnectable)->ArgName("devices")->Arg(1000)->Arg(5000);
+BENCHMARK(BM_ExtendedChains)->Apply(DevicesInFlight);
+
+}  // namespace
+
+BENCHMARK_MAIN();
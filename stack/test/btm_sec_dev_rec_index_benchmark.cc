@@ -0,0 +1,158 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "osi/include/list.h"
+#include "stack/btm/btm_sec_dev_rec_index.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr uint16_t kInvalidHandle = 0xFFFF;
+
+// Lookups per connection: connection complete, encryption change, the L2CAP
+// and SMP traffic, and disconnection.
+constexpr int kHandleLookupsPerConnection = 8;
+constexpr int kAddressLookupsPerConnection = 4;
+
+// The fields of tBTM_SEC_DEV_REC used by the lookups.
+struct Record {
+  RawAddress bd_addr;
+  RawAddress pseudo_addr;
+  uint16_t hci_handle;
+  uint16_t ble_hci_handle;
+};
+
+using Index = SecDevRecIndex<Record>;
+
+Index::Keys KeysOf(const Record& record) {
+  return {record.bd_addr, record.pseudo_addr, record.hci_handle,
+          record.ble_hci_handle};
+}
+
+// Bonded devices, half of them LE, none connected.
+std::vector<Record> MakeRecords(int count) {
+  std::vector<Record> records(count);
+  for (int i = 0; i < count; i++) {
+    Record& record = records[i];
+    record.bd_addr = RawAddress(
+        {0x00, 0x1b, 0xdc, 0x00, (uint8_t)(i >> 8), (uint8_t)i});
+    record.pseudo_addr = i % 2 ? record.bd_addr : RawAddress::kEmpty;
+    record.hci_handle = kInvalidHandle;
+    record.ble_hci_handle = kInvalidHandle;
+  }
+  return records;
+}
+
+// The connections come and go over the records in a pseudo random order.
+int NextDevice(uint32_t* seed, int count) {
+  *seed = *seed * 1664525 + 1013904223;
+  return (*seed >> 8) % count;
+}
+
+uint16_t HandleOf(int device) { return 0x0001 + device % 0x0EFF; }
+
+bool is_handle_equal(void* data, void* context) {
+  Record* record = static_cast<Record*>(data);
+  uint16_t* handle = static_cast<uint16_t*>(context);
+  return !(record->hci_handle == *handle || record->ble_hci_handle == *handle);
+}
+
+bool is_address_equal(void* data, void* context) {
+  Record* record = static_cast<Record*>(data);
+  const RawAddress* bd_addr = static_cast<RawAddress*>(context);
+  return !(record->bd_addr == *bd_addr || record->pseudo_addr == *bd_addr);
+}
+
+// The former lookups: a scan of the list, one callback per record.
+void BM_ListScan(State& state) {
+  int count = state.range(0);
+  std::vector<Record> records = MakeRecords(count);
+  list_t* list = list_new(nullptr);
+  for (Record& record : records) list_append(list, &record);
+
+  uint32_t seed = 1;
+  for (auto _ : state) {
+    Record& record = records[NextDevice(&seed, count)];
+    uint16_t handle = HandleOf(&record - records.data());
+    record.hci_handle = handle;
+
+    for (int i = 0; i < kHandleLookupsPerConnection; i++) {
+      list_node_t* n = list_foreach(list, is_handle_equal, &handle);
+      benchmark::DoNotOptimize(n);
+    }
+    for (int i = 0; i < kAddressLookupsPerConnection; i++) {
+      list_node_t* n = list_foreach(list, is_address_equal, &record.bd_addr);
+      benchmark::DoNotOptimize(n);
+    }
+
+    record.hci_handle = kInvalidHandle;
+  }
+  state.SetItemsProcessed(state.iterations());
+  list_free(list);
+}
+
+void BM_Index(State& state) {
+  int count = state.range(0);
+  std::vector<Record> records = MakeRecords(count);
+  Index index;
+  for (Record& record : records) index.Add(&record, KeysOf(record));
+
+  uint32_t seed = 1;
+  for (auto _ : state) {
+    Record& record = records[NextDevice(&seed, count)];
+    uint16_t handle = HandleOf(&record - records.data());
+    record.hci_handle = handle;
+    index.Update(&record, KeysOf(record));
+
+    for (int i = 0; i < kHandleLookupsPerConnection; i++)
+      benchmark::DoNotOptimize(index.FindByHandle(handle));
+    for (int i = 0; i < kAddressLookupsPerConnection; i++)
+      benchmark::DoNotOptimize(index.FindByAddress(record.bd_addr));
+
+    record.hci_handle = kInvalidHandle;
+    index.Update(&record, KeysOf(record));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Records allocated and removed, the way unbonded devices come and go.
+void BM_IndexAddRemove(State& state) {
+  int count = state.range(0);
+  std::vector<Record> records = MakeRecords(count);
+  Index index;
+  for (Record& record : records) index.Add(&record, KeysOf(record));
+
+  uint32_t seed = 1;
+  for (auto _ : state) {
+    Record& record = records[NextDevice(&seed, count)];
+    index.Remove(&record);
+    index.Add(&record, KeysOf(record));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ListScan)->Arg(100)->Arg(500)->Arg(1000);
+BENCHMARK(BM_Index)->Arg(100)->Arg(500)->Arg(1000);
+BENCHMARK(BM_IndexAddRemove)->Arg(100)->Arg(500)->Arg(1000);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,123 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "stack/btm/btm_sec_dev_rec_index.h"
+
+namespace {
+
+constexpr uint16_t kInvalidHandle = 0xFFFF;
+
+struct Record {
+  int id;
+};
+
+using Index = SecDevRecIndex<Record>;
+
+const RawAddress kAddr({0x00, 0x11, 0x22, 0x33, 0x44, 0x55});
+const RawAddress kOtherAddr({0x00, 0x11, 0x22, 0x33, 0x44, 0x66});
+const RawAddress kRandomAddr({0x4a, 0x11, 0x22, 0x33, 0x44, 0x77});
+
+Index::Keys Keys(const RawAddress& bd_addr, uint16_t hci_handle,
+                 uint16_t ble_hci_handle) {
+  return {bd_addr, RawAddress::kEmpty, hci_handle, ble_hci_handle};
+}
+
+}  // namespace
+
+TEST(SecDevRecIndexTest, find_by_address_and_pseudo_address) {
+  Index index;
+  Record a{0}, b{1};
+  index.Add(&a, Keys(kAddr, kInvalidHandle, kInvalidHandle));
+  index.Add(&b, {kOtherAddr, kRandomAddr, kInvalidHandle, kInvalidHandle});
+
+  EXPECT_EQ(&a, index.FindByAddress(kAddr));
+  EXPECT_EQ(&b, index.FindByAddress(kOtherAddr));
+  EXPECT_EQ(&b, index.FindByAddress(kRandomAddr));
+  EXPECT_EQ(nullptr, index.FindByAddress(
+                         RawAddress({0x00, 0x00, 0x00, 0x00, 0x00, 0x01})));
+}
+
+TEST(SecDevRecIndexTest, find_by_br_edr_and_le_handle) {
+  Index index;
+  Record a{0}, b{1};
+  index.Add(&a, Keys(kAddr, 0x0001, kInvalidHandle));
+  index.Add(&b, Keys(kOtherAddr, kInvalidHandle, 0x0041));
+
+  EXPECT_EQ(&a, index.FindByHandle(0x0001));
+  EXPECT_EQ(&b, index.FindByHandle(0x0041));
+  EXPECT_EQ(nullptr, index.FindByHandle(0x0002));
+}
+
+TEST(SecDevRecIndexTest, first_added_is_found) {
+  Index index;
+  Record a{0}, b{1}, c{2};
+  index.Add(&a, Keys(kOtherAddr, kInvalidHandle, kInvalidHandle));
+  index.Add(&b, Keys(kAddr, kInvalidHandle, kInvalidHandle));
+  index.Add(&c, Keys(kAddr, kInvalidHandle, kInvalidHandle));
+
+  EXPECT_EQ(&a, index.FindByHandle(kInvalidHandle));
+  EXPECT_EQ(&b, index.FindByAddress(kAddr));
+
+  // Moving a record keeps its place in the order
+  index.Update(&a, Keys(kAddr, kInvalidHandle, kInvalidHandle));
+  EXPECT_EQ(&a, index.FindByAddress(kAddr));
+  EXPECT_TRUE(index.IsBefore(&a, &c));
+  EXPECT_FALSE(index.IsBefore(&c, &b));
+
+  index.Remove(&a);
+  index.Remove(&b);
+  EXPECT_EQ(&c, index.FindByAddress(kAddr));
+  EXPECT_EQ(&c, index.FindByHandle(kInvalidHandle));
+}
+
+TEST(SecDevRecIndexTest, update_moves_the_keys) {
+  Index index;
+  Record a{0};
+  index.Add(&a, Keys(kAddr, kInvalidHandle, kInvalidHandle));
+
+  index.Update(&a, {kOtherAddr, kAddr, 0x0001, 0x0041});
+  EXPECT_EQ(&a, index.FindByAddress(kAddr));
+  EXPECT_EQ(&a, index.FindByAddress(kOtherAddr));
+  EXPECT_EQ(&a, index.FindByHandle(0x0041));
+  EXPECT_EQ(nullptr, index.FindByHandle(kInvalidHandle));
+
+  index.Update(&a, Keys(kOtherAddr, kInvalidHandle, kInvalidHandle));
+  EXPECT_EQ(nullptr, index.FindByAddress(kAddr));
+  EXPECT_EQ(nullptr, index.FindByHandle(0x0001));
+  EXPECT_EQ(&a, index.FindByHandle(kInvalidHandle));
+}
+
+TEST(SecDevRecIndexTest, removed_records_are_not_found) {
+  Index index;
+  Record a{0};
+  index.Add(&a, {kAddr, kRandomAddr, 0x0001, 0x0041});
+  index.Remove(&a);
+
+  EXPECT_EQ(0u, index.size());
+  EXPECT_EQ(nullptr, index.FindByAddress(kAddr));
+  EXPECT_EQ(nullptr, index.FindByAddress(kRandomAddr));
+  EXPECT_EQ(nullptr, index.FindByHandle(0x0001));
+  EXPECT_EQ(nullptr, index.FindByHandle(0x0041));
+
+  // Unknown records are ignored
+  index.Update(&a, Keys(kAddr, 0x0001, 0x0041));
+  index.Remove(&a);
+  EXPECT_EQ(nullptr, index.FindByAddress(kAddr));
+}
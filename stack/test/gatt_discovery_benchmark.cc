@@ -0,0 +1,190 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "bt_types.h"
+#include "gatt_api.h"
+#include "gatt_int.h"
+#include "l2c_int.h"
+
+using ::benchmark::State;
+using bluetooth::Uuid;
+
+namespace {
+
+// 40 services of 8 characteristics, each with a value and a CCCD, make a
+// database of 40 * (1 + 8 * 3) = 1000 attributes.
+constexpr int kNumServices = 40;
+constexpr int kCharsPerService = 8;
+constexpr uint16_t kMtu = GATT_DEF_BLE_MTU_SIZE;
+
+struct Characteristic {
+  uint16_t decl_handle;
+  uint16_t value_handle;
+};
+
+struct Service {
+  uint16_t s_hdl;
+  uint16_t e_hdl;
+  std::vector<Characteristic> chars;
+};
+
+// Vendor services and characteristics use 128-bit UUIDs, which is also the
+// worst case for the number of entries per response.
+Uuid VendorUuid(int service, int characteristic) {
+  uint8_t uuid[Uuid::kNumBytes128] = {0x6e, 0x40, 0x00, 0x00, 0xb5, 0xa3,
+                                      0xf3, 0x93, 0xe0, 0xa9, 0xe5, 0x0e,
+                                      0x24, 0xdc, 0xca, 0x9e};
+  uuid[2] = service;
+  uuid[3] = characteristic;
+  return Uuid::From128BitBE(uuid);
+}
+
+tGATT_CBACK gatt_callbacks;
+
+std::vector<Service> BuildDatabase() {
+  l2c_init();
+  l2cb.l2cap_trace_level = BT_TRACE_LEVEL_NONE;
+  gatt_init();
+  tGATT_IF gatt_if = GATT_Register(Uuid::GetRandom(), &gatt_callbacks);
+
+  std::vector<Service> services;
+  for (int s = 0; s < kNumServices; s++) {
+    std::vector<btgatt_db_element_t> db(1 + 2 * kCharsPerService);
+    db[0].type = BTGATT_DB_PRIMARY_SERVICE;
+    db[0].uuid = VendorUuid(s, 0);
+    for (int c = 0; c < kCharsPerService; c++) {
+      btgatt_db_element_t& chr = db[1 + 2 * c];
+      chr.type = BTGATT_DB_CHARACTERISTIC;
+      chr.uuid = VendorUuid(s, c + 1);
+      chr.properties = GATT_CHAR_PROP_BIT_READ | GATT_CHAR_PROP_BIT_NOTIFY;
+      chr.permissions = GATT_PERM_READ;
+
+      btgatt_db_element_t& cccd = db[2 + 2 * c];
+      cccd.type = BTGATT_DB_DESCRIPTOR;
+      cccd.uuid = Uuid::From16Bit(GATT_UUID_CHAR_CLIENT_CONFIG);
+      cccd.permissions = GATT_PERM_READ | GATT_PERM_WRITE;
+    }
+    CHECK(GATTS_AddService(gatt_if, db.data(), db.size()) ==
+          GATT_SERVICE_STARTED);
+
+    Service service = {db[0].attribute_handle, db.back().attribute_handle, {}};
+    for (int c = 0; c < kCharsPerService; c++) {
+      uint16_t value_handle = db[1 + 2 * c].attribute_handle;
+      service.chars.push_back({(uint16_t)(value_handle - 1), value_handle});
+    }
+    services.push_back(service);
+  }
+  return services;
+}
+
+void FreeDatabase() {
+  gatt_free();
+  l2c_free();
+}
+
+// The link is never connected in L2CAP, so the responses are built in full
+// and then dropped by L2CA_SendFixedChnlData.
+tGATT_TCB& ConnectClient() {
+  tGATT_TCB& tcb = gatt_cb.tcb[0];
+  tcb.in_use = true;
+  tcb.peer_bda = RawAddress({0x00, 0x11, 0x22, 0x33, 0x44, 0x55});
+  tcb.transport = BT_TRANSPORT_LE;
+  tcb.att_lcid = L2CAP_ATT_CID;
+  tcb.payload_size = kMtu;
+  return tcb;
+}
+
+void SendRequest(tGATT_TCB& tcb, uint8_t op_code, uint16_t s_hdl,
+                 uint16_t e_hdl, uint16_t type) {
+  uint8_t pdu[6];
+  uint8_t* p = pdu;
+  UINT16_TO_STREAM(p, s_hdl);
+  UINT16_TO_STREAM(p, e_hdl);
+  if (op_code != GATT_REQ_FIND_INFO) UINT16_TO_STREAM(p, type);
+  gatt_server_handle_client_req(tcb, op_code, p - pdu, pdu);
+}
+
+// Replays the requests of a client discovering every service, characteristic
+// and descriptor. With 128-bit UUIDs and the default MTU each response holds
+// a single service or characteristic, so the client continues right after
+// the last handle it learned until the server answers Attribute Not Found.
+void DiscoverAll(tGATT_TCB& tcb, const std::vector<Service>& services) {
+  // The GATT service registered by gatt_init comes first.
+  uint16_t s_hdl = 0x0001;
+  for (const tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
+    SendRequest(tcb, GATT_REQ_READ_BY_GRP_TYPE, s_hdl, 0xffff,
+                GATT_UUID_PRI_SERVICE);
+    s_hdl = el.e_hdl + 1;
+  }
+  SendRequest(tcb, GATT_REQ_READ_BY_GRP_TYPE, s_hdl, 0xffff,
+              GATT_UUID_PRI_SERVICE);
+
+  for (const Service& service : services) {
+    s_hdl = service.s_hdl;
+    for (const Characteristic& chr : service.chars) {
+      SendRequest(tcb, GATT_REQ_READ_BY_TYPE, s_hdl, service.e_hdl,
+                  GATT_UUID_CHAR_DECLARE);
+      s_hdl = chr.decl_handle + 1;
+    }
+    SendRequest(tcb, GATT_REQ_READ_BY_TYPE, s_hdl, service.e_hdl,
+                GATT_UUID_CHAR_DECLARE);
+
+    for (size_t c = 0; c < service.chars.size(); c++) {
+      uint16_t e_hdl = c + 1 < service.chars.size()
+                           ? service.chars[c + 1].decl_handle - 1
+                           : service.e_hdl;
+      SendRequest(tcb, GATT_REQ_FIND_INFO, service.chars[c].value_handle + 1,
+                  e_hdl, 0);
+    }
+  }
+}
+
+void BM_FullDiscovery(State& state) {
+  std::vector<Service> services = BuildDatabase();
+  tGATT_TCB& tcb = ConnectClient();
+
+  for (auto _ : state) DiscoverAll(tcb, services);
+
+  FreeDatabase();
+}
+BENCHMARK(BM_FullDiscovery);
+
+// Reads the declaration of every characteristic by handle range, the pattern
+// of clients that look up a single characteristic by UUID.
+void BM_ReadByTypePerCharacteristic(State& state) {
+  std::vector<Service> services = BuildDatabase();
+  tGATT_TCB& tcb = ConnectClient();
+
+  for (auto _ : state) {
+    for (const Service& service : services) {
+      for (const Characteristic& chr : service.chars) {
+        SendRequest(tcb, GATT_REQ_READ_BY_TYPE, chr.decl_handle, service.e_hdl,
+                    GATT_UUID_CHAR_DECLARE);
+      }
+    }
+  }
+
+  FreeDatabase();
+}
+BENCHMARK(BM_ReadByTypePerCharacteristic);
+
+}  // namespace
+
+BENCHMARK_MAIN();
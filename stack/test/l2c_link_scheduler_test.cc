@@ -0,0 +1,407 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack/l2cap/l2c_link_scheduler.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+using bluetooth::l2cap::LinkScheduler;
+
+namespace {
+
+constexpr size_t kMaxLinks = 8;
+
+// Plays the role of l2c_link_check_send_pkts and the controller: links queue
+// ACL packets, the scheduler picks which one fills each free controller
+// buffer, and the controller reports a completed packet for every buffer
+// once its air time has passed, in transmission order.
+class SimulatedController {
+ public:
+  struct Link {
+    uint16_t segments_per_packet = 1;
+    size_t queued = 0;  // packets
+    size_t segments_sent = 0;
+  };
+
+  SimulatedController(LinkScheduler& scheduler, uint16_t num_buffers,
+                      uint64_t air_time_us)
+      : scheduler_(scheduler),
+        free_buffers_(num_buffers),
+        air_time_us_(air_time_us),
+        links_(kMaxLinks) {}
+
+  Link& link(size_t index) { return links_[index]; }
+  uint64_t now() const { return now_us_; }
+
+  void Queue(size_t index, size_t packets) {
+    links_[index].queued += packets;
+    scheduler_.MarkReady(index, now_us_);
+    Service();
+  }
+
+  // Runs until |until_us|, calling |on_tick| whenever time moves forward.
+  template <typename Callback>
+  void RunUntil(uint64_t until_us, Callback on_tick) {
+    while (now_us_ < until_us) {
+      uint64_t next_us = until_us;
+      if (!in_air_.empty())
+        next_us = std::min(next_us, in_air_.front().done_us);
+      now_us_ = next_us;
+
+      while (!in_air_.empty() && in_air_.front().done_us <= now_us_) {
+        free_buffers_++;
+        scheduler_.OnCompleted(in_air_.front().link, 1, now_us_);
+        in_air_.pop_front();
+      }
+      on_tick(now_us_);
+      Service();
+    }
+  }
+
+  void RunUntil(uint64_t until_us) {
+    RunUntil(until_us, [](uint64_t) {});
+  }
+
+ private:
+  struct InAir {
+    size_t link;
+    uint64_t done_us;
+  };
+
+  void Service() {
+    while (free_buffers_ > 0) {
+      int index = scheduler_.Next(LinkScheduler::kBrEdr);
+      if (index == LinkScheduler::kNoLink) return;
+
+      Link& link = links_[index];
+      if (link.queued == 0) {
+        scheduler_.MarkIdle(index);
+        continue;
+      }
+      // Like l2c_link_send_to_lower, a segmented packet goes out whole even
+      // if it takes the controller past its window.
+      link.queued--;
+      for (uint16_t i = 0; i < link.segments_per_packet; i++) {
+        uint64_t start_us = now_us_;
+        if (!in_air_.empty())
+          start_us = std::max(start_us, in_air_.back().done_us);
+        in_air_.push_back({(size_t)index, start_us + air_time_us_});
+        free_buffers_--;
+      }
+      link.segments_sent += link.segments_per_packet;
+      scheduler_.OnSent(index, link.segments_per_packet, now_us_);
+    }
+  }
+
+  LinkScheduler& scheduler_;
+  int free_buffers_;
+  uint64_t air_time_us_;
+  uint64_t now_us_ = 0;
+  std::vector<Link> links_;
+  std::deque<InAir> in_air_;
+};
+
+TEST(L2capLinkSchedulerTest, NothingReady) {
+  LinkScheduler scheduler(kMaxLinks);
+  EXPECT_EQ(LinkScheduler::kNoLink, scheduler.Next(LinkScheduler::kBrEdr));
+
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 1, 4, 0);
+  EXPECT_EQ(LinkScheduler::kNoLink, scheduler.Next(LinkScheduler::kBrEdr));
+
+  scheduler.MarkReady(0, 0);
+  EXPECT_EQ(0, scheduler.Next(LinkScheduler::kBrEdr));
+  EXPECT_EQ(LinkScheduler::kNoLink, scheduler.Next(LinkScheduler::kLe));
+
+  scheduler.MarkIdle(0);
+  EXPECT_EQ(LinkScheduler::kNoLink, scheduler.Next(LinkScheduler::kBrEdr));
+}
+
+TEST(L2capLinkSchedulerTest, PoolsAreIndependent) {
+  LinkScheduler scheduler(kMaxLinks);
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 1, 4, 0);
+  scheduler.ConfigureLink(1, LinkScheduler::kLe, 1, 4, 0);
+  scheduler.MarkReady(0, 0);
+  scheduler.MarkReady(1, 0);
+
+  EXPECT_EQ(0, scheduler.Next(LinkScheduler::kBrEdr));
+  EXPECT_EQ(1, scheduler.Next(LinkScheduler::kLe));
+
+  // Moving a ready link to the other pool takes it out of its old round.
+  scheduler.ConfigureLink(0, LinkScheduler::kLe, 1, 4, 0);
+  EXPECT_EQ(LinkScheduler::kNoLink, scheduler.Next(LinkScheduler::kBrEdr));
+  EXPECT_TRUE(scheduler.IsReady(0));
+}
+
+TEST(L2capLinkSchedulerTest, RoundRobinWithEqualWeights) {
+  LinkScheduler scheduler(kMaxLinks);
+  for (size_t link = 0; link < 3; link++) {
+    scheduler.ConfigureLink(link, LinkScheduler::kBrEdr, 1, 100, 0);
+    scheduler.MarkReady(link, 0);
+  }
+
+  std::vector<int> order;
+  for (int i = 0; i < 6; i++) {
+    int link = scheduler.Next(LinkScheduler::kBrEdr);
+    order.push_back(link);
+    scheduler.OnSent(link, 1, 0);
+  }
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 0, 1, 2}), order);
+}
+
+TEST(L2capLinkSchedulerTest, BlockedLinkLeavesRoundUntilCompleted) {
+  LinkScheduler scheduler(kMaxLinks);
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 4, 2, 0);
+  scheduler.ConfigureLink(1, LinkScheduler::kBrEdr, 1, 100, 0);
+  scheduler.MarkReady(0, 0);
+  scheduler.MarkReady(1, 0);
+
+  EXPECT_EQ(0, scheduler.Next(LinkScheduler::kBrEdr));
+  scheduler.OnSent(0, 1, 0);
+  EXPECT_EQ(0, scheduler.Next(LinkScheduler::kBrEdr));
+  scheduler.OnSent(0, 1, 0);
+  EXPECT_FALSE(scheduler.IsReady(0));
+  EXPECT_EQ(2, scheduler.InFlight(0));
+
+  EXPECT_EQ(1, scheduler.Next(LinkScheduler::kBrEdr));
+  scheduler.OnSent(1, 1, 0);
+
+  // Link 0 rejoins the round behind the link being served.
+  scheduler.OnCompleted(0, 1, 10);
+  EXPECT_TRUE(scheduler.IsReady(0));
+  EXPECT_EQ(1, scheduler.Next(LinkScheduler::kBrEdr));
+  scheduler.OnSent(1, 1, 10);
+  EXPECT_EQ(0, scheduler.Next(LinkScheduler::kBrEdr));
+}
+
+TEST(L2capLinkSchedulerTest, QuotaChangeBlocksAndUnblocks) {
+  LinkScheduler scheduler(kMaxLinks);
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 1, 4, 0);
+  scheduler.MarkReady(0, 0);
+  scheduler.OnSent(0, 2, 0);
+
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 1, 2, 0);
+  EXPECT_FALSE(scheduler.IsReady(0));
+  EXPECT_EQ(LinkScheduler::kNoLink, scheduler.Next(LinkScheduler::kBrEdr));
+
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 1, 3, 0);
+  EXPECT_TRUE(scheduler.IsReady(0));
+}
+
+TEST(L2capLinkSchedulerTest, RoundRobinQuotaBlocksSharingLinks) {
+  LinkScheduler scheduler(kMaxLinks);
+  scheduler.SetRoundRobinQuota(LinkScheduler::kBrEdr, 1);
+  for (size_t link = 0; link < 3; link++) {
+    scheduler.ConfigureLink(link, LinkScheduler::kBrEdr, 1, 0, 0);
+    scheduler.MarkReady(link, 0);
+  }
+
+  EXPECT_EQ(0, scheduler.Next(LinkScheduler::kBrEdr));
+  scheduler.OnSent(0, 1, 0);
+  EXPECT_EQ(1, scheduler.RoundRobinInFlight(LinkScheduler::kBrEdr));
+  EXPECT_FALSE(scheduler.IsReady(1));
+  EXPECT_FALSE(scheduler.IsReady(2));
+  EXPECT_EQ(LinkScheduler::kNoLink, scheduler.Next(LinkScheduler::kBrEdr));
+
+  // Any link completing its buffer lets all of them back in the round.
+  scheduler.OnCompleted(0, 1, 10);
+  EXPECT_TRUE(scheduler.IsReady(1));
+  EXPECT_TRUE(scheduler.IsReady(2));
+  EXPECT_EQ(1, scheduler.Next(LinkScheduler::kBrEdr));
+
+  // So does a larger quota.
+  scheduler.OnSent(1, 1, 10);
+  EXPECT_FALSE(scheduler.IsReady(2));
+  scheduler.SetRoundRobinQuota(LinkScheduler::kBrEdr, 2);
+  EXPECT_EQ(2, scheduler.Next(LinkScheduler::kBrEdr));
+}
+
+TEST(L2capLinkSchedulerTest, RemovedLinkIsForgotten) {
+  LinkScheduler scheduler(kMaxLinks);
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 1, 4, 0);
+  scheduler.ConfigureLink(1, LinkScheduler::kBrEdr, 1, 4, 0);
+  scheduler.MarkReady(0, 0);
+  scheduler.MarkReady(1, 0);
+  scheduler.OnSent(0, 1, 0);
+
+  scheduler.RemoveLink(0);
+  EXPECT_EQ(1, scheduler.Next(LinkScheduler::kBrEdr));
+  scheduler.OnCompleted(0, 1, 10);  // Late completion for the old link
+  EXPECT_EQ(0u, scheduler.GetStats(0, 10).packets_sent);
+}
+
+// Busy links get controller buffers in proportion to their weights.
+TEST(L2capLinkSchedulerTest, WeightedShares) {
+  LinkScheduler scheduler(kMaxLinks);
+  SimulatedController controller(scheduler, 4, 100);
+  const uint16_t weights[] = {4, 2, 1, 1};
+  for (size_t i = 0; i < 4; i++) {
+    scheduler.ConfigureLink(i, LinkScheduler::kBrEdr, weights[i], 100, 0);
+    controller.Queue(i, 100000);
+  }
+
+  controller.RunUntil(1000000);
+
+  size_t total = 0;
+  for (size_t i = 0; i < 4; i++) total += controller.link(i).segments_sent;
+  for (size_t i = 0; i < 4; i++) {
+    double share = (double)controller.link(i).segments_sent / total;
+    EXPECT_NEAR(weights[i] / 8.0, share, 0.01) << "link " << i;
+  }
+}
+
+// A link sending segmented PDUs is charged per segment, so it does not get
+// more of the controller than a link of the same weight sending small ones.
+TEST(L2capLinkSchedulerTest, SegmentsAreCharged) {
+  LinkScheduler scheduler(kMaxLinks);
+  SimulatedController controller(scheduler, 4, 100);
+  controller.link(0).segments_per_packet = 3;
+  for (size_t i = 0; i < 2; i++) {
+    scheduler.ConfigureLink(i, LinkScheduler::kBrEdr, 1, 100, 0);
+    controller.Queue(i, 100000);
+  }
+
+  controller.RunUntil(1000000);
+
+  double ratio = (double)controller.link(0).segments_sent /
+                 controller.link(1).segments_sent;
+  EXPECT_NEAR(1.0, ratio, 0.01);
+}
+
+// The controller never sits idle while some link has data and credits.
+TEST(L2capLinkSchedulerTest, WorkConserving) {
+  LinkScheduler scheduler(kMaxLinks);
+  SimulatedController controller(scheduler, 8, 100);
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 8, 8, 0);
+  scheduler.ConfigureLink(1, LinkScheduler::kBrEdr, 1, 8, 0);
+  controller.Queue(1, 100000);
+
+  // The heavily weighted link only has a little data; the other one takes
+  // the rest of the air time.
+  controller.Queue(0, 10);
+  controller.RunUntil(1000000);
+
+  // One buffer completes every 100us, plus the eight still in the air.
+  EXPECT_EQ(10u, controller.link(0).segments_sent);
+  EXPECT_EQ(10000u + 8u - 10u, controller.link(1).segments_sent);
+}
+
+// Round-robin links outnumbering the round-robin quota never have more than
+// the quota outstanding together, even with free controller buffers, and
+// take even turns at it next to a link with a quota of its own.
+TEST(L2capLinkSchedulerTest, RoundRobinLinksOutnumberQuota) {
+  constexpr uint16_t kRoundRobinQuota = 2;
+  constexpr size_t kNumRoundRobinLinks = 5;
+
+  LinkScheduler scheduler(kMaxLinks);
+  SimulatedController controller(scheduler, 8, 100);
+  scheduler.SetRoundRobinQuota(LinkScheduler::kBrEdr, kRoundRobinQuota);
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 1, 4, 0);
+  controller.Queue(0, 100000);
+  for (size_t i = 1; i <= kNumRoundRobinLinks; i++) {
+    scheduler.ConfigureLink(i, LinkScheduler::kBrEdr, 1, 0, 0);
+    controller.Queue(i, 100000);
+  }
+
+  uint16_t max_in_flight = 0;
+  controller.RunUntil(1000000, [&](uint64_t) {
+    uint16_t in_flight = 0;
+    for (size_t i = 1; i <= kNumRoundRobinLinks; i++)
+      in_flight += scheduler.InFlight(i);
+    EXPECT_EQ(in_flight, scheduler.RoundRobinInFlight(LinkScheduler::kBrEdr));
+    max_in_flight = std::max(max_in_flight, in_flight);
+  });
+
+  EXPECT_EQ(kRoundRobinQuota, max_in_flight);
+  EXPECT_GT(controller.link(0).segments_sent, 0u);
+  for (size_t i = 2; i <= kNumRoundRobinLinks; i++) {
+    double ratio = (double)controller.link(i).segments_sent /
+                   controller.link(1).segments_sent;
+    EXPECT_NEAR(1.0, ratio, 0.01) << "link " << i;
+  }
+}
+
+// An A2DP link with a higher weight sharing the controller with several
+// saturating links gets its media packets out within a few buffer times,
+// and the statistics report its wait and credit use.
+TEST(L2capLinkSchedulerTest, A2dpLatencyUnderLoad) {
+  constexpr uint64_t kAirTimeUs = 1250;  // 2-DH5
+  constexpr uint64_t kMediaIntervalUs = 20000;
+  constexpr size_t kPacketsPerInterval = 3;
+  constexpr size_t kA2dp = 0;
+  constexpr size_t kNumBusyLinks = 4;
+
+  LinkScheduler scheduler(kMaxLinks);
+  SimulatedController controller(scheduler, 8, kAirTimeUs);
+  scheduler.ConfigureLink(kA2dp, LinkScheduler::kBrEdr, 4, 5, 0);
+  for (size_t i = 1; i <= kNumBusyLinks; i++) {
+    scheduler.ConfigureLink(i, LinkScheduler::kBrEdr, 1, 2, 0);
+    controller.Queue(i, 1000000);
+  }
+
+  uint64_t next_media_us = 0;
+  controller.RunUntil(2000000, [&](uint64_t now_us) {
+    if (now_us >= next_media_us) {
+      controller.Queue(kA2dp, kPacketsPerInterval);
+      next_media_us += kMediaIntervalUs;
+    }
+  });
+
+  // The media packets only ever wait behind one buffer of each busy link
+  // and the buffers that are already in the air.
+  LinkScheduler::LinkStats stats = scheduler.GetStats(kA2dp, controller.now());
+  EXPECT_GE(stats.packets_sent, 99u * kPacketsPerInterval);
+  EXPECT_LE(stats.wait_max_us, (8 + kNumBusyLinks) * kAirTimeUs);
+  EXPECT_GT(stats.CreditUtilizationPercent(), 0u);
+  EXPECT_LT(stats.CreditUtilizationPercent(), 100u);
+
+  // The busy links keep most of their credits in use, the bursty A2DP link
+  // far fewer.
+  unsigned a2dp_utilization = stats.CreditUtilizationPercent();
+  for (size_t i = 1; i <= kNumBusyLinks; i++) {
+    stats = scheduler.GetStats(i, controller.now());
+    EXPECT_GT(stats.packets_sent, 0u);
+    EXPECT_GT(stats.CreditUtilizationPercent(), 2 * a2dp_utilization);
+  }
+}
+
+TEST(L2capLinkSchedulerTest, Statistics) {
+  LinkScheduler scheduler(kMaxLinks);
+  scheduler.ConfigureLink(0, LinkScheduler::kBrEdr, 1, 2, 0);
+  scheduler.ConfigureLink(1, LinkScheduler::kBrEdr, 1, 2, 0);
+  scheduler.MarkReady(0, 0);
+  scheduler.MarkReady(1, 0);
+
+  scheduler.OnSent(0, 1, 100);
+  scheduler.OnSent(1, 1, 300);
+  scheduler.OnSent(0, 1, 400);
+  scheduler.OnCompleted(0, 2, 600);
+
+  LinkScheduler::LinkStats stats = scheduler.GetStats(0, 800);
+  EXPECT_EQ(2u, stats.packets_sent);
+  EXPECT_EQ(2u, stats.wait_samples);
+  EXPECT_EQ(400u, stats.wait_total_us);
+  EXPECT_EQ(300u, stats.wait_max_us);
+  EXPECT_EQ(200u, stats.AverageWaitUs());
+  // One buffer out for 300us and two for 200us, out of 2 * 800us of credit.
+  EXPECT_EQ(700u, stats.in_flight_us);
+  EXPECT_EQ(1600u, stats.credit_us);
+  EXPECT_EQ(43u, stats.CreditUtilizationPercent());
+}
+
+}  // namespace
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "bt_types.h"
+#include "l2c_int.h"
+#include "osi/include/allocator.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr uint16_t kFirstHandle = 0x0080;
+constexpr uint16_t kPayloadSize = 32;
+
+uint16_t HandleOfLink(int link) { return kFirstHandle + 3 * link; }
+
+// Marks every LCB as a connected BR/EDR link, the way l2c_link_hci_conn_comp
+// leaves them, without going through the controller.
+void ConnectAllLinks() {
+  l2c_init();
+  l2cb.l2cap_trace_level = BT_TRACE_LEVEL_NONE;
+  for (int link = 0; link < MAX_L2CAP_LINKS; link++) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[link];
+    p_lcb->in_use = true;
+    p_lcb->link_state = LST_CONNECTED;
+    p_lcb->transport = BT_TRANSPORT_BR_EDR;
+    p_lcb->handle = HCI_INVALID_HANDLE;
+    l2cu_set_lcb_handle(p_lcb, HandleOfLink(link));
+  }
+}
+
+void DisconnectAllLinks() {
+  for (int link = 0; link < MAX_L2CAP_LINKS; link++) {
+    l2cu_set_lcb_handle(&l2cb.lcb_pool[link], HCI_INVALID_HANDLE);
+    l2cb.lcb_pool[link].in_use = false;
+  }
+  l2c_free();
+}
+
+// A connectionless channel packet is dropped by L2CAP right after the link
+// and channel lookups, which isolates them from the rest of the RX path.
+BT_HDR* MakeAclPacket(uint16_t handle) {
+  uint16_t hci_len = L2CAP_PKT_OVERHEAD + kPayloadSize;
+  BT_HDR* p_msg = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + 4 + hci_len);
+  p_msg->event = BT_EVT_TO_BTU_HCI_ACL;
+  p_msg->len = 4 + hci_len;
+  p_msg->offset = 0;
+  p_msg->layer_specific = 0;
+
+  uint8_t* p = (uint8_t*)(p_msg + 1);
+  UINT16_TO_STREAM(p, handle | (L2CAP_PKT_START << L2CAP_PKT_TYPE_SHIFT));
+  UINT16_TO_STREAM(p, hci_len);
+  UINT16_TO_STREAM(p, kPayloadSize);
+  UINT16_TO_STREAM(p, L2CAP_CONNECTIONLESS_CID);
+  return p_msg;
+}
+
+// Inbound ACL packets round-robin over MAX_L2CAP_LINKS active links.
+void BM_RxAclData(State& state) {
+  ConnectAllLinks();
+
+  for (auto _ : state) {
+    for (int link = 0; link < MAX_L2CAP_LINKS; link++)
+      l2c_rcv_acl_data(MakeAclPacket(HandleOfLink(link)));
+  }
+
+  DisconnectAllLinks();
+  state.SetItemsProcessed(state.iterations() * MAX_L2CAP_LINKS);
+}
+
+void BM_FindLcbByHandle(State& state) {
+  ConnectAllLinks();
+
+  for (auto _ : state) {
+    for (int link = 0; link < MAX_L2CAP_LINKS; link++)
+      benchmark::DoNotOptimize(l2cu_find_lcb_by_handle(HandleOfLink(link)));
+  }
+
+  DisconnectAllLinks();
+  state.SetItemsProcessed(state.iterations() * MAX_L2CAP_LINKS);
+}
+
+void BM_FindRcbByPsm(State& state) {
+  l2c_init();
+  for (int client = 0; client < MAX_L2CAP_CLIENTS; client++)
+    l2cu_allocate_rcb(0x1001 + 2 * client);
+
+  for (auto _ : state) {
+    for (int client = 0; client < MAX_L2CAP_CLIENTS; client++)
+      benchmark::DoNotOptimize(l2cu_find_rcb_by_psm(0x1001 + 2 * client));
+  }
+
+  for (int client = 0; client < MAX_L2CAP_CLIENTS; client++)
+    l2cu_release_rcb(&l2cb.rcb_pool[client]);
+  l2c_free();
+  state.SetItemsProcessed(state.iterations() * MAX_L2CAP_CLIENTS);
+}
+
+}  // namespace
+
+BENCHMARK(BM_RxAclData);
+BENCHMARK(BM_FindLcbByHandle);
+BENCHMARK(BM_FindRcbByPsm);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+using ::benchmark::State;
+
+namespace {
+
+struct Scalar {
+  uint32_t n[KEY_LENGTH_DWORDS_P256];
+};
+
+Scalar MakeScalar(uint32_t* seed) {
+  Scalar k;
+  for (uint32_t& word : k.n) {
+    *seed = *seed * 1664525 + 1013904223;
+    word = *seed;
+  }
+  return k;
+}
+
+// A peer public key: a multiple of the base point.
+Point MakePeerKey(uint32_t* seed) {
+  Scalar k = MakeScalar(seed);
+  Point p;
+  ECC_PointMult_Base(&p, k.n);
+  return p;
+}
+
+// Public key generation, as the former ECC_PointMult().
+void BM_BinNafBase(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  uint32_t seed = 1;
+  Scalar k = MakeScalar(&seed);
+  Point q;
+  for (auto _ : state) {
+    Scalar n = k;
+    ECC_PointMult_Bin_NAF(&q, &curve_p256.G, n.n, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(q);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// DHKey computation, as the former ECC_PointMult().
+void BM_BinNafPeer(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  uint32_t seed = 1;
+  Scalar k = MakeScalar(&seed);
+  Point p = MakePeerKey(&seed);
+  Point q;
+  for (auto _ : state) {
+    Scalar n = k;
+    ECC_PointMult_Bin_NAF(&q, &p, n.n, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(q);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_Base(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  uint32_t seed = 1;
+  Scalar k = MakeScalar(&seed);
+  Point q;
+  for (auto _ : state) {
+    ECC_PointMult_Base(&q, k.n);
+    benchmark::DoNotOptimize(q);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_Window(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  uint32_t seed = 1;
+  Scalar k = MakeScalar(&seed);
+  Point p = MakePeerKey(&seed);
+  Point q;
+  for (auto _ : state) {
+    ECC_PointMult_Window(&q, &p, k.n);
+    benchmark::DoNotOptimize(q);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// A whole LE Secure Connections key exchange: key pair and DHKey.
+void BM_Pairing(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  uint32_t seed = 1;
+  Point peer = MakePeerKey(&seed);
+  for (auto _ : state) {
+    Scalar k = MakeScalar(&seed);
+    Point public_key, dhkey;
+    ECC_PointMult(&public_key, &curve_p256.G, k.n, KEY_LENGTH_DWORDS_P256);
+    ECC_PointMult(&dhkey, &peer, k.n, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(dhkey);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_BinNafBase);
+BENCHMARK(BM_BinNafPeer);
+BENCHMARK(BM_Base);
+BENCHMARK(BM_Window);
+BENCHMARK(BM_Pairing);
+
+}  // namespace
+
+BENCHMARK_MAIN();
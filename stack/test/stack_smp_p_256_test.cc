@@ -0,0 +1,191 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <string>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+namespace testing {
+
+namespace {
+
+/* Words of a big endian hexadecimal number of 64 digits, least significant
+ * first */
+void from_hex(uint32_t* words, const std::string& hex) {
+  ASSERT_EQ(64u, hex.size());
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+    words[i] = strtoul(hex.substr(56 - 8 * i, 8).c_str(), nullptr, 16);
+  }
+}
+
+struct Scalar {
+  uint32_t n[KEY_LENGTH_DWORDS_P256];
+};
+
+Scalar scalar(const std::string& hex) {
+  Scalar s;
+  from_hex(s.n, hex);
+  return s;
+}
+
+Point point(const std::string& x, const std::string& y) {
+  Point p;
+  memset(&p, 0, sizeof(p));
+  from_hex(p.x, x);
+  from_hex(p.y, y);
+  return p;
+}
+
+void expect_point_eq(const Point& expected, const Point& actual) {
+  EXPECT_EQ(0, memcmp(expected.x, actual.x, sizeof(expected.x)));
+  EXPECT_EQ(0, memcmp(expected.y, actual.y, sizeof(expected.y)));
+}
+
+class SmpP256Test : public ::testing::Test {
+ protected:
+  void SetUp() override { p_256_init_curve(KEY_LENGTH_DWORDS_P256); }
+
+  /* Checks all the ways to multiply the base point */
+  void ExpectBaseMult(const Scalar& k, const Point& expected) {
+    Point q;
+    ECC_PointMult_Base(&q, k.n);
+    expect_point_eq(expected, q);
+    ECC_PointMult_Window(&q, &curve_p256.G, k.n);
+    expect_point_eq(expected, q);
+
+    Scalar n = k;
+    ECC_PointMult(&q, &curve_p256.G, n.n, KEY_LENGTH_DWORDS_P256);
+    expect_point_eq(expected, q);
+    EXPECT_EQ(0, memcmp(k.n, n.n, sizeof(n.n)));
+  }
+};
+
+/* Multiples of the base point: 2G from the NIST test vectors, and the ones
+ * around the order n of the curve */
+TEST_F(SmpP256Test, base_point_multiples) {
+  struct {
+    const char* k;
+    const char* x;
+    const char* y;
+  } multiples[] = {
+      {"0000000000000000000000000000000000000000000000000000000000000001",
+       "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296",
+       "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5"},
+      {"0000000000000000000000000000000000000000000000000000000000000002",
+       "7cf27b188d034f7e8a52380304b51ac3c08969e277f21b35a60b48fc47669978",
+       "07775510db8ed040293d9ac69f7430dbba7dade63ce982299e04b79d227873d1"},
+      // n - 1: -G
+      {"ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632550",
+       "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296",
+       "b01cbd1c01e58065711814b583f061e9d431cca994cea1313449bf97c840ae0a"},
+      // n and 0: the point at infinity, returned as (0, 0)
+      {"ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551",
+       "0000000000000000000000000000000000000000000000000000000000000000",
+       "0000000000000000000000000000000000000000000000000000000000000000"},
+      {"0000000000000000000000000000000000000000000000000000000000000000",
+       "0000000000000000000000000000000000000000000000000000000000000000",
+       "0000000000000000000000000000000000000000000000000000000000000000"},
+  };
+
+  for (const auto& multiple : multiples) {
+    ExpectBaseMult(scalar(multiple.k), point(multiple.x, multiple.y));
+  }
+}
+
+/* P-256 sample data of the Core specification, Vol 3, Part H, 2.3.5.6.1 */
+TEST_F(SmpP256Test, core_specification_sample_data) {
+  struct {
+    const char* private_a;
+    const char* public_a_x;
+    const char* public_a_y;
+    const char* private_b;
+    const char* public_b_x;
+    const char* public_b_y;
+    const char* dhkey;
+  } samples[] = {
+      {"3f49f6d4a3c55f3874c9b3e3d2103f504aff607beb40b7995899b8a6cd3c1abd",
+       "20b003d2f297be2c5e2c83a7e9f9a5b9eff49111acf4fddbcc0301480e359de6",
+       "dc809c49652aeb6d63329abf5a52155c766345c28fed3024741c8ed01589d28b",
+       "55188b3d32f6bb9a900afcfbeed4e72a59cb9ac2f19d7cfb6b4fdd49f47fc5fd",
+       "1ea1f0f01faf1d9609592284f19e4c0047b58afd8615a69f559077b22faaa190",
+       "4c55f33e429dad377356703a9ab85160472d1130e28e36765f89aff915b1214a",
+       "ec0234a357c8ad05341010a60a397d9b99796b13b4f866f1868d34f373bfa698"},
+      {"06a516693c9aa31a6084545d0c5db641b48572b97203ddffb7ac73f7d0457663",
+       "2c31a47b5779809ef44cb5eaaf5c3e43d5f8faad4a8794cb987e9b03745c78dd",
+       "919512183898dfbecd52e2408e43871fd021109117bd3ed4eaf8437743715d4f",
+       "529aa0670d72cd6497502ed473502b037e8803b5c60829a5a3caa219505530ba",
+       "f465e43ff23d3f1b9dc7dfc04da8758184dbc966204796eccf0d6cf5e16500cc",
+       "0201d048bcbbd899eeefc424164e33c201c2b010ca6b4d43a8a155cad8ecb279",
+       "ab85843a2f6d883f62e5684b38e307335fe6e1945ecd19604105c6f23221eb69"},
+  };
+
+  for (const auto& sample : samples) {
+    Scalar private_a = scalar(sample.private_a);
+    Scalar private_b = scalar(sample.private_b);
+    Point public_a = point(sample.public_a_x, sample.public_a_y);
+    Point public_b = point(sample.public_b_x, sample.public_b_y);
+    EXPECT_TRUE(ECC_ValidatePoint(public_a));
+    EXPECT_TRUE(ECC_ValidatePoint(public_b));
+
+    ExpectBaseMult(private_a, public_a);
+    ExpectBaseMult(private_b, public_b);
+
+    uint32_t dhkey[KEY_LENGTH_DWORDS_P256];
+    from_hex(dhkey, sample.dhkey);
+    Point q;
+    ECC_PointMult(&q, &public_b, private_a.n, KEY_LENGTH_DWORDS_P256);
+    EXPECT_EQ(0, memcmp(dhkey, q.x, sizeof(dhkey)));
+    ECC_PointMult(&q, &public_a, private_b.n, KEY_LENGTH_DWORDS_P256);
+    EXPECT_EQ(0, memcmp(dhkey, q.x, sizeof(dhkey)));
+  }
+}
+
+TEST_F(SmpP256Test, matches_bin_naf) {
+  uint32_t seed = 1;
+  auto next = [&seed]() {
+    seed = seed * 1664525 + 1013904223;
+    return seed;
+  };
+
+  Point p = curve_p256.G;
+  for (int i = 0; i < 32; i++) {
+    Scalar k;
+    for (uint32_t& word : k.n) word = next();
+    // A few scalars with long runs of zeros and ones
+    if (i % 4 == 1) memset(k.n, 0, sizeof(k.n) / 2);
+    if (i % 4 == 2) memset(&k.n[4], 0xff, sizeof(k.n) / 2);
+
+    Scalar n = k;
+    Point expected, q;
+    ECC_PointMult_Bin_NAF(&expected, &p, n.n, KEY_LENGTH_DWORDS_P256);
+    ECC_PointMult_Window(&q, &p, k.n);
+    expect_point_eq(expected, q);
+    ECC_PointMult_Base(&q, k.n);
+    ECC_PointMult_Window(&p, &curve_p256.G, k.n);
+    expect_point_eq(p, q);
+    EXPECT_TRUE(ECC_ValidatePoint(p));
+  }
+}
+
+}  // namespace
+
+}  // namespace testing
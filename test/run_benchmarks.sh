@@ -10,6 +10,22 @@
 known_benchmarks=(
   bluetooth_benchmark_thread_performance
   bluetooth_benchmark_timer_performance
+  bluetooth_benchmark_fixed_queue
+  bluetooth_benchmark_buffer_allocator
+  bluetooth_benchmark_packet_fragmenter
+  bluetooth_benchmark_l2cap_lookup
+  bluetooth_benchmark_gatt_discovery
+  bluetooth_benchmark_sbc_encoder
+  bluetooth_benchmark_a2dp_sbc_multi_encoder
+  bluetooth_benchmark_a2dp_pcm_converter
+  bluetooth_benchmark_rpa_resolver
+  bluetooth_benchmark_smp_p_256
+  bluetooth_benchmark_ble_scan
+  bluetooth_benchmark_btm_dev_rec_index
+  bluetooth_benchmark_config
+  bluetooth_benchmark_btif_sock
+  bluetooth_benchmark_stack
+  bluetooth_benchmark_avrcp_browsing
 )
 
 usage() {
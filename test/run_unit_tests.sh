@@ -11,6 +11,7 @@ known_tests=(
   net_test_btcore
   net_test_bta
   net_test_btif
+  net_test_btif_a2dp_sink_jitter_buffer
   net_test_btif_profile_queue
   net_test_device
   net_test_hci
@@ -24,6 +25,8 @@ known_tests=(
   net_test_performance
   net_test_stack_rfcomm
   net_test_gatt_conn_multiplexing
+  net_test_stack_l2cap_scheduler
+  net_test_sbc_encoder
 )
 
 known_remote_tests=(
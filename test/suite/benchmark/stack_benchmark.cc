@@ -0,0 +1,1061 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Benchmarks of the whole stack, from the socket of an application to the
+// controller and back, booted through the HAL like the Bluetooth service does.
+//
+// Run against the simulated controller (RootCanal) of two devices whose phys
+// are linked, one running the benchmarks and the other the sink:
+//
+//   peer$   bluetooth_benchmark_stack --sink
+//   device$ bluetooth_benchmark_stack --peer=<peer address>
+//           [--le_peer=<peer LE address>] [--benchmark_format=json]
+//
+// The sink accepts the connections and acknowledges the data received, so that
+// the throughput measured is that of the data delivered to the peer
+// application. It also serves a GATT service notifying bursts on request, and
+// is an A2DP sink. The benchmarks needing a peer are skipped without --peer;
+// the A2DP one feeds the stream through the audio sockets of the stack, and is
+// skipped when the audio HAL 2.0 data path is enabled.
+// --benchmark_format=json and --benchmark_out=<file> make the results machine
+// readable.
+
+#include <benchmark/benchmark.h>
+#include <binder/ProcessState.h>
+#include <hardware/bluetooth.h>
+#include <hardware/bt_av.h>
+#include <hardware/bt_gatt.h>
+#include <hardware/bt_sock.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_a2dp_hw/include/audio_a2dp_hw.h"
+#include "osi/include/osi.h"
+#include "osi/include/socket_utils/sockets.h"
+#include "service/common/bluetooth/low_energy_constants.h"
+#include "service/hal/bluetooth_av_interface.h"
+#include "service/hal/bluetooth_gatt_interface.h"
+#include "service/hal/bluetooth_interface.h"
+#include "stack/include/bt_types.h"
+#include "types/bluetooth/uuid.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+using bluetooth::Uuid;
+using bluetooth::hal::BluetoothAvInterface;
+using bluetooth::hal::BluetoothGattInterface;
+using bluetooth::hal::BluetoothInterface;
+
+namespace {
+
+// The services the sink listens on.
+const Uuid kRfcommUuid =
+    Uuid::FromString("8d4e3a1c-5b0f-4a2e-9c7d-2f6b1e0a3d58");
+constexpr int kL2capPsm = 0x1001;
+constexpr int kL2capBasicModePsm = 0x1003;
+constexpr int kLeCocPsm = 0x0081;
+const Uuid kGattAppUuid =
+    Uuid::FromString("3f0c7a52-9e1b-4d86-b2a4-6c58e1d0f937");
+const Uuid kGattServiceUuid =
+    Uuid::FromString("c5a3e0d2-1f84-4b6e-8d39-07b2f6a41e5c");
+const Uuid kGattNotifyUuid =
+    Uuid::FromString("c5a3e0d3-1f84-4b6e-8d39-07b2f6a41e5c");
+const Uuid kGattControlUuid =
+    Uuid::FromString("c5a3e0d4-1f84-4b6e-8d39-07b2f6a41e5c");
+const Uuid kCccdUuid = Uuid::From16Bit(0x2902);
+
+// The sink acknowledges each block received with a single byte.
+constexpr size_t kBlockSize = 64 * 1024;
+constexpr size_t kRfcommPacketSize = 990;
+constexpr uint8_t kAck = 0xac;
+
+// The GATT client asks for bursts of notifications of the largest size the
+// MTU allows, writing the count and the size to the control characteristic.
+constexpr int kGattMtu = 517;
+constexpr uint32_t kGattBurst = 100;
+constexpr int kGattWrite = 2;         // Write with response
+constexpr int kGattCongested = 0x8f;  // Queued, but the channel is congested
+constexpr std::chrono::milliseconds kGattBackoff(2);
+
+// The A2DP source reads silence from the audio socket, as much as it encodes.
+constexpr size_t kPcmChunkSize = 4096;
+constexpr std::chrono::milliseconds kPositionPollPeriod(1);
+// The reads of the same media tick are closer than this.
+constexpr std::chrono::microseconds kSameTick(1000);
+
+constexpr std::chrono::seconds kTimeout(30);
+
+RawAddress peer_address = RawAddress::kEmpty;
+RawAddress le_peer_address = RawAddress::kEmpty;
+
+class Stack : public BluetoothInterface::Observer {
+ public:
+  bool Start() {
+    if (!BluetoothInterface::Initialize()) return false;
+    BluetoothInterface::Get()->AddObserver(this);
+    interface_ = BluetoothInterface::Get()->GetHALInterface();
+    if (!Enable()) return false;
+    sockets_ = static_cast<const btsock_interface_t*>(
+        interface_->get_profile_interface(BT_PROFILE_SOCKETS_ID));
+    return sockets_ != nullptr;
+  }
+
+  void Stop() {
+    Disable();
+    BluetoothInterface::Get()->RemoveObserver(this);
+    BluetoothInterface::CleanUp();
+  }
+
+  bool Enable() {
+    return interface_->enable() == BT_STATUS_SUCCESS &&
+           WaitForState(BT_STATE_ON);
+  }
+
+  bool Disable() {
+    return interface_->disable() == BT_STATUS_SUCCESS &&
+           WaitForState(BT_STATE_OFF);
+  }
+
+  const btsock_interface_t* sockets() const { return sockets_; }
+
+  // Waits for the links of the last connection to be dropped, so that the
+  // next one is set up from scratch.
+  bool WaitForDisconnection() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_for(lock, kTimeout, [this] { return links_ == 0; });
+  }
+
+  void AdapterStateChangedCallback(bt_state_t state) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    state_ = state;
+    changed_.notify_all();
+  }
+
+  void AclStateChangedCallback(bt_status_t status,
+                               const RawAddress& remote_bdaddr,
+                               bt_acl_state_t state) override {
+    if (status != BT_STATUS_SUCCESS) return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    links_ += state == BT_ACL_STATE_CONNECTED ? 1 : -1;
+    links_ = std::max(links_, 0);
+    changed_.notify_all();
+  }
+
+  // Both ends accept the pairing the peer asks for.
+  void SSPRequestCallback(RawAddress* remote_bd_addr, bt_bdname_t* bd_name,
+                          uint32_t cod, bt_ssp_variant_t pairing_variant,
+                          uint32_t pass_key) override {
+    interface_->ssp_reply(remote_bd_addr, pairing_variant, 1, pass_key);
+  }
+
+ private:
+  bool WaitForState(bt_state_t state) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_for(lock, kTimeout,
+                             [this, state] { return state_ == state; });
+  }
+
+  const bt_interface_t* interface_ = nullptr;
+  const btsock_interface_t* sockets_ = nullptr;
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  bt_state_t state_ = BT_STATE_OFF;
+  int links_ = 0;
+};
+
+Stack* stack;
+
+// The PSM of the L2CAP services, RFCOMM finding its channel through SDP.
+int ChannelOf(btsock_type_t type, int flags) {
+  switch (type) {
+    case BTSOCK_L2CAP:
+      return (flags & BTSOCK_FLAG_L2CAP_BASIC_MODE) ? kL2capBasicModePsm
+                                                   : kL2capPsm;
+    case BTSOCK_L2CAP_LE:
+      return kLeCocPsm;
+    default:
+      return 0;
+  }
+}
+
+bool ReceiveAll(int fd, void* buffer, size_t size) {
+  uint8_t* data = static_cast<uint8_t*>(buffer);
+  while (size > 0) {
+    ssize_t received;
+    OSI_NO_INTR(received = recv(fd, data, size, 0));
+    if (received <= 0) return false;
+    data += received;
+    size -= received;
+  }
+  return true;
+}
+
+bool SendAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t sent;
+    OSI_NO_INTR(sent = send(fd, data, size, MSG_NOSIGNAL));
+    if (sent <= 0) return false;
+    data += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+// Reads the connect signal the stack sends to the application, and the socket
+// it passes along for the connections accepted by a listening socket.
+bool ReceiveSignal(int fd, sock_connect_signal_t* signal, int* accepted_fd) {
+  char control[CMSG_SPACE(sizeof(int))];
+  struct iovec iov = {signal, sizeof(*signal)};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t received;
+  OSI_NO_INTR(received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC));
+  if (received <= 0) return false;
+
+  *accepted_fd = -1;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+      memcpy(accepted_fd, CMSG_DATA(cmsg), sizeof(*accepted_fd));
+  }
+  return ReceiveAll(fd, reinterpret_cast<uint8_t*>(signal) + received,
+                    sizeof(*signal) - received);
+}
+
+// Returns the socket of a connection to the sink, or -1.
+int Connect(btsock_type_t type, int flags, const RawAddress& address,
+            sock_connect_signal_t* signal) {
+  const Uuid* uuid = type == BTSOCK_RFCOMM ? &kRfcommUuid : nullptr;
+  int channel = ChannelOf(type, flags);
+  int fd = -1;
+  if (stack->sockets()->connect(&address, type, uuid, channel, &fd, flags,
+                                getuid()) != BT_STATUS_SUCCESS)
+    return -1;
+
+  int accepted_fd;
+  if (!ReceiveAll(fd, &channel, sizeof(channel)) ||
+      !ReceiveSignal(fd, signal, &accepted_fd) || signal->status != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Sends a block in packets of |packet_size| and waits for the sink to
+// acknowledge it.
+bool SendBlock(int fd, const std::vector<uint8_t>& block, size_t packet_size) {
+  for (size_t offset = 0; offset < block.size(); offset += packet_size) {
+    if (!SendAll(fd, block.data() + offset,
+                 std::min(packet_size, block.size() - offset)))
+      return false;
+  }
+  uint8_t ack;
+  return ReceiveAll(fd, &ack, sizeof(ack)) && ack == kAck;
+}
+
+// Reads everything |fd| receives, acknowledging each block.
+void Sink(int fd, size_t packet_size) {
+  std::vector<uint8_t> buffer(std::max(packet_size, kBlockSize));
+  size_t pending = 0;
+  ssize_t received;
+  while (true) {
+    OSI_NO_INTR(received = recv(fd, buffer.data(), buffer.size(), 0));
+    if (received <= 0) break;
+    for (pending += received; pending >= kBlockSize; pending -= kBlockSize) {
+      if (!SendAll(fd, &kAck, sizeof(kAck))) break;
+    }
+  }
+  close(fd);
+}
+
+// Accepts the connections to a service until the stack stops.
+void Serve(btsock_type_t type, int flags) {
+  const Uuid* uuid = type == BTSOCK_RFCOMM ? &kRfcommUuid : nullptr;
+  int channel = ChannelOf(type, flags);
+  int fd = -1;
+  bt_status_t status = stack->sockets()->listen(
+      type, "bluetooth_benchmark_stack", uuid, channel, &fd, flags, getuid());
+  if (status != BT_STATUS_SUCCESS ||
+      !ReceiveAll(fd, &channel, sizeof(channel))) {
+    fprintf(stderr, "Unable to listen on socket type %d\n", type);
+    return;
+  }
+
+  sock_connect_signal_t signal;
+  int accepted_fd;
+  while (ReceiveSignal(fd, &signal, &accepted_fd)) {
+    if (accepted_fd < 0) continue;
+    size_t packet_size = signal.max_rx_packet_size;
+    std::thread(Sink, accepted_fd, packet_size).detach();
+  }
+  close(fd);
+}
+
+// Waits on the state the callbacks of the HAL update.
+class Waiter {
+ protected:
+  bool Wait(const std::function<bool()>& done) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_for(lock, kTimeout, done);
+  }
+
+  void Update(const std::function<void()>& update) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    update();
+    changed_.notify_all();
+  }
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+};
+
+// The GATT service of the sink: a write to its control characteristic asks
+// for a burst of notifications, sent one at a time like an application waiting
+// for each to be sent before the next.
+class GattServer : public BluetoothGattInterface::ServerObserver, Waiter {
+ public:
+  bool Start() {
+    gatt_ = BluetoothGattInterface::Get();
+    server_ = gatt_->GetServerHALInterface();
+    gatt_->AddServerObserver(this);
+    if (server_->register_server(kGattAppUuid) != BT_STATUS_SUCCESS ||
+        !Wait([this] { return done_; }) || status_ != 0)
+      return false;
+
+    std::vector<btgatt_db_element_t> service = {
+        {.uuid = kGattServiceUuid, .type = BTGATT_DB_PRIMARY_SERVICE},
+        {.uuid = kGattNotifyUuid,
+         .type = BTGATT_DB_CHARACTERISTIC,
+         .properties = bluetooth::kCharacteristicPropertyNotify},
+        {.uuid = kCccdUuid,
+         .type = BTGATT_DB_DESCRIPTOR,
+         .permissions = bluetooth::kAttributePermissionRead |
+                        bluetooth::kAttributePermissionWrite},
+        {.uuid = kGattControlUuid,
+         .type = BTGATT_DB_CHARACTERISTIC,
+         .properties = bluetooth::kCharacteristicPropertyWrite,
+         .permissions = bluetooth::kAttributePermissionWrite}};
+    Update([this] { done_ = false; });
+    if (server_->add_service(server_if_, service) != BT_STATUS_SUCCESS ||
+        !Wait([this] { return done_; }) || status_ != 0)
+      return false;
+
+    sender_ = std::thread(&GattServer::Send, this);
+    return true;
+  }
+
+  void Stop() {
+    Update([this] { stopping_ = true; });
+    if (sender_.joinable()) sender_.join();
+    if (server_if_ >= 0) server_->unregister_server(server_if_);
+    gatt_->RemoveServerObserver(this);
+  }
+
+  void RegisterServerCallback(BluetoothGattInterface* gatt_iface, int status,
+                              int server_if, const Uuid& app_uuid) override {
+    if (app_uuid != kGattAppUuid) return;
+    Update([&] {
+      server_if_ = status == 0 ? server_if : -1;
+      status_ = status;
+      done_ = true;
+    });
+  }
+
+  void ConnectionCallback(BluetoothGattInterface* gatt_iface, int conn_id,
+                          int server_if, int connected,
+                          const RawAddress& bda) override {
+    if (connected) return;
+    Update([&] {
+      if (conn_id != conn_id_) return;
+      remaining_ = 0;
+      in_flight_ = false;
+    });
+  }
+
+  void ServiceAddedCallback(
+      BluetoothGattInterface* gatt_iface, int status, int server_if,
+      std::vector<btgatt_db_element_t> service) override {
+    if (server_if != server_if_) return;
+    Update([&] {
+      for (const btgatt_db_element_t& element : service) {
+        if (element.uuid == kGattNotifyUuid)
+          notify_handle_ = element.attribute_handle;
+        else if (element.uuid == kGattControlUuid)
+          control_handle_ = element.attribute_handle;
+      }
+      status_ = status;
+      done_ = true;
+    });
+  }
+
+  // Asks for |count| notifications of |size| bytes.
+  void RequestWriteCharacteristicCallback(
+      BluetoothGattInterface* gatt_iface, int conn_id, int trans_id,
+      const RawAddress& bda, int attr_handle, int offset, bool need_rsp,
+      bool is_prep, std::vector<uint8_t> value) override {
+    if (need_rsp) Respond(conn_id, trans_id, attr_handle);
+    if (attr_handle != control_handle_ || value.size() < 6) return;
+    Update([&] {
+      conn_id_ = conn_id;
+      remaining_ = value[0] | value[1] << 8 | value[2] << 16 | value[3] << 24;
+      size_ = std::min<size_t>(value[4] | value[5] << 8, BTGATT_MAX_ATTR_LEN);
+    });
+  }
+
+  // The client enabling the notifications.
+  void RequestWriteDescriptorCallback(
+      BluetoothGattInterface* gatt_iface, int conn_id, int trans_id,
+      const RawAddress& bda, int attr_handle, int offset, bool need_rsp,
+      bool is_prep, std::vector<uint8_t> value) override {
+    if (need_rsp) Respond(conn_id, trans_id, attr_handle);
+  }
+
+  // A notification is dropped when the channel is already congested, and sent
+  // again after a while.
+  void IndicationSentCallback(BluetoothGattInterface* gatt_iface, int conn_id,
+                              int status) override {
+    Update([&] {
+      in_flight_ = false;
+      if ((status == 0 || status == kGattCongested) && remaining_ > 0)
+        remaining_--;
+      backoff_ = status != 0;
+    });
+  }
+
+ private:
+  void Respond(int conn_id, int trans_id, int attr_handle) {
+    btgatt_response_t response = {};
+    response.attr_value.handle = attr_handle;
+    server_->send_response(conn_id, trans_id, 0, response);
+  }
+
+  void Send() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      changed_.wait(lock, [this] {
+        return stopping_ || (remaining_ > 0 && !in_flight_);
+      });
+      if (stopping_) return;
+      if (backoff_) {
+        backoff_ = false;
+        lock.unlock();
+        std::this_thread::sleep_for(kGattBackoff);
+        lock.lock();
+        continue;
+      }
+
+      in_flight_ = true;
+      int conn_id = conn_id_;
+      std::vector<uint8_t> value(size_, 0x5a);
+      lock.unlock();
+      bt_status_t status = server_->send_indication(
+          server_if_, notify_handle_, conn_id, 0, std::move(value));
+      lock.lock();
+      if (status != BT_STATUS_SUCCESS) {
+        in_flight_ = false;
+        remaining_ = 0;
+      }
+    }
+  }
+
+  BluetoothGattInterface* gatt_ = nullptr;
+  const btgatt_server_interface_t* server_ = nullptr;
+  std::thread sender_;
+
+  bool done_ = false;
+  int status_ = 0;
+  int server_if_ = -1;
+  int notify_handle_ = 0;
+  int control_handle_ = 0;
+
+  int conn_id_ = 0;
+  uint32_t remaining_ = 0;
+  size_t size_ = 0;
+  bool in_flight_ = false;
+  bool backoff_ = false;
+  bool stopping_ = false;
+};
+
+// A client of the GATT service of the sink.
+class GattClient : public BluetoothGattInterface::ClientObserver, Waiter {
+ public:
+  GattClient()
+      : gatt_(BluetoothGattInterface::Get()),
+        client_(gatt_->GetClientHALInterface()) {
+    gatt_->AddClientObserver(this);
+  }
+
+  ~GattClient() {
+    if (client_if_ >= 0) client_->unregister_client(client_if_);
+    gatt_->RemoveClientObserver(this);
+  }
+
+  // Connects to the service and enables its notifications.
+  bool Connect(const RawAddress& address) {
+    address_ = address;
+    return Run([this] { return client_->register_client(kGattAppUuid); }) &&
+           Run([this] {
+             return client_->connect(client_if_, address_, true,
+                                     BT_TRANSPORT_LE, false, PHY_LE_1M_MASK);
+           }) &&
+           Run([this] { return client_->configure_mtu(conn_id_, kGattMtu); }) &&
+           Run([this] {
+             return client_->search_service(conn_id_, &kGattServiceUuid);
+           }) &&
+           Run([this] { return client_->get_gatt_db(conn_id_); }) &&
+           Run([this] {
+             return client_->register_for_notification(client_if_, address_,
+                                                       notify_handle_);
+           }) &&
+           Run([this] {
+             return client_->write_descriptor(conn_id_, cccd_handle_, 0,
+                                              {0x01, 0x00});
+           });
+  }
+
+  bool Disconnect() {
+    return Run([this] {
+      return client_->disconnect(client_if_, address_, conn_id_);
+    });
+  }
+
+  // The largest notification the MTU allows.
+  size_t payload_size() const { return mtu_ - 3; }
+
+  // Asks for |count| notifications of |size| bytes, and waits for them.
+  bool Burst(uint32_t count, size_t size) {
+    Update([this] {
+      notifications_ = 0;
+      write_failed_ = false;
+    });
+    std::vector<uint8_t> value = {
+        static_cast<uint8_t>(count),       static_cast<uint8_t>(count >> 8),
+        static_cast<uint8_t>(count >> 16), static_cast<uint8_t>(count >> 24),
+        static_cast<uint8_t>(size),        static_cast<uint8_t>(size >> 8)};
+    return client_->write_characteristic(conn_id_, control_handle_, kGattWrite,
+                                         0, value) == BT_STATUS_SUCCESS &&
+           Wait([this, count] {
+             return notifications_ >= count || write_failed_;
+           }) &&
+           !write_failed_;
+  }
+
+  void RegisterClientCallback(BluetoothGattInterface* gatt_iface, int status,
+                              int client_if, const Uuid& app_uuid) override {
+    if (app_uuid != kGattAppUuid) return;
+    Finish(status, [&] { client_if_ = status == 0 ? client_if : -1; });
+  }
+
+  void ConnectCallback(BluetoothGattInterface* gatt_iface, int conn_id,
+                       int status, int client_if,
+                       const RawAddress& bda) override {
+    if (client_if != client_if_) return;
+    Finish(status, [&] { conn_id_ = conn_id; });
+  }
+
+  void DisconnectCallback(BluetoothGattInterface* gatt_iface, int conn_id,
+                          int status, int client_if,
+                          const RawAddress& bda) override {
+    if (client_if == client_if_) Finish(status, [] {});
+  }
+
+  void MtuChangedCallback(BluetoothGattInterface* gatt_iface, int conn_id,
+                          int status, int mtu) override {
+    // The default MTU is kept when the peer turns the exchange down.
+    if (conn_id != conn_id_) return;
+    Finish(0, [&] {
+      if (status == 0) mtu_ = mtu;
+    });
+  }
+
+  void SearchCompleteCallback(BluetoothGattInterface* gatt_iface, int conn_id,
+                              int status) override {
+    if (conn_id == conn_id_) Finish(status, [] {});
+  }
+
+  void GetGattDbCallback(BluetoothGattInterface* gatt_iface, int conn_id,
+                         const btgatt_db_element_t* gatt_db,
+                         int size) override {
+    if (conn_id != conn_id_) return;
+    // The descriptors follow their characteristic.
+    uint16_t characteristic = 0;
+    for (int i = 0; i < size; i++) {
+      const btgatt_db_element_t& element = gatt_db[i];
+      if (element.type == BTGATT_DB_CHARACTERISTIC) {
+        characteristic = element.attribute_handle;
+        if (element.uuid == kGattNotifyUuid)
+          notify_handle_ = characteristic;
+        else if (element.uuid == kGattControlUuid)
+          control_handle_ = characteristic;
+      } else if (element.type == BTGATT_DB_DESCRIPTOR &&
+                 element.uuid == kCccdUuid &&
+                 characteristic == notify_handle_) {
+        cccd_handle_ = element.attribute_handle;
+      }
+    }
+    bool found = notify_handle_ && control_handle_ && cccd_handle_;
+    Finish(found ? 0 : -1, [] {});
+  }
+
+  void RegisterForNotificationCallback(BluetoothGattInterface* gatt_iface,
+                                       int conn_id, int registered, int status,
+                                       uint16_t handle) override {
+    if (handle == notify_handle_) Finish(status, [] {});
+  }
+
+  void NotifyCallback(BluetoothGattInterface* gatt_iface, int conn_id,
+                      const btgatt_notify_params_t& p_data) override {
+    if (conn_id != conn_id_ || p_data.handle != notify_handle_) return;
+    Update([this] { notifications_++; });
+  }
+
+  void WriteCharacteristicCallback(BluetoothGattInterface* gatt_iface,
+                                   int conn_id, int status,
+                                   uint16_t handle) override {
+    if (conn_id != conn_id_ || status == 0) return;
+    Update([this] { write_failed_ = true; });
+  }
+
+  void WriteDescriptorCallback(BluetoothGattInterface* gatt_iface,
+                               int conn_id, int status,
+                               uint16_t handle) override {
+    if (handle == cccd_handle_) Finish(status, [] {});
+  }
+
+ private:
+  // Calls the HAL, and waits for the callback reporting the outcome.
+  bool Run(const std::function<bt_status_t()>& call) {
+    Update([this] { done_ = false; });
+    return call() == BT_STATUS_SUCCESS && Wait([this] { return done_; }) &&
+           status_ == 0;
+  }
+
+  void Finish(int status, const std::function<void()>& update) {
+    Update([&] {
+      update();
+      status_ = status;
+      done_ = true;
+    });
+  }
+
+  BluetoothGattInterface* gatt_;
+  const btgatt_client_interface_t* client_;
+  RawAddress address_;
+
+  bool done_ = false;
+  int status_ = 0;
+  int client_if_ = -1;
+  int conn_id_ = 0;
+  int mtu_ = 23;
+  uint16_t notify_handle_ = 0;
+  uint16_t cccd_handle_ = 0;
+  uint16_t control_handle_ = 0;
+
+  uint32_t notifications_ = 0;
+  bool write_failed_ = false;
+};
+
+// An A2DP source streaming to the sink, fed through the audio sockets of the
+// stack like the audio HAL does.
+class A2dpSource : public BluetoothAvInterface::A2dpSourceObserver, Waiter {
+ public:
+  A2dpSource()
+      : av_(BluetoothAvInterface::Get()),
+        source_(av_->GetA2dpSourceHALInterface()) {
+    av_->AddA2dpSourceObserver(this);
+  }
+
+  ~A2dpSource() {
+    Stop();
+    if (state_ != BTAV_CONNECTION_STATE_DISCONNECTED &&
+        source_->disconnect(address_) == BT_STATUS_SUCCESS)
+      WaitForState(BTAV_CONNECTION_STATE_DISCONNECTED);
+    av_->RemoveA2dpSourceObserver(this);
+  }
+
+  bool Connect(const RawAddress& address) {
+    address_ = address;
+    return source_->connect(address) == BT_STATUS_SUCCESS &&
+           WaitForState(BTAV_CONNECTION_STATE_CONNECTED) &&
+           source_->set_active_device(address) == BT_STATUS_SUCCESS;
+  }
+
+  bool Start() {
+    ctrl_fd_ = osi_socket_local_client(
+        A2DP_CTRL_PATH, ANDROID_SOCKET_NAMESPACE_ABSTRACT, SOCK_STREAM);
+    if (ctrl_fd_ < 0) return false;
+    struct timeval timeout = {static_cast<time_t>(kTimeout.count()), 0};
+    setsockopt(ctrl_fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // The stream is ready once the peer is made active.
+    auto deadline = std::chrono::steady_clock::now() + kTimeout;
+    while (!Command(A2DP_CTRL_CMD_CHECK_READY)) {
+      if (std::chrono::steady_clock::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!Command(A2DP_CTRL_CMD_START)) return false;
+
+    data_fd_ = osi_socket_local_client(
+        A2DP_DATA_PATH, ANDROID_SOCKET_NAMESPACE_ABSTRACT, SOCK_STREAM);
+    if (data_fd_ < 0) return false;
+    feeder_ = std::thread(Feed, data_fd_);
+    return true;
+  }
+
+  void Stop() {
+    if (data_fd_ >= 0) {
+      Command(A2DP_CTRL_CMD_SUSPEND);
+      shutdown(data_fd_, SHUT_RDWR);
+      feeder_.join();
+      close(data_fd_);
+      data_fd_ = -1;
+    }
+    if (ctrl_fd_ >= 0) {
+      close(ctrl_fd_);
+      ctrl_fd_ = -1;
+    }
+  }
+
+  // The time of the last read of the stream by the stack, on the monotonic
+  // clock.
+  bool LastRead(std::chrono::nanoseconds* time) {
+    uint64_t bytes_read;
+    uint16_t delay;
+    uint32_t seconds;
+    uint32_t nanoseconds;
+    if (!Command(A2DP_CTRL_GET_PRESENTATION_POSITION) ||
+        !ReceiveAll(ctrl_fd_, &bytes_read, sizeof(bytes_read)) ||
+        !ReceiveAll(ctrl_fd_, &delay, sizeof(delay)) ||
+        !ReceiveAll(ctrl_fd_, &seconds, sizeof(seconds)) ||
+        !ReceiveAll(ctrl_fd_, &nanoseconds, sizeof(nanoseconds)))
+      return false;
+    *time =
+        std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoseconds);
+    return true;
+  }
+
+  void ConnectionStateCallback(BluetoothAvInterface* iface,
+                               const RawAddress& bd_addr,
+                               btav_connection_state_t state) override {
+    if (bd_addr == address_) Update([&] { state_ = state; });
+  }
+
+ private:
+  bool WaitForState(btav_connection_state_t state) {
+    return Wait([this, state] { return state_ == state; });
+  }
+
+  bool Command(tA2DP_CTRL_CMD cmd) {
+    uint8_t command = cmd;
+    uint8_t ack;
+    if (!SendAll(ctrl_fd_, &command, sizeof(command))) return false;
+    do {
+      if (!ReceiveAll(ctrl_fd_, &ack, sizeof(ack))) return false;
+    } while (ack == A2DP_CTRL_ACK_PENDING);
+    return ack == A2DP_CTRL_ACK_SUCCESS;
+  }
+
+  // Writes silence until the stream stops.
+  static void Feed(int fd) {
+    std::vector<uint8_t> silence(kPcmChunkSize, 0);
+    while (SendAll(fd, silence.data(), silence.size())) {
+    }
+  }
+
+  BluetoothAvInterface* av_;
+  const btav_source_interface_t* source_;
+  RawAddress address_;
+  btav_connection_state_t state_ = BTAV_CONNECTION_STATE_DISCONNECTED;
+
+  int ctrl_fd_ = -1;
+  int data_fd_ = -1;
+  std::thread feeder_;
+};
+
+// Waits for the stack to read the stream at a later media tick than |tick|.
+bool NextTick(A2dpSource* source, std::chrono::nanoseconds* tick) {
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (std::chrono::steady_clock::now() < deadline) {
+    std::chrono::nanoseconds read;
+    if (!source->LastRead(&read)) return false;
+    if (read - *tick >= kSameTick) {
+      *tick = read;
+      return true;
+    }
+    std::this_thread::sleep_for(kPositionPollPeriod);
+  }
+  return false;
+}
+
+// The time from enabling the adapter to the stack reporting it on, the
+// controller set up included.
+void BM_Enable(State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    if (!stack->Disable()) {
+      state.SkipWithError("Unable to disable the adapter");
+      break;
+    }
+    state.ResumeTiming();
+    if (!stack->Enable()) {
+      state.SkipWithError("Unable to enable the adapter");
+      break;
+    }
+  }
+}
+
+// The time from an application asking for a connection to its socket being
+// connected, with no link to the peer beforehand.
+// Arguments: socket type, L2CAP channel in basic mode rather than ERTM.
+void BM_Connect(State& state) {
+  auto type = static_cast<btsock_type_t>(state.range(0));
+  int flags = state.range(1) ? BTSOCK_FLAG_L2CAP_BASIC_MODE : 0;
+  const RawAddress& address =
+      type == BTSOCK_L2CAP_LE ? le_peer_address : peer_address;
+  if (address.IsEmpty()) {
+    state.SkipWithError("No peer, see --peer");
+    return;
+  }
+
+  for (auto _ : state) {
+    if (!stack->WaitForDisconnection()) {
+      state.SkipWithError("The link to the peer was not dropped");
+      break;
+    }
+    auto start = std::chrono::steady_clock::now();
+    sock_connect_signal_t signal;
+    int fd = Connect(type, flags, address, &signal);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (fd < 0) {
+      state.SkipWithError("Unable to connect");
+      break;
+    }
+    state.SetIterationTime(elapsed.count());
+    close(fd);
+  }
+}
+
+// The data an application sends to the peer application, over one connection.
+// Arguments: socket type, L2CAP channel in basic mode rather than ERTM.
+void BM_Throughput(State& state) {
+  auto type = static_cast<btsock_type_t>(state.range(0));
+  int flags = state.range(1) ? BTSOCK_FLAG_L2CAP_BASIC_MODE : 0;
+  const RawAddress& address =
+      type == BTSOCK_L2CAP_LE ? le_peer_address : peer_address;
+  if (address.IsEmpty()) {
+    state.SkipWithError("No peer, see --peer");
+    return;
+  }
+
+  sock_connect_signal_t signal;
+  int fd = Connect(type, flags, address, &signal);
+  if (fd < 0) {
+    state.SkipWithError("Unable to connect");
+    return;
+  }
+  if (type == BTSOCK_L2CAP_LE)
+    stack->sockets()->request_max_tx_data_length(address);
+
+  // L2CAP sockets send a packet per write.
+  size_t packet_size =
+      type == BTSOCK_RFCOMM ? kRfcommPacketSize : signal.max_tx_packet_size;
+  std::vector<uint8_t> block(kBlockSize, 0x5a);
+  for (auto _ : state) {
+    if (!SendBlock(fd, block, packet_size)) {
+      state.SkipWithError("The connection was lost");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kBlockSize);
+  state.counters["packet_size"] = packet_size;
+  close(fd);
+}
+
+// The notifications a GATT server application sends to the client
+// application, over one LE connection.
+void BM_GattNotifications(State& state) {
+  if (le_peer_address.IsEmpty()) {
+    state.SkipWithError("No peer, see --peer");
+    return;
+  }
+
+  GattClient client;
+  if (!client.Connect(le_peer_address)) {
+    state.SkipWithError("Unable to connect");
+    return;
+  }
+  size_t payload_size = client.payload_size();
+  for (auto _ : state) {
+    if (!client.Burst(kGattBurst, payload_size)) {
+      state.SkipWithError("The notifications were lost");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kGattBurst);
+  state.SetBytesProcessed(state.iterations() * kGattBurst * payload_size);
+  state.counters["payload_size"] = payload_size;
+  client.Disconnect();
+}
+
+// The interval between the media packets of an A2DP stream, timed from the
+// reads of the audio by the stack, and its jitter.
+void BM_A2dpPacing(State& state) {
+  if (peer_address.IsEmpty()) {
+    state.SkipWithError("No peer, see --peer");
+    return;
+  }
+
+  A2dpSource source;
+  if (!source.Connect(peer_address)) {
+    state.SkipWithError("Unable to connect");
+    return;
+  }
+  std::chrono::nanoseconds tick(0);
+  if (!source.Start() || !NextTick(&source, &tick)) {
+    state.SkipWithError("Unable to stream through the audio sockets");
+    return;
+  }
+
+  std::vector<double> intervals;
+  for (auto _ : state) {
+    std::chrono::nanoseconds last = tick;
+    if (!NextTick(&source, &tick)) {
+      state.SkipWithError("The stream was lost");
+      break;
+    }
+    std::chrono::duration<double> interval = tick - last;
+    state.SetIterationTime(interval.count());
+    intervals.push_back(interval.count());
+  }
+  if (intervals.empty()) return;
+
+  double mean = 0;
+  for (double interval : intervals) mean += interval;
+  mean /= intervals.size();
+  double variance = 0;
+  double max_deviation = 0;
+  for (double interval : intervals) {
+    variance += (interval - mean) * (interval - mean);
+    max_deviation = std::max(max_deviation, std::abs(interval - mean));
+  }
+  variance /= intervals.size();
+  state.counters["jitter_us"] = std::sqrt(variance) * 1e6;
+  state.counters["max_jitter_us"] = max_deviation * 1e6;
+}
+
+void SocketTypes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"type", "basic_mode"});
+  for (int type : {BTSOCK_RFCOMM, BTSOCK_L2CAP, BTSOCK_L2CAP_LE})
+    b->Args({type, 0});
+  b->Args({BTSOCK_L2CAP, 1});
+}
+
+BENCHMARK(BM_Enable)->Iterations(5)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Connect)
+    ->Apply(SocketTypes)
+    ->Iterations(5)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Throughput)->Apply(SocketTypes)->UseRealTime();
+BENCHMARK(BM_GattNotifications)->UseRealTime();
+BENCHMARK(BM_A2dpPacing)
+    ->Iterations(500)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+bool ParseAddress(const char* arg, const char* name, RawAddress* address) {
+  size_t length = strlen(name);
+  return strncmp(arg, name, length) == 0 &&
+         RawAddress::FromString(arg + length, *address);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  bool sink = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--sink") == 0) {
+      sink = true;
+    } else if (!ParseAddress(argv[i], "--peer=", &peer_address) &&
+               !ParseAddress(argv[i], "--le_peer=", &le_peer_address)) {
+      fprintf(stderr,
+              "Usage: %s --sink | [--peer=<address>] [--le_peer=<address>] "
+              "[--benchmark_...]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (le_peer_address.IsEmpty()) le_peer_address = peer_address;
+
+  android::ProcessState::self()->startThreadPool();
+  Stack bluetooth_stack;
+  stack = &bluetooth_stack;
+  if (!stack->Start()) {
+    fprintf(stderr, "Unable to start the stack\n");
+    return 1;
+  }
+
+  // The A2DP sink is the role the profile starts in.
+  if (!BluetoothGattInterface::Initialize() ||
+      !BluetoothAvInterface::Initialize()) {
+    fprintf(stderr, "Unable to start the GATT and A2DP profiles\n");
+    return 1;
+  }
+
+  if (sink) {
+    GattServer gatt_server;
+    if (!gatt_server.Start()) fprintf(stderr, "Unable to serve over GATT\n");
+    std::vector<std::thread> services;
+    for (btsock_type_t type : {BTSOCK_RFCOMM, BTSOCK_L2CAP, BTSOCK_L2CAP_LE})
+      services.emplace_back(Serve, type, 0);
+    services.emplace_back(Serve, BTSOCK_L2CAP, BTSOCK_FLAG_L2CAP_BASIC_MODE);
+    for (auto& service : services) service.join();
+    gatt_server.Stop();
+  } else {
+    BluetoothAvInterface::Get()->A2dpSinkDisable();
+    BluetoothAvInterface::Get()->A2dpSourceEnable({});
+    benchmark::RunSpecifiedBenchmarks();
+  }
+
+  BluetoothAvInterface::CleanUp();
+  BluetoothGattInterface::CleanUp();
+  stack->Stop();
+  return 0;
+}
@@ -19,30 +19,51 @@
 #include "test_environment.h"
 
 #include <base/logging.h>
+#include <stdlib.h>
+#include <string.h>
 #include <utils/Log.h>
 #include <future>
 
 #include "hci_internals.h"
 
 using ::android::bluetooth::root_canal::TestEnvironment;
+using ::test_vendor_lib::TimeMode;
 
 constexpr uint16_t kTestPort = 6401;
 constexpr uint16_t kHciServerPort = 6402;
 constexpr uint16_t kLinkServerPort = 6403;
 
+// Runs the simulation in virtual time, see test_vendor_lib::TimeMode.
+constexpr char kVirtualTimeOption[] = "--virtual_time";
+// Seeds the random numbers used by the models, to replay a run.
+constexpr char kSeedOption[] = "--seed=";
+
 int main(int argc, char** argv) {
   ALOGI("main");
   uint16_t test_port = kTestPort;
   uint16_t hci_server_port = kHciServerPort;
   uint16_t link_server_port = kLinkServerPort;
+  TimeMode time_mode = TimeMode::kRealTime;
 
+  int position = 0;
   for (int arg = 0; arg < argc; arg++) {
+    if (strcmp(argv[arg], kVirtualTimeOption) == 0) {
+      ALOGI("%d: %s", arg, argv[arg]);
+      time_mode = TimeMode::kVirtualTime;
+      continue;
+    }
+    if (strncmp(argv[arg], kSeedOption, strlen(kSeedOption)) == 0) {
+      unsigned int seed = strtoul(argv[arg] + strlen(kSeedOption), nullptr, 0);
+      ALOGI("%d: %s (%u)", arg, argv[arg], seed);
+      srandom(seed);
+      continue;
+    }
     int port = atoi(argv[arg]);
     ALOGI("%d: %s (%d)", arg, argv[arg], port);
     if (port < 0 || port > 0xffff) {
       ALOGW("%s out of range", argv[arg]);
     } else {
-      switch (arg) {
+      switch (position++) {
         case 0:  // executable name
           break;
         case 1:
@@ -60,7 +81,7 @@ int main(int argc, char** argv) {
     }
   }
 
-  TestEnvironment root_canal(test_port, hci_server_port, link_server_port);
+  TestEnvironment root_canal(test_port, hci_server_port, link_server_port, time_mode);
   std::promise<void> barrier;
   std::future<void> barrier_future = barrier.get_future();
   root_canal.initialize(std::move(barrier));
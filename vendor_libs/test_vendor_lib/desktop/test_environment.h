@@ -30,8 +30,10 @@ namespace root_canal {
 
 class TestEnvironment {
  public:
-  TestEnvironment(uint16_t test_port, uint16_t hci_server_port, uint16_t link_server_port)
-      : test_port_(test_port), hci_server_port_(hci_server_port), link_server_port_(link_server_port) {}
+  TestEnvironment(uint16_t test_port, uint16_t hci_server_port, uint16_t link_server_port,
+                  test_vendor_lib::TimeMode time_mode = test_vendor_lib::TimeMode::kRealTime)
+      : test_port_(test_port), hci_server_port_(hci_server_port), link_server_port_(link_server_port),
+        async_manager_(time_mode) {}
 
   void initialize(std::promise<void> barrier);
 
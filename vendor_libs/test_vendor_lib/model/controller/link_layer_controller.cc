@@ -1067,7 +1067,7 @@ bool LinkLayerController::LeWhiteListFull() {
 
 void LinkLayerController::Reset() {
   inquiry_state_ = Inquiry::InquiryState::STANDBY;
-  last_inquiry_ = steady_clock::now();
+  last_inquiry_ = Now();
   le_scan_enable_ = 0;
   le_connect_ = 0;
 }
@@ -1105,7 +1105,7 @@ void LinkLayerController::SetInquiryMaxResponses(uint8_t max) {
 }
 
 void LinkLayerController::Inquiry() {
-  steady_clock::time_point now = steady_clock::now();
+  steady_clock::time_point now = Now();
   if (duration_cast<milliseconds>(now - last_inquiry_) < milliseconds(2000)) {
     return;
   }
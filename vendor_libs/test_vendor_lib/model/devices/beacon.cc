@@ -77,6 +77,10 @@ void Beacon::TimerTick() {
   }
 }
 
+bool Beacon::ReceivesPacketType(Link::PacketType type) const {
+  return type == Link::PacketType::LE_SCAN;
+}
+
 void Beacon::IncomingPacket(packets::LinkLayerPacketView packet) {
   if (packet.GetDestinationAddress() == properties_.GetLeAddress() && packet.GetType() == Link::PacketType::LE_SCAN) {
     std::unique_ptr<packets::LeAdvertisementBuilder> scan_response = packets::LeAdvertisementBuilder::Create(
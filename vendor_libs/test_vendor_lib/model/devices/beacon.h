@@ -45,6 +45,8 @@ class Beacon : public Device {
 
   virtual void IncomingPacket(packets::LinkLayerPacketView packet) override;
 
+  virtual bool ReceivesPacketType(Link::PacketType type) const override;
+
   virtual void TimerTick() override;
 
  private:
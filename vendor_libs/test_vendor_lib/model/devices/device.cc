@@ -48,7 +48,7 @@ void Device::UnregisterPhyLayer(std::shared_ptr<PhyLayer> phy) {
 bool Device::IsAdvertisementAvailable(std::chrono::milliseconds scan_time) const {
   if (advertising_interval_ms_ == std::chrono::milliseconds(0)) return false;
 
-  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point now = Now();
 
   std::chrono::steady_clock::time_point last_interval =
       ((now - time_stamp_) / advertising_interval_ms_) * advertising_interval_ms_ + time_stamp_;
@@ -22,7 +22,9 @@
 #include <string>
 #include <vector>
 
+#include "include/link.h"
 #include "model/devices/device_properties.h"
+#include "model/setup/async_manager.h"
 #include "model/setup/phy_layer.h"
 #include "packets/link_layer/link_layer_packet_builder.h"
 #include "packets/link_layer/link_layer_packet_view.h"
@@ -37,7 +39,7 @@ namespace test_vendor_lib {
 class Device {
  public:
   Device(const std::string properties_filename = "")
-      : time_stamp_(std::chrono::steady_clock::now()), properties_(properties_filename) {}
+      : time_stamp_(Now()), properties_(properties_filename) {}
   virtual ~Device() = default;
 
   // Initialize the device based on the values of |args|.
@@ -75,6 +77,12 @@ class Device {
 
   virtual void IncomingPacket(packets::LinkLayerPacketView){};
 
+  // Returns true if IncomingPacket() handles packets of |type|. The phys only
+  // pass those to the device. Asked when the device is added to a phy.
+  virtual bool ReceivesPacketType(Link::PacketType) const {
+    return true;
+  }
+
   virtual void SendLinkLayerPacket(std::shared_ptr<packets::LinkLayerPacketBuilder> packet, Phy::Type phy_type);
 
  protected:
@@ -20,14 +20,17 @@
 
 #include "osi/include/log.h"
 
+#include <base/logging.h>
+
 #include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 #include "fcntl.h"
-#include "sys/select.h"
+#include "sys/epoll.h"
 #include "unistd.h"
 
 namespace test_vendor_lib {
@@ -41,9 +44,11 @@ namespace test_vendor_lib {
 // After construction of this objects nothing happens beyond some very simple
 // member initialization. When the first FD is set up for watching the object
 // starts a new thread which watches the given (and later provided) FDs using
-// select() inside a loop. A special FD (a pipe) is also watched which is
-// used to notify the thread of internal changes on the object state (like
-// the addition of new FDs to watch on). Every access to internal state is
+// epoll inside a loop, so that their number is not limited by FD_SETSIZE and
+// a wakeup costs the number of FDs ready rather than the number watched. The
+// FDs are added to and removed from the epoll instance as they are watched
+// and unwatched. A special FD (a pipe) is also watched which is used to
+// notify the thread that it must stop. Every access to internal state is
 // synchronized using a single internal mutex. The thread is only stopped on
 // destruction of the object, by modifying a flag, which is the only member
 // variable accessed without acquiring the lock (because the notification to
@@ -74,6 +79,13 @@ namespace test_vendor_lib {
 // cond var possibly forever if there are no tasks scheduled, efectively
 // causing a deadlock).
 
+// In virtual time the task thread keeps its own clock instead of waiting on
+// the steady one. The FD watching thread tells it when it is idle, that is
+// blocked in epoll_wait() with nothing to read, and only then does the task thread
+// move its clock forward to the time of the next task. While read callbacks
+// run, or while data waits to be read, the clock stands still and the task
+// thread only runs the tasks already due.
+
 // This number also states the maximum number of scheduled tasks we can handle
 // at a given time
 static const uint16_t kMaxTaskId = -1; /* 2^16 - 1, permisible ids are {1..2^16-1}*/
@@ -92,6 +104,23 @@ static inline AsyncTaskId NextAsyncTaskId(const AsyncTaskId id) {
 // no need to treat that case.
 static const int kNotificationBufferSize = 10;
 
+// The most events handled per wakeup of the FD watching thread. More FDs can
+// be watched, the others are handled on the next wakeup.
+static const int kMaxEvents = 64;
+
+// The time of the AsyncManager running in virtual time, as a count of ticks
+// of the steady clock, or kRealTimeClock when none is.
+static const std::chrono::steady_clock::rep kRealTimeClock = -1;
+static std::atomic<std::chrono::steady_clock::rep> virtual_clock{kRealTimeClock};
+
+std::chrono::steady_clock::time_point Now() {
+  std::chrono::steady_clock::rep ticks = virtual_clock;
+  if (ticks == kRealTimeClock) {
+    return std::chrono::steady_clock::now();
+  }
+  return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(ticks));
+}
+
 // Async File Descriptor Watcher Implementation:
 class AsyncManager::AsyncFdWatcher {
  public:
@@ -109,20 +138,38 @@ class AsyncManager::AsyncFdWatcher {
       return started;
     }
 
-    // notify the thread so that it knows of the new FD
-    notifyThread();
+    // the thread sees the new FD on its next wait, no need to notify it
+    if (watchFd(file_descriptor) != 0 && errno != EEXIST) {
+      LOG_ERROR(LOG_TAG, "%s: Unable to watch fd %d: %s", __func__, file_descriptor, strerror(errno));
+      std::unique_lock<std::mutex> guard(internal_mutex_);
+      watched_shared_fds_.erase(file_descriptor);
+      return -1;
+    }
 
     return 0;
   }
 
   void StopWatchingFileDescriptor(int file_descriptor) {
     std::unique_lock<std::mutex> guard(internal_mutex_);
-    watched_shared_fds_.erase(file_descriptor);
+    if (watched_shared_fds_.erase(file_descriptor) != 0) {
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, file_descriptor, nullptr);
+    }
   }
 
-  AsyncFdWatcher() = default;
+  // |on_idle| is called with true when the thread waits for data with nothing
+  // to read, and with false when it stops waiting.
+  explicit AsyncFdWatcher(const std::function<void(bool)>& on_idle)
+      : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)), on_idle_(on_idle) {
+    if (epoll_fd_ < 0) {
+      LOG_ERROR(LOG_TAG, "%s: Unable to create the epoll instance: %s", __func__, strerror(errno));
+    }
+  }
 
-  ~AsyncFdWatcher() = default;
+  ~AsyncFdWatcher() {
+    if (epoll_fd_ >= 0) {
+      close(epoll_fd_);
+    }
+  }
 
   int stopThread() {
     if (!std::atomic_exchange(&running_, false)) {
@@ -139,9 +186,16 @@ class AsyncManager::AsyncFdWatcher {
 
     {
       std::unique_lock<std::mutex> guard(internal_mutex_);
+      for (auto& fdp : watched_shared_fds_) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fdp.first, nullptr);
+      }
       watched_shared_fds_.clear();
     }
 
+    if (on_idle_) {
+      on_idle_(true);
+    }
+
     return 0;
   }
 
@@ -155,6 +209,10 @@ class AsyncManager::AsyncFdWatcher {
     if (std::atomic_exchange(&running_, true)) {
       return 0;  // if already running
     }
+    // busy until the thread first waits for data
+    if (on_idle_) {
+      on_idle_(false);
+    }
     // set up the communication channel
     int pipe_fds[2];
     if (pipe2(pipe_fds, O_NONBLOCK)) {
@@ -166,6 +224,10 @@ class AsyncManager::AsyncFdWatcher {
     }
     notification_listen_fd_ = pipe_fds[0];
     notification_write_fd_ = pipe_fds[1];
+    if (watchFd(notification_listen_fd_) != 0) {
+      LOG_ERROR(LOG_TAG, "%s: Unable to watch the communication channel: %s", __func__, strerror(errno));
+      return -1;
+    }
 
     thread_ = std::thread([this]() { ThreadRoutine(); });
     if (!thread_.joinable()) {
@@ -184,44 +246,55 @@ class AsyncManager::AsyncFdWatcher {
     return 0;
   }
 
-  int setUpFileDescriptorSet(fd_set& read_fds) {
-    // add comm channel to the set
-    FD_SET(notification_listen_fd_, &read_fds);
-    int nfds = notification_listen_fd_;
+  // Level triggered, like select(): a callback that does not read everything
+  // is called again.
+  int watchFd(int file_descriptor) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = file_descriptor;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, file_descriptor, &event);
+  }
 
-    // add watched FDs to the set
-    {
-      std::unique_lock<std::mutex> guard(internal_mutex_);
-      for (auto& fdp : watched_shared_fds_) {
-        FD_SET(fdp.first, &read_fds);
-        nfds = std::max(fdp.first, nfds);
-      }
+  // Waits for data like epoll_wait(), telling on_idle_ when it would block.
+  int waitForReads(struct epoll_event* events) {
+    if (!on_idle_) {
+      return epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+    }
+    int retval = epoll_wait(epoll_fd_, events, kMaxEvents, 0);
+    if (retval != 0) {
+      return retval;
     }
-    return nfds;
+    on_idle_(true);
+    retval = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+    on_idle_(false);
+    return retval;
   }
 
   // check the comm channel and read everything there
-  bool consumeThreadNotifications(fd_set& read_fds) {
-    if (FD_ISSET(notification_listen_fd_, &read_fds)) {
-      char buffer[kNotificationBufferSize];
-      while (TEMP_FAILURE_RETRY(read(notification_listen_fd_, buffer, kNotificationBufferSize)) ==
-             kNotificationBufferSize) {
+  bool consumeThreadNotifications(const struct epoll_event* events, int count) {
+    for (int i = 0; i < count; i++) {
+      if (events[i].data.fd == notification_listen_fd_) {
+        char buffer[kNotificationBufferSize];
+        while (TEMP_FAILURE_RETRY(read(notification_listen_fd_, buffer, kNotificationBufferSize)) ==
+               kNotificationBufferSize) {
+        }
+        return true;
       }
-      return true;
     }
     return false;
   }
 
-  // check all file descriptors and call callbacks if necesary
-  void runAppropriateCallbacks(fd_set& read_fds) {
-    // not a good idea to call a callback while holding the FD lock,
-    // nor to release the lock while traversing the map
+  // call the callbacks of the file descriptors ready, unless they stopped
+  // being watched meanwhile
+  void runAppropriateCallbacks(const struct epoll_event* events, int count) {
+    // not a good idea to call a callback while holding the FD lock
     std::vector<decltype(watched_shared_fds_)::value_type> fds;
     {
       std::unique_lock<std::mutex> guard(internal_mutex_);
-      for (auto& fdc : watched_shared_fds_) {
-        if (FD_ISSET(fdc.first, &read_fds)) {
-          fds.push_back(fdc);
+      for (int i = 0; i < count; i++) {
+        auto fdc = watched_shared_fds_.find(events[i].data.fd);
+        if (fdc != watched_shared_fds_.end()) {
+          fds.push_back(*fdc);
         }
       }
     }
@@ -231,13 +304,10 @@ class AsyncManager::AsyncFdWatcher {
   }
 
   void ThreadRoutine() {
+    struct epoll_event events[kMaxEvents];
     while (running_) {
-      fd_set read_fds;
-      FD_ZERO(&read_fds);
-      int nfds = setUpFileDescriptorSet(read_fds);
-
       // wait until there is data available to read on some FD
-      int retval = select(nfds + 1, &read_fds, NULL, NULL, NULL);
+      int retval = waitForReads(events);
       if (retval <= 0) {  // there was some error or a timeout
         LOG_ERROR(LOG_TAG,
                   "%s: There was an error while waiting for data on the file "
@@ -246,14 +316,14 @@ class AsyncManager::AsyncFdWatcher {
         continue;
       }
 
-      consumeThreadNotifications(read_fds);
+      consumeThreadNotifications(events, retval);
 
       // Do not read if there was a call to stop running
       if (!running_) {
         break;
       }
 
-      runAppropriateCallbacks(read_fds);
+      runAppropriateCallbacks(events, retval);
     }
   }
 
@@ -261,7 +331,13 @@ class AsyncManager::AsyncFdWatcher {
   std::thread thread_;
   std::mutex internal_mutex_;
 
-  std::map<int, ReadCallback> watched_shared_fds_;
+  std::unordered_map<int, ReadCallback> watched_shared_fds_;
+
+  // Watches the FDs and the communication channel, any number of them
+  int epoll_fd_;
+
+  // Only set in virtual time
+  std::function<void(bool)> on_idle_;
 
   // A pair of FD to send information to the reading thread
   int notification_listen_fd_;
@@ -272,12 +348,12 @@ class AsyncManager::AsyncFdWatcher {
 class AsyncManager::AsyncTaskManager {
  public:
   AsyncTaskId ExecAsync(std::chrono::milliseconds delay, const TaskCallback& callback) {
-    return scheduleTask(std::make_shared<Task>(std::chrono::steady_clock::now() + delay, callback));
+    return scheduleTask(std::make_shared<Task>(now() + delay, callback));
   }
 
   AsyncTaskId ExecAsyncPeriodically(std::chrono::milliseconds delay, std::chrono::milliseconds period,
                                     const TaskCallback& callback) {
-    return scheduleTask(std::make_shared<Task>(std::chrono::steady_clock::now() + delay, period, callback));
+    return scheduleTask(std::make_shared<Task>(now() + delay, period, callback));
   }
 
   bool CancelAsyncTask(AsyncTaskId async_task_id) {
@@ -291,9 +367,29 @@ class AsyncManager::AsyncTaskManager {
     return true;
   }
 
-  AsyncTaskManager() = default;
+  explicit AsyncTaskManager(TimeMode time_mode) : virtual_time_(time_mode == TimeMode::kVirtualTime) {
+    if (virtual_time_) {
+      std::chrono::steady_clock::rep expected = kRealTimeClock;
+      CHECK(virtual_clock.compare_exchange_strong(expected,
+                                                  std::chrono::steady_clock::now().time_since_epoch().count()))
+          << "Only one AsyncManager may run in virtual time";
+    }
+  }
+
+  ~AsyncTaskManager() {
+    if (virtual_time_) {
+      virtual_clock = kRealTimeClock;
+    }
+  }
 
-  ~AsyncTaskManager() = default;
+  // Lets the clock jump, in virtual time, while the FD watching thread is idle.
+  void SetFdWatcherIdle(bool idle) {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    fd_watcher_idle_ = idle;
+    if (idle) {
+      internal_cond_var_.notify_one();
+    }
+  }
 
   int stopThread() {
     {
@@ -384,6 +480,22 @@ class AsyncManager::AsyncTaskManager {
     return tasks_by_id.count(task_id) != 0;
   }
 
+  std::chrono::steady_clock::time_point now() const {
+    return virtual_time_ ? Now() : std::chrono::steady_clock::now();
+  }
+
+  // In virtual time, moves the clock to the time of the next task if nothing
+  // else is left to do. Call it while holding the lock.
+  void advanceVirtualClock() {
+    if (!virtual_time_ || !fd_watcher_idle_ || task_queue_.empty()) {
+      return;
+    }
+    std::chrono::steady_clock::time_point next = (*task_queue_.begin())->time;
+    if (next > now()) {
+      virtual_clock = next.time_since_epoch().count();
+    }
+  }
+
   int tryStartThread() {
     // need the lock because of the running flag and the cond var
     std::unique_lock<std::mutex> guard(internal_mutex_);
@@ -407,9 +519,10 @@ class AsyncManager::AsyncTaskManager {
       bool run_it = false;
       {
         std::unique_lock<std::mutex> guard(internal_mutex_);
+        advanceVirtualClock();
         if (!task_queue_.empty()) {
           std::shared_ptr<Task> task_p = *(task_queue_.begin());
-          if (task_p->time < std::chrono::steady_clock::now()) {
+          if (task_p->time <= now()) {
             run_it = true;
             callback = task_p->callback;
             task_queue_.erase(task_p);  // need to remove and add again if
@@ -428,10 +541,18 @@ class AsyncManager::AsyncTaskManager {
       }
       {
         std::unique_lock<std::mutex> guard(internal_mutex_);
+        // the stop may have been notified while the callback ran
+        if (!running_) break;
         // wait on condition variable with timeout just in time for next task if
         // any
         if (task_queue_.size() > 0) {
-          internal_cond_var_.wait_until(guard, (*task_queue_.begin())->time);
+          std::chrono::steady_clock::time_point next = (*task_queue_.begin())->time;
+          if (!virtual_time_) {
+            internal_cond_var_.wait_until(guard, next);
+          } else if (next > now() && !fd_watcher_idle_) {
+            // the clock will jump once the FD watching thread is idle
+            internal_cond_var_.wait(guard);
+          }
         } else {
           internal_cond_var_.wait(guard);
         }
@@ -446,13 +567,23 @@ class AsyncManager::AsyncTaskManager {
   std::mutex internal_mutex_;
   std::condition_variable internal_cond_var_;
 
+  const bool virtual_time_;
+  bool fd_watcher_idle_ = true;
+
   AsyncTaskId lastTaskId_ = kInvalidTaskId;
   std::map<AsyncTaskId, std::shared_ptr<Task> > tasks_by_id;
   std::set<std::shared_ptr<Task>, task_p_comparator> task_queue_;
 };
 
 // Async Manager Implementation:
-AsyncManager::AsyncManager() : fdWatcher_p_(new AsyncFdWatcher()), taskManager_p_(new AsyncTaskManager()) {}
+AsyncManager::AsyncManager(TimeMode time_mode) : taskManager_p_(new AsyncTaskManager(time_mode)) {
+  std::function<void(bool)> on_idle;
+  if (time_mode == TimeMode::kVirtualTime) {
+    AsyncTaskManager* task_manager = taskManager_p_.get();
+    on_idle = [task_manager](bool idle) { task_manager->SetFdWatcherIdle(idle); };
+  }
+  fdWatcher_p_.reset(new AsyncFdWatcher(on_idle));
+}
 
 AsyncManager::~AsyncManager() {
   // Make sure the threads are stopped before destroying the object.
@@ -22,6 +22,19 @@ using CriticalCallback = std::function<void(void)>;
 using AsyncTaskId = uint16_t;
 constexpr uint16_t kInvalidTaskId = 0;
 
+// The clock the tasks are scheduled on. In real time it is the steady clock.
+// In virtual time it stands still while there is work to do, and jumps to the
+// time of the next task as soon as no watched file descriptor is ready to be
+// read and no read callback is running, so that hours of simulated time can
+// run in seconds.
+enum class TimeMode { kRealTime, kVirtualTime };
+
+// Returns the time on the clock of the tasks: the virtual time of the
+// AsyncManager running in virtual time, if there is one, or the steady clock.
+// The models read it instead of the steady clock, so that their timings agree
+// with the tasks they schedule.
+std::chrono::steady_clock::time_point Now();
+
 // Manages tasks that should be done in the future. It can watch file
 // descriptors to call a given callback when it is certain that a non-blocking
 // read is possible or can call a callback at a specific time (aproximately) and
@@ -43,6 +56,10 @@ constexpr uint16_t kInvalidTaskId = 0;
 // Synchronize(const CriticalCallback&) member function to execute code inside
 // critical sections. Callbacks passed to this method on the same AsyncManager
 // object from different threads are granted to *NOT* run concurrently.
+// Only one AsyncManager at a time may run in virtual time. Its tasks due at the
+// same time run in the order they were scheduled, so a simulation driven by
+// its own tasks, rather than by other threads or file descriptors, replays
+// identically.
 class AsyncManager {
  public:
   // Starts watching a file descriptor in a separate thread. The
@@ -83,7 +100,7 @@ class AsyncManager {
   // have very simple CriticalCallbacks, preferably using lambda expressions.
   void Synchronize(const CriticalCallback&);
 
-  AsyncManager();
+  explicit AsyncManager(TimeMode time_mode = TimeMode::kRealTime);
 
   ~AsyncManager();
 
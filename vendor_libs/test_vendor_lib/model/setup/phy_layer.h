@@ -24,12 +24,13 @@ namespace test_vendor_lib {
 
 class PhyLayer {
  public:
-  PhyLayer(Phy::Type phy_type, uint32_t id, const std::function<void(packets::LinkLayerPacketView)>& device_receive)
+  PhyLayer(Phy::Type phy_type, uint32_t id,
+           const std::function<void(const packets::LinkLayerPacketView&)>& device_receive)
       : phy_type_(phy_type), id_(id), transmit_to_device_(device_receive) {}
 
   virtual void Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet) = 0;
 
-  virtual void Receive(packets::LinkLayerPacketView packet) = 0;
+  virtual void Receive(const packets::LinkLayerPacketView& packet) = 0;
 
   virtual void TimerTick() = 0;
 
@@ -48,7 +49,7 @@ class PhyLayer {
   uint32_t id_;
 
  protected:
-  const std::function<void(packets::LinkLayerPacketView)> transmit_to_device_;
+  const std::function<void(const packets::LinkLayerPacketView&)> transmit_to_device_;
 };
 
 }  // namespace test_vendor_lib
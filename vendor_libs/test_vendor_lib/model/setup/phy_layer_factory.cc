@@ -18,55 +18,86 @@
 
 #include "phy_layer_factory.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 
 #include "osi/include/log.h"
 
 namespace test_vendor_lib {
 
-PhyLayerFactory::PhyLayerFactory(Phy::Type phy_type) : phy_type_(phy_type) {}
+// The packet types up to SCO, the last one. The others are passed like UNKNOWN.
+static const size_t kPacketTypes = static_cast<size_t>(Link::PacketType::SCO) + 1;
+
+static size_t PacketTypeIndex(Link::PacketType type) {
+  size_t index = static_cast<size_t>(type);
+  return index < kPacketTypes ? index : static_cast<size_t>(Link::PacketType::UNKNOWN);
+}
+
+PhyLayerFactory::PhyLayerFactory(Phy::Type phy_type) : phy_type_(phy_type), receivers_(kPacketTypes) {}
 
 Phy::Type PhyLayerFactory::GetType() {
   return phy_type_;
 }
 
 std::shared_ptr<PhyLayer> PhyLayerFactory::GetPhyLayer(
-    const std::function<void(packets::LinkLayerPacketView)>& device_receive) {
-  std::shared_ptr<PhyLayer> new_phy =
-      std::make_shared<PhyLayerImpl>(phy_type_, next_id_++, device_receive, std::shared_ptr<PhyLayerFactory>(this));
-  phy_layers_.push_back(new_phy);
+    const std::function<void(const packets::LinkLayerPacketView&)>& device_receive,
+    const std::function<bool(Link::PacketType)>& receives) {
+  std::weak_ptr<PhyLayerFactory> factory = weak_from_this();
+  CHECK(!factory.expired()) << "The factory must be owned by a shared pointer";
+  std::shared_ptr<PhyLayer> new_phy = std::make_shared<PhyLayerImpl>(phy_type_, next_id_++, device_receive, factory);
+  phy_layers_.push_back(new_phy.get());
+  for (size_t type = 0; type < kPacketTypes; type++) {
+    if (!receives || receives(static_cast<Link::PacketType>(type))) {
+      receivers_[type].push_back(new_phy.get());
+    }
+  }
   return new_phy;
 }
 
 void PhyLayerFactory::UnregisterPhyLayer(uint32_t id) {
-  for (auto it = phy_layers_.begin(); it != phy_layers_.end();) {
-    if ((*it)->GetId() == id) {
-      it = phy_layers_.erase(it);
+  auto has_id = [id](PhyLayer* phy) { return phy != nullptr && phy->GetId() == id; };
+  phy_layers_.erase(std::remove_if(phy_layers_.begin(), phy_layers_.end(), has_id), phy_layers_.end());
+  for (auto& receivers : receivers_) {
+    if (sending_ > 0) {
+      // Send is going through the receivers by index, leave them in place
+      std::replace_if(receivers.begin(), receivers.end(), has_id, nullptr);
+      unregistered_while_sending_ = true;
     } else {
-      it++;
+      receivers.erase(std::remove_if(receivers.begin(), receivers.end(), has_id), receivers.end());
     }
   }
 }
 
 void PhyLayerFactory::Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet, uint32_t id) {
-  // Convert from a Builder to a View
-  std::shared_ptr<std::vector<uint8_t>> serialized_packet =
-      std::shared_ptr<std::vector<uint8_t>>(new std::vector<uint8_t>());
+  // Convert from a Builder to a View, once for all the receivers
+  std::shared_ptr<std::vector<uint8_t>> serialized_packet = std::make_shared<std::vector<uint8_t>>();
   std::back_insert_iterator<std::vector<uint8_t>> itr(*serialized_packet);
   serialized_packet->reserve(packet->size());
   packet->Serialize(itr);
-  packets::LinkLayerPacketView packet_view = packets::LinkLayerPacketView::Create(serialized_packet);
-
-  for (const auto phy : phy_layers_) {
-    if (id != phy->GetId()) {
-      phy->Receive(packet_view);
+  const packets::LinkLayerPacketView packet_view = packets::LinkLayerPacketView::Create(serialized_packet);
+
+  // By index, as receiving may send other packets and add phy layers. The phy
+  // layers destroyed meanwhile are only blanked out until the last Send ends.
+  const std::vector<PhyLayer*>& receivers = receivers_[PacketTypeIndex(packet_view.GetType())];
+  sending_++;
+  for (size_t i = 0; i < receivers.size(); i++) {
+    PhyLayer* receiver = receivers[i];
+    if (receiver != nullptr && id != receiver->GetId()) {
+      receiver->Receive(packet_view);
+    }
+  }
+  if (--sending_ == 0 && unregistered_while_sending_) {
+    unregistered_while_sending_ = false;
+    for (auto& type_receivers : receivers_) {
+      type_receivers.erase(std::remove(type_receivers.begin(), type_receivers.end(), nullptr), type_receivers.end());
     }
   }
 }
 
 void PhyLayerFactory::TimerTick() {
-  for (auto phy : phy_layers_) {
-    phy->TimerTick();
+  for (size_t i = 0; i < phy_layers_.size(); i++) {
+    phy_layers_[i]->TimerTick();
   }
 }
 
@@ -84,20 +115,25 @@ std::string PhyLayerFactory::ToString() const {
 }
 
 PhyLayerImpl::PhyLayerImpl(Phy::Type phy_type, uint32_t id,
-                           const std::function<void(packets::LinkLayerPacketView)>& device_receive,
-                           const std::shared_ptr<PhyLayerFactory>& factory)
+                           const std::function<void(const packets::LinkLayerPacketView&)>& device_receive,
+                           const std::weak_ptr<PhyLayerFactory>& factory)
     : PhyLayer(phy_type, id, device_receive), factory_(factory) {}
 
 PhyLayerImpl::~PhyLayerImpl() {
-  factory_->UnregisterPhyLayer(GetId());
-  PhyLayer::~PhyLayer();
+  std::shared_ptr<PhyLayerFactory> factory = factory_.lock();
+  if (factory) {
+    factory->UnregisterPhyLayer(GetId());
+  }
 }
 
 void PhyLayerImpl::Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet) {
-  factory_->Send(packet, GetId());
+  std::shared_ptr<PhyLayerFactory> factory = factory_.lock();
+  if (factory) {
+    factory->Send(packet, GetId());
+  }
 }
 
-void PhyLayerImpl::Receive(packets::LinkLayerPacketView packet) {
+void PhyLayerImpl::Receive(const packets::LinkLayerPacketView& packet) {
   transmit_to_device_(packet);
 }
 
@@ -16,9 +16,11 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <vector>
 
+#include "include/link.h"
 #include "include/phy.h"
 #include "packets/link_layer/link_layer_packet_builder.h"
 #include "packets/link_layer/link_layer_packet_view.h"
@@ -26,7 +28,10 @@
 
 namespace test_vendor_lib {
 
-class PhyLayerFactory {
+// Connects the phy layers of the devices sharing a medium. The factory must be
+// owned by a shared pointer; the phy layers it returns are owned by their
+// devices and remove themselves from the factory when destroyed.
+class PhyLayerFactory : public std::enable_shared_from_this<PhyLayerFactory> {
   friend class PhyLayerImpl;
 
  public:
@@ -36,7 +41,13 @@ class PhyLayerFactory {
 
   Phy::Type GetType();
 
-  std::shared_ptr<PhyLayer> GetPhyLayer(const std::function<void(packets::LinkLayerPacketView)>& device_receive);
+  // Returns a phy layer that passes to |device_receive| the packets sent by
+  // the other phy layers. Only the packet types for which |receives| returns
+  // true, when given, are passed, so that the devices that ignore most of the
+  // traffic are not visited for each packet. |receives| is only called here.
+  std::shared_ptr<PhyLayer> GetPhyLayer(
+      const std::function<void(const packets::LinkLayerPacketView&)>& device_receive,
+      const std::function<bool(Link::PacketType)>& receives = nullptr);
 
   void UnregisterPhyLayer(uint32_t id);
 
@@ -49,21 +60,28 @@ class PhyLayerFactory {
 
  private:
   Phy::Type phy_type_;
-  std::vector<std::shared_ptr<PhyLayer>> phy_layers_;
+  std::vector<PhyLayer*> phy_layers_;
+  // The phy layers receiving each packet type, indexed by type
+  std::vector<std::vector<PhyLayer*>> receivers_;
+  // How many Send calls are going through the receivers, and whether phy
+  // layers were unregistered meanwhile, leaving null receivers to erase
+  int sending_{0};
+  bool unregistered_while_sending_{false};
   uint32_t next_id_{1};
 };
 
 class PhyLayerImpl : public PhyLayer {
  public:
-  PhyLayerImpl(Phy::Type phy_type, uint32_t id, const std::function<void(packets::LinkLayerPacketView)>& device_receive,
-               const std::shared_ptr<PhyLayerFactory>& factory);
+  PhyLayerImpl(Phy::Type phy_type, uint32_t id,
+               const std::function<void(const packets::LinkLayerPacketView&)>& device_receive,
+               const std::weak_ptr<PhyLayerFactory>& factory);
   virtual ~PhyLayerImpl() override;
 
   virtual void Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet) override;
-  virtual void Receive(packets::LinkLayerPacketView packet) override;
+  virtual void Receive(const packets::LinkLayerPacketView& packet) override;
   virtual void TimerTick() override;
 
  private:
-  std::shared_ptr<PhyLayerFactory> factory_;
+  std::weak_ptr<PhyLayerFactory> factory_;
 };
 }  // namespace test_vendor_lib
@@ -124,8 +124,9 @@ void TestModel::AddDeviceToPhy(size_t dev_index, size_t phy_index) {
     return;
   }
   std::shared_ptr<Device> dev = devices_[dev_index];
-  dev->RegisterPhyLayer(
-      phys_[phy_index]->GetPhyLayer([dev](packets::LinkLayerPacketView packet) { dev->IncomingPacket(packet); }));
+  dev->RegisterPhyLayer(phys_[phy_index]->GetPhyLayer(
+      [dev](const packets::LinkLayerPacketView& packet) { dev->IncomingPacket(packet); },
+      [dev](Link::PacketType type) { return dev->ReceivesPacketType(type); }));
 }
 
 void TestModel::DelDeviceFromPhy(size_t dev_index, size_t phy_index) {
@@ -16,8 +16,10 @@
 
 #include "model/setup/async_manager.h"
 #include <gtest/gtest.h>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <future>
 #include <vector>
 
 #include <netdb.h>
@@ -168,4 +170,71 @@ TEST_F(AsyncManagerSocketTest, TestMultipleConnections) {
   }
 }
 
+TEST(AsyncManagerVirtualTimeTest, JumpsToTheNextTask) {
+  std::promise<std::chrono::steady_clock::time_point> fired;
+  AsyncManager async_manager(TimeMode::kVirtualTime);
+
+  std::chrono::steady_clock::time_point start = Now();
+  std::chrono::steady_clock::time_point wall_start = std::chrono::steady_clock::now();
+  async_manager.ExecAsync(std::chrono::hours(1), [&fired]() { fired.set_value(Now()); });
+
+  std::future<std::chrono::steady_clock::time_point> future = fired.get_future();
+  ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_EQ(future.get() - start, std::chrono::hours(1));
+  EXPECT_LT(std::chrono::steady_clock::now() - wall_start, std::chrono::minutes(1));
+}
+
+TEST(AsyncManagerVirtualTimeTest, RunsTheTasksInOrder) {
+  int tick = 0;
+  std::vector<int> ticks;
+  std::promise<void> done;
+  AsyncManager async_manager(TimeMode::kVirtualTime);
+
+  // Scheduled from a task, so that the clock does not move meanwhile. The
+  // samples are due at the same times as some ticks, but come after them.
+  async_manager.ExecAsync(std::chrono::milliseconds(0), [&]() {
+    async_manager.ExecAsyncPeriodically(std::chrono::milliseconds(0), std::chrono::milliseconds(10),
+                                        [&tick]() { tick++; });
+    for (int i = 1; i <= 10; i++) {
+      async_manager.ExecAsync(std::chrono::seconds(i), [&ticks, &tick]() { ticks.push_back(tick); });
+    }
+    async_manager.ExecAsync(std::chrono::seconds(10), [&done]() { done.set_value(); });
+  });
+
+  ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  ASSERT_EQ(ticks.size(), 10u);
+  for (int i = 1; i <= 10; i++) {
+    EXPECT_EQ(ticks[i - 1], 100 * i + 1);
+  }
+}
+
+TEST(AsyncManagerVirtualTimeTest, WaitsForTheReadCallbacks) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  std::promise<void> reading;
+  std::promise<void> read_done;
+  std::promise<void> fired;
+  AsyncManager async_manager(TimeMode::kVirtualTime);
+
+  async_manager.WatchFdForNonBlockingReads(fds[0], [&reading, &read_done](int fd) {
+    char buffer;
+    EXPECT_EQ(read(fd, &buffer, 1), 1);
+    reading.set_value();
+    read_done.get_future().wait();
+  });
+  ASSERT_EQ(write(fds[1], "1", 1), 1);
+  reading.get_future().wait();
+
+  async_manager.ExecAsync(std::chrono::hours(1), [&fired]() { fired.set_value(); });
+  std::future<void> future = fired.get_future();
+  EXPECT_EQ(future.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+
+  read_done.set_value();
+  EXPECT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+
+  async_manager.StopWatchingFileDescriptor(fds[0]);
+  close(fds[0]);
+  close(fds[1]);
+}
+
 }  // namespace test_vendor_lib
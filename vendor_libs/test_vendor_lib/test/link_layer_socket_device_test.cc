@@ -59,11 +59,11 @@ class LinkLayerSocketDeviceTest : public ::testing::Test {
   class MockPhyLayer : public PhyLayer {
    public:
     MockPhyLayer(const std::function<void(std::shared_ptr<LinkLayerPacketBuilder>)>& on_receive)
-        : PhyLayer(Phy::Type::LOW_ENERGY, 0, [](LinkLayerPacketView) {}), on_receive_(on_receive) {}
+        : PhyLayer(Phy::Type::LOW_ENERGY, 0, [](const LinkLayerPacketView&) {}), on_receive_(on_receive) {}
     virtual void Send(const std::shared_ptr<LinkLayerPacketBuilder> packet) override {
       on_receive_(packet);
     }
-    virtual void Receive(LinkLayerPacketView) override {}
+    virtual void Receive(const LinkLayerPacketView&) override {}
     virtual void TimerTick() override {}
 
    private:
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "model/devices/beacon.h"
+#include "model/setup/phy_layer_factory.h"
+
+using ::benchmark::State;
+using test_vendor_lib::Beacon;
+using test_vendor_lib::Device;
+using test_vendor_lib::Link;
+using test_vendor_lib::Phy;
+using test_vendor_lib::PhyLayerFactory;
+using test_vendor_lib::packets::LinkLayerPacketView;
+
+namespace {
+
+// Beacons advertising on one LE phy, with a scanner receiving everything.
+// Every iteration each beacon sends one advertisement. Unfiltered, every
+// device receives every packet, the way the phy was before the receivers were
+// split by packet type.
+// Arguments: beacons, filtered.
+void BM_Advertise(State& state) {
+  auto factory = std::make_shared<PhyLayerFactory>(Phy::Type::LOW_ENERGY);
+  bool filtered = state.range(1);
+
+  size_t received = 0;
+  std::shared_ptr<test_vendor_lib::PhyLayer> scanner =
+      factory->GetPhyLayer([&received](const LinkLayerPacketView&) { received++; });
+
+  std::vector<std::shared_ptr<Device>> beacons;
+  for (int i = 0; i < state.range(0); i++) {
+    // The beacons own their phy layers, which must not own the beacons.
+    std::shared_ptr<Device> beacon = Beacon::Create();
+    Device* device = beacon.get();
+    std::function<bool(Link::PacketType)> receives = nullptr;
+    if (filtered) {
+      receives = [device](Link::PacketType type) { return device->ReceivesPacketType(type); };
+    }
+    beacon->RegisterPhyLayer(factory->GetPhyLayer(
+        [device](const LinkLayerPacketView& packet) { device->IncomingPacket(packet); }, receives));
+    beacons.push_back(beacon);
+  }
+
+  for (auto _ : state) {
+    for (auto& beacon : beacons) {
+      beacon->TimerTick();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * beacons.size());
+  state.counters["received"] = received;
+}
+
+// The unfiltered phy takes seconds per iteration past a thousand beacons.
+void Swarms(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"beacons", "filtered"});
+  for (int beacons : {10, 100, 1000}) {
+    b->Args({beacons, 0});
+  }
+  for (int beacons : {10, 100, 1000, 5000}) {
+    b->Args({beacons, 1});
+  }
+}
+
+BENCHMARK(BM_Advertise)->Apply(Swarms);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "model/devices/beacon.h"
+#include "model/setup/phy_layer_factory.h"
+
+using test_vendor_lib::packets::LeAdvertisementBuilder;
+using test_vendor_lib::packets::LinkLayerPacketBuilder;
+using test_vendor_lib::packets::LinkLayerPacketView;
+
+namespace test_vendor_lib {
+
+namespace {
+
+// A device handling every packet type, which records the types it receives
+class RecordingDevice : public Device {
+ public:
+  void Initialize(const std::vector<std::string>&) override {}
+  std::string GetTypeString() const override {
+    return "recording_device";
+  }
+
+  std::vector<Link::PacketType> received_;
+};
+
+class PhyLayerFactoryTest : public ::testing::Test {
+ public:
+  PhyLayerFactoryTest() : factory_(std::make_shared<PhyLayerFactory>(Phy::Type::LOW_ENERGY)) {
+    sender_ = factory_->GetPhyLayer([](const LinkLayerPacketView&) {});
+  }
+
+ protected:
+  // Adds |device| to the phy the way TestModel does, recording the types of
+  // the packets passed to it in |received|.
+  void AddDevice(const std::shared_ptr<Device>& device, std::vector<Link::PacketType>* received) {
+    Device* dev = device.get();
+    dev->RegisterPhyLayer(factory_->GetPhyLayer(
+        [received](const LinkLayerPacketView& packet) { received->push_back(packet.GetType()); },
+        [dev](Link::PacketType type) { return dev->ReceivesPacketType(type); }));
+  }
+
+  void SendLeScan() {
+    sender_->Send(LinkLayerPacketBuilder::WrapLeScan(source_, destination_));
+  }
+
+  void SendLeAdvertisement() {
+    sender_->Send(LinkLayerPacketBuilder::WrapLeAdvertisement(
+        LeAdvertisementBuilder::Create(LeAdvertisement::AddressType::PUBLIC,
+                                       LeAdvertisement::AdvertisementType::ADV_NONCONN_IND, {}),
+        source_));
+  }
+
+  std::shared_ptr<PhyLayerFactory> factory_;
+  std::shared_ptr<PhyLayer> sender_;
+  Address source_{{0x01, 0x02, 0x03, 0x04, 0x05, 0x06}};
+  Address destination_{{0x11, 0x12, 0x13, 0x14, 0x15, 0x16}};
+};
+
+TEST_F(PhyLayerFactoryTest, ReceiversByPacketType) {
+  std::shared_ptr<Device> beacon = Beacon::Create();
+  std::vector<Link::PacketType> beacon_received;
+  AddDevice(beacon, &beacon_received);
+  auto device = std::make_shared<RecordingDevice>();
+  AddDevice(device, &device->received_);
+
+  SendLeScan();
+  SendLeAdvertisement();
+
+  EXPECT_EQ(std::vector<Link::PacketType>({Link::PacketType::LE_SCAN}), beacon_received);
+  EXPECT_EQ(std::vector<Link::PacketType>({Link::PacketType::LE_SCAN, Link::PacketType::LE_ADVERTISEMENT}),
+            device->received_);
+}
+
+TEST_F(PhyLayerFactoryTest, ReceiverDestroyedWhileSending) {
+  size_t received[3] = {0, 0, 0};
+  std::shared_ptr<PhyLayer> first = factory_->GetPhyLayer([&received](const LinkLayerPacketView&) { received[0]++; });
+  // The second receiver destroys the first one, which comes before it
+  std::shared_ptr<PhyLayer> second = factory_->GetPhyLayer([&received, &first](const LinkLayerPacketView&) {
+    received[1]++;
+    first.reset();
+  });
+  std::shared_ptr<PhyLayer> third = factory_->GetPhyLayer([&received](const LinkLayerPacketView&) { received[2]++; });
+
+  SendLeScan();
+  EXPECT_EQ(1u, received[0]);
+  EXPECT_EQ(1u, received[1]);
+  EXPECT_EQ(1u, received[2]);
+
+  SendLeScan();
+  EXPECT_EQ(1u, received[0]);
+  EXPECT_EQ(2u, received[1]);
+  EXPECT_EQ(2u, received[2]);
+}
+
+}  // namespace
+
+}  // namespace test_vendor_lib